@@ -32,6 +32,7 @@
 #include <QDir>
 #include <QProgressBar>
 #include <QMap>
+#include <QHash>
 #include <QPair>
 #include <QAudioInput>
 #include <QAudioFormat>
@@ -196,19 +197,27 @@ public:
         }*/
     }
 
+    // 群通知按 id 显示：新的 id 追加一条消息，已显示过的 id（已读、撤回等状态更新）只改原消息的内容
     void setNoticeMsg(QList<Notification> listNoticeMsg)
     {
         UserInfo userInfo = CommonInfo::GetData();
         for (auto iter : listNoticeMsg)
         {
-            if (QString::number(iter.sender_id) == userInfo.teacher_unique_id)
+            auto shown = m_noticeMessages.find(iter.id);
+            if (shown != m_noticeMessages.end())
             {
-                addTextMessage(":/res/img/home.png", iter.sender_name, iter.content, true);
-            }
-            else
-            {
-                addTextMessage(":/res/img/home.png", iter.sender_name, iter.content, false);
+                if (shown->label->text() != iter.content)
+                {
+                    shown->label->setText(iter.content);
+                    shown->item->setSizeHint(m_listWidget->itemWidget(shown->item)->sizeHint());
+                }
+                continue;
             }
+
+            bool isMine = QString::number(iter.sender_id) == userInfo.teacher_unique_id;
+            QLabel* lblMessage = addTextMessage(":/res/img/home.png", iter.sender_name, iter.content, isMine);
+            NoticeMessage notice = { m_listWidget->item(m_listWidget->count() - 1), lblMessage };
+            m_noticeMessages.insert(iter.id, notice);
         }
     }
     
@@ -627,6 +636,14 @@ private:
     QLineEdit* m_lineEdit;
     ChatMessage m_lastMessage;
     bool m_hasLastMessage = false;
+
+    // 已显示的群通知，按通知 id；消息列表只追加不删除，指针一直有效
+    struct NoticeMessage
+    {
+        QListWidgetItem* item;
+        QLabel* label;
+    };
+    QHash<int, NoticeMessage> m_noticeMessages;
     
     // 实时录音相关
     QAudioInput* m_audioInput = nullptr;
@@ -718,7 +735,7 @@ private:
     }
 
 
-    void addTextMessage(const QString& avatarPath, const QString& senderName, const QString& text, bool isMine)
+    QLabel* addTextMessage(const QString& avatarPath, const QString& senderName, const QString& text, bool isMine)
     {
         QDateTime now = QDateTime::currentDateTime();
         if (!m_hasLastMessage || m_lastMessage.time.secsTo(now) > 180) addTimeLabel(now);
@@ -738,6 +755,7 @@ private:
         m_lastMessage = { avatarPath, senderName, text, isMine, now };
         m_hasLastMessage = true;
         m_listWidget->scrollToBottom();
+        return lblMessage;
     }
 
     void addImageMessage(const QString& avatarPath, const QString& senderName, const QString& imgPath, bool isMine)
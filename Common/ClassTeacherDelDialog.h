@@ -15,6 +15,8 @@
 #include "TAHttpHandler.h"
 #include "CommonInfo.h"
 #include "TaQTWebSocket.h"
+#include "TaMessageBus.h"
+#include "TaEndpoints.h"
 
 class ClassTeacherDelDialog : public QDialog
 {
@@ -151,7 +153,7 @@ public:
         {
             //QMap<QString, QString> params;
             //params["id_card"] = "320506197910016493";
-            QString url = "http://47.100.126.194:5000/friends?";
+            QString url = TaEndpoints::url("/friends?");
             url += "id_card=";
             url += "320506197910016493";
             m_httpHandler->get(url);
@@ -235,7 +237,8 @@ public:
 
     QVector<QString> getNoticeMsg()
     {
-        return m_NoticeMsg;
+        // 通知由消息总线统一保存（有上限），不再在各对话框里各存一份
+        return TaMessageBus::noticeMsg();
     }
 
     // 辅助函数：为 ScheduleDialog 建立群聊退出信号连接
@@ -259,11 +262,6 @@ public:
     void InitWebSocket()
     {
         TaQTWebSocket::regRecvDlg(this);
-        if (m_pWs)
-        {
-            connect(m_pWs, &TaQTWebSocket::newMessage,
-                this, &ClassTeacherDelDialog::onWebSocketMessage);
-        }
 
         //socket = new QWebSocket();
         //connect(socket, &QWebSocket::connected, this, &ClassTeacherDelDialog::onConnected);
@@ -317,32 +315,6 @@ private:
         parentLayout->addWidget(rowWidget);
     }
     private slots:
-        // ChatDialog.cpp
-        void onWebSocketMessage(const QString& msg)
-        {
-            qDebug() << " ClassTeacherDelDialog msg:" << msg; // 发信号;
-            // 这里可以解析 JSON 或直接追加到聊天窗口
-            //addTextMessage(":/avatar_teacher.png", "对方", msg, false);
-            m_NoticeMsg.push_back(msg);
-            if (m_scheduleDlg)
-            {
-                QJsonParseError parseError;
-                QJsonDocument doc = QJsonDocument::fromJson(msg.toUtf8(), &parseError);
-                if (parseError.error != QJsonParseError::NoError) {
-                    qDebug() << "JSON parse error:" << parseError.errorString();
-                }
-                else {
-                    if (doc.isObject()) {
-                        QJsonObject obj = doc.object();
-                        if (obj["type"].toString() == 3)
-                        {
-                            obj["group_id"].toString();
-                        }
-                    }
-                }
-            }
-        }
-
         void onConnected() {
             //logView->append("✅ 已连接到服务端");
         }
@@ -352,7 +324,7 @@ private:
             if (0 != msg.compare("pong") && 0 == msg.contains("不在线"))
             {
                 //QMessageBox::information(NULL, "提示", msg);
-                m_NoticeMsg.push_back(msg);
+                TaMessageBus::publish(msg);
             }
         }
 
@@ -436,16 +408,8 @@ private:
             members.append(m1);
             createGroupMsg["members"] = members;
 
-            // 用 QJsonDocument 序列化
-            QJsonDocument doc(createGroupMsg);
-            // 输出美化格式（有缩进）
-            QString prettyString = QString::fromUtf8(doc.toJson(QJsonDocument::Indented));
-            qDebug() << "美化格式:" << prettyString;
-
-            if (!prettyString.isEmpty()) {
-            	//socket->sendTextMessage(QString("to:%1:%2").arg(teacher_unique_id, prettyString));
-                TaQTWebSocket::sendPrivateMessage(QString("to:%1:%2").arg(teacher_unique_id, prettyString));
-            }
+            // 紧凑 JSON 或二进制控制帧，由 TaQTWebSocket 按当前封包模式决定
+            TaQTWebSocket::sendControlMessage(teacher_unique_id, createGroupMsg);
         }
 
         //void sendPrivateMessage() {
@@ -494,6 +458,5 @@ private:
     //QTimer* heartbeatTimer;
     QPushButton* btnOk = NULL;
     QPushButton* btnCancel = NULL;
-    QVector<QString> m_NoticeMsg;
     TaQTWebSocket* m_pWs = NULL;
 };
@@ -14,6 +14,7 @@
 #include "TAHttpHandler.h"
 #include "CommonInfo.h"
 #include "TaQTWebSocket.h"
+#include "TaMessageBus.h"
 #include "ImSDK/includes/TIMCloud.h"
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -25,6 +26,8 @@
 #include <QUrl>
 #include <QUrlQuery>
 #include <QMetaObject>
+#include "TaEndpoints.h"
+#include "TaGroupSync.h"
 
 class ClassTeacherDialog : public QDialog
 {
@@ -232,7 +235,7 @@ public:
         UserInfo userInfo = CommonInfo::GetData();
         if (m_httpHandler)
         {
-            QString url = "http://47.100.126.194:5000/friends?";
+            QString url = TaEndpoints::url("/friends?");
             url += "id_card=";
             url += userInfo.strIdNumber;
             m_httpHandler->get(url);
@@ -247,7 +250,8 @@ public:
 
     QVector<QString> getNoticeMsg()
     {
-        return m_NoticeMsg;
+        // 通知由消息总线统一保存（有上限），不再在各对话框里各存一份
+        return TaMessageBus::noticeMsg();
     }
 
     //// 辅助函数：为 ScheduleDialog 建立群聊退出信号连接
@@ -271,11 +275,6 @@ public:
     void InitWebSocket()
     {
         TaQTWebSocket::regRecvDlg(this);
-        if (m_pWs)
-        {
-            connect(m_pWs, &TaQTWebSocket::newMessage,
-                this, &ClassTeacherDialog::onWebSocketMessage);
-        }
 
         //socket = new QWebSocket();
         //connect(socket, &QWebSocket::connected, this, &ClassTeacherDialog::onConnected);
@@ -325,7 +324,7 @@ private:
         QByteArray reqData = doc.toJson(QJsonDocument::Compact);
 
         QNetworkAccessManager* manager = new QNetworkAccessManager(this);
-        QNetworkRequest request(QUrl("http://47.100.126.194:5000/getClassesByPrefix"));
+        QNetworkRequest request(QUrl(TaEndpoints::url("/getClassesByPrefix")));
         request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
         QNetworkReply* reply = manager->post(request, reqData);
         connect(reply, &QNetworkReply::finished, this, [this, reply]() {
@@ -400,16 +399,6 @@ private:
         parentLayout->addWidget(rowWidget);
     }
     private slots:
-        // ChatDialog.cpp
-        void onWebSocketMessage(const QString& msg)
-        {
-            qDebug() << " ClassTeacherDialog msg:" << msg; // 发信号;
-            // 这里可以解析 JSON 或直接追加到聊天窗口
-            //addTextMessage(":/avatar_teacher.png", "对方", msg, false);
-            m_NoticeMsg.push_back(msg);
-            // m_scheduleDlg 已移至 FriendGroupDialog 中管理，通知处理移至 FriendGroupDialog
-        }
-
         void onConnected() {
             //logView->append("✅ 已连接到服务端");
         }
@@ -419,7 +408,7 @@ private:
             if (0 != msg.compare("pong") && 0 == msg.contains("不在线"))
             {
                 //QMessageBox::information(NULL, "提示", msg);
-                m_NoticeMsg.push_back(msg);
+                TaMessageBus::publish(msg);
             }
         }
 
@@ -894,48 +883,22 @@ private:
         
         groupObj["member_info"] = memberInfo;
         
-        // 构造groups数组（当前用户/群主）
-        QJsonArray groupsArray;
-        groupsArray.append(groupObj);
-        
-        // 构造最终的上传JSON（当前用户/群主）
-        QJsonObject uploadData;
-        uploadData["user_id"] = userinfo.teacher_unique_id; // 当前用户的ID（群主）
-        uploadData["groups"] = groupsArray;
-        
-        // 转换为JSON字符串
-        QJsonDocument uploadDoc(uploadData);
-        QByteArray jsonData = uploadDoc.toJson(QJsonDocument::Compact);
-        
-        // 上传当前用户（群主）的群组信息到服务器
-        QString url = "http://47.100.126.194:5000/groups/sync";
-        
-        // 创建一个临时连接来处理群组上传的响应
-        // 使用 QPointer 来安全地管理连接，避免悬空指针
+        // 上传当前用户（群主）的群组信息到服务器，由同步引擎合并、重试
+        // 使用 QPointer 来安全地管理回调，对话框关闭后不再发信号
         QPointer<ClassTeacherDialog> self = this;
-        QMetaObject::Connection* conn = new QMetaObject::Connection;
-        *conn = connect(m_httpHandler, &TAHttpHandler::success, this, [=](const QString& responseString) {
-            // 检查响应是否包含群组信息（通过检查是否包含 "groups" 或 "group_id" 来判断）
-            // 这里简单判断：如果响应包含我们上传的 groupId，就认为是群组上传的响应
-            if (responseString.contains(groupId) || responseString.contains("\"code\":200") || responseString.contains("\"code\": 200")) {
-                qDebug() << "群组信息上传成功，响应:" << responseString;
-                
-                // 断开临时连接
-                if (conn && *conn) {
-                    disconnect(*conn);
-                    delete conn;
-                }
-                
-                // 发出群组创建成功信号，通知父窗口刷新群列表
-                if (self) {
-                    emit self->groupCreated(groupId);
-                }
+        TaGroupSync::instance()->syncGroup(userinfo.teacher_unique_id, groupObj, [=](bool ok) {
+            if (!ok) {
+                qWarning() << "群组信息上传失败，群组ID:" << groupId;
+                return;
             }
-        }, Qt::UniqueConnection);
-        
-        m_httpHandler->post(url, jsonData);
+            qDebug() << "群组信息上传成功，群组ID:" << groupId;
+            
+            // 发出群组创建成功信号，通知父窗口刷新群列表
+            if (self) {
+                emit self->groupCreated(groupId);
+            }
+        });
         qDebug() << "上传群主群组信息到服务器，群组ID:" << groupId;
-        qDebug() << "上传JSON:" << QString::fromUtf8(jsonData);
         
         // 如果有被邀请的成员，也需要为被邀请的成员创建群组信息并上传
         // 暂时注释掉，因为创建群组时不添加被邀请成员
@@ -957,23 +920,9 @@ private:
             
             invitedGroupObj["member_info"] = invitedMemberInfo;
             
-            // 构造被邀请成员的groups数组
-            QJsonArray invitedGroupsArray;
-            invitedGroupsArray.append(invitedGroupObj);
-            
-            // 构造被邀请成员的上传JSON
-            QJsonObject invitedUploadData;
-            invitedUploadData["user_id"] = teacherUniqueId; // 被邀请成员的ID
-            invitedUploadData["groups"] = invitedGroupsArray;
-            
-            // 转换为JSON字符串
-            QJsonDocument invitedUploadDoc(invitedUploadData);
-            QByteArray invitedJsonData = invitedUploadDoc.toJson(QJsonDocument::Compact);
-            
             // 上传被邀请成员的群组信息到服务器
-            m_httpHandler->post(url, invitedJsonData);
+            TaGroupSync::instance()->syncGroup(teacherUniqueId, invitedGroupObj);
             qDebug() << "上传被邀请成员群组信息到服务器，群组ID:" << groupId << "，成员ID:" << teacherUniqueId;
-            qDebug() << "上传JSON:" << QString::fromUtf8(invitedJsonData);
         }
         */
     }
@@ -989,6 +938,5 @@ private:
     //QTimer* heartbeatTimer;
     QPushButton* btnOk = NULL;
     QPushButton* btnCancel = NULL;
-    QVector<QString> m_NoticeMsg;
     TaQTWebSocket* m_pWs = NULL;
 };
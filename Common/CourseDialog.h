@@ -11,6 +11,7 @@
 #include <QJsonArray>
 #include "CourseTableWidget.h"
 #include "TAHttpHandler.h"
+#include "TaEndpoints.h"
 
 class CourseDialog : public QDialog
 {
@@ -189,7 +190,7 @@ private slots:
         const QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
 
         // 4) 发送到服务器（使用提供的保存接口）
-        const QString url = QStringLiteral("http://47.100.126.194:5000/course-schedule/save");
+        const QString url = TaEndpoints::url("/course-schedule/save");
         if (m_httpHandler)
         {
             m_httpHandler->post(url, jsonData);
@@ -12,9 +12,11 @@
 #include <QIODevice>
 #include <QFileInfo>
 #include <QTimer>
+#include <QProgressDialog>
+#include <QDebug>
 #include "MidtermGradeDialog.h"
 #include "StudentPhysiqueDialog.h"
-#include "xlsxdocument.h"
+#include "TaImportPipeline.h"
 
 class CustomListDialog : public QDialog
 {
@@ -75,11 +77,22 @@ public:
 
         // 连接"+"按钮点击事件，导入Excel表格
         connect(btnAdd, &QPushButton::clicked, this, &CustomListDialog::onImportExcel);
+
+        // 导入在后台线程读取和解析，数据行分批送回来填表
+        m_importPipeline = new TaImportPipeline(this);
+        connect(m_importPipeline, &TaImportPipeline::tableDetected, this, &CustomListDialog::onImportTableDetected);
+        connect(m_importPipeline, &TaImportPipeline::rowsReady, this, &CustomListDialog::onImportRowsReady);
+        connect(m_importPipeline, &TaImportPipeline::progress, this, &CustomListDialog::onImportProgress);
+        connect(m_importPipeline, &TaImportPipeline::finished, this, &CustomListDialog::onImportFinished);
     }
 
 private slots:
     void onImportExcel()
     {
+        if (m_importPipeline->isRunning()) {
+            return;
+        }
+
         QString fileName = QFileDialog::getOpenFileName(
             this,
             "导入表格文件",
@@ -91,287 +104,142 @@ private slots:
             return;
         }
 
-        // 检查文件扩展名
-        QFileInfo fileInfo(fileName);
-        QString suffix = fileInfo.suffix().toLower();
-        
-        QStringList headers;
-        QList<QStringList> dataRows;
-        
-        // 根据文件类型读取数据
-        if (suffix == "xlsx" || suffix == "xls") {
-            // 读取 Excel 文件
-            if (!readExcelFile(fileName, headers, dataRows)) {
-                QMessageBox::critical(this, "错误", "无法读取 Excel 文件！");
-                return;
-            }
-        } else if (suffix == "csv") {
-            // 读取 CSV 文件
-            if (!readCSVFile(fileName, headers, dataRows)) {
-                QMessageBox::critical(this, "错误", "无法读取 CSV 文件！");
-                return;
-            }
-        } else {
-            QMessageBox::warning(this, "提示", "不支持的文件格式！\n请选择 Excel (*.xlsx, *.xls) 或 CSV (*.csv) 文件。");
-            return;
-        }
-        
-        if (headers.isEmpty()) {
-            QMessageBox::warning(this, "提示", "文件为空或格式不正确！");
-            return;
-        }
-        
-        // 判断表格类型
-        bool isMidtermGrade = false; // 期中成绩单
-        bool isStudentPhysique = false; // 学生体质统计表
-        
-        // 检查是否是期中成绩单（包含：学号、姓名、语文、数学、英语、总分）
-        if (headers.contains("学号") && headers.contains("姓名") && 
-            headers.contains("语文") && headers.contains("数学") && 
-            headers.contains("英语") && headers.contains("总分") &&
-            !headers.contains("小组")) {
-            isMidtermGrade = true;
+        m_importSuffix = QFileInfo(fileName).suffix().toLower();
+        m_importKind = TaImportPipeline::UnknownTable;
+
+        // 进度框：读取超过 500ms 才弹出，可以取消
+        if (!m_importProgress) {
+            m_importProgress = new QProgressDialog(this);
+            m_importProgress->setWindowTitle("导入表格");
+            m_importProgress->setCancelButtonText("取消");
+            m_importProgress->setWindowModality(Qt::WindowModal);
+            m_importProgress->setMinimumDuration(500);
+            m_importProgress->setAutoClose(false);
+            m_importProgress->setAutoReset(false);
+            connect(m_importProgress, &QProgressDialog::canceled, m_importPipeline, &TaImportPipeline::cancel);
         }
-        // 检查是否是学生体质统计表（包含：小组、学号、姓名等）
-        else if (headers.contains("小组") && headers.contains("学号") && 
-                 headers.contains("姓名") && headers.contains("小组总分")) {
-            isStudentPhysique = true;
+        m_importProgress->setLabelText("正在读取表格...");
+        m_importProgress->setRange(0, 100);
+        m_importProgress->setValue(0);
+
+        m_importPipeline->start(fileName);
+    }
+
+    void onImportProgress(int percent)
+    {
+        if (!m_importProgress) return;
+
+        if (percent < 0) {
+            m_importProgress->setRange(0, 0); // 无法估计进度，显示忙碌
+        } else {
+            m_importProgress->setRange(0, 100);
+            m_importProgress->setValue(percent);
         }
+    }
 
-        // 根据表格类型导入数据
-        if (isMidtermGrade) {
+    // 识别出表格类型后先清空目标表格并显示，之后的数据行边收边填
+    void onImportTableDetected(int kind, const QStringList& headers)
+    {
+        m_importKind = kind;
+        if (kind == TaImportPipeline::MidtermGradeTable) {
             if (!m_midtermGradeDlg) {
                 m_midtermGradeDlg = new MidtermGradeDialog(m_classid, this);
             }
-            m_midtermGradeDlg->importData(headers, dataRows);
-            
-            QMessageBox::information(this, "导入成功", 
-                QString("已成功导入期中成绩单！\n共%1行数据。").arg(dataRows.size()));
-            
+            m_midtermGradeDlg->beginImport(headers);
             m_midtermGradeDlg->show();
-            
-            // 延迟询问是否立即上传（等待对话框显示完成）
-            QTimer::singleShot(300, this, [=]() {
-                QMessageBox msgBox(m_midtermGradeDlg);
-                msgBox.setWindowTitle("上传确认");
-                msgBox.setText("是否立即上传到服务器？");
-                msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-                msgBox.setDefaultButton(QMessageBox::Yes);
-                msgBox.button(QMessageBox::Yes)->setText("立即上传");
-                msgBox.button(QMessageBox::No)->setText("稍后上传");
-                
-                int ret = msgBox.exec();
-                if (ret == QMessageBox::Yes) {
-                    // 直接调用上传方法
-                    QMetaObject::invokeMethod(m_midtermGradeDlg, "onUpload", Qt::QueuedConnection);
-                }
-            });
-        } else if (isStudentPhysique) {
+        } else if (kind == TaImportPipeline::StudentPhysiqueTable) {
             if (!m_studentPhysiqueDlg) {
                 m_studentPhysiqueDlg = new StudentPhysiqueDialog(this);
             }
-            m_studentPhysiqueDlg->importData(headers, dataRows);
-            
-            QMessageBox::information(this, "导入成功", 
-                QString("已成功导入学生体质统计表！\n共%1行数据。").arg(dataRows.size()));
-            
+            m_studentPhysiqueDlg->beginImport(headers);
             m_studentPhysiqueDlg->show();
-            
-            // 延迟询问是否立即上传（等待对话框显示完成）
-            QTimer::singleShot(300, this, [=]() {
-                QMessageBox msgBox(m_studentPhysiqueDlg);
-                msgBox.setWindowTitle("上传确认");
-                msgBox.setText("是否立即上传到服务器？");
-                msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-                msgBox.setDefaultButton(QMessageBox::Yes);
-                msgBox.button(QMessageBox::Yes)->setText("立即上传");
-                msgBox.button(QMessageBox::No)->setText("稍后上传");
-                
-                int ret = msgBox.exec();
-                if (ret == QMessageBox::Yes) {
-                    // 直接调用上传方法
-                    QMetaObject::invokeMethod(m_studentPhysiqueDlg, "onUpload", Qt::QueuedConnection);
-                }
-            });
-        } else {
-            QMessageBox::warning(this, "提示", 
-                "无法识别表格类型！\n\n"
-                "期中成绩单应包含：学号、姓名、语文、数学、英语、总分\n"
-                "学生体质统计表应包含：小组、学号、姓名、小组总分\n\n"
-                "请确保文件格式正确，列名匹配上述要求。");
+        }
+        if (m_importProgress) {
+            m_importProgress->setLabelText("正在导入数据...");
         }
     }
 
-private:
-    // 读取 Excel 文件
-    bool readExcelFile(const QString& fileName, QStringList& headers, QList<QStringList>& dataRows)
+    void onImportRowsReady(const QList<QStringList>& rows)
     {
-        using namespace QXlsx;
-        
-        // 检查文件是否存在
-        if (!QFile::exists(fileName)) {
-            return false;
+        if (m_importKind == TaImportPipeline::MidtermGradeTable) {
+            m_midtermGradeDlg->appendImportRows(rows);
+        } else if (m_importKind == TaImportPipeline::StudentPhysiqueTable) {
+            m_studentPhysiqueDlg->appendImportRows(rows);
         }
-        
-        Document xlsx(fileName);
-        
-        // 读取第一行作为表头
-        int col = 1;
-        headers.clear();
-        while (true) {
-            QVariant cellValue = xlsx.read(1, col);
-            if (cellValue.isNull()) {
-                // 如果第一列就是空的，可能是文件格式问题
-                if (col == 1) {
-                    return false;
-                }
-                break;
-            }
-            QString cellText = cellValue.toString().trimmed();
-            if (cellText.isEmpty() && col > 1) {
-                // 遇到空列，停止读取表头
-                break;
-            }
-            headers.append(cellText);
-            ++col;
-            // 限制最大列数，防止无限循环
-            if (col > 1000) {
-                break;
-            }
-        }
-        
-        if (headers.isEmpty()) {
-            return false;
-        }
-        
-        // 读取数据行（从第2行开始）
-        dataRows.clear();
-        int row = 2;
-        int maxRows = 10000; // 限制最大行数，防止无限循环
-        
-        while (row <= maxRows) {
-            QStringList rowData;
-            bool hasData = false;
-            
-            for (int c = 1; c <= headers.size(); ++c) {
-                QVariant cellValue = xlsx.read(row, c);
-                QString cellText = cellValue.isNull() ? "" : cellValue.toString().trimmed();
-                rowData.append(cellText);
-                if (!cellText.isEmpty()) {
-                    hasData = true;
-                }
-            }
-            
-            if (!hasData) {
-                // 连续遇到空行，停止读取（最多检查3行）
-                bool allEmpty = true;
-                for (int checkRow = row; checkRow < row + 3 && checkRow <= maxRows; ++checkRow) {
-                    for (int c = 1; c <= headers.size(); ++c) {
-                        QVariant cellValue = xlsx.read(checkRow, c);
-                        if (!cellValue.isNull() && !cellValue.toString().trimmed().isEmpty()) {
-                            allEmpty = false;
-                            break;
-                        }
-                    }
-                    if (!allEmpty) break;
-                }
-                if (allEmpty) {
-                    break; // 确实都是空行，停止读取
-                }
-            }
-            
-            dataRows.append(rowData);
-            ++row;
-        }
-        
-        return true;
     }
-    
-    // 读取 CSV 文件
-    bool readCSVFile(const QString& fileName, QStringList& headers, QList<QStringList>& dataRows)
+
+    void onImportFinished(int error, int rowCount)
     {
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            return false;
+        if (m_importProgress) {
+            m_importProgress->reset();
+            m_importProgress->hide();
         }
 
-        QTextStream in(&file);
-        in.setCodec("UTF-8");
-        
-        QString content = in.readAll();
-        if (content.startsWith("\xEF\xBB\xBF")) {
-            content = content.mid(3);
+        // 已经开始填表的话，无论成功还是取消都收尾（合并小组、计算总分）
+        QDialog* targetDlg = nullptr;
+        QString tableName;
+        if (m_importKind == TaImportPipeline::MidtermGradeTable) {
+            m_midtermGradeDlg->finishImport();
+            targetDlg = m_midtermGradeDlg;
+            tableName = "期中成绩单";
+        } else if (m_importKind == TaImportPipeline::StudentPhysiqueTable) {
+            m_studentPhysiqueDlg->finishImport();
+            targetDlg = m_studentPhysiqueDlg;
+            tableName = "学生体质统计表";
         }
-        
-        // 解析 CSV 内容（处理引号和逗号）
-        QStringList lines;
-        QString currentLine;
-        bool inQuotes = false;
-        
-        for (int i = 0; i < content.length(); ++i) {
-            QChar c = content[i];
-            if (c == '"') {
-                inQuotes = !inQuotes;
-                currentLine += c;
-            } else if (c == '\n' && !inQuotes) {
-                if (!currentLine.isEmpty()) {
-                    lines.append(currentLine);
-                }
-                currentLine.clear();
-            } else {
-                currentLine += c;
+        m_importKind = TaImportPipeline::UnknownTable;
+
+        switch (error) {
+        case TaImportPipeline::NoError:
+            break;
+        case TaImportPipeline::Canceled:
+            if (targetDlg) {
+                QMessageBox::information(this, "提示", QString("已取消导入。\n已导入%1行数据。").arg(rowCount));
             }
+            return;
+        case TaImportPipeline::UnsupportedFormat:
+            QMessageBox::warning(this, "提示", "不支持的文件格式！\n请选择 Excel (*.xlsx, *.xls) 或 CSV (*.csv) 文件。");
+            return;
+        case TaImportPipeline::ReadFailed:
+            QMessageBox::critical(this, "错误", m_importSuffix == "csv" ? "无法读取 CSV 文件！" : "无法读取 Excel 文件！");
+            return;
+        case TaImportPipeline::EmptyTable:
+            QMessageBox::warning(this, "提示", "文件为空或格式不正确！");
+            return;
+        default:
+            QMessageBox::warning(this, "提示", 
+                "无法识别表格类型！\n\n"
+                "期中成绩单应包含：学号、姓名、语文、数学、英语、总分\n"
+                "学生体质统计表应包含：小组、学号、姓名、小组总分\n\n"
+                "请确保文件格式正确，列名匹配上述要求。");
+            return;
         }
-        if (!currentLine.isEmpty()) {
-            lines.append(currentLine);
-        }
-        
-        if (lines.isEmpty()) {
-            file.close();
-            return false;
+
+        if (!targetDlg) {
+            return;
         }
 
-        // 解析 CSV 行的辅助函数
-        auto parseCSVLine = [](const QString& line) -> QStringList {
-            QStringList fields;
-            QString currentField;
-            bool inQuotes = false;
+        QMessageBox::information(this, "导入成功", 
+            QString("已成功导入%1！\n共%2行数据。").arg(tableName).arg(rowCount));
+
+        targetDlg->show();
+
+        // 延迟询问是否立即上传（等待对话框显示完成）
+        QTimer::singleShot(300, this, [=]() {
+            QMessageBox msgBox(targetDlg);
+            msgBox.setWindowTitle("上传确认");
+            msgBox.setText("是否立即上传到服务器？");
+            msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+            msgBox.setDefaultButton(QMessageBox::Yes);
+            msgBox.button(QMessageBox::Yes)->setText("立即上传");
+            msgBox.button(QMessageBox::No)->setText("稍后上传");
             
-            for (int i = 0; i < line.length(); ++i) {
-                QChar c = line[i];
-                if (c == '"') {
-                    if (i + 1 < line.length() && line[i + 1] == '"') {
-                        // 双引号转义
-                        currentField += '"';
-                        ++i;
-                    } else {
-                        inQuotes = !inQuotes;
-                    }
-                } else if (c == ',' && !inQuotes) {
-                    fields.append(currentField.trimmed());
-                    currentField.clear();
-                } else {
-                    currentField += c;
-                }
+            int ret = msgBox.exec();
+            if (ret == QMessageBox::Yes) {
+                // 直接调用上传方法
+                QMetaObject::invokeMethod(targetDlg, "onUpload", Qt::QueuedConnection);
             }
-            fields.append(currentField.trimmed()); // 添加最后一个字段
-            return fields;
-        };
-        
-        // 读取表头
-        headers = parseCSVLine(lines[0]);
-        
-        // 读取数据行
-        dataRows.clear();
-        for (int i = 1; i < lines.size(); ++i) {
-            QStringList fields = parseCSVLine(lines[i]);
-            if (!fields.isEmpty() && !fields[0].trimmed().isEmpty()) { // 跳过空行
-                dataRows.append(fields);
-            }
-        }
-        
-        file.close();
-        return true;
+        });
     }
 
 private:
@@ -405,4 +273,8 @@ private:
     MidtermGradeDialog* m_midtermGradeDlg = nullptr;
     StudentPhysiqueDialog* m_studentPhysiqueDlg = nullptr;
     QString m_classid;
+    TaImportPipeline* m_importPipeline = nullptr;
+    QProgressDialog* m_importProgress = nullptr;
+    int m_importKind = TaImportPipeline::UnknownTable; // 正在填的表格
+    QString m_importSuffix;
 };
@@ -0,0 +1,596 @@
+#include "ExamTrendDialog.h"
+#include "HeatmapTypes.h"
+#include <QPainter>
+#include <QResizeEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QToolTip>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QtConcurrent>
+#include <QtNumeric>
+#include <cmath>
+
+TaExamHeatmapView::TaExamHeatmapView(QWidget* parent)
+    : QWidget(parent)
+    , m_rowHeight(kMaxRowHeight)
+    , m_scroll(0)
+    , m_dragging(false)
+    , m_dragScroll(0)
+    , m_cacheDirty(true)
+{
+    setMouseTracking(true);
+    setMinimumSize(400, 300);
+
+    m_gradientLut.resize(256);
+    for (int i = 0; i < 256; ++i) {
+        m_gradientLut[i] = heatmapGradientColor(i / 255.0);
+    }
+}
+
+void TaExamHeatmapView::setData(const TaExamStore& store, const TaExamAnalysis& analysis)
+{
+    m_store = store;
+    m_analysis = analysis;
+    buildLevels();
+
+    // 默认整张表放得下
+    m_rowHeight = fitRowHeight();
+    setScroll(0);
+}
+
+void TaExamHeatmapView::buildLevels()
+{
+    m_levels.clear();
+
+    const QVector<int>& order = m_analysis.rowOrder();
+    int exams = m_analysis.examCount();
+    int subject = m_analysis.subject();
+    if (order.isEmpty() || exams == 0 || subject < 0) return;
+
+    // 第 0 层每行一个学生
+    Level base;
+    base.bands = order.size();
+    base.sums.fill(0, base.bands * exams);
+    base.counts.fill(0, base.bands * exams);
+    for (int row = 0; row < order.size(); ++row) {
+        for (int exam = 0; exam < exams; ++exam) {
+            float value = m_store.score(order[row], exam, subject);
+            if (!qIsNaN(value)) {
+                base.sums[row * exams + exam] = value;
+                base.counts[row * exams + exam] = 1;
+            }
+        }
+    }
+    m_levels.append(base);
+
+    // 逐层两两合并，直到只剩一条；总大小不超过第 0 层的两倍
+    while (m_levels.last().bands > 1) {
+        const Level& prev = m_levels.last();
+        Level next;
+        next.bands = (prev.bands + 1) / 2;
+        next.sums.fill(0, next.bands * exams);
+        next.counts.fill(0, next.bands * exams);
+        for (int band = 0; band < prev.bands; ++band) {
+            for (int exam = 0; exam < exams; ++exam) {
+                next.sums[(band / 2) * exams + exam] += prev.sums[band * exams + exam];
+                next.counts[(band / 2) * exams + exam] += prev.counts[band * exams + exam];
+            }
+        }
+        m_levels.append(next);
+    }
+}
+
+int TaExamHeatmapView::currentLevel() const
+{
+    int level = 0;
+    while (level + 1 < m_levels.size() && m_rowHeight * (1 << level) < kMinBandPixels) {
+        ++level;
+    }
+    return level;
+}
+
+double TaExamHeatmapView::fitRowHeight() const
+{
+    int rows = m_analysis.rowOrder().size();
+    if (rows == 0) return kMaxRowHeight;
+    double fit = qMax(1, height() - kHeaderHeight) / double(rows);
+    return qMin(fit, double(kMaxRowHeight));
+}
+
+void TaExamHeatmapView::setScroll(double scroll)
+{
+    int rows = m_analysis.rowOrder().size();
+    double visibleRows = (height() - kHeaderHeight) / m_rowHeight;
+    m_scroll = qBound(0.0, scroll, qMax(0.0, rows - visibleRows));
+    m_cacheDirty = true;
+    update();
+}
+
+QColor TaExamHeatmapView::colorFor(float sum, int count) const
+{
+    if (count == 0) return QColor(230, 230, 230); // 缺考或没有成绩
+
+    double range = m_analysis.maximum() - m_analysis.minimum();
+    if (range == 0) range = 1;
+    double normalized = (sum / count - m_analysis.minimum()) / range;
+    return QColor(m_gradientLut[qBound(0, int(normalized * 255 + 0.5), 255)]);
+}
+
+void TaExamHeatmapView::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    // 只有数据、缩放、平移或大小变化时重画，其余重绘只贴图
+    if (m_cacheDirty) {
+        renderCache();
+    }
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_cache);
+}
+
+void TaExamHeatmapView::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    m_rowHeight = qMax(m_rowHeight, fitRowHeight());
+    setScroll(m_scroll);
+}
+
+void TaExamHeatmapView::renderCache()
+{
+    m_cacheDirty = false;
+
+    qreal ratio = devicePixelRatioF();
+    m_cache = QPixmap(size() * ratio);
+    m_cache.setDevicePixelRatio(ratio);
+    m_cache.fill(Qt::white);
+
+    QPainter painter(&m_cache);
+    if (m_levels.isEmpty()) {
+        painter.setPen(Qt::gray);
+        painter.drawText(rect(), Qt::AlignCenter, "请导入各班历次的期中成绩表");
+        return;
+    }
+
+    const QVector<int>& order = m_analysis.rowOrder();
+    int rows = order.size();
+    int exams = m_analysis.examCount();
+    double columnWidth = double(width() - kLabelWidth) / exams;
+    QFontMetrics metrics = painter.fontMetrics();
+
+    // 考试名
+    painter.setPen(Qt::black);
+    for (int exam = 0; exam < exams; ++exam) {
+        QRectF header(kLabelWidth + exam * columnWidth, 0, columnWidth, kHeaderHeight);
+        painter.drawText(header, Qt::AlignCenter,
+            metrics.elidedText(m_store.examName(exam), Qt::ElideRight, qMax(0, int(columnWidth) - 4)));
+    }
+
+    // 格子：只画可见的条，每条覆盖 2^level 行
+    int level = currentLevel();
+    const Level& bands = m_levels[level];
+    int span = 1 << level;
+    double visibleRows = (height() - kHeaderHeight) / m_rowHeight;
+    int firstBand = int(m_scroll) / span;
+    int lastBand = qMin(bands.bands - 1, int(std::ceil(m_scroll + visibleRows)) / span);
+
+    painter.setClipRect(QRect(kLabelWidth, kHeaderHeight, width() - kLabelWidth, height() - kHeaderHeight));
+    for (int band = firstBand; band <= lastBand; ++band) {
+        double top = kHeaderHeight + (band * span - m_scroll) * m_rowHeight;
+        double bottom = kHeaderHeight + (qMin((band + 1) * span, rows) - m_scroll) * m_rowHeight;
+        for (int exam = 0; exam < exams; ++exam) {
+            int index = band * exams + exam;
+            QRectF cell(kLabelWidth + exam * columnWidth, top, columnWidth, bottom - top);
+            painter.fillRect(cell, colorFor(bands.sums[index], bands.counts[index]));
+        }
+    }
+
+    // 考试之间的竖线
+    painter.setPen(Qt::white);
+    for (int exam = 1; exam < exams; ++exam) {
+        double x = kLabelWidth + exam * columnWidth;
+        painter.drawLine(QPointF(x, kHeaderHeight), QPointF(x, height()));
+    }
+
+    // 班级分隔线；行高足够时左侧逐行写姓名，否则每个班写一次班级名
+    painter.setClipping(false);
+    const QVector<int>& starts = m_analysis.classStarts();
+    bool showNames = m_rowHeight >= metrics.height();
+    for (int classIndex = 0; classIndex + 1 < starts.size(); ++classIndex) {
+        double top = kHeaderHeight + (starts[classIndex] - m_scroll) * m_rowHeight;
+        double bottom = kHeaderHeight + (starts[classIndex + 1] - m_scroll) * m_rowHeight;
+        if (bottom < kHeaderHeight || top > height()) continue;
+
+        if (top >= kHeaderHeight) {
+            painter.setPen(QColor(60, 60, 60));
+            painter.drawLine(QPointF(0, top), QPointF(width(), top));
+        }
+
+        if (showNames) continue;
+        double visibleTop = qMax(top, double(kHeaderHeight));
+        double visibleBottom = qMin(bottom, double(height()));
+        if (visibleBottom - visibleTop < metrics.height()) continue;
+        painter.setPen(Qt::black);
+        painter.drawText(QRectF(4, visibleTop, kLabelWidth - 8, visibleBottom - visibleTop), Qt::AlignLeft | Qt::AlignVCenter,
+            metrics.elidedText(m_store.className(classIndex), Qt::ElideRight, kLabelWidth - 8));
+    }
+
+    if (showNames) {
+        painter.setPen(Qt::black);
+        painter.setClipRect(QRect(0, kHeaderHeight, kLabelWidth, height() - kHeaderHeight));
+        int lastRow = qMin(rows - 1, int(std::ceil(m_scroll + visibleRows)));
+        for (int row = int(m_scroll); row <= lastRow; ++row) {
+            int student = order[row];
+            double top = kHeaderHeight + (row - m_scroll) * m_rowHeight;
+            QString label = m_store.className(m_store.studentClass(student)) + " " + m_store.studentName(student);
+            painter.drawText(QRectF(4, top, kLabelWidth - 8, m_rowHeight), Qt::AlignLeft | Qt::AlignVCenter,
+                metrics.elidedText(label, Qt::ElideLeft, kLabelWidth - 8));
+        }
+    }
+}
+
+void TaExamHeatmapView::wheelEvent(QWheelEvent* event)
+{
+    int delta = event->angleDelta().y();
+    if (delta == 0 || m_levels.isEmpty()) return;
+
+    // 以鼠标所在的行为中心缩放
+    double y = event->position().y() - kHeaderHeight;
+    double anchor = m_scroll + y / m_rowHeight;
+    double factor = std::pow(1.25, delta / 120.0);
+    m_rowHeight = qBound(fitRowHeight(), m_rowHeight * factor, double(kMaxRowHeight));
+    setScroll(anchor - y / m_rowHeight);
+    event->accept();
+}
+
+void TaExamHeatmapView::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = true;
+        m_dragStart = event->pos();
+        m_dragScroll = m_scroll;
+        setCursor(Qt::ClosedHandCursor);
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void TaExamHeatmapView::mouseMoveEvent(QMouseEvent* event)
+{
+    if (m_dragging) {
+        setScroll(m_dragScroll - (event->pos().y() - m_dragStart.y()) / m_rowHeight);
+        return;
+    }
+
+    const QVector<int>& order = m_analysis.rowOrder();
+    int exams = m_analysis.examCount();
+    if (m_levels.isEmpty() || event->pos().x() < kLabelWidth || event->pos().y() < kHeaderHeight) {
+        QToolTip::hideText();
+        return;
+    }
+
+    double columnWidth = double(width() - kLabelWidth) / exams;
+    int exam = int((event->pos().x() - kLabelWidth) / columnWidth);
+    int row = int(m_scroll + (event->pos().y() - kHeaderHeight) / m_rowHeight);
+    if (exam < 0 || exam >= exams || row < 0 || row >= order.size()) {
+        QToolTip::hideText();
+        return;
+    }
+
+    QString text;
+    int level = currentLevel();
+    if (level == 0) {
+        int student = order[row];
+        float value = m_store.score(student, exam, m_analysis.subject());
+        const TaExamAnalysis::Trend& trend = m_analysis.trend(student);
+        text = QString("%1（%2）  %3\n%4：%5\n趋势：%6 分/次")
+            .arg(m_store.studentName(student), m_store.studentId(student),
+                m_store.className(m_store.studentClass(student)), m_store.examName(exam),
+                qIsNaN(value) ? QString("缺考") : QString::number(value, 'f', 1),
+                (trend.slope > 0 ? "+" : "") + QString::number(trend.slope, 'f', 1));
+    } else {
+        // 合并显示时提示这一条的平均分
+        int span = 1 << level;
+        int band = row / span;
+        int first = band * span;
+        int last = qMin(first + span, order.size());
+        const Level& bands = m_levels[level];
+        int count = bands.counts[band * exams + exam];
+        text = QString("第 %1–%2 行，%3 人有成绩\n%4 平均：%5")
+            .arg(first + 1).arg(last).arg(count).arg(m_store.examName(exam))
+            .arg(count ? QString::number(bands.sums[band * exams + exam] / count, 'f', 1) : QString("-"));
+    }
+    QToolTip::showText(event->globalPos(), text, this);
+}
+
+void TaExamHeatmapView::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton && m_dragging) {
+        m_dragging = false;
+        unsetCursor();
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+ExamTrendDialog::ExamTrendDialog(QWidget* parent)
+    : QDialog(parent)
+    , m_importTotal(0)
+    , m_analysisPending(false)
+{
+    setWindowTitle("多班成绩趋势");
+    resize(1100, 700);
+    setStyleSheet("background-color: #f5f5f5;");
+
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(10);
+    mainLayout->setContentsMargins(15, 15, 15, 15);
+
+    // 顶部控制栏
+    QHBoxLayout* controlLayout = new QHBoxLayout;
+    btnAdd = new QPushButton("导入成绩表");
+    btnAdd->setStyleSheet("background-color: green; color: white; padding: 6px 12px; border-radius: 4px; font-size: 14px;");
+    btnClear = new QPushButton("清空");
+    btnClear->setStyleSheet("background-color: gray; color: white; padding: 6px 12px; border-radius: 4px; font-size: 14px;");
+    QLabel* lblSubject = new QLabel("科目:");
+    subjectComboBox = new QComboBox;
+    subjectComboBox->setMinimumWidth(100);
+    QLabel* lblExam = new QLabel("考试:");
+    examComboBox = new QComboBox;
+    examComboBox->setMinimumWidth(140);
+    lblStatus = new QLabel("请导入各班历次的期中成绩表，文件名格式：班级_考试名");
+
+    controlLayout->addWidget(btnAdd);
+    controlLayout->addWidget(btnClear);
+    controlLayout->addWidget(lblSubject);
+    controlLayout->addWidget(subjectComboBox);
+    controlLayout->addWidget(lblExam);
+    controlLayout->addWidget(examComboBox);
+    controlLayout->addWidget(lblStatus, 1);
+    mainLayout->addLayout(controlLayout);
+
+    // 左侧热力图，右侧各班分布
+    QHBoxLayout* contentLayout = new QHBoxLayout;
+    heatmapView = new TaExamHeatmapView;
+    classTable = new QTableWidget(0, 9);
+    QStringList headers = { "班级", "人数", "平均分", "标准差", "P25", "中位数", "P75", "进步", "退步" };
+    classTable->setHorizontalHeaderLabels(headers);
+    classTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    classTable->verticalHeader()->setVisible(false);
+    classTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    classTable->setStyleSheet(
+        "QTableWidget { background-color: white; gridline-color: #ddd; }"
+        "QHeaderView::section { background-color: #4169e1; color: white; font-weight: bold; padding: 4px; }"
+    );
+    contentLayout->addWidget(heatmapView, 3);
+    contentLayout->addWidget(classTable, 2);
+    mainLayout->addLayout(contentLayout, 1);
+
+    m_importPipeline = new TaImportPipeline(this);
+    connect(m_importPipeline, &TaImportPipeline::tableDetected, this, &ExamTrendDialog::onImportTableDetected);
+    connect(m_importPipeline, &TaImportPipeline::rowsReady, this, &ExamTrendDialog::onImportRowsReady);
+    connect(m_importPipeline, &TaImportPipeline::finished, this, &ExamTrendDialog::onImportFinished);
+
+    m_analysisWatcher = new QFutureWatcher<TaExamAnalysis>(this);
+    connect(m_analysisWatcher, &QFutureWatcher<TaExamAnalysis>::finished, this, &ExamTrendDialog::onAnalysisFinished);
+
+    connect(btnAdd, &QPushButton::clicked, this, &ExamTrendDialog::onAddTables);
+    connect(btnClear, &QPushButton::clicked, this, &ExamTrendDialog::onClear);
+    connect(subjectComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ExamTrendDialog::onSubjectChanged);
+    connect(examComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ExamTrendDialog::onExamChanged);
+}
+
+void ExamTrendDialog::onAddTables()
+{
+    if (m_importPipeline->isRunning()) {
+        return;
+    }
+
+    QStringList fileNames = QFileDialog::getOpenFileNames(
+        this,
+        "选择各班期中成绩表（文件名：班级_考试名）",
+        "",
+        "Excel文件 (*.xlsx *.xls);;CSV文件 (*.csv);;所有文件 (*.*)"
+    );
+    if (fileNames.isEmpty()) {
+        return;
+    }
+
+    m_pendingFiles = fileNames;
+    m_importTotal = fileNames.size();
+    m_failedFiles.clear();
+    btnAdd->setEnabled(false);
+    importNext();
+}
+
+void ExamTrendDialog::importNext()
+{
+    if (m_pendingFiles.isEmpty()) {
+        btnAdd->setEnabled(true);
+        QString status = QString("已导入 %1 个班级、%2 次考试、%3 名学生")
+            .arg(m_store.classCount()).arg(m_store.examCount()).arg(m_store.studentCount());
+        if (!m_failedFiles.isEmpty()) {
+            status += QString("，%1 个文件未导入").arg(m_failedFiles.size());
+            QMessageBox::warning(this, "提示", "以下文件不是期中成绩表或读取失败：\n" + m_failedFiles.join("\n"));
+        }
+        lblStatus->setText(status);
+        refreshCombos();
+        startAnalysis();
+        return;
+    }
+
+    m_currentFile = m_pendingFiles.takeFirst();
+    m_importHeaders.clear();
+    m_importRows.clear();
+    lblStatus->setText(QString("正在导入 %1/%2：%3")
+        .arg(m_importTotal - m_pendingFiles.size()).arg(m_importTotal).arg(QFileInfo(m_currentFile).fileName()));
+    m_importPipeline->start(m_currentFile);
+}
+
+void ExamTrendDialog::onImportTableDetected(int kind, const QStringList& headers)
+{
+    // 只接受期中成绩单，其他表格按未导入处理
+    if (kind == TaImportPipeline::MidtermGradeTable) {
+        m_importHeaders = headers;
+    }
+}
+
+void ExamTrendDialog::onImportRowsReady(const QList<QStringList>& rows)
+{
+    if (!m_importHeaders.isEmpty()) {
+        m_importRows += rows;
+    }
+}
+
+void ExamTrendDialog::onImportFinished(int error, int rowCount)
+{
+    Q_UNUSED(rowCount);
+    if (error == TaImportPipeline::Canceled) {
+        return;
+    }
+
+    QString className, examName;
+    splitFileName(m_currentFile, &className, &examName);
+    if (error != TaImportPipeline::NoError || m_importHeaders.isEmpty()
+        || m_store.addTable(className, examName, m_importHeaders, m_importRows) < 0) {
+        m_failedFiles.append(QFileInfo(m_currentFile).fileName());
+    }
+    m_importRows.clear();
+    importNext();
+}
+
+void ExamTrendDialog::onClear()
+{
+    m_pendingFiles.clear();
+    m_importPipeline->cancel();
+    btnAdd->setEnabled(true);
+
+    // 正在计算的结果已经过时，算完后丢弃
+    m_analysisPending = m_analysisWatcher->isRunning();
+    m_store.clear();
+    m_analysisStore.clear();
+    m_analysis = TaExamAnalysis();
+    heatmapView->setData(m_analysisStore, m_analysis);
+    refreshCombos();
+    classTable->setRowCount(0);
+    lblStatus->setText("请导入各班历次的期中成绩表，文件名格式：班级_考试名");
+}
+
+void ExamTrendDialog::refreshCombos()
+{
+    QString subject = subjectComboBox->currentText();
+    QString exam = examComboBox->currentText();
+
+    subjectComboBox->blockSignals(true);
+    subjectComboBox->clear();
+    for (int i = 0; i < m_store.subjectCount(); ++i) {
+        subjectComboBox->addItem(m_store.subjectName(i));
+    }
+    // 保留原来的选择，第一次默认总分
+    int subjectIndex = subjectComboBox->findText(subject.isEmpty() ? QString("总分") : subject);
+    subjectComboBox->setCurrentIndex(subjectIndex >= 0 ? subjectIndex : 0);
+    subjectComboBox->blockSignals(false);
+
+    examComboBox->blockSignals(true);
+    examComboBox->clear();
+    for (int i = 0; i < m_store.examCount(); ++i) {
+        examComboBox->addItem(m_store.examName(i));
+    }
+    // 保留原来的选择，第一次默认最近一次考试
+    int examIndex = examComboBox->findText(exam);
+    examComboBox->setCurrentIndex(examIndex >= 0 ? examIndex : examComboBox->count() - 1);
+    examComboBox->blockSignals(false);
+}
+
+void ExamTrendDialog::onSubjectChanged(int index)
+{
+    Q_UNUSED(index);
+    startAnalysis();
+}
+
+void ExamTrendDialog::onExamChanged(int index)
+{
+    Q_UNUSED(index);
+    updateClassTable();
+}
+
+void ExamTrendDialog::startAnalysis()
+{
+    int subject = m_store.findSubject(subjectComboBox->currentText());
+    if (subject < 0) {
+        return;
+    }
+
+    if (m_analysisWatcher->isRunning()) {
+        m_analysisPending = true;
+        return;
+    }
+
+    // 成绩库是隐式共享的，复制一份快照交给后台线程，导入新表不影响正在进行的计算
+    m_analysisStore = m_store;
+    TaExamStore store = m_store;
+    lblStatus->setText("正在计算...");
+    m_analysisWatcher->setFuture(QtConcurrent::run([store, subject]() {
+        return TaExamAnalysis::compute(store, subject);
+    }));
+}
+
+void ExamTrendDialog::onAnalysisFinished()
+{
+    if (m_analysisPending) {
+        m_analysisPending = false;
+        startAnalysis();
+        return;
+    }
+
+    m_analysis = m_analysisWatcher->result();
+    heatmapView->setData(m_analysisStore, m_analysis);
+    updateClassTable();
+    lblStatus->setText(QString("%1 个班级、%2 次考试、%3 名学生")
+        .arg(m_analysisStore.classCount()).arg(m_analysisStore.examCount()).arg(m_analysisStore.studentCount()));
+}
+
+void ExamTrendDialog::updateClassTable()
+{
+    int exam = examComboBox->currentIndex();
+    if (m_analysis.subject() < 0 || exam < 0 || exam >= m_analysis.examCount()) {
+        classTable->setRowCount(0);
+        return;
+    }
+
+    classTable->setRowCount(m_analysis.classCount());
+    for (int classIndex = 0; classIndex < m_analysis.classCount(); ++classIndex) {
+        const TaExamAnalysis::Distribution& distribution = m_analysis.distribution(classIndex, exam);
+        const TaExamAnalysis::ClassSummary& summary = m_analysis.classSummary(classIndex);
+        QStringList cells = {
+            m_analysisStore.className(classIndex),
+            QString::number(distribution.count),
+            QString::number(distribution.mean, 'f', 1),
+            QString::number(distribution.stddev, 'f', 1),
+            QString::number(distribution.p25, 'f', 1),
+            QString::number(distribution.median, 'f', 1),
+            QString::number(distribution.p75, 'f', 1),
+            QString::number(summary.rising),
+            QString::number(summary.falling)
+        };
+        for (int col = 0; col < cells.size(); ++col) {
+            QTableWidgetItem* item = new QTableWidgetItem(cells[col]);
+            item->setTextAlignment(Qt::AlignCenter);
+            classTable->setItem(classIndex, col, item);
+        }
+    }
+}
+
+void ExamTrendDialog::splitFileName(const QString& fileName, QString* className, QString* examName)
+{
+    // “班级_考试名”；没有下划线时整个文件名作班级
+    QString baseName = QFileInfo(fileName).completeBaseName();
+    int separator = baseName.indexOf('_');
+    if (separator > 0 && separator < baseName.size() - 1) {
+        *className = baseName.left(separator).trimmed();
+        *examName = baseName.mid(separator + 1).trimmed();
+    } else {
+        *className = baseName.trimmed();
+        *examName = "未命名考试";
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <QDialog>
+#include <QWidget>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QComboBox>
+#include <QLabel>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QFutureWatcher>
+#include <QPixmap>
+#include <QVector>
+#include <QList>
+#include "TaExamStore.h"
+#include "TaExamAnalysis.h"
+#include "TaImportPipeline.h"
+
+// 多班级成绩热力图：行是学生（按班级排列），列是考试，颜色为所选科目的成绩。
+// 滚轮缩放、拖动平移；行高不足 kMinBandPixels 像素时按细节层级把相邻 2^k 行合并成一条，取平均分，
+// 画出的条数不随学生数增长。画好的格子缓存在 m_cache 中，只有数据、缩放、平移或大小变化时重画。
+class TaExamHeatmapView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TaExamHeatmapView(QWidget* parent = nullptr);
+
+    void setData(const TaExamStore& store, const TaExamAnalysis& analysis);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+
+private:
+    static const int kHeaderHeight = 28; // 顶部考试名
+    static const int kLabelWidth = 90;   // 左侧班级名、姓名
+    static const int kMinBandPixels = 2;
+    static const int kMaxRowHeight = 32;
+
+    // 第 k 层每 2^k 行合并为一条，sums/counts 按 [条 * 考试数 + 考试] 存放
+    struct Level
+    {
+        int bands = 0;
+        QVector<float> sums;
+        QVector<int> counts;
+    };
+
+    void buildLevels();
+    int currentLevel() const;
+    double fitRowHeight() const;
+    void setScroll(double scroll);
+    void renderCache();
+    QColor colorFor(float sum, int count) const;
+
+    TaExamStore m_store;
+    TaExamAnalysis m_analysis;
+    QVector<Level> m_levels;
+    QVector<QRgb> m_gradientLut; // 256 级渐变色表
+    double m_rowHeight; // 每个学生行的像素高度
+    double m_scroll;    // 视图顶部对应的行（可以是小数）
+    bool m_dragging;
+    QPoint m_dragStart;
+    double m_dragScroll;
+    QPixmap m_cache;
+    bool m_cacheDirty;
+};
+
+// 多班级历次考试的成绩趋势：导入各班各次的期中成绩表，按科目显示热力图和各班分布。
+// 成绩表文件名按“班级_考试名”命名，例如“七年级1班_2024期中.xlsx”；导入按选择的顺序依次进行，
+// 考试的先后按导入顺序。统计在后台线程并行计算，界面只在计算完成后刷新。
+class ExamTrendDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ExamTrendDialog(QWidget* parent = nullptr);
+
+private slots:
+    void onAddTables();
+    void onClear();
+    void onSubjectChanged(int index);
+    void onExamChanged(int index);
+    void onImportTableDetected(int kind, const QStringList& headers);
+    void onImportRowsReady(const QList<QStringList>& rows);
+    void onImportFinished(int error, int rowCount);
+    void onAnalysisFinished();
+
+private:
+    void importNext();
+    void refreshCombos();
+    void startAnalysis();
+    void updateClassTable();
+    static void splitFileName(const QString& fileName, QString* className, QString* examName);
+
+    QPushButton* btnAdd;
+    QPushButton* btnClear;
+    QComboBox* subjectComboBox;
+    QComboBox* examComboBox;
+    QLabel* lblStatus;
+    TaExamHeatmapView* heatmapView;
+    QTableWidget* classTable;
+
+    TaImportPipeline* m_importPipeline;
+    QStringList m_pendingFiles;
+    QString m_currentFile;
+    QStringList m_importHeaders;
+    QList<QStringList> m_importRows;
+    int m_importTotal;
+    QStringList m_failedFiles;
+
+    TaExamStore m_store;
+    TaExamStore m_analysisStore; // m_analysis 计算时所用的成绩库快照
+    TaExamAnalysis m_analysis;
+    QFutureWatcher<TaExamAnalysis>* m_analysisWatcher;
+    bool m_analysisPending; // 计算中数据或科目又变了，算完再算一次
+};
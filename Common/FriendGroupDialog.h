@@ -22,6 +22,9 @@
 #include "TAHttpHandler.h"
 #include "ImSDK/includes/TIMCloud.h"
 #include "CommonInfo.h"
+#include "TaMessageBus.h"
+#include "TaEndpoints.h"
+#include "TaGroupSync.h"
 #include <QMap>
 
 class RowItem : public QFrame {
@@ -604,15 +607,8 @@ public:
                 {
                     m_scheduleDlg[unique_group_id] = new ScheduleDialog(classid, this, m_pWs);
                     m_scheduleDlg[unique_group_id]->InitWebSocket();
-                    QList<Notification> curNotification;
-                    for (auto iter : notifications)
-                    {
-                        if (iter.unique_group_id == unique_group_id)
-                        {
-                            curNotification.append(iter);
-                        }
-                    }
-                    m_scheduleDlg[unique_group_id]->setNoticeMsg(curNotification);
+                    // 通知已由消息总线解析并按群索引
+                    m_scheduleDlg[unique_group_id]->setNoticeMsg(TaMessageBus::notificationsOfGroup(unique_group_id));
                     
                     // 在创建对话框后立即建立连接，而不是等到按钮点击
                     connectGroupLeftSignal(m_scheduleDlg[unique_group_id], unique_group_id);
@@ -688,13 +684,13 @@ public:
         if (m_httpHandler)
         {
             UserInfo userInfo = CommonInfo::GetData();
-            QString url = "http://47.100.126.194:5000/friends?";
+            QString url = TaEndpoints::url("/friends?");
             url += "id_card=";
             url += userInfo.strIdNumber;
             m_httpHandler->get(url);
 
             // 调用获取群组信息的接口
-            QString groupUrl = "http://47.100.126.194:5000/groups/by-teacher?";
+            QString groupUrl = TaEndpoints::url("/groups/by-teacher?");
             groupUrl += "teacher_unique_id=";
             groupUrl += userInfo.teacher_unique_id;
             m_httpHandler->get(groupUrl);
@@ -704,8 +700,6 @@ public:
     void GetGroupJoinedList() { // 已加入群列表
     // 获取群列表
         int ret = TIMGroupGetJoinedGroupList([](int32_t code, const char* desc, const char* json_param, const void* user_data) {
-            FriendGroupDialog* ths = (FriendGroupDialog*)user_data;
-            
             if (strlen(json_param) == 0) {
                 return;
             }
@@ -798,21 +792,8 @@ public:
                 groupsArray.append(groupObj);
             }
             
-            // 构造最终的上传JSON
-            QJsonObject uploadData;
-            uploadData["user_id"] = userId;
-            uploadData["groups"] = groupsArray;
-            
-            // 转换为JSON字符串
-            QJsonDocument uploadDoc(uploadData);
-            QByteArray jsonData = uploadDoc.toJson(QJsonDocument::Compact);
-            
-            // 上传到服务器
-            if (ths->m_httpHandler) {
-                QString url = "http://47.100.126.194:5000/groups/sync";
-                ths->m_httpHandler->post(url, jsonData);
-                qDebug() << "上传群组信息到服务器，共" << groupsArray.size() << "个群组";
-            }
+            // 交给同步引擎：只上传相对上次确认快照有变化的群，并记录已退出的群
+            TaGroupSync::instance()->syncJoinedGroups(userId, groupsArray);
             
             //CIMWnd::GetInst().Logf("GroupList", kTIMLog_Info, json_param);
             }, this);
@@ -828,11 +809,7 @@ public:
         }
 
         TaQTWebSocket::regRecvDlg(this);
-        if (m_pWs)
-        {
-            connect(m_pWs, &TaQTWebSocket::newMessage,
-                this, &FriendGroupDialog::onWebSocketMessage);
-        }
+        // 通知消息由 TaMessageBus 统一解析保存，这里无需再订阅原始文本
     }
 
     void setTitleName(const QString& name) {
@@ -926,51 +903,6 @@ public:
     FriendNotifyDialog* friendNotifyDlg = NULL;
     GroupNotifyDialog* grpNotifyDlg = NULL;
 
- private slots:
-	 void onWebSocketMessage(const QString& msg)
-	 {
-         // 解析 JSON 文本
-         QJsonParseError parseError;
-         QJsonDocument doc = QJsonDocument::fromJson(msg.toUtf8(), &parseError);
-         if (parseError.error != QJsonParseError::NoError) {
-             qWarning() << "JSON解析失败:" << parseError.errorString();
-             return;
-         }
-
-         if (!doc.isObject()) {
-             qWarning() << "根节点不是 JSON 对象";
-             return;
-         }
-
-         QJsonObject rootObj = doc.object();
-
-         // 提取 data 数组
-         if (rootObj.contains("data") && rootObj["data"].isArray()) {
-             QJsonArray dataArray = rootObj["data"].toArray();
-             for (auto item : dataArray) {
-                 if (!item.isObject()) continue;
-                 QJsonObject obj = item.toObject();
-
-                 Notification n;
-                 n.id = obj["id"].toInt();
-                 n.sender_id = obj["sender_id"].toInt();
-                 n.sender_name = obj["sender_name"].isNull() ? "" : obj["sender_name"].toString();
-                 n.receiver_id = obj["receiver_id"].toInt();
-                 n.unique_group_id = obj["unique_group_id"].isNull() ? "" : obj["unique_group_id"].toString();
-                 n.group_name = obj["group_name"].isNull() ? "" : obj["group_name"].toString();
-                 n.content = obj["content"].toString();
-                 n.content_text = obj["content_text"].toInt();
-                 n.is_read = obj["is_read"].toInt();
-                 n.is_agreed = obj["is_agreed"].toInt();
-                 n.remark = obj["remark"].isNull() ? "" : obj["remark"].toString();
-                 n.created_at = obj["created_at"].toString();
-                 n.updated_at = obj["updated_at"].toString();
-
-                 notifications.append(n);
-             }
-         }
-	 }
-
  private:
 	 bool m_dragging;
 	 QPoint m_dragStartPos;
@@ -989,5 +921,4 @@ public:
      QVBoxLayout* gJoinLayout = NULL;
      TaQTWebSocket* m_pWs = NULL;
      QMap<QString, ScheduleDialog*> m_scheduleDlg;
-     QList<Notification> notifications;
 };
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QDateTime>
+#include <QPointer>
+#include "TaEndpoints.h"
+#include "TaGroupSync.h"
 
 FriendSelectDialog::FriendSelectDialog(QWidget* parent)
     : QDialog(parent)
@@ -71,7 +74,7 @@ void FriendSelectDialog::InitData()
     UserInfo userInfo = CommonInfo::GetData();
     if (m_httpHandler)
     {
-        QString url = "http://47.100.126.194:5000/friends?";
+        QString url = TaEndpoints::url("/friends?");
         url += "id_card=";
         url += userInfo.strIdNumber;
         m_httpHandler->get(url);
@@ -393,14 +396,13 @@ void FriendSelectDialog::inviteMembersToServer(const QVector<QString>& memberIds
     }
     
     UserInfo userInfo = CommonInfo::GetData();
-    QString url = "http://47.100.126.194:5000/groups/sync";
     
     // 使用共享指针来跟踪所有请求的状态
     struct UploadState {
         int totalCount;
         int successCount;
         int failCount;
-        FriendSelectDialog* dlg;
+        QPointer<FriendSelectDialog> dlg;
         QString groupId;
     };
     
@@ -460,47 +462,25 @@ void FriendSelectDialog::inviteMembersToServer(const QVector<QString>& memberIds
         
         groupObj["member_info"] = memberInfo;
         
-        // 构造groups数组
-        QJsonArray groupsArray;
-        groupsArray.append(groupObj);
-        
-        // 构造上传JSON
-        QJsonObject uploadData;
-        uploadData["user_id"] = memberId;
-        uploadData["groups"] = groupsArray;
-        
-        // 转换为JSON字符串
-        QJsonDocument uploadDoc(uploadData);
-        QByteArray jsonData = uploadDoc.toJson(QJsonDocument::Compact);
-        
-        // 上传到服务器
-        QNetworkAccessManager* manager = new QNetworkAccessManager(this);
-        QNetworkRequest request;
-        request.setUrl(QUrl(url));
-        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-        QNetworkReply* reply = manager->post(request, jsonData);
-        
-        connect(reply, &QNetworkReply::finished, [=]() {
-            if (reply->error() == QNetworkReply::NoError) {
+        // 上传到服务器（同步引擎负责合并和失败重试）
+        TaGroupSync::instance()->syncGroup(memberId, groupObj, [=](bool ok) {
+            if (ok) {
                 qDebug() << "上传被邀请成员群组信息到服务器成功，成员ID:" << memberId;
                 state->successCount++;
             } else {
-                qWarning() << "上传被邀请成员群组信息失败，成员ID:" << memberId << "错误:" << reply->errorString();
+                qWarning() << "上传被邀请成员群组信息失败，成员ID:" << memberId;
                 state->failCount++;
             }
             
             // 检查是否所有请求都已完成
             if (state->successCount + state->failCount >= state->totalCount) {
                 // 所有请求都已完成，发出信号通知刷新成员列表
-                if (state->successCount > 0) {
+                if (state->successCount > 0 && state->dlg) {
                     qDebug() << "所有成员上传完成，成功:" << state->successCount << "失败:" << state->failCount;
                     emit state->dlg->membersInvitedSuccess(state->groupId);
                 }
                 delete state;
             }
-            
-            reply->deleteLater();
-            manager->deleteLater();
         });
     }
 }
@@ -114,7 +114,14 @@ HeatmapSegmentDialog::HeatmapSegmentDialog(QWidget* parent)
 
 void HeatmapSegmentDialog::setStudentData(const QList<struct StudentInfo>& students)
 {
-    m_students = students;
+    TaScoreStats stats;
+    stats.setStudents(students);
+    setStudentData(stats);
+}
+
+void HeatmapSegmentDialog::setStudentData(const TaScoreStats& stats)
+{
+    m_stats = stats;
     updateAllStatistics();
 }
 
@@ -259,20 +266,15 @@ void HeatmapSegmentDialog::updateRowStatistics(int row)
         return;
     }
 
-    // 统计该区间内的学生数量
-    int count = 0;
-    for (const auto& student : m_students) {
-        if (student.score >= minValue && student.score <= maxValue) {
-            count++;
-        }
-    }
+    // 统计该区间内的学生数量（含两端）
+    int count = m_stats.countInRange(QString(), minValue, maxValue);
 
     countItem->setText(QString::number(count));
 
     // 计算百分数
     double percentage = 0.0;
-    if (m_students.size() > 0) {
-        percentage = (count * 100.0) / m_students.size();
+    if (m_stats.studentCount() > 0) {
+        percentage = (count * 100.0) / m_stats.studentCount();
     }
     percentItem->setText(QString::number(percentage, 'f', 1) + "%");
 }
@@ -14,6 +14,7 @@
 #include <QList>
 #include "ScheduleDialog.h" // 包含 StudentInfo 定义
 #include "HeatmapTypes.h" // 包含 SegmentRange 定义
+#include "TaScoreStats.h"
 
 class HeatmapSegmentDialog : public QDialog
 {
@@ -24,6 +25,8 @@ public:
     
     // 设置学生数据（用于计算人数和百分数）
     void setStudentData(const QList<struct StudentInfo>& students);
+    // 直接使用已排好序的成绩统计（与 ScheduleDialog 共享，不再重排）
+    void setStudentData(const TaScoreStats& stats);
     
     // 获取分段区间列表
     QList<SegmentRange> getSegments() const;
@@ -47,7 +50,7 @@ private:
     QTableWidget* table;
     QPushButton* btnAddRow;
     QPushButton* btnConfirm;
-    QList<struct StudentInfo> m_students;
+    TaScoreStats m_stats; // 按成绩排好序，区间人数二分查找
     QList<SegmentRange> m_segments;
 };
 
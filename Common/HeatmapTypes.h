@@ -10,3 +10,32 @@ struct SegmentRange {
     double percentage; // 百分数
 };
 
+// 渐变热力图的颜色：蓝色(低) -> 绿色 -> 黄色 -> 红色(高)，normalized 为 0~1
+inline QRgb heatmapGradientColor(double normalized)
+{
+    QColor color;
+    if (normalized < 0.33) {
+        double t = normalized / 0.33;
+        color = QColor(
+            int(0 + t * 0),
+            int(0 + t * 255),
+            int(255 - t * 0)
+        );
+    } else if (normalized < 0.66) {
+        double t = (normalized - 0.33) / 0.33;
+        color = QColor(
+            int(0 + t * 255),
+            255,
+            int(255 - t * 255)
+        );
+    } else {
+        double t = (normalized - 0.66) / 0.34;
+        color = QColor(
+            255,
+            int(255 - t * 255),
+            0
+        );
+    }
+    return color.rgb();
+}
+
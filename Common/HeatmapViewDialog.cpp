@@ -1,5 +1,6 @@
 #include "HeatmapViewDialog.h"
 #include <QPainter>
+#include <QResizeEvent>
 #include <algorithm>
 
 HeatmapViewDialog::HeatmapViewDialog(QWidget* parent)
@@ -7,7 +8,14 @@ HeatmapViewDialog::HeatmapViewDialog(QWidget* parent)
     , m_heatmapType(2)
     , m_minValue(0)
     , m_maxValue(100)
+    , m_cacheDirty(true)
 {
+    // 渐变色表只算一次，绘制时按归一化成绩查表
+    m_gradientLut.resize(256);
+    for (int i = 0; i < 256; ++i) {
+        m_gradientLut[i] = heatmapGradientColor(i / 255.0);
+    }
+
     setWindowTitle("热力图");
     resize(800, 600);
     setStyleSheet("background-color: #f5f5f5;");
@@ -40,105 +48,109 @@ HeatmapViewDialog::HeatmapViewDialog(QWidget* parent)
 
 void HeatmapViewDialog::setStudentData(const QList<struct StudentInfo>& students)
 {
-    m_students = students;
+    TaScoreStats stats;
+    stats.setStudents(students);
+    setStudentData(stats);
+}
+
+void HeatmapViewDialog::setStudentData(const TaScoreStats& stats)
+{
+    m_stats = stats;
     
-    // 计算最小和最大成绩
-    if (!m_students.isEmpty()) {
-        m_minValue = m_students[0].score;
-        m_maxValue = m_students[0].score;
-        for (const auto& student : m_students) {
-            if (student.score < m_minValue) m_minValue = student.score;
-            if (student.score > m_maxValue) m_maxValue = student.score;
-        }
+    // 按成绩排好的顺序和最小、最大成绩都直接取自统计
+    m_sortedScores.clear();
+    for (int student : m_stats.order(QString())) {
+        double score = 0;
+        m_stats.value(student, QString(), &score);
+        m_sortedScores.append(score);
+    }
+    if (!m_sortedScores.isEmpty()) {
+        m_minValue = m_stats.minimum(QString());
+        m_maxValue = m_stats.maximum(QString());
     }
     
-    update();
+    updateCellColors();
 }
 
 void HeatmapViewDialog::setSegments(const QList<struct SegmentRange>& segments)
 {
     m_segments = segments;
-    update();
+    updateCellColors();
 }
 
 void HeatmapViewDialog::setHeatmapType(int type)
 {
     m_heatmapType = type;
     typeComboBox->setCurrentIndex(type - 1);
-    update();
+    updateCellColors();
 }
 
 void HeatmapViewDialog::paintEvent(QPaintEvent* event)
 {
     QDialog::paintEvent(event);
     
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
-    
-    if (m_heatmapType == 1) {
-        drawSegmentHeatmap(painter);
-    } else {
-        drawGradientHeatmap(painter);
+    // 数据、分段、类型或窗口大小变了才重画格子，其余重绘（如移动窗口、被遮挡后露出）只贴图
+    if (m_cacheDirty) {
+        renderCache();
     }
+    
+    QPainter painter(this);
+    painter.drawPixmap(kStartX, kStartY, m_cache);
 }
 
-void HeatmapViewDialog::drawSegmentHeatmap(QPainter& painter)
+void HeatmapViewDialog::resizeEvent(QResizeEvent* event)
 {
-    // 绘制分段热力图
-    int width = this->width() - 30;
-    int height = this->height() - 100;
-    int startX = 15;
-    int startY = 80;
-    
-    // 计算每个学生的位置（简化：按成绩排序后排列）
-    QList<struct StudentInfo> sortedStudents = m_students;
-    std::sort(sortedStudents.begin(), sortedStudents.end(), 
-        [](const struct StudentInfo& a, const struct StudentInfo& b) {
-            return a.score < b.score;
-        });
-    
-    int cols = 20; // 每行20个
-    int cellWidth = width / cols;
-    int cellHeight = cellWidth;
-    
-    for (int i = 0; i < sortedStudents.size(); ++i) {
-        int row = i / cols;
-        int col = i % cols;
-        int x = startX + col * cellWidth;
-        int y = startY + row * cellHeight;
-        
-        QColor color = getColorForValue(sortedStudents[i].score);
-        painter.fillRect(x, y, cellWidth - 2, cellHeight - 2, color);
+    QDialog::resizeEvent(event);
+    m_cacheDirty = true;
+}
+
+void HeatmapViewDialog::updateCellColors()
+{
+    // 每个格子的颜色只和成绩、分段、类型有关，改变窗口大小时不用重算
+    m_cellColors.resize(m_sortedScores.size());
+    for (int i = 0; i < m_sortedScores.size(); ++i) {
+        if (m_heatmapType == 1) {
+            m_cellColors[i] = getColorForValue(m_sortedScores[i]).rgb();
+        } else {
+            m_cellColors[i] = getGradientColorForValue(m_sortedScores[i]);
+        }
     }
+    
+    m_cacheDirty = true;
+    update();
 }
 
-void HeatmapViewDialog::drawGradientHeatmap(QPainter& painter)
+void HeatmapViewDialog::renderCache()
 {
-    // 绘制渐变热力图
-    int width = this->width() - 30;
-    int height = this->height() - 100;
-    int startX = 15;
-    int startY = 80;
+    m_cacheDirty = false;
+    
+    int width = this->width() - 2 * kStartX;
+    int height = this->height() - kStartY - 20;
+    if (width <= 0 || height <= 0) {
+        m_cache = QPixmap();
+        return;
+    }
+    
+    qreal ratio = devicePixelRatioF();
+    m_cache = QPixmap(QSize(width, height) * ratio);
+    m_cache.setDevicePixelRatio(ratio);
+    m_cache.fill(Qt::transparent);
     
-    // 计算每个学生的位置
-    QList<struct StudentInfo> sortedStudents = m_students;
-    std::sort(sortedStudents.begin(), sortedStudents.end(), 
-        [](const struct StudentInfo& a, const struct StudentInfo& b) {
-            return a.score < b.score;
-        });
+    QPainter painter(&m_cache);
     
+    // 按成绩从低到高排列，每行20个
     int cols = 20;
     int cellWidth = width / cols;
     int cellHeight = cellWidth;
     
-    for (int i = 0; i < sortedStudents.size(); ++i) {
+    for (int i = 0; i < m_cellColors.size(); ++i) {
         int row = i / cols;
         int col = i % cols;
-        int x = startX + col * cellWidth;
-        int y = startY + row * cellHeight;
+        int x = col * cellWidth;
+        int y = row * cellHeight;
+        if (y >= height) break;
         
-        QColor color = getGradientColorForValue(sortedStudents[i].score);
-        painter.fillRect(x, y, cellWidth - 2, cellHeight - 2, color);
+        painter.fillRect(x, y, cellWidth - 2, cellHeight - 2, QColor(m_cellColors[i]));
     }
 }
 
@@ -153,45 +165,20 @@ QColor HeatmapViewDialog::getColorForValue(double value)
     return QColor(200, 200, 200); // 默认灰色
 }
 
-QColor HeatmapViewDialog::getGradientColorForValue(double value)
+QRgb HeatmapViewDialog::getGradientColorForValue(double value) const
 {
-    // 计算归一化值 (0-1)
+    // 计算归一化值 (0-1)，查 256 级色表
     double range = m_maxValue - m_minValue;
     if (range == 0) range = 1;
     double normalized = (value - m_minValue) / range;
-    
-    // 计算渐变颜色：蓝色(低) -> 绿色 -> 黄色 -> 红色(高)
-    QColor color;
-    if (normalized < 0.33) {
-        double t = normalized / 0.33;
-        color = QColor(
-            int(0 + t * 0),
-            int(0 + t * 255),
-            int(255 - t * 0)
-        );
-    } else if (normalized < 0.66) {
-        double t = (normalized - 0.33) / 0.33;
-        color = QColor(
-            int(0 + t * 255),
-            255,
-            int(255 - t * 255)
-        );
-    } else {
-        double t = (normalized - 0.66) / 0.34;
-        color = QColor(
-            255,
-            int(255 - t * 255),
-            0
-        );
-    }
-    
-    return color;
+    int index = qBound(0, int(normalized * 255 + 0.5), 255);
+    return m_gradientLut[index];
 }
 
 void HeatmapViewDialog::onTypeChanged(int index)
 {
     m_heatmapType = index + 1;
-    update();
+    updateCellColors();
 }
 
 void HeatmapViewDialog::onClose()
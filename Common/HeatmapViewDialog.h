@@ -10,9 +10,12 @@
 #include <QDebug>
 #include <QList>
 #include <QColor>
+#include <QPixmap>
+#include <QVector>
 #include <algorithm>
 #include "ScheduleDialog.h" // 包含 StudentInfo 定义
 #include "HeatmapTypes.h" // 包含 SegmentRange 定义
+#include "TaScoreStats.h"
 
 class HeatmapViewDialog : public QDialog
 {
@@ -23,6 +26,8 @@ public:
     
     // 设置学生数据
     void setStudentData(const QList<struct StudentInfo>& students);
+    // 直接使用已排好序的成绩统计（与 ScheduleDialog 共享，不再重排）
+    void setStudentData(const TaScoreStats& stats);
     
     // 设置分段区间（用于热力图1）
     void setSegments(const QList<struct SegmentRange>& segments);
@@ -32,23 +37,34 @@ public:
 
 protected:
     void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
 
 private slots:
     void onTypeChanged(int index);
     void onClose();
 
 private:
-    void drawSegmentHeatmap(QPainter& painter);
-    void drawGradientHeatmap(QPainter& painter);
+    static const int kStartX = 15; // 热力图区域左上角
+    static const int kStartY = 80;
+    
+    // 数据、分段或类型变化后重算每个格子的颜色，并标记缓存失效
+    void updateCellColors();
+    // 把格子画进 m_cache
+    void renderCache();
     QColor getColorForValue(double value);
-    QColor getGradientColorForValue(double value);
+    QRgb getGradientColorForValue(double value) const;
     
     QComboBox* typeComboBox;
     QPushButton* btnClose;
-    QList<struct StudentInfo> m_students;
+    TaScoreStats m_stats;
+    QVector<double> m_sortedScores; // 从低到高，设置数据时取一次，绘制时不再排序
     QList<struct SegmentRange> m_segments;
     int m_heatmapType; // 1=分段，2=渐变
     double m_minValue;
     double m_maxValue;
+    QVector<QRgb> m_gradientLut; // 256 级渐变色表
+    QVector<QRgb> m_cellColors;  // 与 m_sortedScores 一一对应
+    QPixmap m_cache;             // 画好的格子，重绘时直接贴
+    bool m_cacheDirty;
 };
 
@@ -10,6 +10,7 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QDateTime>
+#include "TaEndpoints.h"
 
 MemberKickDialog::MemberKickDialog(QWidget* parent)
     : QDialog(parent)
@@ -308,7 +309,7 @@ void MemberKickDialog::kickMembersFromServer(const QVector<QString>& memberIds,
         return;
     }
     
-    QString url = "http://47.100.126.194:5000/groups/remove-member";
+    QString url = TaEndpoints::url("/groups/remove-member");
     
     // 使用共享指针来跟踪所有请求的状态
     struct RemoveState {
@@ -16,6 +16,7 @@
 #include <qjsonarray.h>
 #include <qregularexpression.h>
 #include "TABaseDialog.h"
+#include "TaEndpoints.h"
 
 class MemberManagerWidget : public QWidget
 {
@@ -271,7 +272,7 @@ private slots:
                 }
 
                 // 构造删除请求
-                QUrl url("http://47.100.126.194:5000/delete_teacher");
+                QUrl url(TaEndpoints::url("/delete_teacher"));
                 QNetworkRequest request(url);
                 request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
@@ -355,7 +356,7 @@ private slots:
             QByteArray jsonData = doc.toJson();
 
             // 发送 POST 请求
-            QNetworkRequest request(QUrl("http://47.100.126.194:5000/add_teacher"));
+            QNetworkRequest request(QUrl(TaEndpoints::url("/add_teacher")));
             request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
             QNetworkReply* reply = manager_->post(request, jsonData);
@@ -387,7 +388,7 @@ private slots:
 
  private:
     void fetchTeachers(const QString& schoolId) {
-        QString url = QString("http://47.100.126.194:5000/get_list_teachers?schoolId=%1")
+        QString url = TaEndpoints::url("/get_list_teachers?schoolId=%1")
             .arg(schoolId);
         QNetworkRequest request_get;
         request_get.setUrl(QUrl(url));
@@ -17,11 +17,15 @@
 #include <QBrush>
 #include <QColor>
 #include <algorithm>
+#include <cmath>
+#include <climits>
 #include "ScheduleDialog.h"
 #include "ArrangeSeatDialog.h"
 #include <QApplication>
 #include <QDebug>
 #include <QDate>
+#include "TaEndpoints.h"
+#include "TaTableExport.h"
 
 MidtermGradeDialog::MidtermGradeDialog(QString classid, QWidget* parent) : QDialog(parent)
 {
@@ -97,20 +101,41 @@ MidtermGradeDialog::MidtermGradeDialog(QString classid, QWidget* parent) : QDial
     textDescription->setPlainText("说明:该表为期中成绩表。语文总分120、数学总分120");
     mainLayout->addWidget(textDescription);
 
-    // 表格
-    table = new QTableWidget(6, 8); // 初始6行，8列（学号、姓名、语文、数学、英语、总分 + 2个空白列）
-    QStringList headers = { "学号", "姓名", "语文", "数学", "英语", "总分", "", "" };
-    table->setHorizontalHeaderLabels(headers);
+    // 表格：初始6行，8列（学号、姓名、语文、数学、英语、总分 + 2个空白列）
+    // 空白列和后加的列按分数列存，填了文字也照样保留
+    m_grades.insertColumn(0, "学号", TaGradeTable::IdColumn);
+    m_grades.insertColumn(1, "姓名", TaGradeTable::TextColumn);
+    m_grades.insertColumn(2, "语文", TaGradeTable::ScoreColumn);
+    m_grades.insertColumn(3, "数学", TaGradeTable::ScoreColumn);
+    m_grades.insertColumn(4, "英语", TaGradeTable::ScoreColumn);
+    m_grades.insertColumn(5, "总分", TaGradeTable::ScoreColumn);
+    m_grades.insertColumn(6, "", TaGradeTable::ScoreColumn);
+    m_grades.insertColumn(7, "", TaGradeTable::ScoreColumn);
+    m_grades.insertRows(0, 6);
+
+    // 添加示例数据
+    m_grades.setText(0, 2, "100");
+    m_grades.setText(0, 3, "89");
+    m_grades.setText(1, 2, "90");
+    m_grades.setText(1, 3, "78");
+    m_grades.setText(2, 2, "97");
+    m_grades.setText(2, 3, "80");
+    m_grades.setText(3, 2, "67");
+    m_grades.setText(3, 3, "97");
+
+    m_model = new TaGradeTableModel(&m_grades, this);
+    table = new QTableView;
+    table->setModel(m_model);
 
     // 表格样式
     table->setStyleSheet(
-        "QTableWidget { background-color: white; gridline-color: #ddd; }"
-        "QTableWidget::item { padding: 5px; }"
+        "QTableView { background-color: white; gridline-color: #ddd; }"
+        "QTableView::item { padding: 5px; }"
         "QHeaderView::section { background-color: #4169e1; color: white; font-weight: bold; padding: 8px; }"
     );
     table->setAlternatingRowColors(true);
     table->setStyleSheet(table->styleSheet() + 
-        "QTableWidget { alternate-background-color: #e6f3ff; }"
+        "QTableView { alternate-background-color: #e6f3ff; }"
     );
 
     table->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::SelectedClicked);
@@ -118,25 +143,6 @@ MidtermGradeDialog::MidtermGradeDialog(QString classid, QWidget* parent) : QDial
     table->setSelectionMode(QAbstractItemView::SingleSelection);
     table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 
-    // 初始化表格数据
-    for (int row = 0; row < table->rowCount(); ++row) {
-        for (int col = 0; col < table->columnCount(); ++col) {
-            QTableWidgetItem* item = new QTableWidgetItem("");
-            item->setTextAlignment(Qt::AlignCenter);
-            table->setItem(row, col, item);
-        }
-    }
-
-    // 添加示例数据
-    if (table->item(0, 2)) table->item(0, 2)->setText("100");
-    if (table->item(0, 3)) table->item(0, 3)->setText("89");
-    if (table->item(1, 2)) table->item(1, 2)->setText("90");
-    if (table->item(1, 3)) table->item(1, 3)->setText("78");
-    if (table->item(2, 2)) table->item(2, 2)->setText("97");
-    if (table->item(2, 3)) table->item(2, 3)->setText("80");
-    if (table->item(3, 2)) table->item(3, 2)->setText("67");
-    if (table->item(3, 3)) table->item(3, 3)->setText("97");
-
     mainLayout->addWidget(table);
 
     // 固定列索引（不能删除的列）
@@ -160,22 +166,29 @@ MidtermGradeDialog::MidtermGradeDialog(QString classid, QWidget* parent) : QDial
     // 初始化网络管理器
     networkManager = new QNetworkAccessManager(this);
 
-    // 单元格点击和悬浮事件
-    connect(table, &QTableWidget::cellClicked, this, &MidtermGradeDialog::onCellClicked);
-    connect(table, &QTableWidget::cellEntered, this, &MidtermGradeDialog::onCellEntered);
+    // 单元格点击编辑注释；注释由模型作为悬浮提示显示
+    connect(table, &QTableView::clicked, this, &MidtermGradeDialog::onCellClicked);
     table->setMouseTracking(true);
 
     // 右键菜单用于删除行
     table->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(table, &QTableWidget::customContextMenuRequested, this, &MidtermGradeDialog::onTableContextMenu);
+    connect(table, &QTableView::customContextMenuRequested, this, &MidtermGradeDialog::onTableContextMenu);
 }
 
 void MidtermGradeDialog::importData(const QStringList& headers, const QList<QStringList>& dataRows)
 {
-    if (!table) return;
+    beginImport(headers);
+    appendImportRows(dataRows);
+    finishImport();
+}
+
+void MidtermGradeDialog::beginImport(const QStringList& headers)
+{
+    m_importColumns.clear();
+    m_importColumnCount = headers.size();
 
     // 清空现有数据
-    table->setRowCount(0);
+    m_model->clearRows();
 
     // 获取列索引映射
     QMap<QString, int> headerMap;
@@ -183,97 +196,56 @@ void MidtermGradeDialog::importData(const QStringList& headers, const QList<QStr
         headerMap[headers[i]] = i;
     }
 
-    // 获取固定列的索引
-    int colId = -1, colName = -1, colChinese = -1, colMath = -1, colEnglish = -1, colTotal = -1;
-    
-    // 在表格中找到对应的列
-    for (int col = 0; col < table->columnCount(); ++col) {
-        QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
-        if (!headerItem) continue;
-        QString headerText = headerItem->text();
-        
-        if (headerText == "学号") colId = col;
-        else if (headerText == "姓名") colName = col;
-        else if (headerText == "语文") colChinese = col;
-        else if (headerText == "数学") colMath = col;
-        else if (headerText == "英语") colEnglish = col;
-        else if (headerText == "总分") colTotal = col;
+    // 在表格中找到固定列（学号、姓名、语文、数学、英语、总分）对应的源数据列
+    static const QStringList importHeaders = { "学号", "姓名", "语文", "数学", "英语", "总分" };
+    for (int col = 0; col < m_grades.columnCount(); ++col) {
+        QString headerText = m_grades.columnName(col);
+        if (importHeaders.contains(headerText) && headerMap.contains(headerText)) {
+            m_importColumns.append(qMakePair(headerMap[headerText], col));
+        }
     }
+}
 
-    // 导入数据
+void MidtermGradeDialog::appendImportRows(const QList<QStringList>& dataRows)
+{
+    int count = 0;
     for (const QStringList& rowData : dataRows) {
-        if (rowData.size() != headers.size()) continue; // 跳过列数不匹配的行
-
-        int row = table->rowCount();
-        table->insertRow(row);
-
-        // 初始化所有单元格
-        for (int col = 0; col < table->columnCount(); ++col) {
-            QTableWidgetItem* item = new QTableWidgetItem("");
-            item->setTextAlignment(Qt::AlignCenter);
-            table->setItem(row, col, item);
-        }
+        if (rowData.size() == m_importColumnCount) ++count; // 跳过列数不匹配的行
+    }
+    if (count == 0) return;
 
-        // 填充数据
-        if (colId >= 0 && headerMap.contains("学号")) {
-            int srcCol = headerMap["学号"];
-            if (srcCol < rowData.size()) {
-                table->item(row, colId)->setText(rowData[srcCol]);
-            }
-        }
-        if (colName >= 0 && headerMap.contains("姓名")) {
-            int srcCol = headerMap["姓名"];
-            if (srcCol < rowData.size()) {
-                table->item(row, colName)->setText(rowData[srcCol]);
-            }
-        }
-        if (colChinese >= 0 && headerMap.contains("语文")) {
-            int srcCol = headerMap["语文"];
-            if (srcCol < rowData.size()) {
-                table->item(row, colChinese)->setText(rowData[srcCol]);
-            }
-        }
-        if (colMath >= 0 && headerMap.contains("数学")) {
-            int srcCol = headerMap["数学"];
-            if (srcCol < rowData.size()) {
-                table->item(row, colMath)->setText(rowData[srcCol]);
-            }
-        }
-        if (colEnglish >= 0 && headerMap.contains("英语")) {
-            int srcCol = headerMap["英语"];
-            if (srcCol < rowData.size()) {
-                table->item(row, colEnglish)->setText(rowData[srcCol]);
-            }
-        }
-        if (colTotal >= 0 && headerMap.contains("总分")) {
-            int srcCol = headerMap["总分"];
-            if (srcCol < rowData.size()) {
-                table->item(row, colTotal)->setText(rowData[srcCol]);
-            }
+    // 整批一次性加行，直接写入数据模型后统一通知视图
+    int first = m_grades.rowCount();
+    m_model->insertRows(first, count);
+    int row = first;
+    for (const QStringList& rowData : dataRows) {
+        if (rowData.size() != m_importColumnCount) continue;
+        for (const QPair<int, int>& column : m_importColumns) {
+            m_grades.setText(row, column.second, rowData[column.first]);
         }
+        ++row;
     }
+    m_model->rowsUpdated(first, row - 1);
+}
+
+void MidtermGradeDialog::finishImport()
+{
+    m_importColumns.clear();
+    m_importColumnCount = 0;
 }
 
 void MidtermGradeDialog::onAddRow()
 {
-    int currentRow = table->currentRow();
+    int currentRow = table->currentIndex().row();
     if (currentRow < 0) {
-        currentRow = table->rowCount() - 1;
-    }
-    int insertRow = currentRow + 1;
-    table->insertRow(insertRow);
-
-    // 初始化新行的所有单元格
-    for (int col = 0; col < table->columnCount(); ++col) {
-        QTableWidgetItem* item = new QTableWidgetItem("");
-        item->setTextAlignment(Qt::AlignCenter);
-        table->setItem(insertRow, col, item);
+        currentRow = m_grades.rowCount() - 1;
     }
+    m_model->insertRows(currentRow + 1, 1);
 }
 
 void MidtermGradeDialog::onDeleteColumn()
 {
-    int currentCol = table->currentColumn();
+    int currentCol = table->currentIndex().column();
     if (currentCol < 0) {
         QMessageBox::information(this, "提示", "请先选择要删除的列");
         return;
@@ -288,7 +260,7 @@ void MidtermGradeDialog::onDeleteColumn()
     int ret = QMessageBox::question(this, "确认", "确定要删除这一列吗？", 
                                     QMessageBox::Yes | QMessageBox::No);
     if (ret == QMessageBox::Yes) {
-        table->removeColumn(currentCol);
+        m_model->removeColumns(currentCol, 1);
         // 更新固定列索引（删除列后，后续列的索引会变化）
         QSet<int> newFixedColumns;
         for (int col : fixedColumns) {
@@ -316,15 +288,7 @@ void MidtermGradeDialog::onAddColumn()
 
     // 在姓名列后添加
     int insertCol = nameColumnIndex + 1;
-    table->insertColumn(insertCol);
-    table->setHorizontalHeaderItem(insertCol, new QTableWidgetItem(columnName));
-
-    // 初始化新列的所有单元格
-    for (int row = 0; row < table->rowCount(); ++row) {
-        QTableWidgetItem* item = new QTableWidgetItem("");
-        item->setTextAlignment(Qt::AlignCenter);
-        table->setItem(row, insertCol, item);
-    }
+    m_model->insertGradeColumn(insertCol, columnName, TaGradeTable::ScoreColumn);
 
     // 更新固定列索引（插入列后，姓名列之后的固定列索引会变化）
     QSet<int> newFixedColumns;
@@ -341,29 +305,33 @@ void MidtermGradeDialog::onAddColumn()
 
 void MidtermGradeDialog::onFontColor()
 {
-    QTableWidgetItem* item = table->currentItem();
-    if (!item) {
+    QModelIndex index = table->currentIndex();
+    if (!index.isValid()) {
         QMessageBox::information(this, "提示", "请先选择要设置字体颜色的单元格");
         return;
     }
 
-    QColor color = QColorDialog::getColor(item->foreground().color(), this, "选择字体颜色");
+    QVariant current = m_model->data(index, Qt::ForegroundRole);
+    QColor initial = current.isValid() ? current.value<QBrush>().color() : QColor(Qt::black);
+    QColor color = QColorDialog::getColor(initial, this, "选择字体颜色");
     if (color.isValid()) {
-        item->setForeground(QBrush(color));
+        m_model->setData(index, QBrush(color), Qt::ForegroundRole);
     }
 }
 
 void MidtermGradeDialog::onBgColor()
 {
-    QTableWidgetItem* item = table->currentItem();
-    if (!item) {
+    QModelIndex index = table->currentIndex();
+    if (!index.isValid()) {
         QMessageBox::information(this, "提示", "请先选择要设置背景色的单元格");
         return;
     }
 
-    QColor color = QColorDialog::getColor(item->background().color(), this, "选择背景色");
+    QVariant current = m_model->data(index, Qt::BackgroundRole);
+    QColor initial = current.isValid() ? current.value<QBrush>().color() : QColor(Qt::black);
+    QColor color = QColorDialog::getColor(initial, this, "选择背景色");
     if (color.isValid()) {
-        item->setBackground(QBrush(color));
+        m_model->setData(index, QBrush(color), Qt::BackgroundRole);
     }
 }
 
@@ -379,11 +347,22 @@ void MidtermGradeDialog::onAscOrder()
 
 void MidtermGradeDialog::onExport()
 {
-    QString fileName = QFileDialog::getSaveFileName(this, "导出成绩表", "", "CSV文件 (*.csv);;所有文件 (*.*)");
+    QString fileName = QFileDialog::getSaveFileName(this, "导出成绩表", "", "Excel文件 (*.xlsx);;CSV文件 (*.csv);;所有文件 (*.*)");
     if (fileName.isEmpty()) {
         return;
     }
 
+    // xlsx 逐行流式写出，大表导出内存占用恒定
+    if (fileName.endsWith(".xlsx", Qt::CaseInsensitive)) {
+        QString error;
+        if (!TaTableExport::writeXlsx(fileName, "成绩表", m_grades, table, textDescription->toPlainText(), &error)) {
+            QMessageBox::critical(this, "错误", "导出失败：" + error);
+            return;
+        }
+        QMessageBox::information(this, "成功", "导出完成！");
+        return;
+    }
+
     QFile file(fileName);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         QMessageBox::critical(this, "错误", "无法创建文件");
@@ -403,25 +382,19 @@ void MidtermGradeDialog::onExport()
     }
 
     // 导出表头
-    for (int col = 0; col < table->columnCount(); ++col) {
-        QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
-        QString headerText = headerItem ? headerItem->text() : "";
-        if (!headerText.isEmpty()) {
-            out << headerText;
-        }
-        if (col < table->columnCount() - 1) {
+    for (int col = 0; col < m_grades.columnCount(); ++col) {
+        out << m_grades.columnName(col);
+        if (col < m_grades.columnCount() - 1) {
             out << ",";
         }
     }
     out << "\n";
 
     // 导出数据
-    for (int row = 0; row < table->rowCount(); ++row) {
-        for (int col = 0; col < table->columnCount(); ++col) {
-            QTableWidgetItem* item = table->item(row, col);
-            QString text = item ? item->text() : "";
-            out << text;
-            if (col < table->columnCount() - 1) {
+    for (int row = 0; row < m_grades.rowCount(); ++row) {
+        for (int col = 0; col < m_grades.columnCount(); ++col) {
+            out << m_grades.text(row, col);
+            if (col < m_grades.columnCount() - 1) {
                 out << ",";
             }
         }
@@ -437,13 +410,13 @@ void MidtermGradeDialog::onUpload()
     qDebug() << "onUpload() 方法被调用！";
     
     // 检查表格是否有数据
-    if (table->rowCount() == 0) {
+    if (m_grades.rowCount() == 0) {
         qDebug() << "表格中没有数据，无法上传！";
         QMessageBox::warning(this, "提示", "表格中没有数据，无法上传！");
         return;
     }
     
-    qDebug() << "表格有数据，行数:" << table->rowCount();
+    qDebug() << "表格有数据，行数:" << m_grades.rowCount();
 
     // 使用类中的 m_classid
     QString classId = m_classid;
@@ -485,32 +458,30 @@ void MidtermGradeDialog::onUpload()
     QJsonArray scoresArray;
     
     // 获取列索引
-    int colId = -1, colName = -1, colChinese = -1, colMath = -1, colEnglish = -1;
-    for (int col = 0; col < table->columnCount(); ++col) {
-        QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
-        if (!headerItem) continue;
-        QString headerText = headerItem->text();
-        if (headerText == "学号") colId = col;
-        else if (headerText == "姓名") colName = col;
-        else if (headerText == "语文") colChinese = col;
-        else if (headerText == "数学") colMath = col;
-        else if (headerText == "英语") colEnglish = col;
-    }
+    int colId = m_grades.findColumn("学号");
+    int colName = m_grades.findColumn("姓名");
+    int colChinese = m_grades.findColumn("语文");
+    int colMath = m_grades.findColumn("数学");
+    int colEnglish = m_grades.findColumn("英语");
 
     if (colId < 0 || colName < 0) {
         QMessageBox::warning(this, "错误", "表格中缺少必要列：学号、姓名！");
         return;
     }
 
+    // 成绩只上传整数分，直接取分数列的数值
+    auto readScore = [this](QJsonObject& scoreObj, const char* key, int row, int col) {
+        double value = 0;
+        if (col >= 0 && m_grades.number(row, col, &value) &&
+            value == std::floor(value) && std::fabs(value) <= INT_MAX) {
+            scoreObj[key] = int(value);
+        }
+    };
+
     // 读取每一行数据
-    for (int row = 0; row < table->rowCount(); ++row) {
-        QTableWidgetItem* idItem = table->item(row, colId);
-        QTableWidgetItem* nameItem = table->item(row, colName);
-        
-        if (!idItem || !nameItem) continue;
-        
-        QString studentId = idItem->text().trimmed();
-        QString studentName = nameItem->text().trimmed();
+    for (int row = 0; row < m_grades.rowCount(); ++row) {
+        QString studentId = m_grades.text(row, colId).trimmed();
+        QString studentName = m_grades.text(row, colName).trimmed();
         
         // 至少要有学号或姓名
         if (studentId.isEmpty() && studentName.isEmpty()) {
@@ -526,36 +497,9 @@ void MidtermGradeDialog::onUpload()
         }
 
         // 读取成绩
-        if (colChinese >= 0) {
-            QTableWidgetItem* item = table->item(row, colChinese);
-            if (item && !item->text().trimmed().isEmpty()) {
-                bool ok;
-                int score = item->text().toInt(&ok);
-                if (ok) {
-                    scoreObj["chinese"] = score;
-                }
-            }
-        }
-        if (colMath >= 0) {
-            QTableWidgetItem* item = table->item(row, colMath);
-            if (item && !item->text().trimmed().isEmpty()) {
-                bool ok;
-                int score = item->text().toInt(&ok);
-                if (ok) {
-                    scoreObj["math"] = score;
-                }
-            }
-        }
-        if (colEnglish >= 0) {
-            QTableWidgetItem* item = table->item(row, colEnglish);
-            if (item && !item->text().trimmed().isEmpty()) {
-                bool ok;
-                int score = item->text().toInt(&ok);
-                if (ok) {
-                    scoreObj["english"] = score;
-                }
-            }
-        }
+        readScore(scoreObj, "chinese", row, colChinese);
+        readScore(scoreObj, "math", row, colMath);
+        readScore(scoreObj, "english", row, colEnglish);
 
         scoresArray.append(scoreObj);
     }
@@ -579,7 +523,7 @@ void MidtermGradeDialog::onUpload()
     QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
 
     // 发送 POST 请求
-    QString url = "http://47.100.126.194:5000/student-scores/save";
+    QString url = TaEndpoints::url("/student-scores/save");
     QNetworkRequest request;
     request.setUrl(QUrl(url));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
@@ -637,29 +581,17 @@ void MidtermGradeDialog::onUpload()
     });
 }
 
-void MidtermGradeDialog::onCellClicked(int row, int column)
+void MidtermGradeDialog::onCellClicked(const QModelIndex& index)
 {
-    showCellComment(row, column);
-}
-
-void MidtermGradeDialog::onCellEntered(int row, int column)
-{
-    // 鼠标悬浮时显示注释提示
-    QTableWidgetItem* item = table->item(row, column);
-    if (item) {
-        QString comment = item->data(Qt::UserRole).toString();
-        if (!comment.isEmpty()) {
-            QToolTip::showText(QCursor::pos(), comment, table);
-        }
-    }
+    showCellComment(index.row(), index.column());
 }
 
 void MidtermGradeDialog::onTableContextMenu(const QPoint& pos)
 {
-    QTableWidgetItem* item = table->itemAt(pos);
-    if (!item) return;
+    QModelIndex index = table->indexAt(pos);
+    if (!index.isValid()) return;
 
-    int row = item->row();
+    int row = index.row();
     QMenu menu(this);
     
     QAction* editCommentAction = menu.addAction("编辑注释");
@@ -668,66 +600,26 @@ void MidtermGradeDialog::onTableContextMenu(const QPoint& pos)
     QAction* selectedAction = menu.exec(table->viewport()->mapToGlobal(pos));
     
     if (selectedAction == editCommentAction) {
-        showCellComment(row, item->column());
+        showCellComment(row, index.column());
     } else if (selectedAction == deleteRowAction) {
         int ret = QMessageBox::question(this, "确认", "确定要删除这一行吗？", 
                                         QMessageBox::Yes | QMessageBox::No);
         if (ret == QMessageBox::Yes) {
-            table->removeRow(row);
+            m_model->removeRows(row, 1);
         }
     }
 }
 
 void MidtermGradeDialog::sortTable(bool ascending)
 {
-    int sortColumn = table->currentColumn();
+    int sortColumn = table->currentIndex().column();
     if (sortColumn < 0) {
         QMessageBox::information(this, "提示", "请先选择要排序的列");
         return;
     }
 
-    // 获取所有行数据
-    QList<QList<QTableWidgetItem*>> rowsData;
-    for (int row = 0; row < table->rowCount(); ++row) {
-        QList<QTableWidgetItem*> rowData;
-        for (int col = 0; col < table->columnCount(); ++col) {
-            QTableWidgetItem* item = table->item(row, col);
-            if (item) {
-                // 创建新的item副本
-                QTableWidgetItem* newItem = item->clone();
-                rowData.append(newItem);
-            } else {
-                rowData.append(new QTableWidgetItem(""));
-            }
-        }
-        rowsData.append(rowData);
-    }
-
-    // 按指定列排序
-    std::sort(rowsData.begin(), rowsData.end(), [sortColumn, ascending](const QList<QTableWidgetItem*>& a, const QList<QTableWidgetItem*>& b) {
-        if (sortColumn >= a.size() || sortColumn >= b.size()) return false;
-        QString textA = a[sortColumn] ? a[sortColumn]->text() : "";
-        QString textB = b[sortColumn] ? b[sortColumn]->text() : "";
-        
-        // 尝试转换为数字
-        bool okA, okB;
-        double numA = textA.toDouble(&okA);
-        double numB = textB.toDouble(&okB);
-        
-        if (okA && okB) {
-            return ascending ? (numA < numB) : (numA > numB);
-        } else {
-            return ascending ? (textA < textB) : (textA > textB);
-        }
-    });
-
-    // 重新设置表格数据
-    table->setRowCount(rowsData.size());
-    for (int row = 0; row < rowsData.size(); ++row) {
-        for (int col = 0; col < rowsData[row].size(); ++col) {
-            table->setItem(row, col, rowsData[row][col]);
-        }
-    }
+    // 在数据模型的原生数组上排序：数字按数值，其余按文本
+    m_model->sort(sortColumn, ascending ? Qt::AscendingOrder : Qt::DescendingOrder);
 }
 
 void MidtermGradeDialog::openSeatingArrangementDialog()
@@ -736,15 +628,9 @@ void MidtermGradeDialog::openSeatingArrangementDialog()
     QList<StudentInfo> students;
     
     // 获取列索引
-    int colId = -1, colName = -1, colTotal = -1;
-    for (int col = 0; col < table->columnCount(); ++col) {
-        QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
-        if (!headerItem) continue;
-        QString headerText = headerItem->text();
-        if (headerText == "学号") colId = col;
-        else if (headerText == "姓名") colName = col;
-        else if (headerText == "总分") colTotal = col;
-    }
+    int colId = m_grades.findColumn("学号");
+    int colName = m_grades.findColumn("姓名");
+    int colTotal = m_grades.findColumn("总分");
     
     if (colName < 0) {
         QMessageBox::warning(this, "错误", "表格中缺少姓名列！");
@@ -752,33 +638,22 @@ void MidtermGradeDialog::openSeatingArrangementDialog()
     }
     
     // 读取每一行数据
-    for (int row = 0; row < table->rowCount(); ++row) {
-        QTableWidgetItem* nameItem = table->item(row, colName);
-        if (!nameItem || nameItem->text().trimmed().isEmpty()) {
+    for (int row = 0; row < m_grades.rowCount(); ++row) {
+        QString name = m_grades.text(row, colName).trimmed();
+        if (name.isEmpty()) {
             continue; // 跳过空行
         }
         
         StudentInfo student;
-        student.name = nameItem->text().trimmed();
+        student.name = name;
         if (colId >= 0) {
-            QTableWidgetItem* idItem = table->item(row, colId);
-            if (idItem) {
-                student.id = idItem->text().trimmed();
-            }
+            student.id = m_grades.text(row, colId).trimmed();
         }
         
         // 获取总分作为排序依据
+        student.score = 0;
         if (colTotal >= 0) {
-            QTableWidgetItem* totalItem = table->item(row, colTotal);
-            if (totalItem && !totalItem->text().trimmed().isEmpty()) {
-                bool ok;
-                student.score = totalItem->text().toDouble(&ok);
-                if (!ok) student.score = 0;
-            } else {
-                student.score = 0;
-            }
-        } else {
-            student.score = 0;
+            m_grades.number(row, colTotal, &student.score);
         }
         
         student.originalIndex = students.size();
@@ -831,25 +706,21 @@ void MidtermGradeDialog::openSeatingArrangementDialog()
 
 void MidtermGradeDialog::showCellComment(int row, int column)
 {
-    QTableWidgetItem* item = table->item(row, column);
-    if (!item) {
-        item = new QTableWidgetItem("");
-        item->setTextAlignment(Qt::AlignCenter);
-        table->setItem(row, column, item);
-    }
+    QModelIndex index = m_model->index(row, column);
+    if (!index.isValid()) return;
 
-    QString currentComment = item->data(Qt::UserRole).toString();
+    QString currentComment = m_model->data(index, Qt::UserRole).toString();
     bool ok;
     QString comment = QInputDialog::getMultiLineText(this, "单元格注释", 
                                                      QString("单元格 (%1, %2) 的注释:").arg(row + 1).arg(column + 1),
                                                      currentComment, &ok);
     if (ok) {
-        item->setData(Qt::UserRole, comment);
+        m_model->setData(index, comment, Qt::UserRole);
         // 如果有注释，用特殊背景色标记
         if (!comment.isEmpty()) {
-            item->setBackground(QBrush(QColor(255, 255, 200))); // 浅黄色
+            m_model->setData(index, QBrush(QColor(255, 255, 200)), Qt::BackgroundRole); // 浅黄色
         } else {
-            item->setBackground(QBrush()); // 恢复默认
+            m_model->setData(index, QVariant(), Qt::BackgroundRole); // 恢复默认
         }
     }
 }
@@ -2,7 +2,7 @@
 #include <QDialog>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
 #include <QLabel>
 #include <QTextEdit>
@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <QTimer>
 #include <QApplication>
+#include "TaGradeTable.h"
 
 // 前向声明
 class ScheduleDialog;
@@ -57,6 +58,10 @@ public:
     
     // 导入Excel数据
     void importData(const QStringList& headers, const QList<QStringList>& dataRows);
+    // 分批导入：beginImport 清空表格并按表头建立列映射，之后每批数据行调用 appendImportRows，最后 finishImport
+    void beginImport(const QStringList& headers);
+    void appendImportRows(const QList<QStringList>& dataRows);
+    void finishImport();
 
 private slots:
     void onAddRow();
@@ -68,8 +73,7 @@ private slots:
     void onAscOrder();
     void onExport();
     void onUpload();
-    void onCellClicked(int row, int column);
-    void onCellEntered(int row, int column);
+    void onCellClicked(const QModelIndex& index);
     void onTableContextMenu(const QPoint& pos);
 
 private:
@@ -78,7 +82,9 @@ private:
     void showCellComment(int row, int column);
 
 private:
-    QTableWidget* table;
+    QTableView* table;
+    TaGradeTable m_grades;        // 表格数据，导出、上传、排座都从这里读
+    TaGradeTableModel* m_model;
     QTextEdit* textDescription;
     QPushButton* btnAddRow;
     QPushButton* btnDeleteColumn;
@@ -94,4 +100,6 @@ private:
     QSet<int> fixedColumns; // 固定列索引集合（不能删除的列）
     int nameColumnIndex; // 姓名列索引
     QString m_classid;
+    QList<QPair<int, int>> m_importColumns; // 导入中：源数据列 -> 表格列
+    int m_importColumnCount = 0;            // 导入中：源数据的列数
 };
@@ -3,6 +3,7 @@
 #include <qpainterpath>
 #include <QRegExp>
 #include <QMessageBox>
+#include "TaEndpoints.h"
 
 ModalDialog::ModalDialog(QWidget* parent)
     : QDialog(parent), m_dragging(false),
@@ -357,7 +358,7 @@ void ModalDialog::onGetCodeClicked()
     {
         QMap<QString, QString> params;
         params["phone"] = phoneEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/send_verification_code"), params);
+        m_httpHandler->post(TaEndpoints::url("/send_verification_code"), params);
     }
 }
 
@@ -393,6 +394,6 @@ void ModalDialog::onLoginClicked()
         QMap<QString, QString> params;
         params["phone"] = phoneEdit->text();
         params["verification_code"] = codeEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/login"), params);
+        m_httpHandler->post(TaEndpoints::url("/login"), params);
     }
 }
\ No newline at end of file
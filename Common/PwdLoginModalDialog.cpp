@@ -3,6 +3,7 @@
 #include <qpainterpath>
 #include <QRegExp>
 #include <QMessageBox>
+#include "TaEndpoints.h"
 
 PwdLoginModalDialog::PwdLoginModalDialog(QWidget* parent)
     : QDialog(parent), m_dragging(false),
@@ -414,7 +415,7 @@ void PwdLoginModalDialog::onLoginClicked()
         QMap<QString, QString> params;
         params["phone"] = phoneEdit->text();
         params["password"] = codeEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/login"), params);
+        m_httpHandler->post(TaEndpoints::url("/login"), params);
     }
     //accept(); // 验证通过，关闭对话框并返回 Accepted
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <QHeaderView>
 #include <QCheckBox>
 #include <qmessagebox.h>
+#include "TaEndpoints.h"
 
 QClassMgr::QClassMgr(QWidget *parent)
 	: QWidget(parent)
@@ -167,7 +168,7 @@ QClassMgr::QClassMgr(QWidget *parent)
 
             QJsonDocument jsonDoc(jsonArray);
             QByteArray jsonData = jsonDoc.toJson();
-            m_httpHandler->post(QString("http://47.100.126.194:5000/updateClasses"), jsonData);
+            m_httpHandler->post(TaEndpoints::url("/updateClasses"), jsonData);
         }
 	});
 
@@ -263,7 +264,7 @@ void QClassMgr::initData()
 
     // 网络请求
     QNetworkAccessManager* manager = new QNetworkAccessManager(this);
-    QNetworkRequest request(QUrl("http://47.100.126.194:5000/getClassesByPrefix")); // 改成你的接口地址
+    QNetworkRequest request(QUrl(TaEndpoints::url("/getClassesByPrefix"))); // 改成你的接口地址
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
     QNetworkReply* reply = manager->post(request, reqData);
@@ -3,6 +3,7 @@
 #include "ClassTeacherDelDialog.h"
 #include "FriendSelectDialog.h"
 #include "MemberKickDialog.h"
+#include "TaEndpoints.h"
 
 // 解散群聊回调数据结构
 struct DismissGroupCallbackData {
@@ -585,7 +586,7 @@ void QGroupInfo::sendExitGroupRequestToServer(const QString& groupId, const QStr
     QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
     
     // 发送POST请求到服务器
-    QString url = "http://47.100.126.194:5000/groups/leave";
+    QString url = TaEndpoints::url("/groups/leave");
     
     // 使用QNetworkAccessManager发送POST请求
     QNetworkAccessManager* manager = new QNetworkAccessManager(this);
@@ -720,7 +721,7 @@ void QGroupInfo::sendDismissGroupRequestToServer(const QString& groupId, const Q
     QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
     
     // 发送POST请求到服务器（假设解散接口为 /groups/dismiss，如果不同请修改）
-    QString url = "http://47.100.126.194:5000/groups/dismiss";
+    QString url = TaEndpoints::url("/groups/dismiss");
     
     // 使用QNetworkAccessManager发送POST请求
     QNetworkAccessManager* manager = new QNetworkAccessManager(this);
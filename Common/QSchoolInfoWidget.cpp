@@ -7,6 +7,7 @@
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include "UniqueNumberGenerator.h"
+#include "TaEndpoints.h"
 
 QSchoolInfoWidget::QSchoolInfoWidget(QWidget *parent)
 	: QWidget(parent)
@@ -70,7 +71,7 @@ QSchoolInfoWidget::QSchoolInfoWidget(QWidget *parent)
                         params["id"] = obj["code"].toString();
                         params["name"] = m_userInfo.strSchoolName;
                         params["address"] = m_userInfo.strAddress;
-                        m_httpHandler->post(QString("http://47.100.126.194:5000/updateSchoolInfo"), params);
+                        m_httpHandler->post(TaEndpoints::url("/updateSchoolInfo"), params);
                     }
                 }
             }
@@ -136,10 +137,10 @@ QSchoolInfoWidget::QSchoolInfoWidget(QWidget *parent)
         //UniqueNumberGenerator gen;
         //lblCode->setText(QString::number(gen.generate()));
 
-        QUrl url("http://47.100.126.194:5000/unique6digit"); // MySQL+Redis服务端
+        QUrl url(TaEndpoints::url("/unique6digit")); // MySQL+Redis服务端
         if (lblCode->text().isEmpty() && m_httpHandler)
         {
-            m_httpHandler->get("http://47.100.126.194:5000/unique6digit");
+            m_httpHandler->get(TaEndpoints::url("/unique6digit"));
         }
      });
 
@@ -189,7 +190,7 @@ void QSchoolInfoWidget::InitData(UserInfo userInfo)
 
     if (m_httpHandler)
     {
-        QString qUrl("http://47.100.126.194:5000/schools?name=");
+        QString qUrl(TaEndpoints::url("/schools?name="));
         qUrl += m_userInfo.strSchoolName;
         m_httpHandler->get(qUrl);
     }
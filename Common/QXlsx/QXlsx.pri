@@ -3,10 +3,10 @@
 ########################################
 
 QT += core
-QT += gui-private
+QT += gui
 
 # TODO: Define your C++ version. c++14, c++17, etc.
-CONFIG += c++11
+CONFIG += c++17
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which has been marked as deprecated (the exact warnings
@@ -65,6 +65,9 @@ $${QXLSX_HEADERPATH}xlsxcelllocation.h \
 $${QXLSX_HEADERPATH}xlsxcellrange.h \
 $${QXLSX_HEADERPATH}xlsxcellreference.h \
 $${QXLSX_HEADERPATH}xlsxcell_p.h \
+$${QXLSX_HEADERPATH}xlsxcelltable_p.h \
+$${QXLSX_HEADERPATH}xlsxformulaengine_p.h \
+$${QXLSX_HEADERPATH}xlsxsheetdataparser_p.h \
 $${QXLSX_HEADERPATH}xlsxchart.h \
 $${QXLSX_HEADERPATH}xlsxchartsheet.h \
 $${QXLSX_HEADERPATH}xlsxchartsheet_p.h \
@@ -90,6 +93,10 @@ $${QXLSX_HEADERPATH}xlsxnumformatparser_p.h \
 $${QXLSX_HEADERPATH}xlsxrelationships_p.h \
 $${QXLSX_HEADERPATH}xlsxrichstring.h \
 $${QXLSX_HEADERPATH}xlsxrichstring_p.h \
+$${QXLSX_HEADERPATH}xlsxrowreader.h \
+$${QXLSX_HEADERPATH}xlsxrowreader_p.h \
+$${QXLSX_HEADERPATH}xlsxrowwriter.h \
+$${QXLSX_HEADERPATH}xlsxrowwriter_p.h \
 $${QXLSX_HEADERPATH}xlsxsharedstrings_p.h \
 $${QXLSX_HEADERPATH}xlsxsimpleooxmlfile_p.h \
 $${QXLSX_HEADERPATH}xlsxstyles_p.h \
@@ -108,6 +115,9 @@ $${QXLSX_SOURCEPATH}xlsxabstractsheet.cpp \
 $${QXLSX_SOURCEPATH}xlsxcell.cpp \
 $${QXLSX_SOURCEPATH}xlsxcellformula.cpp \
 $${QXLSX_SOURCEPATH}xlsxcelllocation.cpp \
+$${QXLSX_SOURCEPATH}xlsxcelltable.cpp \
+$${QXLSX_SOURCEPATH}xlsxformulaengine.cpp \
+$${QXLSX_SOURCEPATH}xlsxsheetdataparser.cpp \
 $${QXLSX_SOURCEPATH}xlsxcellrange.cpp \
 $${QXLSX_SOURCEPATH}xlsxcellreference.cpp \
 $${QXLSX_SOURCEPATH}xlsxchart.cpp \
@@ -127,6 +137,8 @@ $${QXLSX_SOURCEPATH}xlsxmediafile.cpp \
 $${QXLSX_SOURCEPATH}xlsxnumformatparser.cpp \
 $${QXLSX_SOURCEPATH}xlsxrelationships.cpp \
 $${QXLSX_SOURCEPATH}xlsxrichstring.cpp \
+$${QXLSX_SOURCEPATH}xlsxrowreader.cpp \
+$${QXLSX_SOURCEPATH}xlsxrowwriter.cpp \
 $${QXLSX_SOURCEPATH}xlsxsharedstrings.cpp \
 $${QXLSX_SOURCEPATH}xlsxsimpleooxmlfile.cpp \
 $${QXLSX_SOURCEPATH}xlsxstyles.cpp \
@@ -137,6 +149,21 @@ $${QXLSX_SOURCEPATH}xlsxworksheet.cpp \
 $${QXLSX_SOURCEPATH}xlsxzipreader.cpp \
 $${QXLSX_SOURCEPATH}xlsxzipwriter.cpp
 
+# zip layer: zlib bundled in QXLSX_PARENTPATH/zlib
+INCLUDEPATH += $${QXLSX_PARENTPATH}zlib
+
+SOURCES += \
+$${QXLSX_PARENTPATH}zlib/adler32.c \
+$${QXLSX_PARENTPATH}zlib/compress.c \
+$${QXLSX_PARENTPATH}zlib/crc32.c \
+$${QXLSX_PARENTPATH}zlib/deflate.c \
+$${QXLSX_PARENTPATH}zlib/inffast.c \
+$${QXLSX_PARENTPATH}zlib/inflate.c \
+$${QXLSX_PARENTPATH}zlib/inftrees.c \
+$${QXLSX_PARENTPATH}zlib/trees.c \
+$${QXLSX_PARENTPATH}zlib/uncompr.c \
+$${QXLSX_PARENTPATH}zlib/zutil.c
+
 
 ########################################
 # custom setting for compiler & system
@@ -0,0 +1,481 @@
+// qxlsx_bench.cpp
+//
+// Generates synthetic workbooks and times the main QXlsx paths on them:
+// building a Document and saving it, streaming the same data with RowWriter,
+// opening, scanning with read()/readRange()/RowReader, and recalculating
+// formulas. Results are written as JSON, one record per (variant, size,
+// phase), so runs can be compared by a script.
+//
+//     qxlsx_bench --cells 10000,100000,1000000 --variant all --output bench.json
+//
+// Peak RSS is the peak of the whole process. To get it per case, run one
+// variant and size per process.
+//
+// The store and store_scan phases build the cells in memory only and scan
+// them back. With --layout qmap they run on the layout the worksheet used
+// before CellTable, a QMap of rows holding QMaps of shared_ptr<Cell>, built
+// with the same Cell constructor calls as the old write paths. That mode
+// runs only these two phases. Compare the layouts one per process:
+//
+//     qxlsx_bench --variant numeric --cells 2000000 --layout cell_table
+//     qxlsx_bench --variant numeric --cells 2000000 --layout qmap
+//
+// store_rss_bytes is the growth of the resident set while the first store
+// runs, so it is only meaningful in a fresh process.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "xlsxcell.h"
+#include "xlsxcellrange.h"
+#include "xlsxdocument.h"
+#include "xlsxformat.h"
+#include "xlsxrowreader.h"
+#include "xlsxrowwriter.h"
+#include "xlsxworksheet.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+using namespace QXlsx;
+
+namespace {
+
+const int Columns = 20;
+
+enum Variant
+{
+    Numeric,    // doubles only, like a grade sheet
+    Strings,    // names and comments, half of them repeated
+    Styled      // numbers with one of 64 formats
+};
+
+enum Layout
+{
+    CellTableLayout, // the worksheet as it is
+    QMapLayout       // baseline: the nested QMaps used before CellTable
+};
+
+typedef QMap<int, QMap<int, std::shared_ptr<Cell> > > QMapCells;
+
+qint64 peakRss()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return qint64(counters.PeakWorkingSetSize);
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#ifdef Q_OS_MACOS
+    return qint64(usage.ru_maxrss);
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// Resident set now; -1 where it is not available
+qint64 currentRss()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return qint64(counters.WorkingSetSize);
+    return -1;
+#elif defined(Q_OS_LINUX)
+    FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (!statm)
+        return -1;
+    long size = 0;
+    long resident = 0;
+    const bool ok = std::fscanf(statm, "%ld %ld", &size, &resident) == 2;
+    std::fclose(statm);
+    return ok ? qint64(resident) * sysconf(_SC_PAGESIZE) : -1;
+#else
+    return -1;
+#endif
+}
+
+QString variantName(Variant variant)
+{
+    switch (variant) {
+    case Numeric: return QStringLiteral("numeric");
+    case Strings: return QStringLiteral("string");
+    default: return QStringLiteral("style");
+    }
+}
+
+QVector<Format> makeFormats()
+{
+    static const char *const numberFormats[] = { "0", "0.00", "0.0%", "yyyy-mm-dd" };
+    QVector<Format> formats;
+    for (int i = 0; i < 64; ++i) {
+        Format format;
+        format.setFontBold(i & 1);
+        format.setFontColor(QColor::fromHsv((i * 37) % 360, 200, 160));
+        format.setPatternBackgroundColor(QColor::fromHsv((i * 53) % 360, 40, 250));
+        format.setNumberFormat(QLatin1String(numberFormats[(i >> 1) % 4]));
+        formats.append(format);
+    }
+    return formats;
+}
+
+// Deterministic content, the same for every run
+QVariant cellValue(Variant variant, int row, int col)
+{
+    const quint32 seed = quint32(row) * 2654435761u ^ quint32(col) * 40503u;
+    if (variant == Strings) {
+        if (col == 1)
+            return QStringLiteral("Student %1").arg(row);
+        if (seed % 2)
+            return QStringLiteral("Comment %1 on row %2").arg(col).arg(row);
+        return QStringLiteral("Grade %1").arg(QChar(QLatin1Char('A' + seed % 5)));
+    }
+    return double(seed % 10000) / 100.0;
+}
+
+QVector<QVariant> rowValues(Variant variant, int row)
+{
+    QVector<QVariant> values;
+    values.reserve(Columns);
+    for (int col = 1; col <= Columns; ++col)
+        values.append(cellValue(variant, row, col));
+    return values;
+}
+
+QString layoutName(Layout layout)
+{
+    return layout == QMapLayout ? QStringLiteral("qmap") : QStringLiteral("cell_table");
+}
+
+class Bench
+{
+public:
+    Bench(const QString &directory, int repeat, Layout layout) :
+        m_directory(directory), m_repeat(repeat), m_layout(layout), m_formats(makeFormats())
+    {
+    }
+
+    void run(Variant variant, int cells)
+    {
+        const int rows = qMax(1, cells / Columns);
+        const QString documentFile = m_directory + QStringLiteral("/%1-%2-document.xlsx").arg(variantName(variant)).arg(cells);
+        const QString streamFile = m_directory + QStringLiteral("/%1-%2-stream.xlsx").arg(variantName(variant)).arg(cells);
+        const qint64 count = qint64(rows) * Columns;
+
+        auto record = [&](const QString &phase, const QVector<double> &times, const QString &file, qint64 storeBytes = -1) {
+            QVector<double> sorted = times;
+            std::sort(sorted.begin(), sorted.end());
+            const double median = sorted.at(sorted.size() / 2);
+            QJsonObject result;
+            result.insert(QStringLiteral("variant"), variantName(variant));
+            result.insert(QStringLiteral("layout"), layoutName(m_layout));
+            result.insert(QStringLiteral("cells"), double(count));
+            result.insert(QStringLiteral("rows"), rows);
+            result.insert(QStringLiteral("columns"), Columns);
+            result.insert(QStringLiteral("phase"), phase);
+            result.insert(QStringLiteral("repeat"), sorted.size());
+            result.insert(QStringLiteral("ms"), median);
+            result.insert(QStringLiteral("ms_min"), sorted.first());
+            result.insert(QStringLiteral("ms_max"), sorted.last());
+            result.insert(QStringLiteral("cells_per_second"), median > 0 ? count * 1000.0 / median : 0.0);
+            if (!file.isEmpty())
+                result.insert(QStringLiteral("file_bytes"), double(QFileInfo(file).size()));
+            if (storeBytes >= 0)
+                result.insert(QStringLiteral("store_rss_bytes"), double(storeBytes));
+            result.insert(QStringLiteral("peak_rss_bytes"), double(peakRss()));
+            m_results.append(result);
+            QTextStream(stderr) << variantName(variant) << ' ' << layoutName(m_layout) << ' ' << count << ' '
+                                << phase << ": " << median << " ms\n";
+        };
+
+        // First, so that the resident set has not grown yet
+        qint64 storeBytes = -1;
+        if (m_layout == QMapLayout) {
+            const QVector<double> times = measure([&] {
+                const qint64 before = currentRss();
+                QMapCells table;
+                storeQMap(variant, rows, table);
+                if (storeBytes < 0 && before >= 0)
+                    storeBytes = currentRss() - before;
+            });
+            record(QStringLiteral("store"), times, QString(), storeBytes);
+
+            QMapCells table;
+            storeQMap(variant, rows, table);
+            record(QStringLiteral("store_scan"), measure([&] { scanQMap(table, rows); }), QString());
+            return;
+        }
+
+        const QVector<double> times = measure([&] {
+            const qint64 before = currentRss();
+            Document document;
+            store(variant, rows, document);
+            if (storeBytes < 0 && before >= 0)
+                storeBytes = currentRss() - before;
+        });
+        record(QStringLiteral("store"), times, QString(), storeBytes);
+        {
+            Document document;
+            store(variant, rows, document);
+            record(QStringLiteral("store_scan"), measure([&] { scanCells(document, rows); }), QString());
+        }
+
+        record(QStringLiteral("write_save"), measure([&] { writeDocument(variant, rows, documentFile); }), documentFile);
+        record(QStringLiteral("rowwriter_save"), measure([&] { writeStream(variant, rows, streamFile); }), streamFile);
+        record(QStringLiteral("open"), measure([&] { Document document(documentFile); }), documentFile);
+        record(QStringLiteral("open_parallel"), measure([&] {
+            Document document(documentFile, Document::ParallelLoad | Document::ParallelSharedStrings);
+        }), documentFile);
+
+        {
+            Document document(documentFile);
+            record(QStringLiteral("read_scan"), measure([&] { scanCells(document, rows); }), QString());
+            record(QStringLiteral("read_range"), measure([&] {
+                const QVector<QVariant> values = document.readRange(CellRange(1, 1, rows, Columns));
+                m_sink += values.size();
+            }), QString());
+            record(QStringLiteral("save"), measure([&] { document.saveAs(documentFile); }), documentFile);
+        }
+
+        record(QStringLiteral("rowreader_scan"), measure([&] { scanStream(documentFile); }), QString());
+
+        if (variant == Numeric)
+            record(QStringLiteral("formula_recalc"), measure([&] { recalculate(rows); }), QString());
+    }
+
+    QJsonObject report() const
+    {
+        QJsonObject report;
+        report.insert(QStringLiteral("benchmark"), QStringLiteral("qxlsx_bench"));
+        report.insert(QStringLiteral("qt"), QLatin1String(qVersion()));
+        report.insert(QStringLiteral("os"), QSysInfo::prettyProductName());
+        report.insert(QStringLiteral("cpu"), QSysInfo::currentCpuArchitecture());
+        report.insert(QStringLiteral("date"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+        report.insert(QStringLiteral("results"), m_results);
+        return report;
+    }
+
+private:
+    QVector<double> measure(const std::function<void ()> &job)
+    {
+        QVector<double> times;
+        for (int i = 0; i < m_repeat; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            job();
+            times.append(timer.nsecsElapsed() / 1e6);
+        }
+        return times;
+    }
+
+    void writeDocument(Variant variant, int rows, const QString &file)
+    {
+        Document document;
+        store(variant, rows, document);
+        document.saveAs(file);
+    }
+
+    void store(Variant variant, int rows, Document &document)
+    {
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= Columns; ++col) {
+                if (variant == Styled)
+                    document.write(row, col, cellValue(variant, row, col), m_formats.at((row * 7 + col) % m_formats.size()));
+                else
+                    document.write(row, col, cellValue(variant, row, col));
+            }
+        }
+    }
+
+    // The cells the old write paths created: one Cell per value, numbers as
+    // NumberType and text as SharedStringType
+    void storeQMap(Variant variant, int rows, QMapCells &cells)
+    {
+        for (int row = 1; row <= rows; ++row) {
+            QMap<int, std::shared_ptr<Cell> > &cellsOfRow = cells[row];
+            for (int col = 1; col <= Columns; ++col) {
+                const QVariant value = cellValue(variant, row, col);
+                const Cell::CellType type = variant == Strings ? Cell::SharedStringType : Cell::NumberType;
+                const Format format = variant == Styled ? m_formats.at((row * 7 + col) % m_formats.size()) : Format();
+                cellsOfRow.insert(col, std::make_shared<Cell>(value, type, format));
+            }
+        }
+    }
+
+    // What the old cellAt() and read() did per cell
+    void scanQMap(const QMapCells &cells, int rows)
+    {
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= Columns; ++col) {
+                auto rowIt = cells.constFind(row);
+                if (rowIt == cells.constEnd())
+                    continue;
+                auto cellIt = rowIt->constFind(col);
+                if (cellIt != rowIt->constEnd())
+                    m_sink += (*cellIt)->value().isValid();
+            }
+        }
+    }
+
+    void writeStream(Variant variant, int rows, const QString &file)
+    {
+        RowWriter writer(file);
+        QVector<Format> formats(Columns);
+        for (int row = 1; row <= rows; ++row) {
+            if (variant == Styled) {
+                for (int col = 1; col <= Columns; ++col)
+                    formats[col - 1] = m_formats.at((row * 7 + col) % m_formats.size());
+                writer.appendRow(rowValues(variant, row), formats);
+            } else {
+                writer.appendRow(rowValues(variant, row));
+            }
+        }
+        writer.close();
+    }
+
+    void scanCells(const Document &document, int rows)
+    {
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= Columns; ++col)
+                m_sink += document.read(row, col).isValid();
+        }
+    }
+
+    void scanStream(const QString &file)
+    {
+        RowReader reader(file);
+        while (reader.readNextRow()) {
+            for (const CellView &cell : reader.cells())
+                m_sink += cell.value().isValid();
+        }
+    }
+
+    // One SUM per row and a RANK of it within its block of 100 rows; then
+    // every 100th input changes and the ranks are read back
+    void recalculate(int rows)
+    {
+        Document document;
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= Columns; ++col)
+                document.write(row, col, cellValue(Numeric, row, col));
+            document.write(row, Columns + 1, QStringLiteral("=SUM(A%1:T%1)").arg(row));
+            const int first = (row - 1) / 100 * 100 + 1;
+            document.write(row, Columns + 2, QStringLiteral("=RANK(U%1,U$%2:U$%3)").arg(row).arg(first).arg(first + 99));
+        }
+        for (int row = 1; row <= rows; row += 100)
+            document.write(row, 1, double(row % 97));
+        for (int row = 1; row <= rows; ++row)
+            m_sink += document.readValue(row, Columns + 2).toInt();
+    }
+
+    const QString m_directory;
+    const int m_repeat;
+    const Layout m_layout;
+    const QVector<Format> m_formats;
+    QJsonArray m_results;
+    qint64 m_sink = 0; // keeps the scans from being optimized away
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("qxlsx_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Times QXlsx load, read and save paths on synthetic workbooks."));
+    parser.addHelpOption();
+    QCommandLineOption cellsOption(QStringLiteral("cells"), QStringLiteral("Comma separated cell counts."),
+                                   QStringLiteral("list"), QStringLiteral("10000,100000,1000000"));
+    QCommandLineOption variantOption(QStringLiteral("variant"), QStringLiteral("numeric, string, style or all."),
+                                     QStringLiteral("name"), QStringLiteral("all"));
+    QCommandLineOption repeatOption(QStringLiteral("repeat"), QStringLiteral("Runs per phase; the median is reported."),
+                                    QStringLiteral("count"), QStringLiteral("3"));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("JSON file, stdout when omitted."),
+                                    QStringLiteral("file"));
+    QCommandLineOption directoryOption(QStringLiteral("directory"), QStringLiteral("Where workbooks are written; a temporary directory by default."),
+                                       QStringLiteral("path"));
+    QCommandLineOption layoutOption(QStringLiteral("layout"), QStringLiteral("cell_table, or qmap for the store phases on the pre-CellTable layout."),
+                                    QStringLiteral("name"), QStringLiteral("cell_table"));
+    parser.addOptions({ cellsOption, variantOption, repeatOption, outputOption, directoryOption, layoutOption });
+    parser.process(app);
+
+    QVector<int> sizes;
+    for (const QString &size : parser.value(cellsOption).split(QLatin1Char(','))) {
+        bool ok;
+        const int cells = size.trimmed().toInt(&ok);
+        if (!ok || cells <= 0) {
+            QTextStream(stderr) << "invalid cell count: " << size << '\n';
+            return 1;
+        }
+        sizes.append(cells);
+    }
+
+    QVector<Variant> variants;
+    const QString variant = parser.value(variantOption);
+    if (variant == QLatin1String("numeric") || variant == QLatin1String("all"))
+        variants.append(Numeric);
+    if (variant == QLatin1String("string") || variant == QLatin1String("all"))
+        variants.append(Strings);
+    if (variant == QLatin1String("style") || variant == QLatin1String("all"))
+        variants.append(Styled);
+    if (variants.isEmpty()) {
+        QTextStream(stderr) << "unknown variant: " << variant << '\n';
+        return 1;
+    }
+
+    const QString layout = parser.value(layoutOption);
+    if (layout != QLatin1String("cell_table") && layout != QLatin1String("qmap")) {
+        QTextStream(stderr) << "unknown layout: " << layout << '\n';
+        return 1;
+    }
+
+    QTemporaryDir temporary;
+    const QString directory = parser.isSet(directoryOption) ? parser.value(directoryOption) : temporary.path();
+    Bench bench(directory, qMax(1, parser.value(repeatOption).toInt()),
+                layout == QLatin1String("qmap") ? QMapLayout : CellTableLayout);
+    for (Variant v : qAsConst(variants)) {
+        for (int cells : qAsConst(sizes))
+            bench.run(v, cells);
+    }
+
+    const QByteArray json = QJsonDocument(bench.report()).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            QTextStream(stderr) << "cannot write " << file.fileName() << '\n';
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -68,6 +68,7 @@ public:
 
 	bool isDateTime() const;
     QVariant dateTime() const; // QDateTime, QDate, QTime
+	QString displayText() const;
 
 	bool isRichString() const;
 
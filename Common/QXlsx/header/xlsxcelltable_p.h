@@ -0,0 +1,116 @@
+// xlsxcelltable_p.h
+
+#ifndef XLSXCELLTABLE_P_H
+#define XLSXCELLTABLE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "xlsxglobal.h"
+#include "xlsxcell.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+struct CellTableBlock;
+
+// Cell storage of one worksheet.
+//
+// Rows are grouped into blocks of RowBlockSize rows. Inside a block each
+// column up to DenseColumnLimit is a set of typed vectors indexed by the row
+// offset, so a plain number or a plain shared string costs a double or an int
+// plus a style index, without any Cell object. Everything else (formulas,
+// rich text, booleans, dates, ...) and every column past DenseColumnLimit is
+// kept as a Cell in the sparse map of the block.
+//
+// Rows and columns are 1-based, as everywhere in the Worksheet API.
+class CellTable
+{
+public:
+    enum SlotType
+    {
+        EmptySlot = 0,
+        NumberSlot,       // Cell::NumberType, see number()
+        CustomNumberSlot, // Cell::CustomType holding a number (<c> without "t")
+        SharedStringSlot, // Cell::SharedStringType, see sharedStringIndex()
+        CellSlot          // see cell()
+    };
+
+    enum {
+        RowBlockSize = 64,
+        DenseColumnLimit = 256
+    };
+
+    CellTable();
+    ~CellTable();
+
+    bool isEmpty() const;
+    int cellCount() const;
+    void clear();
+
+    // Rows holding at least one cell; -1 when there is none.
+    int firstRow() const;
+    int lastRow() const;
+    int nextRow(int row) const;
+    bool hasRow(int row) const;
+
+    // Used columns of \a row in ascending order; -1 when there is none.
+    int firstColumn(int row) const;
+    int lastColumn(int row) const;
+    int nextColumn(int row, int col) const;
+
+    SlotType slotType(int row, int col) const;
+    bool contains(int row, int col) const { return slotType(row, col) != EmptySlot; }
+
+    // Valid for NumberSlot and CustomNumberSlot
+    double number(int row, int col) const;
+    // Valid for SharedStringSlot
+    int sharedStringIndex(int row, int col) const;
+    // Valid for the dense slots; -1 means no style
+    int styleIndex(int row, int col) const;
+    // Valid for CellSlot, null otherwise
+    std::shared_ptr<Cell> cell(int row, int col) const;
+
+    // The dense setters return false for columns past DenseColumnLimit,
+    // the caller then stores a Cell instead.
+    bool setNumber(int row, int col, double value, int styleIndex, bool custom = false);
+    bool setSharedString(int row, int col, int sstIndex, int styleIndex);
+    void setCell(int row, int col, const std::shared_ptr<Cell> &cell);
+
+    // Dense slots of column \a col between \a firstRow and \a lastRow, one
+    // call per row block: \a types and \a values hold \a count consecutive
+    // rows starting at \a row. Values are only meaningful for NumberSlot and
+    // CustomNumberSlot. Lets range aggregates run over plain arrays.
+    typedef std::function<void (int row, const quint8 *types, const double *values, int count)> NumberRunVisitor;
+    void visitNumberRuns(int col, int firstRow, int lastRow, const NumberRunVisitor &visitor) const;
+    // Cell objects (CellSlot) inside the rectangle, row by row
+    typedef std::function<void (int row, int col, const std::shared_ptr<Cell> &cell)> CellVisitor;
+    void visitCells(int firstRow, int lastRow, int firstCol, int lastCol, const CellVisitor &visitor) const;
+
+private:
+    Q_DISABLE_COPY(CellTable)
+
+    CellTableBlock *block(int row) const;
+    CellTableBlock *ensureBlock(int row);
+    void occupy(CellTableBlock *block, int offset, int col, SlotType previous);
+
+    std::vector<std::unique_ptr<CellTableBlock> > m_blocks;
+    int m_count;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXCELLTABLE_P_H
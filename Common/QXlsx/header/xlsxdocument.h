@@ -30,9 +30,22 @@ class QXLSX_EXPORT Document : public QObject
     Q_DECLARE_PRIVATE(Document) // D-Pointer. Qt classes have a Q_DECLARE_PRIVATE
                                 // macro in the public class. The macro reads: qglobal.h
 public:
+	enum LoadOption
+	{
+		SequentialLoad = 0x0,
+		ParallelLoad = 0x1,          // inflate the parts and read the sheets on a thread pool
+		ParallelSharedStrings = 0x2, // with ParallelLoad, read sharedStrings.xml alongside the sheets
+		LazySheets = 0x4,            // read a sheet the first time it is accessed, not when opening
+		SkipDrawings = 0x8           // ignore the drawings, charts and pictures of worksheets; they are
+		                             // lost when the document is saved, use for data-only imports
+	};
+	Q_DECLARE_FLAGS(LoadOptions, LoadOption)
+
 	explicit Document(QObject *parent = nullptr);
 	Document(const QString& xlsxName, QObject* parent = nullptr);
 	Document(QIODevice* device, QObject* parent = nullptr);
+	Document(const QString& xlsxName, LoadOptions options, QObject* parent = nullptr);
+	Document(QIODevice* device, LoadOptions options, QObject* parent = nullptr);
 	~Document();
 
 	bool write(const CellReference &cell, const QVariant &value, const Format &format=Format());
@@ -40,6 +53,13 @@ public:
 	
 	QVariant read(const CellReference &cell) const;
 	QVariant read(int row, int col) const;
+	QVariant readValue(const CellReference &cell) const;
+	QVariant readValue(int row, int col) const;
+
+	QVector<QVariant> readRange(const CellRange &range) const;
+	bool writeRange(const CellRange &range, const QVector<QVariant> &values, const Format &format=Format());
+	CellRange usedRange() const;
+	void forEachRow(const CellRange &range, const std::function<bool (int, const QVector<QVariant> &)> &func) const;
 	
     int insertImage(int row, int col, const QImage &image);
     bool getImage(int imageIndex, QImage& img);
@@ -115,6 +135,13 @@ public:
 	bool saveAs(const QString &xlsXname) const;
 	bool saveAs(QIODevice *device) const;
 
+	// deflate level used by save(), 0 (store) to 9 (smallest); -1 is zlib's default
+	void setCompressionLevel(int level);
+	int compressionLevel() const;
+	// threads deflating large parts on save(); 1 deflates on the calling thread
+	void setCompressionThreads(int threads);
+	int compressionThreads() const;
+
 	// copy style from one xlsx file to other
 	static bool copyStyle(const QString &from, const QString &to);
 
@@ -138,6 +165,8 @@ private:
     DocumentPrivate* const d_ptr;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(Document::LoadOptions)
+
 QT_END_NAMESPACE_XLSX
 
 #endif // QXLSX_XLSXDOCUMENT_H
@@ -21,6 +21,8 @@ public:
     void init();
 
     bool loadPackage(QIODevice *device);
+    void loadPartsParallel(const QByteArray &package, const QString &stylesPath,
+                           const QString &sharedStringsPath, const QString &themePath);
     bool savePackage(QIODevice *device) const;
 
 	// copy style from one xlsx file to other
@@ -33,6 +35,9 @@ public:
     QMap<QString, QString> documentProperties; //core, app and custom properties
     QSharedPointer<Workbook> workbook;
     std::shared_ptr<ContentTypes> contentTypes;
+    Document::LoadOptions loadOptions;
+    int compressionLevel;
+    int compressionThreads;
 	bool isLoad; 
 };
 
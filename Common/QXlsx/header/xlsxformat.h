@@ -9,6 +9,7 @@
 #include <QList>
 #include <QExplicitlySharedDataPointer>
 #include <QVariant>
+#include <QSharedPointer>
 
 #include "xlsxglobal.h"
 
@@ -23,6 +24,7 @@ class RichStringPrivate;
 class SharedStrings;
 
 class FormatPrivate;
+class NumFormatProgram;
 
 class QXLSX_EXPORT Format
 {
@@ -207,6 +209,7 @@ public:
     void setProperty(int propertyId, const QVariant &value, const QVariant &clearValue=QVariant(), bool detach=true);
     void clearProperty(int propertyId);
     bool hasProperty(int propertyId) const;
+    bool hasProperties(int first, int last) const;
 
     bool boolProperty(int propertyId, bool defaultValue=false) const;
     int intProperty(int propertyId, int defaultValue=0) const;
@@ -224,20 +227,29 @@ public:
     bool fontIndexValid() const;
     int fontIndex() const;
     QByteArray fontKey() const;
+    quint64 fontHash() const;
+    bool hasSameFont(const Format &other) const;
     bool borderIndexValid() const;
     QByteArray borderKey() const;
+    quint64 borderHash() const;
+    bool hasSameBorder(const Format &other) const;
     int borderIndex() const;
     bool fillIndexValid() const;
     QByteArray fillKey() const;
+    quint64 fillHash() const;
+    bool hasSameFill(const Format &other) const;
     int fillIndex() const;
 
     QByteArray formatKey() const;
+    quint64 formatHash() const;
     bool xfIndexValid() const;
     int xfIndex() const;
     bool dxfIndexValid() const;
     int dxfIndex() const;
 
     void fixNumberFormat(int id, const QString &format);
+    QSharedPointer<const NumFormatProgram> numberFormatProgram() const;
+    void setNumberFormatProgram(const QSharedPointer<const NumFormatProgram> &program);
     void setFontIndex(int index);
     void setBorderIndex(int index);
     void setFillIndex(int index);
@@ -6,8 +6,10 @@
 #include <QSharedData>
 #include <QMap>
 #include <QSet>
+#include <QSharedPointer>
 
 #include "xlsxformat.h"
+#include "xlsxnumformatparser_p.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -94,22 +96,28 @@ public:
     FormatPrivate(const FormatPrivate &other);
     ~FormatPrivate();
 
-    bool dirty; //The key re-generation is need.
-    QByteArray formatKey;
+    // 64-bit hashes of the property ranges Styles deduplicates by.
+    // Equal formats always have equal hashes; different ones are told apart
+    // by sameProperties().
+    static quint64 propertiesHash(const QMap<int, QVariant> &properties, int first, int last);
+    static bool sameProperties(const QMap<int, QVariant> &a, const QMap<int, QVariant> &b, int first, int last);
+
+    bool dirty; //The hash re-generation is need.
+    quint64 format_hash;
 
     bool font_dirty;
     bool font_index_valid;
-    QByteArray font_key;
+    quint64 font_hash;
     int font_index;
 
     bool fill_dirty;
     bool fill_index_valid;
-    QByteArray fill_key;
+    quint64 fill_hash;
     int fill_index;
 
     bool border_dirty;
     bool border_index_valid;
-    QByteArray border_key;
+    quint64 border_hash;
     int border_index;
 
     int xf_index;
@@ -121,6 +129,9 @@ public:
 
     int theme;
 
+    // Compiled numFmt code, attached by Styles; reset when the numFmt changes
+    QSharedPointer<const NumFormatProgram> numFmtProgram;
+
     QMap<int, QVariant> properties;
 };
 
@@ -0,0 +1,216 @@
+// xlsxformulaengine_p.h
+
+#ifndef XLSXFORMULAENGINE_P_H
+#define XLSXFORMULAENGINE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+
+#include <memory>
+
+#include "xlsxglobal.h"
+#include "xlsxcell.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class WorksheetPrivate;
+class CellFormula;
+class FormulaEngine;
+
+// One cell or range reference of a compiled formula. Relative coordinates
+// are offsets from the cell the formula is evaluated for, so the program of
+// a shared formula serves every cell of the group.
+struct FormulaRef
+{
+    enum Absolute
+    {
+        AbsoluteFirstRow = 0x1,
+        AbsoluteFirstColumn = 0x2,
+        AbsoluteLastRow = 0x4,
+        AbsoluteLastColumn = 0x8
+    };
+
+    int firstRow;
+    int firstColumn;
+    int lastRow;
+    int lastColumn;
+    int absolute;
+    QString sheetName; // empty for the sheet of the formula
+};
+
+struct FormulaOp
+{
+    enum Code : quint8
+    {
+        PushNumber, PushString, PushBoolean, PushError, PushRef,
+        Negate, Percent,
+        Add, Subtract, Multiply, Divide, Power, Concat,
+        Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual,
+        Call
+    };
+
+    enum Function : quint8
+    {
+        Sum, Average, Max, Min, Count, CountIf, Rank, If, Round
+    };
+
+    Code code;
+    quint8 argc;    // Call
+    qint32 operand; // pool index, boolean or function
+};
+
+// Formula text compiled to postfix code
+struct FormulaProgram
+{
+    QVector<FormulaOp> ops;
+    QVector<double> numbers;
+    QVector<QString> strings;
+    QVector<FormulaRef> refs;
+    bool external; // refers to other sheets
+
+    // Null if the text uses anything the engine does not support
+    static QSharedPointer<const FormulaProgram> compile(const QString &formula, int anchorRow, int anchorColumn);
+};
+
+// Value on the evaluation stack
+struct FormulaValue
+{
+    enum Type { Empty, Number, String, Boolean, Error, Range };
+
+    FormulaValue() : type(Empty), number(0), engine(nullptr),
+        firstRow(0), firstColumn(0), lastRow(0), lastColumn(0) {}
+
+    static FormulaValue fromNumber(double number);
+    static FormulaValue fromString(const QString &text);
+    static FormulaValue fromBoolean(bool value);
+    static FormulaValue fromError(const QString &error);
+
+    Type type;
+    double number;  // Number and Boolean
+    QString text;   // String and Error
+    FormulaEngine *engine; // Range, sheet the range belongs to
+    int firstRow;
+    int firstColumn;
+    int lastRow;
+    int lastColumn;
+};
+
+/*
+   Calculates the formulas of one worksheet.
+
+   Formulas are compiled once, shared formulas once per group. Every formula
+   records the cells and ranges it reads, and a change to a cell only marks
+   the formulas depending on it as dirty; evaluation then recomputes just the
+   dirty ones. Formulas loaded with a cached value start clean, so opening a
+   file costs nothing until something changes.
+
+   Results are stored in the formula's Cell, from where they are read and
+   saved as the cached <v>. Formulas the engine cannot compile (unsupported
+   functions, defined names, array formulas) keep their cached value.
+   Formulas referring to other sheets are recalculated on every evaluation.
+ */
+class FormulaEngine
+{
+public:
+    explicit FormulaEngine(WorksheetPrivate *sheet);
+    ~FormulaEngine();
+
+    // The cell at (row, col) was written
+    void cellChanged(int row, int col);
+    // Computes the formula at (row, col) if it is dirty. Returns false if
+    // the cell has no formula.
+    bool evaluate(int row, int col);
+    // Computes every dirty formula
+    void recalculate();
+
+    // Value of any cell of the sheet, computing formulas as needed
+    FormulaValue cellValue(int row, int col);
+
+private:
+    Q_DISABLE_COPY(FormulaEngine)
+
+    enum State { Clean, Dirty, Computing };
+
+    struct Precedent
+    {
+        int firstRow;
+        int firstColumn;
+        int lastRow;
+        int lastColumn;
+    };
+
+    struct FormulaCell
+    {
+        std::shared_ptr<Cell> cell;
+        QSharedPointer<const FormulaProgram> program; // null keeps the cached value
+        State state;
+        QVector<Precedent> precedents;
+    };
+
+    struct RangeDependent
+    {
+        int firstRow;
+        int lastRow;
+        quint64 formula;
+    };
+
+    // A formula waiting on compute()'s work stack for its precedents
+    struct ComputeFrame
+    {
+        quint64 key;
+        int precedent; // precedent being scanned
+        quint64 cursor; // first key of it not yet scanned
+    };
+
+    void build();
+    void addFormula(int row, int col, const std::shared_ptr<Cell> &cell, bool dirty);
+    void removeFormula(quint64 key);
+    QSharedPointer<const FormulaProgram> program(const CellFormula &formula, int row, int col);
+    void markDependentsDirty(int row, int col);
+    void refreshExternal();
+    void compute(quint64 key, FormulaCell &formula);
+    quint64 nextDirtyPrecedent(const FormulaCell &formula, ComputeFrame &frame);
+    void store(quint64 key, FormulaCell &formula);
+    void prepareRange(const FormulaValue &range);
+
+    FormulaValue run(const FormulaProgram &program, int row, int col);
+    FormulaValue resolve(const FormulaRef &ref, int row, int col);
+    FormulaValue scalar(const FormulaValue &value);
+    FormulaValue call(int function, const FormulaValue *args, int argc);
+    FormulaValue aggregate(int function, const FormulaValue *args, int argc);
+    FormulaValue countIf(const FormulaValue &range, const FormulaValue &criteria);
+    FormulaValue rank(const FormulaValue *args, int argc);
+    FormulaEngine *engineForSheet(const QString &sheetName) const;
+
+    template <typename Sink>
+    bool visitNumbers(const FormulaValue &range, Sink &sink, FormulaValue *error);
+    template <typename Visitor>
+    void visitValues(const FormulaValue &range, Visitor &visitor);
+
+    WorksheetPrivate *m_sheet;
+    bool m_built;
+    QMap<quint64, FormulaCell> m_formulas; // column-major, see formulaKey()
+    QHash<quint64, QVector<quint64> > m_cellDependents;
+    QHash<int, QVector<RangeDependent> > m_rangeDependents; // by column
+    QHash<int, QSharedPointer<const FormulaProgram> > m_sharedPrograms; // by shared index
+    QVector<quint64> m_external;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXFORMULAENGINE_P_H
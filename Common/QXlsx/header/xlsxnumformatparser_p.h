@@ -36,6 +36,10 @@
 // We mean it.
 //
 
+#include <QString>
+#include <QVector>
+#include <QSharedPointer>
+
 #include "xlsxglobal.h"
 
 QT_BEGIN_NAMESPACE_XLSX
@@ -46,6 +50,96 @@ public:
     static bool isDateTime(const QString &formatCode);
 };
 
+// A numFmt code compiled once: split into sections, tokenized and
+// classified, so that values can be rendered without parsing the code again.
+// Styles keeps one program per distinct code, see Styles::numFormatProgram().
+class NumFormatProgram
+{
+public:
+    enum Category
+    {
+        General,
+        Number,
+        Percent,
+        Scientific,
+        Fraction,
+        Date,
+        Time,
+        DateTime,
+        Text
+    };
+
+    static QSharedPointer<const NumFormatProgram> compile(const QString &formatCode);
+
+    QString formatCode() const { return m_formatCode; }
+    Category category() const { return m_category; }
+    // Same answer as NumFormatParser::isDateTime() for the code
+    bool isDateTime() const { return m_isDateTime; }
+
+    QString render(double value, bool date1904 = false) const;
+    QString render(const QString &text) const;
+
+private:
+    struct Token
+    {
+        enum Type
+        {
+            Literal,
+            NumberBody, // every digit placeholder of the section
+            GeneralNumber,
+            TextValue,  // @
+            Year2, Year4,
+            Month, Month2, MonthShort, MonthLong, MonthLetter,
+            Day, Day2, DayShort, DayLong,
+            Hour, Hour2, Minute, Minute2, Second, Second2,
+            ElapsedHours, ElapsedMinutes, ElapsedSeconds,
+            SubSecond,  // .0, .00 or .000
+            AmPm, AP
+        };
+
+        Type type;
+        QString text; // Literal
+        int width;    // SubSecond digits, Elapsed* minimum width
+    };
+
+    struct Section
+    {
+        QVector<Token> tokens;
+        int condition;   // 0 none, 1 =, 2 <>, 3 <, 4 <=, 5 >, 6 >=
+        double conditionValue;
+        bool isDate;
+        bool hasText;
+        bool hasAmPm;
+        int subSecondDigits;
+
+        // NumberBody
+        int integerZeros;   // 0 placeholders before the point
+        int decimalsMin;    // 0 placeholders after the point
+        int decimalsMax;    // every placeholder after the point
+        bool decimalPoint;
+        bool thousands;
+        int scaleThousands; // trailing commas, each divides by 1000
+        int percent;
+        bool scientific;
+        bool exponentPlus;
+        int exponentDigits;
+        int integerPlaceholders;
+        bool fraction;
+    };
+
+    NumFormatProgram();
+    bool parseSection(const QString &code, Section &section);
+    const Section *sectionFor(double value, bool *negate) const;
+    QString renderNumber(const Section &section, double value) const;
+    QString renderDate(const Section &section, double value, bool date1904) const;
+
+    QString m_formatCode;
+    QVector<Section> m_sections;
+    int m_textSection; // -1 when text is shown as is
+    Category m_category;
+    bool m_isDateTime;
+};
+
 QT_END_NAMESPACE_XLSX
 
 #endif // QXLSX_NUMFORMATPARSER_H
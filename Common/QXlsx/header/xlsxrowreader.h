@@ -0,0 +1,91 @@
+// xlsxrowreader.h
+
+#ifndef QXLSX_XLSXROWREADER_H
+#define QXLSX_XLSXROWREADER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QIODevice>
+
+#include "xlsxglobal.h"
+#include "xlsxcell.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class RowReader;
+class RowReaderPrivate;
+
+// One non-empty cell of the row RowReader is positioned on.
+// Shared strings and date styles are resolved only when value() is called.
+class QXLSX_EXPORT CellView
+{
+public:
+    int column() const { return m_column; }
+    Cell::CellType cellType() const { return m_type; }
+    int styleIndex() const { return m_styleIndex; }
+
+    // Text of <v> (shared string index, number, ...) or of the inline string
+    QString rawValue() const { return m_raw; }
+    bool hasFormula() const { return !m_formula.isEmpty(); }
+    QString formulaText() const { return m_formula; }
+
+    // Same conversions as Document::read(), except that formula cells
+    // return their cached result instead of the formula text.
+    QVariant value() const;
+
+private:
+    friend class RowReader;
+    const RowReaderPrivate *m_reader = nullptr;
+    int m_column = 0;
+    int m_styleIndex = -1;
+    Cell::CellType m_type = Cell::CustomType;
+    QString m_raw;
+    QString m_formula;
+};
+
+// Forward-only reader over the sheetData of one worksheet.
+// Rows are parsed straight from the package with QXmlStreamReader; no Workbook,
+// Worksheet or cell table is built, so memory does not grow with the sheet.
+//
+//     RowReader reader(fileName);
+//     while (reader.readNextRow()) {
+//         for (const CellView &cell : reader.cells())
+//             use(reader.row(), cell.column(), cell.value());
+//     }
+class QXLSX_EXPORT RowReader
+{
+    Q_DECLARE_PRIVATE(RowReader)
+public:
+    explicit RowReader(const QString &xlsxName);
+    // The device must stay open while the reader is used.
+    explicit RowReader(QIODevice *device);
+    ~RowReader();
+
+    bool isValid() const;
+    QString errorString() const;
+
+    // Worksheets only, in workbook order. The first one is selected initially.
+    QStringList sheetNames() const;
+    bool selectSheet(const QString &name);
+    bool selectSheet(int index);
+
+    // Moves to the next <row> element. Rows that are not stored in the file
+    // are skipped, so row() may jump.
+    bool readNextRow();
+    int row() const;
+    // Cells of the current row in file order (ascending columns)
+    const QVector<CellView> &cells() const;
+    // Value of the given column in the current row, or a null QVariant
+    QVariant read(int column) const;
+
+private:
+    Q_DISABLE_COPY(RowReader)
+    RowReaderPrivate *const d_ptr;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXROWREADER_H
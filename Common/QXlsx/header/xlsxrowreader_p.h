@@ -0,0 +1,71 @@
+// xlsxrowreader_p.h
+
+#ifndef QXLSX_XLSXROWREADER_P_H
+#define QXLSX_XLSXROWREADER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QIODevice>
+#include <QXmlStreamReader>
+#include <QScopedPointer>
+
+#include "xlsxglobal.h"
+#include "xlsxrowreader.h"
+#include "xlsxzipreader_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class RowReaderPrivate
+{
+public:
+    RowReaderPrivate();
+
+    void openPackage();
+    bool openSheet(int index);
+
+    void loadSharedStrings() const;
+    void loadStyles() const;
+    QString sharedString(int index) const;
+    bool isDateStyle(int styleIndex) const;
+
+    QScopedPointer<ZipReader> zip;
+    QString errorString;
+
+    QStringList sheetNames;
+    QStringList sheetPaths;
+    QString sharedStringsPath;
+    QString stylesPath;
+    bool date1904;
+
+    // selected sheet, inflated while it is parsed
+    QScopedPointer<QIODevice> sheetStream;
+    QXmlStreamReader reader;
+    bool finished;
+
+    int row;
+    QVector<CellView> cells;
+
+    // resolved on first use
+    mutable bool sharedStringsLoaded;
+    mutable QVector<QString> sharedStrings;
+    mutable bool stylesLoaded;
+    mutable QVector<bool> dateStyles;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXROWREADER_P_H
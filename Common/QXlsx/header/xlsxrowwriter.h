@@ -0,0 +1,79 @@
+// xlsxrowwriter.h
+
+#ifndef QXLSX_XLSXROWWRITER_H
+#define QXLSX_XLSXROWWRITER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <QIODevice>
+
+#include "xlsxglobal.h"
+#include "xlsxformat.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class RowWriterPrivate;
+
+// Write-only, append-only xlsx writer.
+// Rows are serialized as soon as they are appended, so no Document, Worksheet
+// or cell table is kept and memory does not grow with the row count. Strings
+// are written inline; styles go through the usual Format/Styles machinery.
+//
+//     RowWriter writer(fileName);
+//     writer.addSheet(QStringLiteral("Grades"));
+//     writer.appendRow({QStringLiteral("Name"), QStringLiteral("Score")}, headerFormat);
+//     for (...)
+//         writer.appendRow({name, score});
+//     if (!writer.close())
+//         qWarning() << writer.errorString();
+class QXLSX_EXPORT RowWriter
+{
+    Q_DECLARE_PRIVATE(RowWriter)
+public:
+    explicit RowWriter(const QString &xlsxName);
+    // The device must stay open until close() returns.
+    explicit RowWriter(QIODevice *device);
+    // Calls close() if it has not been called yet
+    ~RowWriter();
+
+    bool isValid() const;
+    QString errorString() const;
+
+    // Starts a new worksheet; following rows go into it. A sheet named
+    // "Sheet1" is added implicitly if rows are appended before any addSheet().
+    bool addSheet(const QString &name);
+    // Only allowed before the first row of the current sheet
+    bool setColumnWidth(int colFirst, int colLast, double width);
+
+    // Appends a row below the last one; null QVariants leave the cell empty.
+    // Numbers, bools, strings, QDate/QDateTime/QTime are supported.
+    bool appendRow(const QVector<QVariant> &values, const Format &format = Format());
+    // Same with a format per cell; missing entries mean no format. Reuse
+    // Format objects for cells that look the same, that makes lookups cheap.
+    bool appendRow(const QVector<QVariant> &values, const QVector<Format> &formats);
+    // Leaves \a count empty rows
+    void skipRows(int count);
+    // Row number the next appendRow() writes to (1-based)
+    int nextRow() const;
+
+    // Deflate level of the package, 0 (store) to 9 (smallest); -1, the
+    // default, is zlib's 6. 1 is a good choice for interactive exports.
+    void setCompressionLevel(int level);
+    // Deflates large sheets on \a threads threads; 1 by default
+    void setCompressionThreads(int threads);
+
+    // Finishes the package. Nothing can be appended afterwards.
+    bool close();
+
+private:
+    Q_DISABLE_COPY(RowWriter)
+    bool startRow();
+
+    RowWriterPrivate *const d_ptr;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXROWWRITER_H
@@ -0,0 +1,75 @@
+// xlsxrowwriter_p.h
+
+#ifndef QXLSX_XLSXROWWRITER_P_H
+#define QXLSX_XLSXROWWRITER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTemporaryFile>
+#include <QXmlStreamWriter>
+#include <QScopedPointer>
+
+#include "xlsxglobal.h"
+#include "xlsxformat.h"
+#include "xlsxrowwriter.h"
+#include "xlsxstyles_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+struct RowWriterSheet
+{
+    QString name;
+    QSharedPointer<QTemporaryFile> file; // the complete worksheet part once finished
+    QList<QPair<QPair<int, int>, double> > columnWidths;
+};
+
+class RowWriterPrivate
+{
+public:
+    RowWriterPrivate();
+
+    void startSheetData();
+    void finishSheet();
+    int styleIndex(const Format &format, const QString &numberFormat);
+    int cachedStyleIndex(const Format &format);
+    bool finishRow();
+    void writeCell(int col, const QVariant &value, const Format &format, int xfIndex);
+
+    QString fileName;
+    QPointer<QIODevice> device;
+    QString errorString;
+    bool closed;
+    int compressionLevel;
+    int compressionThreads;
+
+    Styles styles;
+    QList<RowWriterSheet> sheets;
+
+    // serializer of the current sheet
+    QScopedPointer<QXmlStreamWriter> writer;
+    bool sheetDataStarted;
+    int row;
+
+    // the last format and its xf index, neighbouring cells usually share one
+    Format lastFormat;
+    int lastXfIndex;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXROWWRITER_P_H
@@ -38,6 +38,7 @@
 
 #include <QHash>
 #include <QStringList>
+#include <QVector>
 #include <QIODevice>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -48,18 +49,6 @@
 
 QT_BEGIN_NAMESPACE_XLSX
 
-class XlsxSharedStringInfo
-{
-public:
-    XlsxSharedStringInfo(int index=0, int count = 1) :
-        index(index), count(count)
-    {
-    }
-
-    int index;
-    int count;
-};
-
 class  SharedStrings : public AbstractOOXmlFile
 {
 public:
@@ -71,13 +60,22 @@ public:
     int addSharedString(const RichString &string);
     void removeSharedString(const QString &string);
     void removeSharedString(const RichString &string);
+    void removeSharedStringByIndex(int idx);
     void incRefByStringIndex(int idx);
+    void incRefByStringIndex(int idx, int count);
 
     int getSharedStringIndex(const QString &string) const;
     int getSharedStringIndex(const RichString &string) const;
     RichString getSharedString(int index) const;
     QList<RichString> getSharedStrings() const;
 
+    // Renumbering while the package is saved: between beginSave() and
+    // endSave() worksheets write saveIndex(idx) instead of idx, and only the
+    // strings handed out that way are written to sharedStrings.xml.
+    void beginSave();
+    int saveIndex(int idx);
+    void endSave();
+
     void saveToXmlFile(QIODevice *device) const override;
     bool loadFromXmlFile(QIODevice *device) override;
 
@@ -88,9 +86,20 @@ private:
     Format readRichStringPart_rPr(QXmlStreamReader &reader);
     void writeRichStringPart_rPr(QXmlStreamWriter &writer, const Format &format) const;
 
-    QHash<RichString, XlsxSharedStringInfo> m_stringTable; //for fast lookup
+    int appendString(const RichString &string, int refCount);
+
+    // Indices are stable: a string keeps its slot in m_stringList even when
+    // its reference count drops to 0, unused slots are dropped when saving.
     QList<RichString> m_stringList;
+    QVector<int> m_refCounts;
+    QHash<QString, int> m_plainStringTable; // lookup of plain strings, without building a RichString
+    QHash<RichString, int> m_richStringTable; // lookup of strings with several runs
     int m_stringCount;
+
+    bool m_saving;
+    QVector<int> m_saveIndices; // string index -> index in the saved table, -1 if not written
+    QVector<int> m_saveOrder; // string indices in saved order
+    int m_saveRefCount;
 };
 
 QT_END_NAMESPACE_XLSX
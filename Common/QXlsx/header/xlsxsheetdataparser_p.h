@@ -0,0 +1,70 @@
+// xlsxsheetdataparser_p.h
+
+#ifndef XLSXSHEETDATAPARSER_P_H
+#define XLSXSHEETDATAPARSER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVector>
+
+#include "xlsxglobal.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class WorksheetPrivate;
+
+// Reads the <sheetData> element of a worksheet part from its UTF-8 bytes.
+//
+// Plain numbers and shared strings, the bulk of a sheet, go straight into the
+// dense part of WorksheetPrivate::cellTable: A1 references are decoded
+// arithmetically, style attributes are mapped through a cache of xf indices
+// instead of copying a Format per cell and numbers are parsed without a
+// QString. Rows with attributes and all other cells (formulas, dates, inline
+// strings, ...) are passed to WorksheetPrivate::loadXmlRow()/loadXmlCell()
+// through a QXmlStreamReader on just that element, so they load as before.
+class SheetDataParser
+{
+public:
+    explicit SheetDataParser(WorksheetPrivate *sheet);
+
+    // Finds a non-empty, unprefixed <sheetData> element in the worksheet
+    // part; [*begin, *end) covers the element including its tags.
+    static bool locate(const QByteArray &data, int *begin, int *end);
+
+    // Reads the element found by locate()
+    void parse(const char *begin, const char *end);
+
+private:
+    struct StyleInfo
+    {
+        StyleInfo() : known(false), date(false), xfIndex(-1) {}
+
+        bool known;
+        bool date;      // number cells become Cell::DateType
+        qint32 xfIndex; // what cellTable stores, -1 for none
+    };
+
+    bool parseCell(const char *tagBegin, const char *tagEnd, const char *elementEnd);
+    const StyleInfo *styleInfo(int idx);
+    void loadRow(const char *tagBegin, const char *tagEnd);
+    void loadCell(const char *begin, const char *end);
+
+    WorksheetPrivate *m_sheet;
+    QVector<StyleInfo> m_styles;
+    int m_sharedStringCount; // -1 while the shared strings are still loading
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXSHEETDATAPARSER_P_H
@@ -42,6 +42,7 @@
 #include <QMap>
 #include <QStringList>
 #include <QVector>
+#include <QSharedPointer>
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
 #include <QIODevice>
@@ -56,6 +57,7 @@ QT_BEGIN_NAMESPACE_XLSX
 
 class Format;
 class XlsxColor;
+class NumFormatProgram;
 
 struct XlsxFormatNumberData
 {
@@ -80,10 +82,13 @@ public:
 
     QColor getColorByIndex(int idx);
 
+    QSharedPointer<const NumFormatProgram> numFormatProgram(const Format &format);
+
 private:
     friend class Format;
     // friend class ::StylesTest;
 
+    void initBuiltinNumFmts();
     void fixNumFmt(const Format &format);
 
     void writeNumFmts(QXmlStreamWriter &writer) const;
@@ -119,21 +124,25 @@ private:
     QMap<int, QSharedPointer<XlsxFormatNumberData> > m_customNumFmtIdMap;
     QHash<QString, QSharedPointer<XlsxFormatNumberData> > m_customNumFmtsHash;
     int m_nextCustomNumFmtId;
+    // Format code -> compiled program, shared by every Format using the code
+    QHash<QString, QSharedPointer<const NumFormatProgram> > m_numFmtPrograms;
     QList<Format> m_fontsList;
     QList<Format> m_fillsList;
     QList<Format> m_bordersList;
-    QHash<QByteArray, Format> m_fontsHash;
-    QHash<QByteArray, Format> m_fillsHash;
-    QHash<QByteArray, Format> m_bordersHash;
+    // Format hash -> position in the list above; the position is the
+    // font/fill/border id written to the xfs
+    QMultiHash<quint64, int> m_fontsHash;
+    QMultiHash<quint64, int> m_fillsHash;
+    QMultiHash<quint64, int> m_bordersHash;
 
     QVector<QColor> m_indexedColors;
     bool m_isIndexedColorsDefault;
 
     QList<Format> m_xf_formatsList;
-    QHash<QByteArray, Format> m_xf_formatsHash;
+    QMultiHash<quint64, int> m_xf_formatsHash;
 
     QList<Format> m_dxf_formatsList;
-    QHash<QByteArray, Format> m_dxf_formatsHash;
+    QMultiHash<quint64, int> m_dxf_formatsHash;
 
     bool m_emptyFormatAdded;
 };
@@ -29,6 +29,7 @@ class Chart;
 class Chartsheet;
 class Worksheet;
 class WorkbookPrivate;
+class ZipReader;
 
 class QXLSX_EXPORT Workbook : public AbstractOOXmlFile
 {
@@ -74,6 +75,7 @@ private:
     friend class WorksheetPrivate;
     friend class Document;
     friend class DocumentPrivate;
+    friend class SheetDataParser;
 
     Workbook(Workbook::CreateFlag flag);
 
@@ -86,6 +88,9 @@ private:
     QList<QImage> images();
     QList<Drawing *> drawings();
     QList<QSharedPointer<AbstractSheet> > getSheetsByTypes(AbstractSheet::SheetType type) const;
+    void loadPendingSheet(AbstractSheet *sheet) const;
+    void loadPendingSheets() const;
+    void dropDrawing(AbstractSheet *sheet);
     QStringList worksheetNames() const;
     AbstractSheet *addSheet(const QString &name, int sheetId, AbstractSheet::SheetType type = AbstractSheet::ST_WorkSheet);
 };
@@ -6,12 +6,14 @@
 #include <QtGlobal>
 #include <QSharedPointer>
 #include <QStringList>
+#include <QSet>
 
 #include "xlsxworkbook.h"
 #include "xlsxabstractooxmlfile_p.h"
 #include "xlsxtheme_p.h"
 #include "xlsxsimpleooxmlfile_p.h"
 #include "xlsxrelationships_p.h"
+#include "xlsxzipreader_p.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -67,6 +69,12 @@ public:
     int last_worksheet_index;
     int last_chartsheet_index;
     int last_sheet_id;
+
+    // Document::LazySheets: sheets whose parts are still in lazyPackage,
+    // read by Workbook::loadPendingSheet() on first access
+    QSharedPointer<ZipReader> lazyPackage;
+    QSet<AbstractSheet *> pendingSheets;
+    bool skipDrawings; // Document::SkipDrawings
 };
 
 QT_END_NAMESPACE_XLSX
@@ -13,6 +13,9 @@
 #include <QDateTime>
 #include <QUrl>
 #include <QImage>
+#include <QVector>
+
+#include <functional>
 
 #include "xlsxabstractsheet.h"
 #include "xlsxcell.h"
@@ -33,6 +36,7 @@ class ConditionalFormatting;
 class CellRange;
 class RichString;
 class Relationships;
+class FormulaEngine;
 class Chart;
 
 class WorksheetPrivate;
@@ -43,6 +47,7 @@ class QXLSX_EXPORT Worksheet : public AbstractSheet
 private:
     friend class DocumentPrivate;
     friend class Workbook;
+    friend class FormulaEngine;
     friend class ::WorksheetTest;
     Worksheet(const QString &sheetName, int sheetId, Workbook *book, CreateFlag flag);
     Worksheet *copy(const QString &distName, int distId) const override;
@@ -56,6 +61,15 @@ public:
 
     QVariant read(const CellReference &row_column) const;
     QVariant read(int row, int column) const;
+    // Like read(), but formula cells give their calculated result
+    QVariant readValue(const CellReference &row_column) const;
+    QVariant readValue(int row, int column) const;
+
+    // Bulk access. Buffers are row-major, range.columnCount() values per row.
+    QVector<QVariant> readRange(const CellRange &range) const;
+    bool writeRange(const CellRange &range, const QVector<QVariant> &values, const Format &format=Format());
+    CellRange usedRange() const;
+    void forEachRow(const CellRange &range, const std::function<bool (int, const QVector<QVariant> &)> &func) const;
 
     bool writeString(const CellReference &row_column, const QString &value, const Format &format=Format());
     bool writeString(int row, int column, const QString &value, const Format &format=Format());
@@ -158,6 +172,7 @@ public:
 private:
     void saveToXmlFile(QIODevice *device) const override;
     bool loadFromXmlFile(QIODevice *device) override;
+    bool loadFromXmlData(const QByteArray &data) override;
 };
 
 QT_END_NAMESPACE_XLSX
@@ -9,6 +9,7 @@
 #include <QVector>
 #include <QImage>
 #include <QSharedPointer>
+#include <QScopedPointer>
 
 #include <QRegularExpression>
 
@@ -18,6 +19,8 @@
 #include "xlsxdatavalidation.h"
 #include "xlsxconditionalformatting.h"
 #include "xlsxcellformula.h"
+#include "xlsxcelltable_p.h"
+#include "xlsxformulaengine_p.h"
 
 class QXmlStreamWriter;
 class QXmlStreamReader;
@@ -153,6 +156,8 @@ public:
 
     void saveXmlSheetData(QXmlStreamWriter &writer) const;
     void saveXmlCellData(QXmlStreamWriter &writer, int row, int col, std::shared_ptr<Cell> cell) const;
+    void saveXmlDenseCellData(QXmlStreamWriter &writer, int row, int col) const;
+    void saveXmlCellStyle(QXmlStreamWriter &writer, int row, int col, int xfIndex) const;
     void saveXmlMergeCells(QXmlStreamWriter &writer) const;
     void saveXmlHyperlinks(QXmlStreamWriter &writer) const;
     void saveXmlDrawings(QXmlStreamWriter &writer) const;
@@ -162,12 +167,15 @@ public:
     int colPixelsSize(int col) const;
 
     void loadXmlSheetData(QXmlStreamReader &reader);
+    void loadXmlRow(QXmlStreamReader &reader);
+    void loadXmlCell(QXmlStreamReader &reader);
     void loadXmlColumnsInfo(QXmlStreamReader &reader);
     void loadXmlMergeCells(QXmlStreamReader &reader);
     void loadXmlDataValidations(QXmlStreamReader &reader);
     void loadXmlSheetFormatProps(QXmlStreamReader &reader);
     void loadXmlSheetViews(QXmlStreamReader &reader);
     void loadXmlHyperlinks(QXmlStreamReader &reader);
+    void resolveSharedStrings();
 
     QList<QSharedPointer<XlsxRowInfo> > getRowInfoList(int rowFirst, int rowLast);
     QList<QSharedPointer<XlsxColumnInfo> > getColumnInfoList(int colFirst, int colLast);
@@ -176,8 +184,28 @@ public:
 
     SharedStrings *sharedStrings() const;
 
+    std::shared_ptr<Cell> cellAt(int row, int col) const;
+    void storeNumber(int row, int col, double value, const Format &format);
+    void storeSharedString(int row, int col, int sstIndex, const Format &format);
+    // Called by the write functions after a cell was stored
+    void cellChanged(int row, int col);
+    FormulaEngine *formulaEngine() const;
+
 public:
-    QMap<int, QMap<int, std::shared_ptr<Cell> > > cellTable;
+    // cellAt() turns dense slots into Cell objects on demand
+    mutable CellTable cellTable;
+
+    // How loadXmlSheetData() handles shared strings. The parallel package
+    // loader reads several sheets at once, they must not modify SharedStrings.
+    enum SharedStringLoad
+    {
+        LoadSharedStrings,  // look up and reference the strings directly
+        CountSharedStrings, // strings are loaded, references are only counted
+        DeferSharedStrings  // strings are still loading, only indices are kept
+    };
+    SharedStringLoad sharedStringLoad;
+    QVector<int> sharedStringRefs; // sst index -> references, see resolveSharedStrings()
+    QList<std::shared_ptr<Cell> > pendingSharedStringCells; // value holds the sst index
 
     QMap<int, QMap<int, QString> > comments;
     QMap<int, QMap<int, QSharedPointer<XlsxHyperlinkData> > > urlTable;
@@ -190,6 +218,8 @@ public:
     QList<ConditionalFormatting> conditionalFormattingList;
 
     QMap<int, CellFormula> sharedFormulaMap; // shared formula map
+    // created by the first write or formula evaluation
+    mutable QScopedPointer<FormulaEngine> formulas;
 
     CellRange dimension;
     int previous_row;
@@ -6,30 +6,92 @@
 #include <QScopedPointer>
 #include <QStringList>
 #include <QIODevice>
-
-#include "xlsxglobal.h"
-
+#include <QHash>
 #include <QVector>
 
-class QZipReader;
+#include "xlsxglobal.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
+// An entry of the central directory
+struct ZipEntry
+{
+    QString name;
+    quint16 flags;
+    quint16 method; // 0 stored, 8 deflated
+    quint32 crc;
+    qint64 compressedSize;
+    qint64 uncompressedSize;
+    qint64 localHeaderOffset;
+};
+
+// Reads zip packages with the bundled zlib.
+// Entries are inflated from the device on demand, either at once through
+// fileData() or in chunks through openFile(). All reads seek first, so
+// several entries may be read interleaved, but only from one thread.
 class  ZipReader
 {
 public:
     explicit ZipReader(const QString &fileName);
     explicit ZipReader(QIODevice *device);
+    // Reads the package from memory. Every ZipReader has its own position,
+    // so several of them can inflate entries of the same data concurrently.
+    explicit ZipReader(const QByteArray &data);
     ~ZipReader();
     bool exists() const;
     QStringList filePaths() const;
     QByteArray fileData(const QString &fileName) const;
+    // Sequential device inflating the entry while it is read, or nullptr.
+    // The caller owns it; this ZipReader must outlive it.
+    QIODevice *openFile(const QString &fileName) const;
 
 private:
     Q_DISABLE_COPY(ZipReader)
     void init();
-    QScopedPointer<QZipReader> m_reader;
+    bool readCentralDirectory();
+    bool readAt(qint64 pos, char *data, qint64 size) const;
+
+    QScopedPointer<QIODevice> m_ownedDevice;
+    QIODevice *m_device;
+    QVector<ZipEntry> m_entries;
+    QHash<QString, int> m_entryIndex;
     QStringList m_filePaths;
+    bool m_exists;
+
+    friend class ZipEntryReader;
+};
+
+struct ZipInflateState;
+
+// Inflates one entry of a ZipReader while it is read
+class ZipEntryReader : public QIODevice
+{
+public:
+    ZipEntryReader(const ZipReader *zip, const ZipEntry &entry);
+    ~ZipEntryReader() override;
+
+    bool isSequential() const override;
+    qint64 size() const override;
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    bool locateData();
+    bool fillInput();
+
+    const ZipReader *m_zip;
+    ZipEntry m_entry;
+    qint64 m_sourcePos; // next compressed byte, -1 until the local header was read
+    qint64 m_compressedLeft;
+    qint64 m_produced;
+    quint32 m_crc;
+    bool m_finished;
+    QByteArray m_input;
+    QScopedPointer<ZipInflateState> m_state;
 };
 
 QT_END_NAMESPACE_XLSX
@@ -6,13 +6,18 @@
 #include <QtGlobal>
 #include <QString>
 #include <QIODevice>
+#include <QScopedPointer>
+#include <QVector>
 
 #include "xlsxglobal.h"
 
-class QZipWriter;
-
 QT_BEGIN_NAMESPACE_XLSX
 
+// Writes zip packages with the bundled zlib.
+// Entries are deflated in chunks while they are written, so an entry added
+// from a device is never held in memory as a whole. With more than one
+// compression thread, large entries are split into blocks that are deflated
+// concurrently and joined into one deflate stream.
 class ZipWriter
 {
 public:
@@ -20,13 +25,52 @@ public:
     explicit ZipWriter(QIODevice *device);
     ~ZipWriter();
 
+    // 0 stores the entries, 1 is fastest and 9 gives the smallest package;
+    // -1 is zlib's default (6)
+    void setCompressionLevel(int level);
+    int compressionLevel() const;
+    // Threads used for entries larger than one block; 1 deflates on the
+    // calling thread
+    void setCompressionThreads(int threads);
+    int compressionThreads() const;
+
     void addFile(const QString &filePath, QIODevice *device);
     void addFile(const QString &filePath, const QByteArray &data);
     bool error() const;
     void close();
 
 private:
-    QZipWriter *m_writer;
+    Q_DISABLE_COPY(ZipWriter)
+
+    struct Entry
+    {
+        QByteArray name;
+        quint16 flags;
+        quint16 method;
+        quint32 crc;
+        quint32 compressedSize;
+        quint32 uncompressedSize;
+        quint32 localHeaderOffset;
+    };
+
+    void addEntry(const QString &filePath, QIODevice *device, const QByteArray *data);
+    bool deflateSerial(Entry &entry, QIODevice *device, const QByteArray *data);
+    bool deflateParallel(Entry &entry, QIODevice *device, const QByteArray *data);
+    qint64 readInput(QIODevice *device, char *buffer, qint64 size);
+    bool write(const QByteArray &bytes);
+    bool write(const char *bytes, qint64 size);
+
+    QScopedPointer<QIODevice> m_ownedDevice;
+    QIODevice *m_device;
+    QVector<Entry> m_entries;
+    int m_level;
+    int m_threads;
+    quint16 m_dosTime;
+    quint16 m_dosDate;
+    qint64 m_startPos; // position of the package in m_device
+    qint64 m_offset; // bytes written so far
+    bool m_error;
+    bool m_closed;
 };
 
 QT_END_NAMESPACE_XLSX
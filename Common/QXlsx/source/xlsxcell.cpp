@@ -12,6 +12,7 @@
 #include "xlsxcell_p.h"
 #include "xlsxformat.h"
 #include "xlsxformat_p.h"
+#include "xlsxnumformatparser_p.h"
 #include "xlsxutility_p.h"
 #include "xlsxworksheet.h"
 #include "xlsxworkbook.h"
@@ -272,19 +273,16 @@ bool Cell::isDateTime() const
 	Q_D(const Cell);
 
 	Cell::CellType cellType = d->cellType;
-    double dValue = d->value.toDouble(); // number
-//	QString strValue = d->value.toString().toUtf8();
-	bool isValidFormat = d->format.isValid();
-    bool isDateTimeFormat = d->format.isDateTimeFormat(); // datetime format
 
     // dev67
+    // the format is looked at last, text cells never need it
     if ( cellType == NumberType ||
          cellType == DateType ||
          cellType == CustomType )
     {
-        if ( dValue >= 0 &&
-             isValidFormat &&
-             isDateTimeFormat )
+        if ( d->value.toDouble() >= 0 &&
+             d->format.isValid() &&
+             d->format.isDateTimeFormat() )
         {
             return true;
         }
@@ -325,6 +323,37 @@ QVariant Cell::dateTime() const
     return ret;
 }
 
+/*!
+ * Returns the value as Excel displays it, rendered with the number format
+ * of the cell. Dates and times use the English month and day names.
+ */
+QString Cell::displayText() const
+{
+	Q_D(const Cell);
+
+	switch (d->cellType) {
+	case BooleanType:
+		return d->value.toBool() ? QStringLiteral("TRUE") : QStringLiteral("FALSE");
+	case ErrorType:
+		return d->value.toString();
+	case SharedStringType:
+	case InlineStringType:
+	case StringType:
+		return d->format.numberFormatProgram()->render(isRichString() ? d->richString.toPlainString() : d->value.toString());
+	default:
+		break;
+	}
+
+	if (!d->value.isValid())
+		return QString();
+	bool ok;
+	const double number = d->value.toDouble(&ok);
+	if (!ok)
+		return d->value.toString();
+	const bool date1904 = d->parent && d->parent->workbook()->isDate1904();
+	return d->format.numberFormatProgram()->render(number, date1904);
+}
+
 /*!
  * Returns whether the cell is probably a rich string or not
  */
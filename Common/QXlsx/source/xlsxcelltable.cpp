@@ -0,0 +1,368 @@
+// xlsxcelltable.cpp
+
+#include <QtGlobal>
+#include <QVector>
+#include <QMap>
+
+#include <cstring>
+
+#include "xlsxcelltable_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+// Sparse cells of a block are ordered by row offset, then by column
+inline quint32 cellKey(int offset, int col)
+{
+    return (quint32(offset) << 16) | quint32(col);
+}
+
+inline int keyOffset(quint32 key)
+{
+    return int(key >> 16);
+}
+
+inline int keyColumn(quint32 key)
+{
+    return int(key & 0xffff);
+}
+
+inline int rowOffset(int row)
+{
+    return (row - 1) % CellTable::RowBlockSize;
+}
+
+} // namespace
+
+// One column of a row block. Every vector holds RowBlockSize entries once it
+// is allocated; numbers, strings and styles are only allocated when the column
+// actually stores such a value.
+struct CellTableColumn
+{
+    QVector<quint8> types;
+    QVector<double> numbers;
+    QVector<qint32> strings;
+    QVector<qint32> styles;
+};
+
+struct CellTableBlock
+{
+    CellTableBlock() : count(0)
+    {
+        memset(rowCounts, 0, sizeof(rowCounts));
+    }
+
+    QVector<CellTableColumn> columns; // columns 1..columns.size()
+    QMap<quint32, std::shared_ptr<Cell> > cells;
+    quint16 rowCounts[CellTable::RowBlockSize];
+    int count;
+};
+
+CellTable::CellTable()
+    : m_count(0)
+{
+}
+
+CellTable::~CellTable()
+{
+}
+
+bool CellTable::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int CellTable::cellCount() const
+{
+    return m_count;
+}
+
+void CellTable::clear()
+{
+    m_blocks.clear();
+    m_count = 0;
+}
+
+CellTableBlock *CellTable::block(int row) const
+{
+    if (row < 1)
+        return nullptr;
+    const size_t index = size_t(row - 1) / RowBlockSize;
+    return index < m_blocks.size() ? m_blocks[index].get() : nullptr;
+}
+
+CellTableBlock *CellTable::ensureBlock(int row)
+{
+    const size_t index = size_t(row - 1) / RowBlockSize;
+    if (index >= m_blocks.size())
+        m_blocks.resize(index + 1);
+    if (!m_blocks[index])
+        m_blocks[index].reset(new CellTableBlock);
+    return m_blocks[index].get();
+}
+
+int CellTable::firstRow() const
+{
+    return nextRow(0);
+}
+
+int CellTable::lastRow() const
+{
+    for (size_t index = m_blocks.size(); index > 0; --index) {
+        const CellTableBlock *b = m_blocks[index - 1].get();
+        if (!b || !b->count)
+            continue;
+        for (int offset = RowBlockSize - 1; offset >= 0; --offset) {
+            if (b->rowCounts[offset])
+                return int(index - 1) * RowBlockSize + offset + 1;
+        }
+    }
+    return -1;
+}
+
+int CellTable::nextRow(int row) const
+{
+    size_t index = size_t(qMax(row, 0)) / RowBlockSize;
+    int offset = qMax(row, 0) % RowBlockSize;
+    for (; index < m_blocks.size(); ++index, offset = 0) {
+        const CellTableBlock *b = m_blocks[index].get();
+        if (!b || !b->count)
+            continue;
+        for (; offset < RowBlockSize; ++offset) {
+            if (b->rowCounts[offset])
+                return int(index) * RowBlockSize + offset + 1;
+        }
+    }
+    return -1;
+}
+
+bool CellTable::hasRow(int row) const
+{
+    const CellTableBlock *b = block(row);
+    return b && b->rowCounts[rowOffset(row)];
+}
+
+int CellTable::firstColumn(int row) const
+{
+    return nextColumn(row, 0);
+}
+
+int CellTable::lastColumn(int row) const
+{
+    const CellTableBlock *b = block(row);
+    const int offset = rowOffset(row);
+    if (!b || !b->rowCounts[offset])
+        return -1;
+
+    auto it = b->cells.lowerBound(cellKey(offset + 1, 0));
+    if (it != b->cells.constBegin()) {
+        --it;
+        if (keyOffset(it.key()) == offset && keyColumn(it.key()) > DenseColumnLimit)
+            return keyColumn(it.key());
+    }
+
+    for (int col = b->columns.size(); col > 0; --col) {
+        const CellTableColumn &column = b->columns.at(col - 1);
+        if (!column.types.isEmpty() && column.types.at(offset) != EmptySlot)
+            return col;
+    }
+    return -1;
+}
+
+int CellTable::nextColumn(int row, int col) const
+{
+    const CellTableBlock *b = block(row);
+    const int offset = rowOffset(row);
+    if (!b || !b->rowCounts[offset])
+        return -1;
+
+    for (int c = col + 1; c <= b->columns.size(); ++c) {
+        const CellTableColumn &column = b->columns.at(c - 1);
+        if (!column.types.isEmpty() && column.types.at(offset) != EmptySlot)
+            return c;
+    }
+
+    auto it = b->cells.lowerBound(cellKey(offset, qMax(col + 1, int(DenseColumnLimit) + 1)));
+    if (it != b->cells.constEnd() && keyOffset(it.key()) == offset)
+        return keyColumn(it.key());
+    return -1;
+}
+
+CellTable::SlotType CellTable::slotType(int row, int col) const
+{
+    const CellTableBlock *b = block(row);
+    if (!b || col < 1)
+        return EmptySlot;
+
+    const int offset = rowOffset(row);
+    if (col <= DenseColumnLimit) {
+        if (col > b->columns.size())
+            return EmptySlot;
+        const CellTableColumn &column = b->columns.at(col - 1);
+        return column.types.isEmpty() ? EmptySlot : SlotType(column.types.at(offset));
+    }
+    return b->cells.contains(cellKey(offset, col)) ? CellSlot : EmptySlot;
+}
+
+double CellTable::number(int row, int col) const
+{
+    Q_ASSERT(slotType(row, col) == NumberSlot || slotType(row, col) == CustomNumberSlot);
+    return block(row)->columns.at(col - 1).numbers.at(rowOffset(row));
+}
+
+int CellTable::sharedStringIndex(int row, int col) const
+{
+    Q_ASSERT(slotType(row, col) == SharedStringSlot);
+    return block(row)->columns.at(col - 1).strings.at(rowOffset(row));
+}
+
+int CellTable::styleIndex(int row, int col) const
+{
+    const SlotType type = slotType(row, col);
+    if (type == EmptySlot || type == CellSlot)
+        return -1;
+    return block(row)->columns.at(col - 1).styles.at(rowOffset(row));
+}
+
+std::shared_ptr<Cell> CellTable::cell(int row, int col) const
+{
+    const CellTableBlock *b = block(row);
+    if (!b || col < 1)
+        return nullptr;
+    return b->cells.value(cellKey(rowOffset(row), col));
+}
+
+/*
+  Book-keeping for a slot that is about to be (re)written: counts a new cell,
+  or drops the Cell object that the slot held so far.
+ */
+void CellTable::occupy(CellTableBlock *block, int offset, int col, SlotType previous)
+{
+    if (previous == EmptySlot) {
+        ++block->rowCounts[offset];
+        ++block->count;
+        ++m_count;
+    } else if (previous == CellSlot) {
+        block->cells.remove(cellKey(offset, col));
+    }
+}
+
+bool CellTable::setNumber(int row, int col, double value, int styleIndex, bool custom)
+{
+    if (col > DenseColumnLimit)
+        return false;
+
+    CellTableBlock *b = ensureBlock(row);
+    const int offset = rowOffset(row);
+    if (b->columns.size() < col)
+        b->columns.resize(col);
+
+    CellTableColumn &column = b->columns[col - 1];
+    if (column.types.isEmpty())
+        column.types.fill(EmptySlot, RowBlockSize);
+    if (column.numbers.isEmpty())
+        column.numbers.fill(0.0, RowBlockSize);
+    if (column.styles.isEmpty())
+        column.styles.fill(-1, RowBlockSize);
+
+    occupy(b, offset, col, SlotType(column.types.at(offset)));
+    column.types[offset] = custom ? CustomNumberSlot : NumberSlot;
+    column.numbers[offset] = value;
+    column.styles[offset] = styleIndex;
+    return true;
+}
+
+bool CellTable::setSharedString(int row, int col, int sstIndex, int styleIndex)
+{
+    if (col > DenseColumnLimit)
+        return false;
+
+    CellTableBlock *b = ensureBlock(row);
+    const int offset = rowOffset(row);
+    if (b->columns.size() < col)
+        b->columns.resize(col);
+
+    CellTableColumn &column = b->columns[col - 1];
+    if (column.types.isEmpty())
+        column.types.fill(EmptySlot, RowBlockSize);
+    if (column.strings.isEmpty())
+        column.strings.fill(-1, RowBlockSize);
+    if (column.styles.isEmpty())
+        column.styles.fill(-1, RowBlockSize);
+
+    occupy(b, offset, col, SlotType(column.types.at(offset)));
+    column.types[offset] = SharedStringSlot;
+    column.strings[offset] = sstIndex;
+    column.styles[offset] = styleIndex;
+    return true;
+}
+
+void CellTable::setCell(int row, int col, const std::shared_ptr<Cell> &cell)
+{
+    Q_ASSERT(cell);
+
+    CellTableBlock *b = ensureBlock(row);
+    const int offset = rowOffset(row);
+    if (col <= DenseColumnLimit) {
+        if (b->columns.size() < col)
+            b->columns.resize(col);
+        CellTableColumn &column = b->columns[col - 1];
+        if (column.types.isEmpty())
+            column.types.fill(EmptySlot, RowBlockSize);
+        occupy(b, offset, col, SlotType(column.types.at(offset)));
+        column.types[offset] = CellSlot;
+    } else {
+        if (!b->cells.contains(cellKey(offset, col)))
+            occupy(b, offset, col, EmptySlot);
+    }
+    b->cells.insert(cellKey(offset, col), cell);
+}
+
+void CellTable::visitNumberRuns(int col, int firstRow, int lastRow, const NumberRunVisitor &visitor) const
+{
+    firstRow = qMax(firstRow, 1);
+    if (col < 1 || col > DenseColumnLimit || lastRow < firstRow || m_blocks.empty())
+        return;
+
+    const size_t lastIndex = qMin(size_t(lastRow - 1) / RowBlockSize, m_blocks.size() - 1);
+    for (size_t index = size_t(firstRow - 1) / RowBlockSize; index <= lastIndex; ++index) {
+        const CellTableBlock *b = m_blocks[index].get();
+        if (!b || !b->count || col > b->columns.size())
+            continue;
+        const CellTableColumn &column = b->columns.at(col - 1);
+        if (column.numbers.isEmpty())
+            continue;
+
+        const int blockRow = int(index) * RowBlockSize + 1;
+        const int first = qMax(firstRow, blockRow) - blockRow;
+        const int last = qMin(lastRow, blockRow + RowBlockSize - 1) - blockRow;
+        if (first <= last)
+            visitor(blockRow + first, column.types.constData() + first, column.numbers.constData() + first, last - first + 1);
+    }
+}
+
+void CellTable::visitCells(int firstRow, int lastRow, int firstCol, int lastCol, const CellVisitor &visitor) const
+{
+    firstRow = qMax(firstRow, 1);
+    if (lastRow < firstRow || m_blocks.empty())
+        return;
+
+    const size_t lastIndex = qMin(size_t(lastRow - 1) / RowBlockSize, m_blocks.size() - 1);
+    for (size_t index = size_t(firstRow - 1) / RowBlockSize; index <= lastIndex; ++index) {
+        const CellTableBlock *b = m_blocks[index].get();
+        if (!b || b->cells.isEmpty())
+            continue;
+
+        const int blockRow = int(index) * RowBlockSize + 1;
+        const int lastOffset = qMin(lastRow, blockRow + RowBlockSize - 1) - blockRow;
+        for (auto it = b->cells.lowerBound(cellKey(qMax(firstRow, blockRow) - blockRow, 0));
+             it != b->cells.constEnd() && keyOffset(it.key()) <= lastOffset; ++it) {
+            const int col = keyColumn(it.key());
+            if (col >= firstCol && col <= lastCol)
+                visitor(blockRow + keyOffset(it.key()), col, it.value());
+        }
+    }
+}
+
+QT_END_NAMESPACE_XLSX
@@ -9,11 +9,18 @@
 #include <QFile>
 #include <QSharedPointer>
 #include <QDebug>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <functional>
 
 #include "xlsxdocument.h"
 #include "xlsxdocument_p.h"
 #include "xlsxworkbook.h"
 #include "xlsxworksheet.h"
+#include "xlsxworksheet_p.h"
 #include "xlsxcontenttypes_p.h"
 #include "xlsxrelationships_p.h"
 #include "xlsxstyles_p.h"
@@ -152,11 +159,64 @@ namespace xlsxDocumentCpp {
 
 		return sOut;
 	}
+
+	// Runs a function on the thread pool of a LoadTaskGroup
+	class LoadTask : public QRunnable
+	{
+	public:
+		LoadTask(const std::function<void()> &func, QSemaphore *done)
+			: m_func(func), m_done(done)
+		{
+		}
+
+		void run() override
+		{
+			m_func();
+			m_done->release();
+		}
+
+	private:
+		std::function<void()> m_func;
+		QSemaphore *m_done;
+	};
+
+	// Tasks of the parallel package loader; wait() returns once all tasks
+	// started so far have finished
+	class LoadTaskGroup
+	{
+	public:
+		explicit LoadTaskGroup(QThreadPool *pool)
+			: m_pool(pool), m_count(0)
+		{
+		}
+
+		~LoadTaskGroup()
+		{
+			wait();
+		}
+
+		void start(const std::function<void()> &func)
+		{
+			++m_count;
+			m_pool->start(new LoadTask(func, &m_done));
+		}
+
+		void wait()
+		{
+			m_done.acquire(m_count);
+			m_count = 0;
+		}
+
+	private:
+		QThreadPool *m_pool;
+		QSemaphore m_done;
+		int m_count;
+	};
 }
 
 DocumentPrivate::DocumentPrivate(Document *p) :
 	q_ptr(p), defaultPackageName(QStringLiteral("Book1.xlsx")),
-	isLoad(false)
+	loadOptions(Document::ParallelLoad), compressionLevel(-1), compressionThreads(1), isLoad(false)
 {
 }
 
@@ -172,7 +232,20 @@ void DocumentPrivate::init()
 bool DocumentPrivate::loadPackage(QIODevice *device)
 {
 	Q_Q(Document);
-	ZipReader zipReader(device);
+	const bool parallel = loadOptions.testFlag(Document::ParallelLoad);
+	const bool lazy = loadOptions.testFlag(Document::LazySheets);
+
+	// The parallel loader inflates entries with one ZipReader per task,
+	// all of them reading the package from memory. Lazy sheets are read
+	// from memory as well, the device may be gone when they are accessed.
+	QByteArray package;
+	if (parallel || lazy) {
+		if (!device->isSequential())
+			device->seek(0);
+		package = device->readAll();
+	}
+	QSharedPointer<ZipReader> reader(parallel || lazy ? new ZipReader(package) : new ZipReader(device));
+	ZipReader &zipReader = *reader;
 	QStringList filePaths = zipReader.filePaths();
 
 	//Load the Content_Types file
@@ -230,55 +303,70 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
 	workbook->setFilePath(xlworkbook_Path);
 	workbook->loadFromXmlData(zipReader.fileData(xlworkbook_Path));
 
-	//load styles
+	//styles
+	QString stylesPath;
 	QList<XlsxRelationship> rels_styles = workbook->relationships()->documentRelationships(QStringLiteral("/styles"));
 	if (!rels_styles.isEmpty()) {
 		//In normal case this should be styles.xml which in xl
 		QString name = rels_styles[0].target;
 
         // dev34
-        QString path;
         if ( xlworkbook_Dir == QLatin1String(".") ) // root
         {
-            path = name;
+            stylesPath = name;
         }
         else
         {
-            path = xlworkbook_Dir + QLatin1String("/") + name;
+            stylesPath = xlworkbook_Dir + QLatin1String("/") + name;
         }
-
-		QSharedPointer<Styles> styles (new Styles(Styles::F_LoadFromExists));
-		styles->loadFromXmlData(zipReader.fileData(path));
-		workbook->d_func()->styles = styles;
 	}
 
-	//load sharedStrings
+	//sharedStrings
+	QString sharedStringsPath;
 	QList<XlsxRelationship> rels_sharedStrings = workbook->relationships()->documentRelationships(QStringLiteral("/sharedStrings"));
 	if (!rels_sharedStrings.isEmpty()) {
 		//In normal case this should be sharedStrings.xml which in xl
 		QString name = rels_sharedStrings[0].target;
-		QString path = xlworkbook_Dir + QLatin1String("/") + name;
-		workbook->d_func()->sharedStrings->loadFromXmlData(zipReader.fileData(path));
+		sharedStringsPath = xlworkbook_Dir + QLatin1String("/") + name;
 	}
 
-	//load theme
+	//theme
+	QString themePath;
 	QList<XlsxRelationship> rels_theme = workbook->relationships()->documentRelationships(QStringLiteral("/theme"));
 	if (!rels_theme.isEmpty()) {
 		//In normal case this should be theme/theme1.xml which in xl
 		QString name = rels_theme[0].target;
-		QString path = xlworkbook_Dir + QLatin1String("/") + name;
-		workbook->theme()->loadFromXmlData(zipReader.fileData(path));
+		themePath = xlworkbook_Dir + QLatin1String("/") + name;
 	}
 
-	//load sheets
-	for (int i=0; i<workbook->sheetCount(); ++i) {
-		AbstractSheet *sheet = workbook->sheet(i);
-        QString strFilePath = sheet->filePath();
-        QString rel_path = getRelFilePath(strFilePath);
-		//If the .rel file exists, load it.
-		if (zipReader.filePaths().contains(rel_path))
-			sheet->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
-		sheet->loadFromXmlData(zipReader.fileData(sheet->filePath()));
+	if (parallel) {
+		loadPartsParallel(package, stylesPath, sharedStringsPath, themePath);
+	} else {
+		//load styles
+		if (!stylesPath.isEmpty()) {
+			QSharedPointer<Styles> styles (new Styles(Styles::F_LoadFromExists));
+			styles->loadFromXmlData(zipReader.fileData(stylesPath));
+			workbook->d_func()->styles = styles;
+		}
+
+		//load sharedStrings
+		if (!sharedStringsPath.isEmpty())
+			workbook->d_func()->sharedStrings->loadFromXmlData(zipReader.fileData(sharedStringsPath));
+
+		//load theme
+		if (!themePath.isEmpty())
+			workbook->theme()->loadFromXmlData(zipReader.fileData(themePath));
+
+		//load sheets
+		for (int i=0; !lazy && i<workbook->sheetCount(); ++i) {
+			AbstractSheet *sheet = workbook->sheet(i);
+			QString strFilePath = sheet->filePath();
+			QString rel_path = getRelFilePath(strFilePath);
+			//If the .rel file exists, load it.
+			if (zipReader.filePaths().contains(rel_path))
+				sheet->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
+			sheet->loadFromXmlData(zipReader.fileData(sheet->filePath()));
+		}
 	}
 
 	//load external links
@@ -291,6 +379,24 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
 		link->loadFromXmlData(zipReader.fileData(link->filePath()));
 	}
 
+	if (lazy) {
+		// sheets with their drawings, charts and pictures are read by
+		// Workbook::loadPendingSheet() when they are first accessed
+		WorkbookPrivate *workbook_d = workbook->d_func();
+		workbook_d->skipDrawings = loadOptions.testFlag(Document::SkipDrawings);
+		for (int i=0; i<workbook_d->sheets.size(); ++i)
+			workbook_d->pendingSheets.insert(workbook_d->sheets[i].data());
+		if (!workbook_d->pendingSheets.isEmpty())
+			workbook_d->lazyPackage = reader;
+		isLoad = true;
+		return true;
+	}
+
+	if (loadOptions.testFlag(Document::SkipDrawings)) {
+		for (int i=0; i<workbook->sheetCount(); ++i)
+			workbook->dropDrawing(workbook->sheet(i));
+	}
+
 	//load drawings
 	for (int i=0; i<workbook->drawings().size(); ++i) {
 		Drawing *drawing = workbook->drawings()[i];
@@ -319,6 +425,85 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
 	return true;
 }
 
+/*
+  Loads styles, shared strings, theme and the sheets of the package on a
+  thread pool, each task inflating its own entries. The sheets start once
+  the styles are loaded; with Document::ParallelSharedStrings they do not wait
+  for sharedStrings.xml either and the shared string cells are completed
+  afterwards by WorksheetPrivate::resolveSharedStrings(). With
+  Document::LazySheets the sheets are left to Workbook::loadPendingSheet().
+ */
+void DocumentPrivate::loadPartsParallel(const QByteArray &package, const QString &stylesPath,
+										const QString &sharedStringsPath, const QString &themePath)
+{
+	using namespace xlsxDocumentCpp;
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+
+	LoadTaskGroup styleTasks(&pool);
+	LoadTaskGroup sharedStringTasks(&pool);
+	LoadTaskGroup sheetTasks(&pool);
+
+	if (!stylesPath.isEmpty()) {
+		QSharedPointer<Styles> styles (new Styles(Styles::F_LoadFromExists));
+		workbook->d_func()->styles = styles;
+		styleTasks.start([package, stylesPath, styles]() {
+			ZipReader zipReader(package);
+			styles->loadFromXmlData(zipReader.fileData(stylesPath));
+		});
+	}
+
+	if (!themePath.isEmpty()) {
+		Theme *theme = workbook->theme();
+		styleTasks.start([package, themePath, theme]() {
+			ZipReader zipReader(package);
+			theme->loadFromXmlData(zipReader.fileData(themePath));
+		});
+	}
+
+	if (!sharedStringsPath.isEmpty()) {
+		SharedStrings *sharedStrings = workbook->d_func()->sharedStrings.data();
+		sharedStringTasks.start([package, sharedStringsPath, sharedStrings]() {
+			ZipReader zipReader(package);
+			sharedStrings->loadFromXmlData(zipReader.fileData(sharedStringsPath));
+		});
+	}
+
+	const bool deferSharedStrings = loadOptions.testFlag(Document::ParallelSharedStrings);
+	styleTasks.wait();
+	if (!deferSharedStrings)
+		sharedStringTasks.wait();
+
+	QList<WorksheetPrivate *> worksheets;
+	const bool lazy = loadOptions.testFlag(Document::LazySheets);
+	for (int i=0; !lazy && i<workbook->sheetCount(); ++i) {
+		AbstractSheet *sheet = workbook->sheet(i);
+		if (sheet->sheetType() == AbstractSheet::ST_WorkSheet) {
+			WorksheetPrivate *sheet_d = static_cast<Worksheet *>(sheet)->d_func();
+			sheet_d->sharedStringLoad = deferSharedStrings ? WorksheetPrivate::DeferSharedStrings
+														   : WorksheetPrivate::CountSharedStrings;
+			worksheets.append(sheet_d);
+		}
+
+		sheetTasks.start([package, sheet]() {
+			ZipReader zipReader(package);
+			QString rel_path = getRelFilePath(sheet->filePath());
+			//If the .rel file exists, load it.
+			if (zipReader.filePaths().contains(rel_path))
+				sheet->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
+			sheet->loadFromXmlData(zipReader.fileData(sheet->filePath()));
+		});
+	}
+
+	sheetTasks.wait();
+	sharedStringTasks.wait();
+
+	// SharedStrings is only modified here, on the loading thread
+	for (WorksheetPrivate *sheet_d : worksheets)
+		sheet_d->resolveSharedStrings();
+}
+
 bool DocumentPrivate::savePackage(QIODevice *device) const
 {
 	Q_Q(const Document);
@@ -326,12 +511,18 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
 	ZipWriter zipWriter(device);
 	if (zipWriter.error())
 		return false;
+	zipWriter.setCompressionLevel(compressionLevel);
+	zipWriter.setCompressionThreads(compressionThreads);
 
 	contentTypes->clearOverrides();
 
 	DocPropsApp docPropsApp(DocPropsApp::F_NewFromScratch);
 	DocPropsCore docPropsCore(DocPropsCore::F_NewFromScratch);
 
+	// worksheets renumber the shared strings they use, unused ones are dropped
+	SharedStrings *sharedStrings = workbook->sharedStrings();
+	sharedStrings->beginSave();
+
 	// save worksheet xml files
 	QList<QSharedPointer<AbstractSheet> > worksheets = workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet);
 	if (!worksheets.isEmpty())
@@ -406,10 +597,11 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
 	zipWriter.addFile(QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData());
 
 	// save sharedStrings xml file
-	if (!workbook->sharedStrings()->isEmpty()) {
+	if (!sharedStrings->isEmpty()) {
 		contentTypes->addSharedString();
-		zipWriter.addFile(QStringLiteral("xl/sharedStrings.xml"), workbook->sharedStrings()->saveToXmlData());
+		zipWriter.addFile(QStringLiteral("xl/sharedStrings.xml"), sharedStrings->saveToXmlData());
 	}
+	sharedStrings->endSave();
 
     // save calc chain [dev16]
     contentTypes->addCalcChain();
@@ -453,7 +645,7 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
 	zipWriter.addFile(QStringLiteral("[Content_Types].xml"), contentTypes->saveToXmlData());
 
 	zipWriter.close();
-	return true;
+	return !zipWriter.error();
 }
 
 bool DocumentPrivate::copyStyle(const QString &from, const QString &to)
@@ -549,13 +741,27 @@ Document::Document(QObject *parent) :
  * \overload
  * Try to open an existing xlsx document named \a name.
  * The \a parent argument is passed to QObject's constructor.
+ * The package is loaded with Document::ParallelLoad.
  */
 Document::Document(const QString &name, 
 					QObject *parent) :
+	Document(name, ParallelLoad, parent)
+{
+}
+
+/*!
+ * \overload
+ * Try to open an existing xlsx document named \a name, loading it
+ * as specified by \a options.
+ * The \a parent argument is passed to QObject's constructor.
+ */
+Document::Document(const QString &name, LoadOptions options,
+					QObject *parent) :
 	QObject(parent), 
 	d_ptr(new DocumentPrivate(this))
 {
 	d_ptr->packageName = name; 
+	d_ptr->loadOptions = options;
 
 	if (QFile::exists(name)) 
 	{
@@ -576,10 +782,23 @@ Document::Document(const QString &name,
  * \overload
  * Try to open an existing xlsx document from \a device.
  * The \a parent argument is passed to QObject's constructor.
+ * The package is loaded with Document::ParallelLoad.
  */
 Document::Document(QIODevice *device, QObject *parent) :
+	Document(device, ParallelLoad, parent)
+{
+}
+
+/*!
+ * \overload
+ * Try to open an existing xlsx document from \a device, loading it
+ * as specified by \a options.
+ * The \a parent argument is passed to QObject's constructor.
+ */
+Document::Document(QIODevice *device, LoadOptions options, QObject *parent) :
 	QObject(parent), d_ptr(new DocumentPrivate(this))
 {
+	d_ptr->loadOptions = options;
 	if (device && device->isReadable())
 	{
 		if (!d_ptr->loadPackage(device))
@@ -638,6 +857,72 @@ QVariant Document::read(int row, int col) const
 	return QVariant();
 }
 
+/*!
+	Returns the contents of the cell \a cell, with formulas calculated.
+
+	\sa Worksheet::readValue()
+ */
+QVariant Document::readValue(const CellReference &cell) const
+{
+	if (Worksheet *sheet = currentWorksheet())
+		return sheet->readValue(cell);
+	return QVariant();
+}
+
+/*!
+	Returns the contents of the cell (\a row, \a col), with formulas
+	calculated.
+ */
+QVariant Document::readValue(int row, int col) const
+{
+	if (Worksheet *sheet = currentWorksheet())
+		return sheet->readValue(row, col);
+	return QVariant();
+}
+
+/*!
+	Returns the contents of \a range in the current worksheet as a row-major
+	buffer. \sa Worksheet::readRange()
+ */
+QVector<QVariant> Document::readRange(const CellRange &range) const
+{
+	if (Worksheet *sheet = currentWorksheet())
+		return sheet->readRange(range);
+	return QVector<QVariant>();
+}
+
+/*!
+	Writes the row-major buffer \a values into \a range of the current
+	worksheet. \sa Worksheet::writeRange()
+ */
+bool Document::writeRange(const CellRange &range, const QVector<QVariant> &values, const Format &format)
+{
+	if (Worksheet *sheet = currentWorksheet())
+		return sheet->writeRange(range, values, format);
+	return false;
+}
+
+/*!
+	Returns the range holding cells in the current worksheet.
+	\sa Worksheet::usedRange()
+ */
+CellRange Document::usedRange() const
+{
+	if (Worksheet *sheet = currentWorksheet())
+		return sheet->usedRange();
+	return CellRange();
+}
+
+/*!
+	Calls \a func for every non-empty row of \a range in the current
+	worksheet. \sa Worksheet::forEachRow()
+ */
+void Document::forEachRow(const CellRange &range, const std::function<bool (int, const QVector<QVariant> &)> &func) const
+{
+	if (Worksheet *sheet = currentWorksheet())
+		sheet->forEachRow(range, func);
+}
+
 /*!
  * Insert an \a image to current active worksheet at the position \a row, \a column
  * Returns ture if success.
@@ -1261,6 +1546,39 @@ bool Document::saveAs(QIODevice *device) const
 	return d->savePackage(device);
 }
 
+/*!
+ * Sets the deflate \a level used when the document is saved: 0 stores the
+ * parts, 1 is the fastest and 9 gives the smallest file. -1, the default,
+ * selects zlib's default level.
+ */
+void Document::setCompressionLevel(int level)
+{
+	Q_D(Document);
+	d->compressionLevel = qBound(-1, level, 9);
+}
+
+int Document::compressionLevel() const
+{
+	Q_D(const Document);
+	return d->compressionLevel;
+}
+
+/*!
+ * Sets the number of \a threads deflating parts larger than 1 MiB when the
+ * document is saved. The default, 1, deflates on the calling thread.
+ */
+void Document::setCompressionThreads(int threads)
+{
+	Q_D(Document);
+	d->compressionThreads = qMax(1, threads);
+}
+
+int Document::compressionThreads() const
+{
+	Q_D(const Document);
+	return d->compressionThreads;
+}
+
 bool Document::isLoadPackage() const
 {
 	Q_D(const Document);
@@ -1291,6 +1609,8 @@ bool Document::changeimage(int filenoinmidea, QString newfile)
 
     QImage newpic(newfile);
 	
+	// media indices cover all sheets
+	d->workbook->loadPendingSheets();
     auto mediaFileToLoad = d->workbook->mediaFiles();
     const auto mf = mediaFileToLoad[filenoinmidea];
 	
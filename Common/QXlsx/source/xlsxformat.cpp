@@ -2,6 +2,7 @@
 
 #include <QtGlobal>
 #include <QDataStream>
+#include <cstring>
 #include <QDebug>
 
 #include "xlsxformat.h"
@@ -12,10 +13,10 @@
 QT_BEGIN_NAMESPACE_XLSX
 
 FormatPrivate::FormatPrivate()
-	: dirty(true)
-	, font_dirty(true), font_index_valid(false), font_index(0)
-	, fill_dirty(true), fill_index_valid(false), fill_index(0)
-	, border_dirty(true), border_index_valid(false), border_index(0)
+	: dirty(true), format_hash(0)
+	, font_dirty(true), font_index_valid(false), font_hash(0), font_index(0)
+	, fill_dirty(true), fill_index_valid(false), fill_hash(0), fill_index(0)
+	, border_dirty(true), border_index_valid(false), border_hash(0), border_index(0)
 	, xf_index(-1), xf_indexValid(false)
 	, is_dxf_fomat(false), dxf_index(-1), dxf_indexValid(false)
 	, theme(0)
@@ -24,13 +25,14 @@ FormatPrivate::FormatPrivate()
 
 FormatPrivate::FormatPrivate(const FormatPrivate &other)
 	: QSharedData(other)
-	, dirty(other.dirty), formatKey(other.formatKey)
-	, font_dirty(other.font_dirty), font_index_valid(other.font_index_valid), font_key(other.font_key), font_index(other.font_index)
-	, fill_dirty(other.fill_dirty), fill_index_valid(other.fill_index_valid), fill_key(other.fill_key), fill_index(other.fill_index)
-	, border_dirty(other.border_dirty), border_index_valid(other.border_index_valid), border_key(other.border_key), border_index(other.border_index)
+	, dirty(other.dirty), format_hash(other.format_hash)
+	, font_dirty(other.font_dirty), font_index_valid(other.font_index_valid), font_hash(other.font_hash), font_index(other.font_index)
+	, fill_dirty(other.fill_dirty), fill_index_valid(other.fill_index_valid), fill_hash(other.fill_hash), fill_index(other.fill_index)
+	, border_dirty(other.border_dirty), border_index_valid(other.border_index_valid), border_hash(other.border_hash), border_index(other.border_index)
 	, xf_index(other.xf_index), xf_indexValid(other.xf_indexValid)
 	, is_dxf_fomat(other.is_dxf_fomat), dxf_index(other.dxf_index), dxf_indexValid(other.dxf_indexValid)
 	, theme(other.theme)
+	, numFmtProgram(other.numFmtProgram)
 	, properties(other.properties)
 {
 
@@ -41,6 +43,104 @@ FormatPrivate::~FormatPrivate()
 
 }
 
+namespace {
+
+inline quint64 mixHash(quint64 h, quint64 v)
+{
+	h ^= v;
+	h *= Q_UINT64_C(0x100000001b3);
+	return h ^ (h >> 29);
+}
+
+quint64 colorHash(const XlsxColor &color)
+{
+	if (color.isRgbColor())
+		return mixHash(1, color.rgbColor().rgba());
+	if (color.isIndexedColor())
+		return mixHash(2, quint64(color.indexedColor()));
+	if (color.isThemeColor())
+		return mixHash(3, qHash(color.themeColor().join(QLatin1Char(','))));
+	return 0;
+}
+
+quint64 valueHash(const QVariant &value)
+{
+	const int type = value.userType();
+	if (type == qMetaTypeId<XlsxColor>())
+		return mixHash(quint64(type), colorHash(value.value<XlsxColor>()));
+
+	switch (type) {
+	case QMetaType::Bool:
+	case QMetaType::Int:
+	case QMetaType::UInt:
+	case QMetaType::LongLong:
+	case QMetaType::ULongLong:
+		return mixHash(quint64(type), quint64(value.toLongLong()));
+	case QMetaType::Double: {
+		double number = value.toDouble();
+		if (number == 0.0)
+			number = 0.0; // -0.0 == 0.0
+		quint64 bits;
+		memcpy(&bits, &number, sizeof(bits));
+		return mixHash(quint64(type), bits);
+	}
+	case QMetaType::QColor:
+		return mixHash(quint64(type), value.value<QColor>().rgba());
+	default:
+		return mixHash(quint64(type), qHash(value.toString()));
+	}
+}
+
+bool sameValue(const QVariant &a, const QVariant &b)
+{
+	const int type = a.userType();
+	if (type != b.userType())
+		return false;
+	if (type == qMetaTypeId<XlsxColor>()) {
+		// XlsxColor has no registered comparator
+		const XlsxColor ca = a.value<XlsxColor>();
+		const XlsxColor cb = b.value<XlsxColor>();
+		if (ca.isRgbColor() || cb.isRgbColor())
+			return ca.isRgbColor() && cb.isRgbColor() && ca.rgbColor() == cb.rgbColor();
+		if (ca.isIndexedColor() || cb.isIndexedColor())
+			return ca.isIndexedColor() && cb.isIndexedColor() && ca.indexedColor() == cb.indexedColor();
+		return ca.themeColor() == cb.themeColor();
+	}
+	return a == b;
+}
+
+} // namespace
+
+/*
+   Hash of the properties in [first, last). Only ids and values are hashed,
+   so it is stable for a given property set and 0 for an empty range.
+*/
+quint64 FormatPrivate::propertiesHash(const QMap<int, QVariant> &properties, int first, int last)
+{
+	quint64 h = 0;
+	for (auto it = properties.lowerBound(first); it != properties.constEnd() && it.key() < last; ++it) {
+		h = mixHash(h, quint64(it.key()) + 1);
+		h = mixHash(h, valueHash(it.value()));
+	}
+	return h;
+}
+
+bool FormatPrivate::sameProperties(const QMap<int, QVariant> &a, const QMap<int, QVariant> &b, int first, int last)
+{
+	auto ia = a.lowerBound(first);
+	auto ib = b.lowerBound(first);
+	for (;;) {
+		const bool endA = ia == a.constEnd() || ia.key() >= last;
+		const bool endB = ib == b.constEnd() || ib.key() >= last;
+		if (endA || endB)
+			return endA && endB;
+		if (ia.key() != ib.key() || !sameValue(ia.value(), ib.value()))
+			return false;
+		++ia;
+		++ib;
+	}
+}
+
 /*!
  * \class Format
  * \inmodule QtXlsx
@@ -240,7 +340,9 @@ bool Format::isDateTimeFormat() const
 	if (hasProperty(FormatPrivate::P_NumFmt_FormatCode)) 
 	{
 		//Custom numFmt, so
-		//Gauss from the number string
+		//Gauss from the number string, compiled once by Styles
+		if (d->numFmtProgram)
+			return d->numFmtProgram->isDateTime();
 		return NumFormatParser::isDateTime(numberFormat());
 	} 
 	else if (hasProperty(FormatPrivate::P_NumFmt_Id))
@@ -279,6 +381,32 @@ void Format::fixNumberFormat(int id, const QString &format)
 	setProperty(FormatPrivate::P_NumFmt_FormatCode, format, QString(), false);
 }
 
+/*!
+	\internal
+	Returns the compiled number format. Formats added to Styles share one
+	program per format code; others compile theirs on every call.
+ */
+QSharedPointer<const NumFormatProgram> Format::numberFormatProgram() const
+{
+	if (d && d->numFmtProgram)
+		return d->numFmtProgram;
+
+	static const QSharedPointer<const NumFormatProgram> general = NumFormatProgram::compile(QStringLiteral("General"));
+	const QString code = numberFormat();
+	return code.isEmpty() ? general : NumFormatProgram::compile(code);
+}
+
+/*!
+	\internal
+	Called by styles to attach the compiled number format
+ */
+void Format::setNumberFormatProgram(const QSharedPointer<const NumFormatProgram> &program)
+{
+	if (!d)
+		d = new FormatPrivate;
+	d->numFmtProgram = program;
+}
+
 /*!
 	\internal
 	Return true if the format has number format.
@@ -512,20 +640,46 @@ QByteArray Format::fontKey() const
 	if (isEmpty())
 		return QByteArray();
 
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
+	for (int i=FormatPrivate::P_Font_STARTID; i<FormatPrivate::P_Font_ENDID; ++i) {
+        auto it = d->properties.constFind(i);
+        if (it != d->properties.constEnd())
+            stream << i << it.value();
+	};
+
+	return key;
+}
+
+/*!
+ * \internal
+ * Cached hash of the font properties, what Styles interns fonts by.
+ */
+quint64 Format::fontHash() const
+{
+	if (isEmpty())
+		return 0;
+
 	if (d->font_dirty) {
-		QByteArray key;
-		QDataStream stream(&key, QIODevice::WriteOnly);
-		for (int i=FormatPrivate::P_Font_STARTID; i<FormatPrivate::P_Font_ENDID; ++i) {
-            auto it = d->properties.constFind(i);
-            if (it != d->properties.constEnd())
-                stream << i << it.value();
-		};
-
-		const_cast<Format*>(this)->d->font_key = key;
-		const_cast<Format*>(this)->d->font_dirty = false;
+		d->font_hash = FormatPrivate::propertiesHash(d->properties, FormatPrivate::P_Font_STARTID, FormatPrivate::P_Font_ENDID);
+		d->font_dirty = false;
 	}
 
-	return d->font_key;
+	return d->font_hash;
+}
+
+/*!
+ * \internal
+ */
+bool Format::hasSameFont(const Format &other) const
+{
+	if (d == other.d)
+		return true;
+	if (isEmpty() || other.isEmpty())
+		return !hasProperties(FormatPrivate::P_Font_STARTID, FormatPrivate::P_Font_ENDID)
+			&& !other.hasProperties(FormatPrivate::P_Font_STARTID, FormatPrivate::P_Font_ENDID);
+	return fontHash() == other.fontHash()
+		&& FormatPrivate::sameProperties(d->properties, other.d->properties, FormatPrivate::P_Font_STARTID, FormatPrivate::P_Font_ENDID);
 }
 
 /*!
@@ -921,20 +1075,46 @@ QByteArray Format::borderKey() const
 	if (isEmpty())
 		return QByteArray();
 
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
+	for (int i=FormatPrivate::P_Border_STARTID; i<FormatPrivate::P_Border_ENDID; ++i) {
+        auto it = d->properties.constFind(i);
+        if (it != d->properties.constEnd())
+            stream << i << it.value();
+	};
+
+	return key;
+}
+
+/*!
+ * \internal
+ * Cached hash of the border properties, what Styles interns borders by.
+ */
+quint64 Format::borderHash() const
+{
+	if (isEmpty())
+		return 0;
+
 	if (d->border_dirty) {
-		QByteArray key;
-		QDataStream stream(&key, QIODevice::WriteOnly);
-		for (int i=FormatPrivate::P_Border_STARTID; i<FormatPrivate::P_Border_ENDID; ++i) {
-            auto it = d->properties.constFind(i);
-            if (it != d->properties.constEnd())
-                stream << i << it.value();
-		};
-
-		const_cast<Format*>(this)->d->border_key = key;
-		const_cast<Format*>(this)->d->border_dirty = false;
+		d->border_hash = FormatPrivate::propertiesHash(d->properties, FormatPrivate::P_Border_STARTID, FormatPrivate::P_Border_ENDID);
+		d->border_dirty = false;
 	}
 
-	return d->border_key;
+	return d->border_hash;
+}
+
+/*!
+ * \internal
+ */
+bool Format::hasSameBorder(const Format &other) const
+{
+	if (d == other.d)
+		return true;
+	if (isEmpty() || other.isEmpty())
+		return !hasProperties(FormatPrivate::P_Border_STARTID, FormatPrivate::P_Border_ENDID)
+			&& !other.hasProperties(FormatPrivate::P_Border_STARTID, FormatPrivate::P_Border_ENDID);
+	return borderHash() == other.borderHash()
+		&& FormatPrivate::sameProperties(d->properties, other.d->properties, FormatPrivate::P_Border_STARTID, FormatPrivate::P_Border_ENDID);
 }
 
 /*!
@@ -1042,20 +1222,46 @@ QByteArray Format::fillKey() const
 	if (isEmpty())
 		return QByteArray();
 
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
+	for (int i=FormatPrivate::P_Fill_STARTID; i<FormatPrivate::P_Fill_ENDID; ++i) {
+        auto it = d->properties.constFind(i);
+        if (it != d->properties.constEnd())
+            stream << i << it.value();
+	};
+
+	return key;
+}
+
+/*!
+ * \internal
+ * Cached hash of the fill properties, what Styles interns fills by.
+ */
+quint64 Format::fillHash() const
+{
+	if (isEmpty())
+		return 0;
+
 	if (d->fill_dirty) {
-		QByteArray key;
-		QDataStream stream(&key, QIODevice::WriteOnly);
-		for (int i=FormatPrivate::P_Fill_STARTID; i<FormatPrivate::P_Fill_ENDID; ++i) {
-            auto it = d->properties.constFind(i);
-            if (it != d->properties.constEnd())
-                stream << i << it.value();
-		};
-
-		const_cast<Format*>(this)->d->fill_key = key;
-		const_cast<Format*>(this)->d->fill_dirty = false;
+		d->fill_hash = FormatPrivate::propertiesHash(d->properties, FormatPrivate::P_Fill_STARTID, FormatPrivate::P_Fill_ENDID);
+		d->fill_dirty = false;
 	}
 
-	return d->fill_key;
+	return d->fill_hash;
+}
+
+/*!
+ * \internal
+ */
+bool Format::hasSameFill(const Format &other) const
+{
+	if (d == other.d)
+		return true;
+	if (isEmpty() || other.isEmpty())
+		return !hasProperties(FormatPrivate::P_Fill_STARTID, FormatPrivate::P_Fill_ENDID)
+			&& !other.hasProperties(FormatPrivate::P_Fill_STARTID, FormatPrivate::P_Fill_ENDID);
+	return fillHash() == other.fillHash()
+		&& FormatPrivate::sameProperties(d->properties, other.d->properties, FormatPrivate::P_Fill_STARTID, FormatPrivate::P_Fill_ENDID);
 }
 
 /*!
@@ -1170,21 +1376,46 @@ QByteArray Format::formatKey() const
 	if (isEmpty())
 		return QByteArray();
 
-	if (d->dirty) {
-		QByteArray key;
-		QDataStream stream(&key, QIODevice::WriteOnly);
+	QByteArray key;
+	QDataStream stream(&key, QIODevice::WriteOnly);
 
-		QMapIterator<int, QVariant> i(d->properties);
-		while (i.hasNext()) {
-			i.next();
-			stream<<i.key()<<i.value();
-		}
+	QMapIterator<int, QVariant> i(d->properties);
+	while (i.hasNext()) {
+		i.next();
+		stream<<i.key()<<i.value();
+	}
+
+	return key;
+}
+
+/*!
+ * \internal
+ * Cached hash of all properties. Equal formats have equal hashes, so
+ * Styles only compares property maps of formats whose hashes match.
+ */
+quint64 Format::formatHash() const
+{
+	if (isEmpty())
+		return 0;
 
-		d->formatKey = key;
+	if (d->dirty) {
+		d->format_hash = FormatPrivate::propertiesHash(d->properties, FormatPrivate::P_STARTID, FormatPrivate::P_ENDID);
 		d->dirty = false;
 	}
 
-	return d->formatKey;
+	return d->format_hash;
+}
+
+/*!
+ * \internal
+ * Returns true if there is at least one property in [first, last).
+ */
+bool Format::hasProperties(int first, int last) const
+{
+	if (!d)
+		return false;
+	auto it = d->properties.lowerBound(first);
+	return it != d->properties.constEnd() && it.key() < last;
 }
 
 /*!
@@ -1258,7 +1489,12 @@ bool Format::dxfIndexValid() const
 */
 bool Format::operator ==(const Format &format) const
 {
-	return this->formatKey() == format.formatKey();
+	if (d == format.d)
+		return true;
+	if (isEmpty() || format.isEmpty())
+		return isEmpty() && format.isEmpty();
+	return formatHash() == format.formatHash()
+		&& FormatPrivate::sameProperties(d->properties, format.d->properties, FormatPrivate::P_STARTID, FormatPrivate::P_ENDID);
 }
 
 /*!
@@ -1266,7 +1502,7 @@ bool Format::operator ==(const Format &format) const
 */
 bool Format::operator !=(const Format &format) const
 {
-	return this->formatKey() != format.formatKey();
+	return !(*this == format);
 }
 
 int Format::theme() const
@@ -1321,6 +1557,9 @@ void Format::setProperty(int propertyId, const QVariant &value, const QVariant &
 	d->xf_indexValid = false;
 	d->dxf_indexValid = false;
 
+	if (propertyId == FormatPrivate::P_NumFmt_Id || propertyId == FormatPrivate::P_NumFmt_FormatCode)
+		d->numFmtProgram.reset();
+
     if (propertyId >= FormatPrivate::P_Font_STARTID && propertyId < FormatPrivate::P_Font_ENDID)
     {
 		d->font_dirty = true;
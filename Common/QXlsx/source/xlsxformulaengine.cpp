@@ -0,0 +1,1498 @@
+// xlsxformulaengine.cpp
+
+#include <QtGlobal>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "xlsxformulaengine_p.h"
+#include "xlsxcell_p.h"
+#include "xlsxcellformula.h"
+#include "xlsxcellrange.h"
+#include "xlsxcellreference.h"
+#include "xlsxrichstring.h"
+#include "xlsxsharedstrings_p.h"
+#include "xlsxworkbook.h"
+#include "xlsxworksheet.h"
+#include "xlsxworksheet_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+// Formulas are ordered by column, then by row, so the formulas of a range
+// are a few contiguous runs of the map
+inline quint64 formulaKey(int row, int col)
+{
+    return (quint64(col) << 32) | quint32(row);
+}
+
+inline int keyRow(quint64 key)
+{
+    return int(key & 0xffffffff);
+}
+
+inline int keyColumn(quint64 key)
+{
+    return int(key >> 32);
+}
+
+inline bool isNumberSlot(quint8 type)
+{
+    return type == CellTable::NumberSlot || type == CellTable::CustomNumberSlot;
+}
+
+const QString ValueError = QStringLiteral("#VALUE!");
+const QString DivisionError = QStringLiteral("#DIV/0!");
+const QString NumberError = QStringLiteral("#NUM!");
+const QString ReferenceError = QStringLiteral("#REF!");
+const QString NotAvailableError = QStringLiteral("#N/A");
+
+/*
+   Recursive descent parser producing postfix code. Precedence follows Excel:
+   comparison < & < + - < * / < ^ < unary minus < %.
+ */
+class FormulaCompiler
+{
+public:
+    FormulaCompiler(const QString &text, int anchorRow, int anchorColumn, FormulaProgram *program) :
+        m_text(text), m_pos(0), m_anchorRow(anchorRow), m_anchorColumn(anchorColumn), m_program(program)
+    {
+    }
+
+    bool compile()
+    {
+        if (!parseComparison())
+            return false;
+        skipSpaces();
+        return m_pos == m_text.size();
+    }
+
+private:
+    QChar peek(int offset = 0) const
+    {
+        const int pos = m_pos + offset;
+        return pos < m_text.size() ? m_text.at(pos) : QChar();
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && m_text.at(m_pos).isSpace())
+            ++m_pos;
+    }
+
+    void append(FormulaOp::Code code, qint32 operand = 0, quint8 argc = 0)
+    {
+        FormulaOp op;
+        op.code = code;
+        op.argc = argc;
+        op.operand = operand;
+        m_program->ops.append(op);
+    }
+
+    bool parseComparison()
+    {
+        if (!parseConcat())
+            return false;
+        for (;;) {
+            skipSpaces();
+            FormulaOp::Code code;
+            if (peek() == QLatin1Char('=')) {
+                code = FormulaOp::Equal;
+                m_pos += 1;
+            } else if (peek() == QLatin1Char('<') && peek(1) == QLatin1Char('>')) {
+                code = FormulaOp::NotEqual;
+                m_pos += 2;
+            } else if (peek() == QLatin1Char('<') && peek(1) == QLatin1Char('=')) {
+                code = FormulaOp::LessEqual;
+                m_pos += 2;
+            } else if (peek() == QLatin1Char('>') && peek(1) == QLatin1Char('=')) {
+                code = FormulaOp::GreaterEqual;
+                m_pos += 2;
+            } else if (peek() == QLatin1Char('<')) {
+                code = FormulaOp::Less;
+                m_pos += 1;
+            } else if (peek() == QLatin1Char('>')) {
+                code = FormulaOp::Greater;
+                m_pos += 1;
+            } else {
+                return true;
+            }
+            if (!parseConcat())
+                return false;
+            append(code);
+        }
+    }
+
+    bool parseConcat()
+    {
+        if (!parseAdditive())
+            return false;
+        for (;;) {
+            skipSpaces();
+            if (peek() != QLatin1Char('&'))
+                return true;
+            ++m_pos;
+            if (!parseAdditive())
+                return false;
+            append(FormulaOp::Concat);
+        }
+    }
+
+    bool parseAdditive()
+    {
+        if (!parseTerm())
+            return false;
+        for (;;) {
+            skipSpaces();
+            const QChar c = peek();
+            if (c != QLatin1Char('+') && c != QLatin1Char('-'))
+                return true;
+            ++m_pos;
+            if (!parseTerm())
+                return false;
+            append(c == QLatin1Char('+') ? FormulaOp::Add : FormulaOp::Subtract);
+        }
+    }
+
+    bool parseTerm()
+    {
+        if (!parsePower())
+            return false;
+        for (;;) {
+            skipSpaces();
+            const QChar c = peek();
+            if (c != QLatin1Char('*') && c != QLatin1Char('/'))
+                return true;
+            ++m_pos;
+            if (!parsePower())
+                return false;
+            append(c == QLatin1Char('*') ? FormulaOp::Multiply : FormulaOp::Divide);
+        }
+    }
+
+    bool parsePower()
+    {
+        if (!parseUnary())
+            return false;
+        for (;;) {
+            skipSpaces();
+            if (peek() != QLatin1Char('^'))
+                return true;
+            ++m_pos;
+            if (!parseUnary())
+                return false;
+            append(FormulaOp::Power);
+        }
+    }
+
+    bool parseUnary()
+    {
+        skipSpaces();
+        if (peek() == QLatin1Char('-')) {
+            ++m_pos;
+            if (!parseUnary())
+                return false;
+            append(FormulaOp::Negate);
+            return true;
+        }
+        if (peek() == QLatin1Char('+')) {
+            ++m_pos;
+            return parseUnary();
+        }
+        if (!parsePrimary())
+            return false;
+        for (;;) {
+            skipSpaces();
+            if (peek() != QLatin1Char('%'))
+                return true;
+            ++m_pos;
+            append(FormulaOp::Percent);
+        }
+    }
+
+    bool parsePrimary()
+    {
+        skipSpaces();
+        const QChar c = peek();
+        if (c == QLatin1Char('(')) {
+            ++m_pos;
+            if (!parseComparison())
+                return false;
+            skipSpaces();
+            if (peek() != QLatin1Char(')'))
+                return false;
+            ++m_pos;
+            return true;
+        }
+        if (c == QLatin1Char('"'))
+            return parseString();
+        if (c.isDigit() || (c == QLatin1Char('.') && peek(1).isDigit()))
+            return parseNumber();
+        if (c == QLatin1Char('#'))
+            return parseError();
+        if (c == QLatin1Char('\'')) {
+            // quoted sheet name, '' is an escaped quote
+            QString sheetName;
+            for (++m_pos; m_pos < m_text.size(); ++m_pos) {
+                if (m_text.at(m_pos) == QLatin1Char('\'')) {
+                    if (peek(1) != QLatin1Char('\''))
+                        break;
+                    ++m_pos;
+                }
+                sheetName.append(m_text.at(m_pos));
+            }
+            if (peek() != QLatin1Char('\'') || peek(1) != QLatin1Char('!'))
+                return false;
+            m_pos += 2;
+            return parseReference(sheetName);
+        }
+        if (c == QLatin1Char('$'))
+            return parseReference(QString());
+        if (!c.isLetter() && c != QLatin1Char('_'))
+            return false;
+
+        // function, sheet name, boolean or reference
+        int end = m_pos;
+        while (end < m_text.size() && (m_text.at(end).isLetterOrNumber()
+                                       || m_text.at(end) == QLatin1Char('_') || m_text.at(end) == QLatin1Char('.')))
+            ++end;
+        const QString word = m_text.mid(m_pos, end - m_pos);
+        int next = end;
+        while (next < m_text.size() && m_text.at(next).isSpace())
+            ++next;
+
+        if (next < m_text.size() && m_text.at(next) == QLatin1Char('(')) {
+            m_pos = next + 1;
+            return parseCall(word);
+        }
+        if (end < m_text.size() && m_text.at(end) == QLatin1Char('!')) {
+            m_pos = end + 1;
+            return parseReference(word);
+        }
+        if (word.compare(QLatin1String("TRUE"), Qt::CaseInsensitive) == 0
+                || word.compare(QLatin1String("FALSE"), Qt::CaseInsensitive) == 0) {
+            m_pos = end;
+            append(FormulaOp::PushBoolean, word.size() == 4 ? 1 : 0);
+            return true;
+        }
+        return parseReference(QString());
+    }
+
+    bool parseString()
+    {
+        QString text;
+        for (++m_pos; m_pos < m_text.size(); ++m_pos) {
+            if (m_text.at(m_pos) == QLatin1Char('"')) {
+                if (peek(1) != QLatin1Char('"'))
+                    break;
+                ++m_pos;
+            }
+            text.append(m_text.at(m_pos));
+        }
+        if (peek() != QLatin1Char('"'))
+            return false;
+        ++m_pos;
+        m_program->strings.append(text);
+        append(FormulaOp::PushString, m_program->strings.size() - 1);
+        return true;
+    }
+
+    bool parseNumber()
+    {
+        const int start = m_pos;
+        while (peek().isDigit())
+            ++m_pos;
+        if (peek() == QLatin1Char('.')) {
+            ++m_pos;
+            while (peek().isDigit())
+                ++m_pos;
+        }
+        if ((peek() == QLatin1Char('e') || peek() == QLatin1Char('E'))
+                && (peek(1).isDigit() || ((peek(1) == QLatin1Char('+') || peek(1) == QLatin1Char('-')) && peek(2).isDigit()))) {
+            m_pos += 2;
+            while (peek().isDigit())
+                ++m_pos;
+        }
+        bool ok;
+        const double number = m_text.mid(start, m_pos - start).toDouble(&ok);
+        if (!ok)
+            return false;
+        m_program->numbers.append(number);
+        append(FormulaOp::PushNumber, m_program->numbers.size() - 1);
+        return true;
+    }
+
+    bool parseError()
+    {
+        static const char *const errors[] = {
+            "#DIV/0!", "#N/A", "#NAME?", "#NULL!", "#NUM!", "#REF!", "#VALUE!"
+        };
+        for (const char *error : errors) {
+            const QLatin1String name(error);
+            if (m_text.mid(m_pos, name.size()).compare(name, Qt::CaseInsensitive) == 0) {
+                m_pos += name.size();
+                m_program->strings.append(QString(name));
+                append(FormulaOp::PushError, m_program->strings.size() - 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseCall(QString name)
+    {
+        name = name.toUpper();
+        if (name.startsWith(QLatin1String("_XLFN.")))
+            name.remove(0, 6);
+
+        int function;
+        int minArgs = 1;
+        int maxArgs = 255;
+        if (name == QLatin1String("SUM")) {
+            function = FormulaOp::Sum;
+        } else if (name == QLatin1String("AVERAGE")) {
+            function = FormulaOp::Average;
+        } else if (name == QLatin1String("MAX")) {
+            function = FormulaOp::Max;
+        } else if (name == QLatin1String("MIN")) {
+            function = FormulaOp::Min;
+        } else if (name == QLatin1String("COUNT")) {
+            function = FormulaOp::Count;
+        } else if (name == QLatin1String("COUNTIF")) {
+            function = FormulaOp::CountIf;
+            minArgs = maxArgs = 2;
+        } else if (name == QLatin1String("RANK") || name == QLatin1String("RANK.EQ")) {
+            function = FormulaOp::Rank;
+            minArgs = 2;
+            maxArgs = 3;
+        } else if (name == QLatin1String("IF")) {
+            function = FormulaOp::If;
+            minArgs = 2;
+            maxArgs = 3;
+        } else if (name == QLatin1String("ROUND")) {
+            function = FormulaOp::Round;
+            minArgs = maxArgs = 2;
+        } else {
+            return false;
+        }
+
+        int argc = 0;
+        skipSpaces();
+        if (peek() != QLatin1Char(')')) {
+            for (;;) {
+                if (!parseComparison())
+                    return false;
+                ++argc;
+                skipSpaces();
+                if (peek() != QLatin1Char(','))
+                    break;
+                ++m_pos;
+            }
+        }
+        if (peek() != QLatin1Char(')') || argc < minArgs || argc > maxArgs)
+            return false;
+        ++m_pos;
+        append(FormulaOp::Call, function, quint8(argc));
+        return true;
+    }
+
+    // [$]COL[$]ROW; a missing row leaves *row at 0
+    bool parseCell(int *row, int *col, bool *absoluteRow, bool *absoluteCol)
+    {
+        *absoluteCol = peek() == QLatin1Char('$');
+        if (*absoluteCol)
+            ++m_pos;
+        int column = 0;
+        int letters = 0;
+        for (; letters < 3 && peek().isLetter() && peek().unicode() < 128; ++letters, ++m_pos)
+            column = column * 26 + (peek().toUpper().unicode() - 'A' + 1);
+        if (!letters || column > XLSX_COLUMN_MAX)
+            return false;
+        *col = column;
+
+        *absoluteRow = peek() == QLatin1Char('$');
+        if (*absoluteRow)
+            ++m_pos;
+        int number = 0;
+        int digits = 0;
+        for (; digits < 7 && peek().isDigit(); ++digits, ++m_pos)
+            number = number * 10 + peek().digitValue();
+        if (number > XLSX_ROW_MAX || (*absoluteRow && !digits))
+            return false;
+        *row = number;
+
+        const QChar next = peek();
+        return !(next.isLetterOrNumber() || next == QLatin1Char('_') || next == QLatin1Char('.') || next == QLatin1Char('('));
+    }
+
+    bool parseReference(const QString &sheetName)
+    {
+        int firstRow, firstCol, lastRow, lastCol;
+        bool absFirstRow, absFirstCol, absLastRow, absLastCol;
+        if (!parseCell(&firstRow, &firstCol, &absFirstRow, &absFirstCol))
+            return false;
+        const bool isRange = peek() == QLatin1Char(':');
+        if (isRange) {
+            ++m_pos;
+            if (!parseCell(&lastRow, &lastCol, &absLastRow, &absLastCol))
+                return false;
+        } else {
+            lastRow = firstRow;
+            lastCol = firstCol;
+            absLastRow = absFirstRow;
+            absLastCol = absFirstCol;
+        }
+
+        // A:C, whole columns
+        if (!firstRow || !lastRow) {
+            if (!isRange || firstRow || lastRow)
+                return false;
+            firstRow = 1;
+            lastRow = XLSX_ROW_MAX;
+            absFirstRow = absLastRow = true;
+        }
+        if (firstRow > lastRow) {
+            std::swap(firstRow, lastRow);
+            std::swap(absFirstRow, absLastRow);
+        }
+        if (firstCol > lastCol) {
+            std::swap(firstCol, lastCol);
+            std::swap(absFirstCol, absLastCol);
+        }
+
+        FormulaRef ref;
+        ref.absolute = (absFirstRow ? FormulaRef::AbsoluteFirstRow : 0) | (absFirstCol ? FormulaRef::AbsoluteFirstColumn : 0)
+                | (absLastRow ? FormulaRef::AbsoluteLastRow : 0) | (absLastCol ? FormulaRef::AbsoluteLastColumn : 0);
+        ref.firstRow = absFirstRow ? firstRow : firstRow - m_anchorRow;
+        ref.firstColumn = absFirstCol ? firstCol : firstCol - m_anchorColumn;
+        ref.lastRow = absLastRow ? lastRow : lastRow - m_anchorRow;
+        ref.lastColumn = absLastCol ? lastCol : lastCol - m_anchorColumn;
+        ref.sheetName = sheetName;
+        if (!sheetName.isEmpty())
+            m_program->external = true;
+
+        m_program->refs.append(ref);
+        append(FormulaOp::PushRef, m_program->refs.size() - 1);
+        return true;
+    }
+
+    const QString m_text;
+    int m_pos;
+    const int m_anchorRow;
+    const int m_anchorColumn;
+    FormulaProgram *m_program;
+};
+
+QString numberText(double number)
+{
+    return QString::number(number, 'g', 15);
+}
+
+FormulaValue toNumber(const FormulaValue &value)
+{
+    switch (value.type) {
+    case FormulaValue::Number:
+    case FormulaValue::Error:
+        return value;
+    case FormulaValue::Boolean:
+        return FormulaValue::fromNumber(value.number);
+    case FormulaValue::String: {
+        bool ok;
+        const double number = value.text.trimmed().toDouble(&ok);
+        return ok ? FormulaValue::fromNumber(number) : FormulaValue::fromError(ValueError);
+    }
+    default:
+        return FormulaValue::fromNumber(0);
+    }
+}
+
+FormulaValue toBoolean(const FormulaValue &value)
+{
+    switch (value.type) {
+    case FormulaValue::Boolean:
+    case FormulaValue::Error:
+        return value;
+    case FormulaValue::Number:
+        return FormulaValue::fromBoolean(value.number != 0);
+    case FormulaValue::String:
+        if (value.text.compare(QLatin1String("TRUE"), Qt::CaseInsensitive) == 0)
+            return FormulaValue::fromBoolean(true);
+        if (value.text.compare(QLatin1String("FALSE"), Qt::CaseInsensitive) == 0)
+            return FormulaValue::fromBoolean(false);
+        return FormulaValue::fromError(ValueError);
+    default:
+        return FormulaValue::fromBoolean(false);
+    }
+}
+
+QString toText(const FormulaValue &value)
+{
+    switch (value.type) {
+    case FormulaValue::Number:
+        return numberText(value.number);
+    case FormulaValue::Boolean:
+        return value.number != 0 ? QStringLiteral("TRUE") : QStringLiteral("FALSE");
+    case FormulaValue::String:
+    case FormulaValue::Error:
+        return value.text;
+    default:
+        return QString();
+    }
+}
+
+// Excel orders numbers < text < booleans; an empty cell acts as 0, "" or FALSE
+int compareValues(FormulaValue a, FormulaValue b)
+{
+    if (a.type == FormulaValue::Empty)
+        a = b.type == FormulaValue::String ? FormulaValue::fromString(QString())
+          : b.type == FormulaValue::Boolean ? FormulaValue::fromBoolean(false) : FormulaValue::fromNumber(0);
+    if (b.type == FormulaValue::Empty)
+        b = a.type == FormulaValue::String ? FormulaValue::fromString(QString())
+          : a.type == FormulaValue::Boolean ? FormulaValue::fromBoolean(false) : FormulaValue::fromNumber(0);
+
+    if (a.type != b.type) {
+        static const int order[] = { 0, 0, 1, 2, 3, 3 }; // Empty, Number, String, Boolean, ...
+        return order[a.type] < order[b.type] ? -1 : 1;
+    }
+    if (a.type == FormulaValue::String) {
+        const int result = a.text.compare(b.text, Qt::CaseInsensitive);
+        return result < 0 ? -1 : result > 0 ? 1 : 0;
+    }
+    return a.number < b.number ? -1 : a.number > b.number ? 1 : 0;
+}
+
+FormulaValue binary(FormulaOp::Code code, const FormulaValue &a, const FormulaValue &b)
+{
+    if (a.type == FormulaValue::Error)
+        return a;
+    if (b.type == FormulaValue::Error)
+        return b;
+
+    if (code == FormulaOp::Concat)
+        return FormulaValue::fromString(toText(a) + toText(b));
+
+    if (code >= FormulaOp::Equal) {
+        const int c = compareValues(a, b);
+        switch (code) {
+        case FormulaOp::Equal: return FormulaValue::fromBoolean(c == 0);
+        case FormulaOp::NotEqual: return FormulaValue::fromBoolean(c != 0);
+        case FormulaOp::Less: return FormulaValue::fromBoolean(c < 0);
+        case FormulaOp::LessEqual: return FormulaValue::fromBoolean(c <= 0);
+        case FormulaOp::Greater: return FormulaValue::fromBoolean(c > 0);
+        default: return FormulaValue::fromBoolean(c >= 0);
+        }
+    }
+
+    const FormulaValue x = toNumber(a);
+    if (x.type == FormulaValue::Error)
+        return x;
+    const FormulaValue y = toNumber(b);
+    if (y.type == FormulaValue::Error)
+        return y;
+
+    double result;
+    switch (code) {
+    case FormulaOp::Add: result = x.number + y.number; break;
+    case FormulaOp::Subtract: result = x.number - y.number; break;
+    case FormulaOp::Multiply: result = x.number * y.number; break;
+    case FormulaOp::Divide:
+        if (y.number == 0)
+            return FormulaValue::fromError(DivisionError);
+        result = x.number / y.number;
+        break;
+    default: result = std::pow(x.number, y.number); break;
+    }
+    if (!std::isfinite(result))
+        return FormulaValue::fromError(NumberError);
+    return FormulaValue::fromNumber(result);
+}
+
+// Value as read() would see it, without converting dates
+FormulaValue cellContent(const Cell &cell)
+{
+    const QVariant value = cell.value();
+    switch (cell.cellType()) {
+    case Cell::BooleanType:
+        return FormulaValue::fromBoolean(value.toBool());
+    case Cell::ErrorType:
+        return FormulaValue::fromError(value.toString());
+    case Cell::StringType:
+    case Cell::InlineStringType:
+    case Cell::SharedStringType:
+        if (cell.isRichString())
+            return FormulaValue::fromString(cell.d_ptr->richString.toPlainString());
+        return FormulaValue::fromString(value.toString());
+    default:
+    {
+        if (!value.isValid())
+            return FormulaValue();
+        bool ok;
+        const double number = value.toDouble(&ok);
+        return ok ? FormulaValue::fromNumber(number) : FormulaValue::fromString(value.toString());
+    }
+    }
+}
+
+// Case-insensitive match with the COUNTIF wildcards * and ?; ~ escapes them
+bool wildcardMatch(const QString &pattern, int p, const QString &text, int t)
+{
+    while (p < pattern.size()) {
+        const QChar c = pattern.at(p);
+        if (c == QLatin1Char('*')) {
+            while (p < pattern.size() && pattern.at(p) == QLatin1Char('*'))
+                ++p;
+            if (p == pattern.size())
+                return true;
+            for (; t <= text.size(); ++t) {
+                if (wildcardMatch(pattern, p, text, t))
+                    return true;
+            }
+            return false;
+        }
+        if (t == text.size())
+            return false;
+        if (c == QLatin1Char('?')) {
+            ++p;
+            ++t;
+            continue;
+        }
+        QChar literal = c;
+        if (c == QLatin1Char('~') && p + 1 < pattern.size())
+            literal = pattern.at(++p);
+        if (literal.toCaseFolded() != text.at(t).toCaseFolded())
+            return false;
+        ++p;
+        ++t;
+    }
+    return t == text.size();
+}
+
+// Criteria of COUNTIF: a value, or a comparison such as ">=60" or "<>absent"
+struct Criterion
+{
+    explicit Criterion(const FormulaValue &criteria) :
+        op(FormulaOp::Equal), wildcard(false)
+    {
+        if (criteria.type != FormulaValue::String) {
+            operand = criteria;
+            return;
+        }
+
+        QString text = criteria.text;
+        static const struct { const char *prefix; FormulaOp::Code op; } prefixes[] = {
+            { "<>", FormulaOp::NotEqual }, { "<=", FormulaOp::LessEqual }, { ">=", FormulaOp::GreaterEqual },
+            { "<", FormulaOp::Less }, { ">", FormulaOp::Greater }, { "=", FormulaOp::Equal }
+        };
+        for (const auto &prefix : prefixes) {
+            if (text.startsWith(QLatin1String(prefix.prefix))) {
+                op = prefix.op;
+                text.remove(0, int(qstrlen(prefix.prefix)));
+                break;
+            }
+        }
+
+        bool ok;
+        const double number = text.trimmed().toDouble(&ok);
+        if (text.isEmpty())
+            operand = FormulaValue();
+        else if (ok)
+            operand = FormulaValue::fromNumber(number);
+        else if (text.compare(QLatin1String("TRUE"), Qt::CaseInsensitive) == 0)
+            operand = FormulaValue::fromBoolean(true);
+        else if (text.compare(QLatin1String("FALSE"), Qt::CaseInsensitive) == 0)
+            operand = FormulaValue::fromBoolean(false);
+        else
+            operand = FormulaValue::fromString(text);
+        wildcard = operand.type == FormulaValue::String
+                && (op == FormulaOp::Equal || op == FormulaOp::NotEqual)
+                && (text.contains(QLatin1Char('*')) || text.contains(QLatin1Char('?')) || text.contains(QLatin1Char('~')));
+    }
+
+    // Whether blank cells of the range are counted
+    bool matchesBlank() const
+    {
+        if (operand.type == FormulaValue::Empty)
+            return op == FormulaOp::Equal;
+        return op == FormulaOp::NotEqual;
+    }
+
+    bool matches(const FormulaValue &value) const
+    {
+        if (operand.type == FormulaValue::Empty)
+            return op == FormulaOp::NotEqual;
+
+        // only values of the operand's type compare; the rest only satisfy <>
+        const bool sameType = value.type == operand.type;
+        if (op == FormulaOp::Equal || op == FormulaOp::NotEqual) {
+            bool equal = false;
+            if (sameType && wildcard)
+                equal = wildcardMatch(operand.text, 0, value.text, 0);
+            else if (sameType)
+                equal = compareValues(value, operand) == 0;
+            return op == FormulaOp::Equal ? equal : !equal;
+        }
+        if (!sameType)
+            return false;
+        const int c = compareValues(value, operand);
+        switch (op) {
+        case FormulaOp::Less: return c < 0;
+        case FormulaOp::LessEqual: return c <= 0;
+        case FormulaOp::Greater: return c > 0;
+        default: return c >= 0;
+        }
+    }
+
+    FormulaOp::Code op;
+    FormulaValue operand;
+    bool wildcard;
+};
+
+// Sum, count and extremes of the numbers of a range
+struct NumberStats
+{
+    NumberStats() : sum(0), min(std::numeric_limits<double>::infinity()),
+        max(-std::numeric_limits<double>::infinity()), count(0) {}
+
+    void add(double value)
+    {
+        sum += value;
+        min = qMin(min, value);
+        max = qMax(max, value);
+        ++count;
+    }
+
+    void addRun(const quint8 *types, const double *values, int size)
+    {
+        double runSum = 0;
+        double runMin = min;
+        double runMax = max;
+        int runCount = 0;
+        for (int i = 0; i < size; ++i) {
+            const bool number = isNumberSlot(types[i]);
+            const double value = number ? values[i] : 0.0;
+            runSum += value;
+            runCount += number;
+            runMin = number && value < runMin ? value : runMin;
+            runMax = number && value > runMax ? value : runMax;
+        }
+        sum += runSum;
+        min = runMin;
+        max = runMax;
+        count += runCount;
+    }
+
+    void addError(const FormulaValue &value)
+    {
+        if (error.type == FormulaValue::Empty)
+            error = value;
+    }
+
+    double sum;
+    double min;
+    double max;
+    int count;
+    FormulaValue error;
+};
+
+// Position of a number among the numbers of a range, for RANK
+struct RankCounter
+{
+    RankCounter(double value, bool ascending) :
+        value(value), ascending(ascending), ahead(0), found(false) {}
+
+    void add(double number)
+    {
+        if (number == value)
+            found = true;
+        else if (ascending ? number < value : number > value)
+            ++ahead;
+    }
+
+    void addRun(const quint8 *types, const double *values, int size)
+    {
+        for (int i = 0; i < size; ++i) {
+            if (isNumberSlot(types[i]))
+                add(values[i]);
+        }
+    }
+
+    void addError(const FormulaValue &)
+    {
+    }
+
+    double value;
+    bool ascending;
+    int ahead;
+    bool found;
+};
+
+} // namespace
+
+FormulaValue FormulaValue::fromNumber(double number)
+{
+    FormulaValue value;
+    value.type = Number;
+    value.number = number;
+    return value;
+}
+
+FormulaValue FormulaValue::fromString(const QString &text)
+{
+    FormulaValue value;
+    value.type = String;
+    value.text = text;
+    return value;
+}
+
+FormulaValue FormulaValue::fromBoolean(bool boolean)
+{
+    FormulaValue value;
+    value.type = Boolean;
+    value.number = boolean ? 1 : 0;
+    return value;
+}
+
+FormulaValue FormulaValue::fromError(const QString &error)
+{
+    FormulaValue value;
+    value.type = Error;
+    value.text = error;
+    return value;
+}
+
+QSharedPointer<const FormulaProgram> FormulaProgram::compile(const QString &formula, int anchorRow, int anchorColumn)
+{
+    QSharedPointer<FormulaProgram> program(new FormulaProgram);
+    program->external = false;
+    FormulaCompiler compiler(formula, anchorRow, anchorColumn, program.data());
+    if (!compiler.compile())
+        return QSharedPointer<const FormulaProgram>();
+    return program;
+}
+
+FormulaEngine::FormulaEngine(WorksheetPrivate *sheet) :
+    m_sheet(sheet), m_built(false)
+{
+}
+
+FormulaEngine::~FormulaEngine()
+{
+}
+
+/*
+   Collects the formulas of the sheet. Loaded formulas with a cached value
+   are taken as calculated; those without one are calculated on first use.
+ */
+void FormulaEngine::build()
+{
+    m_built = true;
+    const CellTable &table = m_sheet->cellTable;
+    if (table.isEmpty())
+        return;
+
+    QVector<quint64> dirty;
+    table.visitCells(table.firstRow(), table.lastRow(), 1, XLSX_COLUMN_MAX,
+                     [this, &dirty](int row, int col, const std::shared_ptr<Cell> &cell) {
+        if (!cell->hasFormula())
+            return;
+        const bool calculated = cell->value().isValid();
+        addFormula(row, col, cell, !calculated);
+        if (!calculated)
+            dirty.append(formulaKey(row, col));
+    });
+    for (quint64 key : qAsConst(dirty))
+        markDependentsDirty(keyRow(key), keyColumn(key));
+}
+
+void FormulaEngine::addFormula(int row, int col, const std::shared_ptr<Cell> &cell, bool dirty)
+{
+    const quint64 key = formulaKey(row, col);
+    FormulaCell formula;
+    formula.cell = cell;
+    formula.program = program(cell->formula(), row, col);
+    formula.state = dirty && formula.program ? Dirty : Clean;
+
+    if (formula.program) {
+        for (const FormulaRef &ref : formula.program->refs) {
+            if (!ref.sheetName.isEmpty())
+                continue;
+            const FormulaValue range = resolve(ref, row, col);
+            if (range.type != FormulaValue::Range)
+                continue;
+
+            Precedent precedent = { range.firstRow, range.firstColumn, range.lastRow, range.lastColumn };
+            formula.precedents.append(precedent);
+            if (range.firstRow == range.lastRow && range.firstColumn == range.lastColumn) {
+                m_cellDependents[formulaKey(range.firstRow, range.firstColumn)].append(key);
+            } else {
+                for (int c = range.firstColumn; c <= range.lastColumn; ++c) {
+                    RangeDependent dependent = { range.firstRow, range.lastRow, key };
+                    m_rangeDependents[c].append(dependent);
+                }
+            }
+        }
+        if (formula.program->external)
+            m_external.append(key);
+    }
+    m_formulas.insert(key, formula);
+}
+
+void FormulaEngine::removeFormula(quint64 key)
+{
+    auto it = m_formulas.find(key);
+    if (it == m_formulas.end())
+        return;
+
+    for (const Precedent &precedent : qAsConst(it->precedents)) {
+        if (precedent.firstRow == precedent.lastRow && precedent.firstColumn == precedent.lastColumn) {
+            const quint64 cellKey = formulaKey(precedent.firstRow, precedent.firstColumn);
+            auto cellIt = m_cellDependents.find(cellKey);
+            if (cellIt != m_cellDependents.end()) {
+                cellIt->removeAll(key);
+                if (cellIt->isEmpty())
+                    m_cellDependents.erase(cellIt);
+            }
+        } else {
+            for (int c = precedent.firstColumn; c <= precedent.lastColumn; ++c) {
+                auto columnIt = m_rangeDependents.find(c);
+                if (columnIt == m_rangeDependents.end())
+                    continue;
+                QVector<RangeDependent> &dependents = *columnIt;
+                dependents.erase(std::remove_if(dependents.begin(), dependents.end(),
+                                                [key](const RangeDependent &d) { return d.formula == key; }),
+                                 dependents.end());
+                if (dependents.isEmpty())
+                    m_rangeDependents.erase(columnIt);
+            }
+        }
+    }
+    m_external.removeAll(key);
+    m_formulas.erase(it);
+}
+
+// Program of \a formula at (row, col); shared formulas compile their root once
+QSharedPointer<const FormulaProgram> FormulaEngine::program(const CellFormula &formula, int row, int col)
+{
+    switch (formula.formulaType()) {
+    case CellFormula::NormalType:
+        return FormulaProgram::compile(formula.formulaText(), row, col);
+    case CellFormula::SharedType:
+    {
+        const int si = formula.sharedIndex();
+        auto it = m_sharedPrograms.constFind(si);
+        if (it != m_sharedPrograms.constEnd())
+            return *it;
+
+        QSharedPointer<const FormulaProgram> shared;
+        const CellFormula root = m_sheet->sharedFormulaMap.value(si);
+        if (root.isValid()) {
+            const CellReference anchor = root.reference().topLeft();
+            shared = FormulaProgram::compile(root.formulaText(), anchor.row(), anchor.column());
+        }
+        m_sharedPrograms.insert(si, shared);
+        return shared;
+    }
+    default:
+        // array and data table formulas keep their cached values
+        return QSharedPointer<const FormulaProgram>();
+    }
+}
+
+void FormulaEngine::cellChanged(int row, int col)
+{
+    if (!m_built)
+        build();
+
+    const quint64 key = formulaKey(row, col);
+    removeFormula(key);
+    if (m_sheet->cellTable.slotType(row, col) == CellTable::CellSlot) {
+        std::shared_ptr<Cell> cell = m_sheet->cellTable.cell(row, col);
+        if (cell->hasFormula())
+            addFormula(row, col, cell, true);
+    }
+    if (!m_formulas.isEmpty())
+        markDependentsDirty(row, col);
+}
+
+// Marks every formula reading (row, col), directly or through other formulas
+void FormulaEngine::markDependentsDirty(int row, int col)
+{
+    QVector<quint64> pending;
+    pending.append(formulaKey(row, col));
+    while (!pending.isEmpty()) {
+        const quint64 cellKey = pending.takeLast();
+        const int r = keyRow(cellKey);
+
+        auto mark = [this, &pending](quint64 key) {
+            auto it = m_formulas.find(key);
+            if (it != m_formulas.end() && it->state == Clean && it->program) {
+                it->state = Dirty;
+                pending.append(key);
+            }
+        };
+
+        auto cellIt = m_cellDependents.constFind(cellKey);
+        if (cellIt != m_cellDependents.constEnd()) {
+            for (quint64 key : *cellIt)
+                mark(key);
+        }
+        auto rangeIt = m_rangeDependents.constFind(keyColumn(cellKey));
+        if (rangeIt != m_rangeDependents.constEnd()) {
+            for (const RangeDependent &dependent : *rangeIt) {
+                if (r >= dependent.firstRow && r <= dependent.lastRow)
+                    mark(dependent.formula);
+            }
+        }
+    }
+}
+
+// Formulas reading other sheets cannot be tracked, they are always redone
+void FormulaEngine::refreshExternal()
+{
+    for (quint64 key : qAsConst(m_external)) {
+        auto it = m_formulas.find(key);
+        if (it != m_formulas.end() && it->state == Clean)
+            it->state = Dirty;
+        markDependentsDirty(keyRow(key), keyColumn(key));
+    }
+}
+
+bool FormulaEngine::evaluate(int row, int col)
+{
+    if (!m_built)
+        build();
+
+    auto it = m_formulas.find(formulaKey(row, col));
+    if (it == m_formulas.end())
+        return false;
+    refreshExternal();
+    compute(it.key(), *it);
+    return true;
+}
+
+void FormulaEngine::recalculate()
+{
+    if (!m_built)
+        build();
+
+    refreshExternal();
+    for (auto it = m_formulas.begin(); it != m_formulas.end(); ++it)
+        compute(it.key(), *it);
+}
+
+/*
+   Computes a dirty formula after the dirty formulas it reads, depth first
+   with an explicit work stack so that long chains of formulas cannot
+   overflow the call stack. Formulas on the stack are Computing; meeting
+   one again is a circular reference, which cellValue() reports when the
+   program reads it.
+ */
+void FormulaEngine::compute(quint64 key, FormulaCell &formula)
+{
+    if (formula.state != Dirty)
+        return;
+
+    QVector<ComputeFrame> stack;
+    formula.state = Computing;
+    stack.append({ key, 0, 0 });
+    while (!stack.isEmpty()) {
+        ComputeFrame &frame = stack.last();
+        auto it = m_formulas.find(frame.key);
+        const quint64 next = nextDirtyPrecedent(*it, frame);
+        if (next) {
+            m_formulas.find(next)->state = Computing;
+            stack.append({ next, 0, 0 });
+        } else {
+            store(it.key(), *it);
+            stack.removeLast();
+        }
+    }
+}
+
+// Key of the next dirty formula among the precedents of \a formula, 0 if none
+quint64 FormulaEngine::nextDirtyPrecedent(const FormulaCell &formula, ComputeFrame &frame)
+{
+    for (; frame.precedent < formula.precedents.size(); ++frame.precedent, frame.cursor = 0) {
+        const Precedent &precedent = formula.precedents.at(frame.precedent);
+        const quint64 last = formulaKey(precedent.lastRow, precedent.lastColumn);
+        auto it = m_formulas.lowerBound(qMax(frame.cursor, formulaKey(precedent.firstRow, precedent.firstColumn)));
+        while (it != m_formulas.end() && it.key() <= last) {
+            const int row = keyRow(it.key());
+            const int col = keyColumn(it.key());
+            if (row < precedent.firstRow) {
+                it = m_formulas.lowerBound(formulaKey(precedent.firstRow, col));
+            } else if (row > precedent.lastRow) {
+                it = m_formulas.lowerBound(formulaKey(precedent.firstRow, col + 1));
+            } else if (it->state == Dirty) {
+                frame.cursor = it.key() + 1;
+                return it.key();
+            } else {
+                ++it;
+            }
+        }
+    }
+    return 0;
+}
+
+// Runs the program of \a formula, whose precedents are calculated, into its cell
+void FormulaEngine::store(quint64 key, FormulaCell &formula)
+{
+    const FormulaValue result = scalar(run(*formula.program, keyRow(key), keyColumn(key)));
+    formula.state = Clean;
+
+    CellPrivate *cell = formula.cell->d_ptr;
+    switch (result.type) {
+    case FormulaValue::Number:
+        cell->cellType = Cell::NumberType;
+        cell->value = result.number;
+        break;
+    case FormulaValue::Boolean:
+        cell->cellType = Cell::BooleanType;
+        cell->value = result.number != 0;
+        break;
+    case FormulaValue::String:
+        cell->cellType = Cell::StringType;
+        cell->value = result.text;
+        break;
+    case FormulaValue::Error:
+        cell->cellType = Cell::ErrorType;
+        cell->value = result.text;
+        break;
+    default:
+        // a formula referring to an empty cell gives 0
+        cell->cellType = Cell::NumberType;
+        cell->value = 0.0;
+        break;
+    }
+}
+
+FormulaValue FormulaEngine::cellValue(int row, int col)
+{
+    const CellTable &table = m_sheet->cellTable;
+    switch (table.slotType(row, col)) {
+    case CellTable::EmptySlot:
+        return FormulaValue();
+    case CellTable::NumberSlot:
+    case CellTable::CustomNumberSlot:
+        return FormulaValue::fromNumber(table.number(row, col));
+    case CellTable::SharedStringSlot:
+        return FormulaValue::fromString(m_sheet->sharedStrings()->getSharedString(table.sharedStringIndex(row, col)).toPlainString());
+    default:
+        break;
+    }
+
+    std::shared_ptr<Cell> cell = table.cell(row, col);
+    if (!cell)
+        return FormulaValue();
+    if (cell->hasFormula()) {
+        if (!m_built)
+            build();
+        auto it = m_formulas.find(formulaKey(row, col));
+        if (it != m_formulas.end()) {
+            if (it->state == Computing) {
+                // circular reference, Excel shows 0 as well
+                qWarning("QXlsx::FormulaEngine: circular reference at %s",
+                         qPrintable(CellReference(row, col).toString()));
+                return FormulaValue::fromNumber(0);
+            }
+            compute(it.key(), *it);
+        }
+    }
+    return cellContent(*cell);
+}
+
+// Calculates the dirty formulas inside \a range before it is read
+void FormulaEngine::prepareRange(const FormulaValue &range)
+{
+    if (!m_built)
+        build();
+
+    const quint64 last = formulaKey(range.lastRow, range.lastColumn);
+    auto it = m_formulas.lowerBound(formulaKey(range.firstRow, range.firstColumn));
+    while (it != m_formulas.end() && it.key() <= last) {
+        const int row = keyRow(it.key());
+        const int col = keyColumn(it.key());
+        if (row < range.firstRow) {
+            it = m_formulas.lowerBound(formulaKey(range.firstRow, col));
+        } else if (row > range.lastRow) {
+            it = m_formulas.lowerBound(formulaKey(range.firstRow, col + 1));
+        } else {
+            compute(it.key(), *it);
+            ++it;
+        }
+    }
+}
+
+/*
+   Feeds the numbers of \a range to \a sink: the dense columns of the cell
+   table a row block at a time, then the Cell objects. Text, booleans and
+   empty cells are skipped like Excel's aggregates do.
+ */
+template <typename Sink>
+bool FormulaEngine::visitNumbers(const FormulaValue &range, Sink &sink, FormulaValue *error)
+{
+    prepareRange(range);
+    const CellTable &table = m_sheet->cellTable;
+    if (table.isEmpty())
+        return true;
+
+    const int lastRow = qMin(range.lastRow, table.lastRow());
+    const int lastDense = qMin(range.lastColumn, int(CellTable::DenseColumnLimit));
+    for (int col = range.firstColumn; col <= lastDense; ++col) {
+        table.visitNumberRuns(col, range.firstRow, lastRow, [&sink](int, const quint8 *types, const double *values, int count) {
+            sink.addRun(types, values, count);
+        });
+    }
+
+    FormulaValue firstError;
+    table.visitCells(range.firstRow, lastRow, range.firstColumn, range.lastColumn,
+                     [&sink, &firstError](int, int, const std::shared_ptr<Cell> &cell) {
+        const FormulaValue value = cellContent(*cell);
+        if (value.type == FormulaValue::Number) {
+            sink.add(value.number);
+        } else if (value.type == FormulaValue::Error) {
+            sink.addError(value);
+            if (firstError.type == FormulaValue::Empty)
+                firstError = value;
+        }
+    });
+    if (error)
+        *error = firstError;
+    return firstError.type == FormulaValue::Empty;
+}
+
+// Calls \a visitor with the value of every non-empty cell of \a range
+template <typename Visitor>
+void FormulaEngine::visitValues(const FormulaValue &range, Visitor &visitor)
+{
+    prepareRange(range);
+    const CellTable &table = m_sheet->cellTable;
+    for (int row = table.nextRow(range.firstRow - 1); row != -1 && row <= range.lastRow; row = table.nextRow(row)) {
+        for (int col = table.nextColumn(row, range.firstColumn - 1); col != -1 && col <= range.lastColumn;
+             col = table.nextColumn(row, col))
+            visitor(cellValue(row, col));
+    }
+}
+
+FormulaValue FormulaEngine::run(const FormulaProgram &program, int row, int col)
+{
+    QVector<FormulaValue> stack;
+    stack.reserve(8);
+    for (const FormulaOp &op : program.ops) {
+        switch (op.code) {
+        case FormulaOp::PushNumber:
+            stack.append(FormulaValue::fromNumber(program.numbers.at(op.operand)));
+            break;
+        case FormulaOp::PushString:
+            stack.append(FormulaValue::fromString(program.strings.at(op.operand)));
+            break;
+        case FormulaOp::PushBoolean:
+            stack.append(FormulaValue::fromBoolean(op.operand != 0));
+            break;
+        case FormulaOp::PushError:
+            stack.append(FormulaValue::fromError(program.strings.at(op.operand)));
+            break;
+        case FormulaOp::PushRef:
+            stack.append(resolve(program.refs.at(op.operand), row, col));
+            break;
+        case FormulaOp::Negate:
+        case FormulaOp::Percent:
+        {
+            FormulaValue value = toNumber(scalar(stack.takeLast()));
+            if (value.type == FormulaValue::Number)
+                value.number = op.code == FormulaOp::Negate ? -value.number : value.number / 100;
+            stack.append(value);
+            break;
+        }
+        case FormulaOp::Call:
+        {
+            const int first = stack.size() - op.argc;
+            const FormulaValue result = call(op.operand, stack.constData() + first, op.argc);
+            stack.resize(first);
+            stack.append(result);
+            break;
+        }
+        default:
+        {
+            const FormulaValue b = scalar(stack.takeLast());
+            const FormulaValue a = scalar(stack.takeLast());
+            stack.append(binary(op.code, a, b));
+            break;
+        }
+        }
+    }
+    return stack.isEmpty() ? FormulaValue() : stack.last();
+}
+
+// Absolute range of \a ref for the formula at (row, col)
+FormulaValue FormulaEngine::resolve(const FormulaRef &ref, int row, int col)
+{
+    FormulaValue range;
+    range.type = FormulaValue::Range;
+    range.firstRow = ref.absolute & FormulaRef::AbsoluteFirstRow ? ref.firstRow : ref.firstRow + row;
+    range.firstColumn = ref.absolute & FormulaRef::AbsoluteFirstColumn ? ref.firstColumn : ref.firstColumn + col;
+    range.lastRow = ref.absolute & FormulaRef::AbsoluteLastRow ? ref.lastRow : ref.lastRow + row;
+    range.lastColumn = ref.absolute & FormulaRef::AbsoluteLastColumn ? ref.lastColumn : ref.lastColumn + col;
+    if (range.firstRow > range.lastRow)
+        std::swap(range.firstRow, range.lastRow);
+    if (range.firstColumn > range.lastColumn)
+        std::swap(range.firstColumn, range.lastColumn);
+    if (range.firstRow < 1 || range.firstColumn < 1 || range.lastRow > XLSX_ROW_MAX || range.lastColumn > XLSX_COLUMN_MAX)
+        return FormulaValue::fromError(ReferenceError);
+
+    range.engine = ref.sheetName.isEmpty() ? this : engineForSheet(ref.sheetName);
+    if (!range.engine)
+        return FormulaValue::fromError(ReferenceError);
+    return range;
+}
+
+// Value of a single cell range; larger ranges are not valid as a scalar
+FormulaValue FormulaEngine::scalar(const FormulaValue &value)
+{
+    if (value.type != FormulaValue::Range)
+        return value;
+    if (value.firstRow != value.lastRow || value.firstColumn != value.lastColumn)
+        return FormulaValue::fromError(ValueError);
+    return value.engine->cellValue(value.firstRow, value.firstColumn);
+}
+
+FormulaValue FormulaEngine::call(int function, const FormulaValue *args, int argc)
+{
+    switch (function) {
+    case FormulaOp::CountIf:
+        return countIf(args[0], scalar(args[1]));
+    case FormulaOp::Rank:
+        return rank(args, argc);
+    case FormulaOp::If:
+    {
+        const FormulaValue condition = toBoolean(scalar(args[0]));
+        if (condition.type == FormulaValue::Error)
+            return condition;
+        if (condition.number != 0)
+            return scalar(args[1]);
+        return argc > 2 ? scalar(args[2]) : FormulaValue::fromBoolean(false);
+    }
+    case FormulaOp::Round:
+    {
+        const FormulaValue number = toNumber(scalar(args[0]));
+        if (number.type == FormulaValue::Error)
+            return number;
+        const FormulaValue digits = toNumber(scalar(args[1]));
+        if (digits.type == FormulaValue::Error)
+            return digits;
+        const double factor = std::pow(10.0, std::trunc(digits.number));
+        // round the 15 significant digits Excel works with, so 2.675 gives 2.68
+        const double scaled = numberText(number.number * factor).toDouble();
+        return FormulaValue::fromNumber(std::round(scaled) / factor);
+    }
+    default:
+        return aggregate(function, args, argc);
+    }
+}
+
+// SUM, AVERAGE, MAX, MIN and COUNT
+FormulaValue FormulaEngine::aggregate(int function, const FormulaValue *args, int argc)
+{
+    const bool count = function == FormulaOp::Count;
+    NumberStats stats;
+    for (int i = 0; i < argc; ++i) {
+        const FormulaValue &arg = args[i];
+        if (arg.type == FormulaValue::Range) {
+            FormulaValue error;
+            if (!arg.engine->visitNumbers(arg, stats, &error) && !count)
+                return error;
+            continue;
+        }
+
+        // numbers, booleans and numeric text given directly are counted
+        if (arg.type == FormulaValue::Empty)
+            continue;
+        const FormulaValue number = toNumber(arg);
+        if (number.type == FormulaValue::Number)
+            stats.add(number.number);
+        else if (!count)
+            return number;
+    }
+
+    switch (function) {
+    case FormulaOp::Sum:
+        return FormulaValue::fromNumber(stats.sum);
+    case FormulaOp::Average:
+        if (!stats.count)
+            return FormulaValue::fromError(DivisionError);
+        return FormulaValue::fromNumber(stats.sum / stats.count);
+    case FormulaOp::Max:
+        return FormulaValue::fromNumber(stats.count ? stats.max : 0);
+    case FormulaOp::Min:
+        return FormulaValue::fromNumber(stats.count ? stats.min : 0);
+    default:
+        return FormulaValue::fromNumber(stats.count);
+    }
+}
+
+FormulaValue FormulaEngine::countIf(const FormulaValue &range, const FormulaValue &criteria)
+{
+    if (criteria.type == FormulaValue::Error)
+        return criteria;
+    if (range.type != FormulaValue::Range)
+        return FormulaValue::fromError(ValueError);
+
+    const Criterion criterion(criteria);
+    double matches = 0;
+    double filled = 0;
+    auto visitor = [&criterion, &matches, &filled](const FormulaValue &value) {
+        if (value.type == FormulaValue::Empty)
+            return;
+        ++filled;
+        if (criterion.matches(value))
+            ++matches;
+    };
+    range.engine->visitValues(range, visitor);
+
+    if (criterion.matchesBlank()) {
+        const double area = double(range.lastRow - range.firstRow + 1) * (range.lastColumn - range.firstColumn + 1);
+        matches += area - filled;
+    }
+    return FormulaValue::fromNumber(matches);
+}
+
+// RANK(number, ref[, order]): 1 + the numbers of ref ranking before number
+FormulaValue FormulaEngine::rank(const FormulaValue *args, int argc)
+{
+    const FormulaValue number = toNumber(scalar(args[0]));
+    if (number.type == FormulaValue::Error)
+        return number;
+    if (args[1].type != FormulaValue::Range)
+        return FormulaValue::fromError(ValueError);
+
+    bool ascending = false;
+    if (argc > 2) {
+        const FormulaValue order = toNumber(scalar(args[2]));
+        if (order.type == FormulaValue::Error)
+            return order;
+        ascending = order.number != 0;
+    }
+
+    RankCounter counter(number.number, ascending);
+    args[1].engine->visitNumbers(args[1], counter, nullptr);
+    if (!counter.found)
+        return FormulaValue::fromError(NotAvailableError);
+    return FormulaValue::fromNumber(counter.ahead + 1);
+}
+
+FormulaEngine *FormulaEngine::engineForSheet(const QString &sheetName) const
+{
+    Workbook *workbook = m_sheet->workbook;
+    for (int i = 0; i < workbook->sheetCount(); ++i) {
+        AbstractSheet *sheet = workbook->sheet(i);
+        if (sheet->sheetType() == AbstractSheet::ST_WorkSheet
+                && sheet->sheetName().compare(sheetName, Qt::CaseInsensitive) == 0)
+            return static_cast<Worksheet *>(sheet)->d_func()->formulaEngine();
+    }
+    return nullptr;
+}
+
+QT_END_NAMESPACE_XLSX
@@ -4,6 +4,10 @@
 
 #include <QtGlobal>
 #include <QString>
+#include <QStringList>
+#include <QDate>
+
+#include <cmath>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -71,4 +75,552 @@ bool NumFormatParser::isDateTime(const QString &formatCode)
     return false;
 }
 
+namespace {
+
+const char *const monthNames[] = {
+    "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December"
+};
+
+const char *const dayNames[] = {
+    "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"
+};
+
+bool startsWithAt(const QString &code, int pos, const char *text)
+{
+    const QLatin1String needle(text);
+    return code.mid(pos, needle.size()).compare(needle, Qt::CaseInsensitive) == 0;
+}
+
+bool isPlaceholder(QChar c)
+{
+    return c == QLatin1Char('0') || c == QLatin1Char('#') || c == QLatin1Char('?');
+}
+
+// Excel's General: up to 11 characters, scientific for very large or small values
+QString generalText(double value)
+{
+    if (value == 0)
+        return QStringLiteral("0");
+
+    const double magnitude = std::fabs(value);
+    if (magnitude >= 1e11 || magnitude < 1e-9) {
+        QString text = QString::number(value, 'E', 5);
+        const int e = text.indexOf(QLatin1Char('E'));
+        int end = e;
+        while (end > 0 && text.at(end - 1) == QLatin1Char('0'))
+            --end;
+        if (end > 0 && text.at(end - 1) == QLatin1Char('.'))
+            --end;
+        return QString(text.left(end) + text.mid(e));
+    }
+
+    const int integerDigits = magnitude >= 1 ? int(std::floor(std::log10(magnitude))) + 1 : 1;
+    QString text = QString::number(value, 'f', qMax(0, 10 - integerDigits));
+    if (text.contains(QLatin1Char('.'))) {
+        while (text.endsWith(QLatin1Char('0')))
+            text.chop(1);
+        if (text.endsWith(QLatin1Char('.')))
+            text.chop(1);
+    }
+    return text;
+}
+
+QString padded(qint64 value, int width)
+{
+    return QString::number(value).rightJustified(width, QLatin1Char('0'));
+}
+
+} // namespace
+
+NumFormatProgram::NumFormatProgram() :
+    m_textSection(-1), m_category(General), m_isDateTime(false)
+{
+}
+
+QSharedPointer<const NumFormatProgram> NumFormatProgram::compile(const QString &formatCode)
+{
+    QSharedPointer<NumFormatProgram> program(new NumFormatProgram);
+    program->m_formatCode = formatCode;
+    program->m_isDateTime = NumFormatParser::isDateTime(formatCode);
+
+    // sections are separated by ; outside quotes, escapes and brackets
+    QStringList codes;
+    int start = 0;
+    for (int i = 0; i < formatCode.size(); ++i) {
+        const QChar c = formatCode.at(i);
+        if (c == QLatin1Char('"')) {
+            while (++i < formatCode.size() && formatCode.at(i) != QLatin1Char('"'))
+                ;
+        } else if (c == QLatin1Char('\\') || c == QLatin1Char('_') || c == QLatin1Char('*')) {
+            ++i;
+        } else if (c == QLatin1Char('[')) {
+            while (i < formatCode.size() && formatCode.at(i) != QLatin1Char(']'))
+                ++i;
+        } else if (c == QLatin1Char(';')) {
+            codes.append(formatCode.mid(start, i - start));
+            start = i + 1;
+        }
+    }
+    codes.append(formatCode.mid(start));
+
+    for (int i = 0; i < codes.size() && i < 4; ++i) {
+        Section section;
+        if (!program->parseSection(codes.at(i), section)) {
+            // unterminated quote or bracket: fall back to General
+            program->parseSection(QStringLiteral("General"), section);
+        }
+        program->m_sections.append(section);
+    }
+
+    const int count = program->m_sections.size();
+    if (count == 4) {
+        program->m_textSection = 3;
+    } else {
+        for (int i = 0; i < count; ++i) {
+            const Section &section = program->m_sections.at(i);
+            if (section.hasText && !section.isDate && section.integerPlaceholders == 0 && !section.decimalPoint)
+                program->m_textSection = i;
+        }
+    }
+
+    const Section &first = program->m_sections.first();
+    if (program->m_textSection == 0) {
+        program->m_category = Text;
+    } else if (first.isDate) {
+        bool date = false;
+        bool time = false;
+        for (const Token &token : first.tokens) {
+            if (token.type >= Token::Year2 && token.type <= Token::DayLong)
+                date = true;
+            else if (token.type >= Token::Hour)
+                time = true;
+        }
+        program->m_category = date && time ? DateTime : time ? Time : Date;
+    } else if (first.scientific) {
+        program->m_category = Scientific;
+    } else if (first.fraction) {
+        program->m_category = Fraction;
+    } else if (first.percent) {
+        program->m_category = Percent;
+    } else if (first.integerPlaceholders || first.decimalPoint) {
+        program->m_category = Number;
+    } else {
+        program->m_category = General;
+    }
+    return program;
+}
+
+bool NumFormatProgram::parseSection(const QString &code, Section &section)
+{
+    section.condition = 0;
+    section.conditionValue = 0;
+    section.isDate = false;
+    section.hasText = false;
+    section.hasAmPm = false;
+    section.subSecondDigits = 0;
+    section.integerZeros = 0;
+    section.decimalsMin = 0;
+    section.decimalsMax = 0;
+    section.decimalPoint = false;
+    section.thousands = false;
+    section.scaleThousands = 0;
+    section.percent = 0;
+    section.scientific = false;
+    section.exponentPlus = false;
+    section.exponentDigits = 0;
+    section.integerPlaceholders = 0;
+    section.fraction = false;
+
+    QVector<Token> &tokens = section.tokens;
+    auto literal = [&tokens](const QString &text) {
+        if (!tokens.isEmpty() && tokens.last().type == Token::Literal) {
+            tokens.last().text += text;
+            return;
+        }
+        Token token;
+        token.type = Token::Literal;
+        token.text = text;
+        token.width = 0;
+        tokens.append(token);
+    };
+    auto append = [&tokens](Token::Type type, int width = 0) {
+        Token token;
+        token.type = type;
+        token.width = width;
+        tokens.append(token);
+    };
+
+    bool body = false;
+    for (int i = 0; i < code.size(); ++i) {
+        const QChar c = code.at(i);
+        const QChar lower = c.toLower();
+        const QChar next = i + 1 < code.size() ? code.at(i + 1) : QChar();
+
+        if (c == QLatin1Char('"')) {
+            const int end = code.indexOf(QLatin1Char('"'), i + 1);
+            if (end < 0)
+                return false;
+            literal(code.mid(i + 1, end - i - 1));
+            i = end;
+        } else if (c == QLatin1Char('\\')) {
+            if (!next.isNull())
+                literal(QString(next));
+            ++i;
+        } else if (c == QLatin1Char('_')) {
+            literal(QStringLiteral(" "));
+            ++i;
+        } else if (c == QLatin1Char('*')) {
+            ++i;
+        } else if (c == QLatin1Char('[')) {
+            const int end = code.indexOf(QLatin1Char(']'), i + 1);
+            if (end < 0)
+                return false;
+            const QString content = code.mid(i + 1, end - i - 1);
+            i = end;
+            const QString letters = content.toLower();
+            if (!letters.isEmpty() && (letters.count(QLatin1Char('h')) == letters.size()
+                                       || letters.count(QLatin1Char('m')) == letters.size()
+                                       || letters.count(QLatin1Char('s')) == letters.size())) {
+                const Token::Type type = letters.at(0) == QLatin1Char('h') ? Token::ElapsedHours
+                        : letters.at(0) == QLatin1Char('m') ? Token::ElapsedMinutes : Token::ElapsedSeconds;
+                append(type, letters.size());
+                section.isDate = true;
+            } else if (content.startsWith(QLatin1Char('$'))) {
+                // [$symbol-locale]
+                literal(content.mid(1).section(QLatin1Char('-'), 0, 0));
+            } else if (!content.isEmpty() && QStringLiteral("<>=").contains(content.at(0))) {
+                static const char *const operators[] = { "<>", "<=", ">=", "=", "<", ">" };
+                static const int codes[] = { 2, 4, 6, 1, 3, 5 };
+                for (int k = 0; k < 6; ++k) {
+                    const QLatin1String op(operators[k]);
+                    if (content.startsWith(op)) {
+                        bool ok;
+                        section.conditionValue = content.mid(op.size()).trimmed().toDouble(&ok);
+                        if (!ok)
+                            return false;
+                        section.condition = codes[k];
+                        break;
+                    }
+                }
+            }
+            // colors are not rendered
+        } else if (c == QLatin1Char('@')) {
+            append(Token::TextValue);
+            section.hasText = true;
+        } else if (lower == QLatin1Char('g') && startsWithAt(code, i, "general")) {
+            append(Token::GeneralNumber);
+            i += 6;
+        } else if (isPlaceholder(c)) {
+            if (!body) {
+                append(Token::NumberBody);
+                body = true;
+            }
+            if (section.scientific) {
+                ++section.exponentDigits;
+            } else if (section.fraction) {
+                // denominator, rendered as a decimal
+            } else if (section.decimalPoint) {
+                ++section.decimalsMax;
+                if (c == QLatin1Char('0'))
+                    section.decimalsMin = section.decimalsMax;
+            } else {
+                ++section.integerPlaceholders;
+                if (c == QLatin1Char('0'))
+                    ++section.integerZeros;
+                // trailing commas only scale when no placeholder follows
+                section.scaleThousands = 0;
+            }
+        } else if (c == QLatin1Char('.') && section.isDate && !tokens.isEmpty()
+                   && (tokens.last().type == Token::Second || tokens.last().type == Token::Second2)
+                   && next == QLatin1Char('0')) {
+            int digits = 0;
+            while (i + 1 < code.size() && code.at(i + 1) == QLatin1Char('0') && digits < 3) {
+                ++digits;
+                ++i;
+            }
+            section.subSecondDigits = digits;
+            append(Token::SubSecond, digits);
+        } else if (c == QLatin1Char('.') && !section.isDate && !section.decimalPoint
+                   && (body || isPlaceholder(next))) {
+            if (!body) {
+                append(Token::NumberBody);
+                body = true;
+            }
+            section.decimalPoint = true;
+        } else if (c == QLatin1Char(',') && body && !section.scientific) {
+            if (isPlaceholder(next) && !section.decimalPoint)
+                section.thousands = true;
+            else
+                ++section.scaleThousands;
+        } else if (c == QLatin1Char('%')) {
+            ++section.percent;
+            literal(QStringLiteral("%"));
+        } else if (lower == QLatin1Char('e') && body && (next == QLatin1Char('+') || next == QLatin1Char('-'))) {
+            section.scientific = true;
+            section.exponentPlus = next == QLatin1Char('+');
+            ++i;
+        } else if (c == QLatin1Char('/') && body && !section.isDate
+                   && (isPlaceholder(next) || next.isDigit())) {
+            section.fraction = true;
+            while (i + 1 < code.size() && (isPlaceholder(code.at(i + 1)) || code.at(i + 1).isDigit()))
+                ++i;
+        } else if (startsWithAt(code, i, "am/pm")) {
+            append(Token::AmPm);
+            section.hasAmPm = true;
+            section.isDate = true;
+            i += 4;
+        } else if (startsWithAt(code, i, "a/p")) {
+            append(Token::AP);
+            section.hasAmPm = true;
+            section.isDate = true;
+            i += 2;
+        } else if (lower == QLatin1Char('y') || lower == QLatin1Char('m') || lower == QLatin1Char('d')
+                   || lower == QLatin1Char('h') || lower == QLatin1Char('s')) {
+            int run = 1;
+            while (i + run < code.size() && code.at(i + run).toLower() == lower)
+                ++run;
+            i += run - 1;
+            section.isDate = true;
+
+            switch (lower.unicode()) {
+            case 'y':
+                append(run <= 2 ? Token::Year2 : Token::Year4);
+                break;
+            case 'm':
+                append(run == 1 ? Token::Month : run == 2 ? Token::Month2 : run == 3 ? Token::MonthShort
+                     : run == 5 ? Token::MonthLetter : Token::MonthLong);
+                break;
+            case 'd':
+                append(run == 1 ? Token::Day : run == 2 ? Token::Day2 : run == 3 ? Token::DayShort : Token::DayLong);
+                break;
+            case 'h':
+                append(run == 1 ? Token::Hour : Token::Hour2);
+                break;
+            default:
+                append(run == 1 ? Token::Second : Token::Second2);
+                break;
+            }
+        } else {
+            literal(QString(c));
+        }
+    }
+
+    // m and mm are minutes right after hours or right before seconds
+    int previous = -1;
+    for (int i = 0; i < tokens.size(); ++i) {
+        Token &token = tokens[i];
+        if (token.type == Token::Literal)
+            continue;
+        if (token.type == Token::Month || token.type == Token::Month2) {
+            bool minutes = previous >= 0 && (tokens.at(previous).type == Token::Hour || tokens.at(previous).type == Token::Hour2
+                                             || tokens.at(previous).type == Token::ElapsedHours);
+            for (int j = i + 1; !minutes && j < tokens.size(); ++j) {
+                if (tokens.at(j).type == Token::Literal)
+                    continue;
+                minutes = tokens.at(j).type == Token::Second || tokens.at(j).type == Token::Second2
+                        || tokens.at(j).type == Token::ElapsedSeconds;
+                break;
+            }
+            if (minutes)
+                token.type = token.type == Token::Month ? Token::Minute : Token::Minute2;
+        }
+        previous = i;
+    }
+    return true;
+}
+
+// Section used for \a value; \a negate is set when the minus sign is not
+// part of the section
+const NumFormatProgram::Section *NumFormatProgram::sectionFor(double value, bool *negate) const
+{
+    int count = m_sections.size();
+    if (m_textSection == count - 1)
+        --count;
+    *negate = value < 0;
+    if (count <= 0)
+        return nullptr;
+
+    auto matches = [value](const Section &section) {
+        switch (section.condition) {
+        case 1: return value == section.conditionValue;
+        case 2: return value != section.conditionValue;
+        case 3: return value < section.conditionValue;
+        case 4: return value <= section.conditionValue;
+        case 5: return value > section.conditionValue;
+        default: return value >= section.conditionValue;
+        }
+    };
+
+    if (m_sections.at(0).condition) {
+        if (matches(m_sections.at(0)))
+            return &m_sections.at(0);
+        if (count > 1 && (!m_sections.at(1).condition || matches(m_sections.at(1))))
+            return &m_sections.at(1);
+        return &m_sections.at(count > 2 ? 2 : 0);
+    }
+
+    if (count == 1 || value > 0)
+        return &m_sections.at(0);
+    if (value < 0) {
+        *negate = false;
+        return &m_sections.at(1);
+    }
+    return &m_sections.at(count > 2 ? 2 : 0);
+}
+
+QString NumFormatProgram::render(double value, bool date1904) const
+{
+    bool negate;
+    const Section *section = sectionFor(value, &negate);
+    if (!section)
+        return generalText(value);
+    if (section->tokens.isEmpty())
+        return QString(); // an empty section hides the value
+    // Excel shows negative dates as ####; the number is more useful
+    if (section->isDate)
+        return value < 0 ? generalText(value) : renderDate(*section, value, date1904);
+
+    const QString text = renderNumber(*section, std::fabs(value));
+    return negate ? QString(QLatin1Char('-')) + text : text;
+}
+
+QString NumFormatProgram::render(const QString &text) const
+{
+    if (m_textSection < 0)
+        return text;
+
+    QString result;
+    for (const Token &token : m_sections.at(m_textSection).tokens) {
+        if (token.type == Token::Literal)
+            result += token.text;
+        else if (token.type == Token::TextValue)
+            result += text;
+    }
+    return result;
+}
+
+QString NumFormatProgram::renderNumber(const Section &section, double value) const
+{
+    QString body;
+    const double scaled = value * std::pow(100.0, section.percent) / std::pow(1000.0, section.scaleThousands);
+
+    auto fixed = [&section](double number) {
+        QString text = QString::number(number, 'f', section.decimalsMax);
+        QString integer = text.section(QLatin1Char('.'), 0, 0);
+        QString decimals = text.section(QLatin1Char('.'), 1);
+        while (decimals.size() > section.decimalsMin && decimals.endsWith(QLatin1Char('0')))
+            decimals.chop(1);
+        if (integer == QLatin1String("0") && section.integerZeros == 0)
+            integer.clear();
+        integer = integer.rightJustified(section.integerZeros, QLatin1Char('0'));
+        if (section.thousands) {
+            for (int pos = integer.size() - 3; pos > 0; pos -= 3)
+                integer.insert(pos, QLatin1Char(','));
+        }
+        return section.decimalPoint ? QString(integer + QLatin1Char('.') + decimals) : integer;
+    };
+
+    if (section.scientific) {
+        const int step = qMax(1, section.integerPlaceholders);
+        int exponent = 0;
+        double mantissa = scaled;
+        if (scaled != 0) {
+            exponent = int(std::floor(std::log10(scaled)));
+            exponent -= ((exponent % step) + step) % step;
+            mantissa = scaled / std::pow(10.0, exponent);
+            const double factor = std::pow(10.0, section.decimalsMax);
+            mantissa = std::round(mantissa * factor) / factor;
+            if (mantissa >= std::pow(10.0, step)) {
+                mantissa /= std::pow(10.0, step);
+                exponent += step;
+            }
+        }
+        const QString sign = exponent < 0 ? QStringLiteral("-") : section.exponentPlus ? QStringLiteral("+") : QString();
+        body = fixed(mantissa) + QLatin1Char('E') + sign + padded(std::abs(exponent), section.exponentDigits);
+    } else if (section.fraction) {
+        // fractions are shown as decimals
+        body = generalText(scaled);
+    } else {
+        body = fixed(scaled);
+    }
+
+    QString result;
+    for (const Token &token : section.tokens) {
+        if (token.type == Token::Literal)
+            result += token.text;
+        else if (token.type == Token::NumberBody)
+            result += body;
+        else if (token.type == Token::GeneralNumber)
+            result += generalText(value);
+    }
+    return result;
+}
+
+QString NumFormatProgram::renderDate(const Section &section, double value, bool date1904) const
+{
+    qint64 units = 1;
+    for (int i = 0; i < section.subSecondDigits; ++i)
+        units *= 10;
+    const qint64 total = qint64(std::floor(value * 86400.0 * units + 0.5));
+    const qint64 days = total / (86400 * units);
+    const qint64 seconds = (total % (86400 * units)) / units;
+    const qint64 fraction = total % units;
+    const int hour = int(seconds / 3600);
+    const int minute = int(seconds / 60 % 60);
+    const int second = int(seconds % 60);
+
+    // Excel counts the nonexistent 1900-02-29 (day 60) and shows day 0 as 1900-01-00
+    int year, month, day, weekday;
+    if (!date1904 && days == 60) {
+        year = 1900; month = 2; day = 29; weekday = 3;
+    } else if (!date1904 && days == 0) {
+        year = 1900; month = 1; day = 0; weekday = 6;
+    } else {
+        const QDate date = date1904 ? QDate(1904, 1, 1).addDays(days)
+                         : days < 60 ? QDate(1899, 12, 31).addDays(days) : QDate(1899, 12, 30).addDays(days);
+        year = date.year();
+        month = date.month();
+        day = date.day();
+        weekday = date.dayOfWeek();
+    }
+
+    QString result;
+    for (const Token &token : section.tokens) {
+        switch (token.type) {
+        case Token::Literal: result += token.text; break;
+        case Token::Year2: result += padded(year % 100, 2); break;
+        case Token::Year4: result += padded(year, 4); break;
+        case Token::Month: result += QString::number(month); break;
+        case Token::Month2: result += padded(month, 2); break;
+        case Token::MonthShort: result += QLatin1String(monthNames[month - 1]).left(3); break;
+        case Token::MonthLong: result += QLatin1String(monthNames[month - 1]); break;
+        case Token::MonthLetter: result += QLatin1Char(monthNames[month - 1][0]); break;
+        case Token::Day: result += QString::number(day); break;
+        case Token::Day2: result += padded(day, 2); break;
+        case Token::DayShort: result += QLatin1String(dayNames[weekday - 1]).left(3); break;
+        case Token::DayLong: result += QLatin1String(dayNames[weekday - 1]); break;
+        case Token::Hour:
+        case Token::Hour2:
+        {
+            const int shown = section.hasAmPm ? (hour % 12 == 0 ? 12 : hour % 12) : hour;
+            result += token.type == Token::Hour ? QString::number(shown) : padded(shown, 2);
+            break;
+        }
+        case Token::Minute: result += QString::number(minute); break;
+        case Token::Minute2: result += padded(minute, 2); break;
+        case Token::Second: result += QString::number(second); break;
+        case Token::Second2: result += padded(second, 2); break;
+        case Token::ElapsedHours: result += padded(total / (3600 * units), token.width); break;
+        case Token::ElapsedMinutes: result += padded(total / (60 * units), token.width); break;
+        case Token::ElapsedSeconds: result += padded(total / units, token.width); break;
+        case Token::SubSecond: result += QLatin1Char('.'); result += padded(fraction, token.width); break;
+        case Token::AmPm: result += hour < 12 ? QLatin1String("AM") : QLatin1String("PM"); break;
+        case Token::AP: result += hour < 12 ? QLatin1Char('A') : QLatin1Char('P'); break;
+        default: break;
+        }
+    }
+    return result;
+}
+
 QT_END_NAMESPACE_XLSX
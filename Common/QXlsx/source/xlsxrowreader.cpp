@@ -0,0 +1,412 @@
+// xlsxrowreader.cpp
+
+#include <QtGlobal>
+#include <QDir>
+#include <QDateTime>
+#include <QXmlStreamReader>
+#include <QHash>
+
+#include <algorithm>
+
+#include "xlsxrowreader.h"
+#include "xlsxrowreader_p.h"
+#include "xlsxrelationships_p.h"
+#include "xlsxnumformatparser_p.h"
+#include "xlsxutility_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+// "AB12" -> 28; digits are ignored, the row comes from <row r="">
+int columnFromReference(const QStringRef &ref)
+{
+    int col = 0;
+    for (const QChar &ch : ref) {
+        const ushort c = ch.unicode();
+        if (c >= 'A' && c <= 'Z')
+            col = col * 26 + (c - 'A' + 1);
+        else if (c >= 'a' && c <= 'z')
+            col = col * 26 + (c - 'a' + 1);
+        else
+            break;
+    }
+    return col;
+}
+
+QString resolvePath(const QString &baseDir, const QString &target)
+{
+    if (target.startsWith(QLatin1Char('/')))
+        return target.mid(1);
+    if (baseDir == QLatin1String("."))
+        return QDir::cleanPath(target);
+    return QDir::cleanPath(baseDir + QLatin1Char('/') + target);
+}
+
+Cell::CellType cellTypeFromString(const QStringRef &t)
+{
+    if (t == QLatin1String("s"))
+        return Cell::SharedStringType;
+    if (t == QLatin1String("inlineStr"))
+        return Cell::InlineStringType;
+    if (t == QLatin1String("str"))
+        return Cell::StringType;
+    if (t == QLatin1String("b"))
+        return Cell::BooleanType;
+    if (t == QLatin1String("e"))
+        return Cell::ErrorType;
+    if (t == QLatin1String("d"))
+        return Cell::DateType;
+    if (t == QLatin1String("n"))
+        return Cell::NumberType;
+    return Cell::CustomType;
+}
+
+} // namespace
+
+RowReaderPrivate::RowReaderPrivate() :
+    date1904(false), finished(true), row(0),
+    sharedStringsLoaded(false), stylesLoaded(false)
+{
+}
+
+void RowReaderPrivate::openPackage()
+{
+    if (!zip->exists()) {
+        errorString = QStringLiteral("Cannot open package");
+        return;
+    }
+
+    const QStringList filePaths = zip->filePaths();
+    if (!filePaths.contains(QLatin1String("_rels/.rels"))) {
+        errorString = QStringLiteral("Package has no _rels/.rels");
+        return;
+    }
+
+    Relationships rootRels;
+    rootRels.loadFromXmlData(zip->fileData(QStringLiteral("_rels/.rels")));
+    QList<XlsxRelationship> rels_xl = rootRels.documentRelationships(QStringLiteral("/officeDocument"));
+    if (rels_xl.isEmpty()) {
+        errorString = QStringLiteral("Package has no workbook");
+        return;
+    }
+
+    const QString workbookPath = resolvePath(QStringLiteral("."), rels_xl[0].target);
+    const QString workbookDir = splitPath(workbookPath).first();
+
+    Relationships workbookRels;
+    workbookRels.loadFromXmlData(zip->fileData(getRelFilePath(workbookPath)));
+
+    QList<XlsxRelationship> rels = workbookRels.documentRelationships(QStringLiteral("/sharedStrings"));
+    if (!rels.isEmpty())
+        sharedStringsPath = resolvePath(workbookDir, rels[0].target);
+    rels = workbookRels.documentRelationships(QStringLiteral("/styles"));
+    if (!rels.isEmpty())
+        stylesPath = resolvePath(workbookDir, rels[0].target);
+
+    QXmlStreamReader reader(zip->fileData(workbookPath));
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        if (reader.name() == QLatin1String("sheet")) {
+            QXmlStreamAttributes attributes = reader.attributes();
+            XlsxRelationship relationship = workbookRels.getRelationshipById(attributes.value(QLatin1String("r:id")).toString());
+            if (!relationship.type.endsWith(QLatin1String("/worksheet")))
+                continue;
+            sheetNames.append(attributes.value(QLatin1String("name")).toString());
+            sheetPaths.append(resolvePath(workbookDir, relationship.target));
+        } else if (reader.name() == QLatin1String("workbookPr")) {
+            date1904 = reader.attributes().hasAttribute(QLatin1String("date1904"));
+        }
+    }
+
+    if (sheetNames.isEmpty())
+        errorString = QStringLiteral("Workbook has no worksheet");
+}
+
+bool RowReaderPrivate::openSheet(int index)
+{
+    if (index < 0 || index >= sheetPaths.size())
+        return false;
+
+    reader.clear();
+    sheetStream.reset(zip->openFile(sheetPaths[index]));
+    if (!sheetStream) {
+        errorString = QStringLiteral("Cannot read %1").arg(sheetPaths[index]);
+        finished = true;
+        return false;
+    }
+    reader.setDevice(sheetStream.data());
+
+    finished = false;
+    row = 0;
+    cells.clear();
+    return true;
+}
+
+void RowReaderPrivate::loadSharedStrings() const
+{
+    sharedStringsLoaded = true;
+    if (sharedStringsPath.isEmpty())
+        return;
+
+    // Plain text only: runs are concatenated, phonetic hints are dropped
+    QXmlStreamReader reader(zip->fileData(sharedStringsPath));
+    QString current;
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            if (reader.name() == QLatin1String("si"))
+                current.clear();
+            else if (reader.name() == QLatin1String("rPh"))
+                reader.skipCurrentElement();
+            else if (reader.name() == QLatin1String("t"))
+                current += reader.readElementText();
+        } else if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("si")) {
+            sharedStrings.append(current);
+        }
+    }
+}
+
+void RowReaderPrivate::loadStyles() const
+{
+    stylesLoaded = true;
+    if (stylesPath.isEmpty())
+        return;
+
+    // Only what Format::isDateTimeFormat() looks at: the numFmt of each cellXfs entry
+    QHash<int, bool> customDateFormats;
+    QXmlStreamReader reader(zip->fileData(stylesPath));
+    bool inCellXfs = false;
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            if (reader.name() == QLatin1String("numFmt")) {
+                QXmlStreamAttributes attributes = reader.attributes();
+                int id = attributes.value(QLatin1String("numFmtId")).toInt();
+                customDateFormats[id] = NumFormatParser::isDateTime(attributes.value(QLatin1String("formatCode")).toString());
+            } else if (reader.name() == QLatin1String("cellXfs")) {
+                inCellXfs = true;
+            } else if (inCellXfs && reader.name() == QLatin1String("xf")) {
+                int id = reader.attributes().value(QLatin1String("numFmtId")).toInt();
+                bool isDate;
+                if (customDateFormats.contains(id))
+                    isDate = customDateFormats.value(id);
+                else
+                    isDate = (id >= 14 && id <= 22) || (id >= 45 && id <= 47)
+                            || (id >= 27 && id <= 36) || (id >= 50 && id <= 58);
+                dateStyles.append(isDate);
+            }
+        } else if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("cellXfs")) {
+            inCellXfs = false;
+        }
+    }
+}
+
+QString RowReaderPrivate::sharedString(int index) const
+{
+    if (!sharedStringsLoaded)
+        loadSharedStrings();
+    return sharedStrings.value(index);
+}
+
+bool RowReaderPrivate::isDateStyle(int styleIndex) const
+{
+    if (styleIndex < 0)
+        return false;
+    if (!stylesLoaded)
+        loadStyles();
+    return dateStyles.value(styleIndex, false);
+}
+
+/*!
+ * \class CellView
+ * A non-empty cell of the row a RowReader is positioned on.
+ */
+
+QVariant CellView::value() const
+{
+    switch (m_type) {
+    case Cell::SharedStringType:
+        return m_reader->sharedString(m_raw.toInt());
+    case Cell::InlineStringType:
+    case Cell::StringType:
+    case Cell::ErrorType:
+        return m_raw;
+    case Cell::BooleanType:
+        return m_raw.toInt() ? true : false;
+    case Cell::DateType:
+        return QDateTime::fromString(m_raw, Qt::ISODate);
+    default:
+        break;
+    }
+
+    if (m_raw.isEmpty())
+        return QVariant();
+
+    const double number = m_raw.toDouble();
+    if (m_reader->isDateStyle(m_styleIndex))
+        return datetimeFromNumber(number, m_reader->date1904);
+    return number;
+}
+
+/*!
+ * \class RowReader
+ * Forward-only reader that walks the rows of one worksheet without loading the
+ * whole document.
+ */
+
+RowReader::RowReader(const QString &xlsxName) :
+    d_ptr(new RowReaderPrivate)
+{
+    Q_D(RowReader);
+    d->zip.reset(new ZipReader(xlsxName));
+    d->openPackage();
+    if (d->errorString.isEmpty())
+        d->openSheet(0);
+}
+
+RowReader::RowReader(QIODevice *device) :
+    d_ptr(new RowReaderPrivate)
+{
+    Q_D(RowReader);
+    d->zip.reset(new ZipReader(device));
+    d->openPackage();
+    if (d->errorString.isEmpty())
+        d->openSheet(0);
+}
+
+RowReader::~RowReader()
+{
+    delete d_ptr;
+}
+
+bool RowReader::isValid() const
+{
+    Q_D(const RowReader);
+    return d->errorString.isEmpty();
+}
+
+QString RowReader::errorString() const
+{
+    Q_D(const RowReader);
+    return d->errorString;
+}
+
+QStringList RowReader::sheetNames() const
+{
+    Q_D(const RowReader);
+    return d->sheetNames;
+}
+
+bool RowReader::selectSheet(const QString &name)
+{
+    Q_D(RowReader);
+    return d->openSheet(d->sheetNames.indexOf(name));
+}
+
+bool RowReader::selectSheet(int index)
+{
+    Q_D(RowReader);
+    return d->openSheet(index);
+}
+
+bool RowReader::readNextRow()
+{
+    Q_D(RowReader);
+
+    d->cells.clear();
+    if (d->finished)
+        return false;
+
+    QXmlStreamReader &reader = d->reader;
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("sheetData"))
+            break;
+        if (token != QXmlStreamReader::StartElement || reader.name() != QLatin1String("row"))
+            continue;
+
+        // "r" is optional, rows without it follow the previous one
+        const QStringRef r = reader.attributes().value(QLatin1String("r"));
+        d->row = r.isEmpty() ? d->row + 1 : r.toInt();
+
+        int lastColumn = 0;
+        while (!reader.atEnd()) {
+            token = reader.readNext();
+            if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("row"))
+                break;
+            if (token != QXmlStreamReader::StartElement || reader.name() != QLatin1String("c"))
+                continue;
+
+            CellView cell;
+            cell.m_reader = d;
+
+            QXmlStreamAttributes attributes = reader.attributes();
+            const QStringRef ref = attributes.value(QLatin1String("r"));
+            cell.m_column = ref.isEmpty() ? lastColumn + 1 : columnFromReference(ref);
+            lastColumn = cell.m_column;
+            const QStringRef s = attributes.value(QLatin1String("s"));
+            if (!s.isEmpty())
+                cell.m_styleIndex = s.toInt();
+            const QStringRef t = attributes.value(QLatin1String("t"));
+            if (!t.isEmpty())
+                cell.m_type = cellTypeFromString(t);
+
+            while (!reader.atEnd()) {
+                token = reader.readNext();
+                if (token == QXmlStreamReader::EndElement && reader.name() == QLatin1String("c"))
+                    break;
+                if (token != QXmlStreamReader::StartElement)
+                    continue;
+
+                if (reader.name() == QLatin1String("v")) {
+                    cell.m_raw = reader.readElementText();
+                } else if (reader.name() == QLatin1String("f")) {
+                    cell.m_formula = reader.readElementText();
+                } else if (reader.name() == QLatin1String("t")) {
+                    // <is><t> or <is><r><t>
+                    cell.m_raw += reader.readElementText();
+                } else if (reader.name() == QLatin1String("rPh") || reader.name() == QLatin1String("extLst")) {
+                    reader.skipCurrentElement();
+                }
+            }
+
+            if (!cell.m_raw.isEmpty() || cell.hasFormula())
+                d->cells.append(cell);
+        }
+        return true;
+    }
+
+    d->finished = true;
+    if (reader.hasError())
+        d->errorString = reader.errorString();
+    return false;
+}
+
+int RowReader::row() const
+{
+    Q_D(const RowReader);
+    return d->row;
+}
+
+const QVector<CellView> &RowReader::cells() const
+{
+    Q_D(const RowReader);
+    return d->cells;
+}
+
+QVariant RowReader::read(int column) const
+{
+    Q_D(const RowReader);
+
+    // cells are stored in ascending column order
+    auto it = std::lower_bound(d->cells.constBegin(), d->cells.constEnd(), column,
+                               [](const CellView &cell, int col) { return cell.column() < col; });
+    if (it == d->cells.constEnd() || it->column() != column)
+        return QVariant();
+    return it->value();
+}
+
+QT_END_NAMESPACE_XLSX
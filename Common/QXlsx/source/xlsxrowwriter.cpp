@@ -0,0 +1,420 @@
+// xlsxrowwriter.cpp
+
+#include <QtGlobal>
+#include <QDir>
+#include <QFile>
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+#include <QXmlStreamWriter>
+
+#include "xlsxrowwriter.h"
+#include "xlsxrowwriter_p.h"
+#include "xlsxcellreference.h"
+#include "xlsxcontenttypes_p.h"
+#include "xlsxdocpropsapp_p.h"
+#include "xlsxdocpropscore_p.h"
+#include "xlsxrelationships_p.h"
+#include "xlsxtheme_p.h"
+#include "xlsxutility_p.h"
+#include "xlsxzipwriter_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+RowWriterPrivate::RowWriterPrivate() :
+    closed(false), compressionLevel(-1), compressionThreads(1), styles(Styles::F_NewFromScratch),
+    sheetDataStarted(false), row(1), lastXfIndex(-1)
+{
+}
+
+void RowWriterPrivate::startSheetData()
+{
+    RowWriterSheet &sheet = sheets.last();
+
+    writer->writeStartDocument(QStringLiteral("1.0"), true);
+    writer->writeStartElement(QStringLiteral("worksheet"));
+    writer->writeAttribute(QStringLiteral("xmlns"), QStringLiteral("http://schemas.openxmlformats.org/spreadsheetml/2006/main"));
+    writer->writeAttribute(QStringLiteral("xmlns:r"), QStringLiteral("http://schemas.openxmlformats.org/officeDocument/2006/relationships"));
+
+    if (!sheet.columnWidths.isEmpty()) {
+        writer->writeStartElement(QStringLiteral("cols"));
+        for (const auto &width : sheet.columnWidths) {
+            writer->writeEmptyElement(QStringLiteral("col"));
+            writer->writeAttribute(QStringLiteral("min"), QString::number(width.first.first));
+            writer->writeAttribute(QStringLiteral("max"), QString::number(width.first.second));
+            writer->writeAttribute(QStringLiteral("width"), QString::number(width.second, 'g', 15));
+            writer->writeAttribute(QStringLiteral("customWidth"), QStringLiteral("1"));
+        }
+        writer->writeEndElement(); // cols
+    }
+
+    writer->writeStartElement(QStringLiteral("sheetData"));
+    sheetDataStarted = true;
+}
+
+void RowWriterPrivate::finishSheet()
+{
+    if (!writer)
+        return;
+
+    if (!sheetDataStarted)
+        startSheetData();
+    writer->writeEndElement(); // sheetData
+    writer->writeEndElement(); // worksheet
+    writer->writeEndDocument();
+
+    if (writer->hasError() && errorString.isEmpty())
+        errorString = QStringLiteral("Cannot write worksheet %1").arg(sheets.last().name);
+
+    sheets.last().file->close();
+    writer.reset();
+    sheetDataStarted = false;
+    row = 1;
+}
+
+/*
+  xf index of the format, -1 for none. Date and time cells get the format's
+  own number format, or numberFormat when the format has no date format.
+ */
+int RowWriterPrivate::styleIndex(const Format &format, const QString &numberFormat)
+{
+    Format fmt = format;
+    if (!numberFormat.isEmpty() && !(fmt.isValid() && fmt.isDateTimeFormat()))
+        fmt.setNumberFormat(numberFormat);
+    styles.addXfFormat(fmt);
+    return fmt.isEmpty() ? -1 : fmt.xfIndex();
+}
+
+int RowWriterPrivate::cachedStyleIndex(const Format &format)
+{
+    if (format != lastFormat) {
+        lastFormat = format;
+        lastXfIndex = styleIndex(format, QString());
+    }
+    return lastXfIndex;
+}
+
+bool RowWriterPrivate::finishRow()
+{
+    writer->writeEndElement(); // row
+    ++row;
+
+    if (writer->hasError()) {
+        errorString = QStringLiteral("Cannot write worksheet %1").arg(sheets.last().name);
+        return false;
+    }
+    return true;
+}
+
+void RowWriterPrivate::writeCell(int col, const QVariant &value, const Format &format, int xfIndex)
+{
+    writer->writeStartElement(QStringLiteral("c"));
+    writer->writeAttribute(QStringLiteral("r"), CellReference(row, col).toString());
+
+    const int type = value.userType();
+    if (type == QMetaType::Int || type == QMetaType::UInt
+            || type == QMetaType::LongLong || type == QMetaType::ULongLong
+            || type == QMetaType::Double || type == QMetaType::Float) {
+        if (xfIndex >= 0)
+            writer->writeAttribute(QStringLiteral("s"), QString::number(xfIndex));
+        writer->writeTextElement(QStringLiteral("v"), QString::number(value.toDouble(), 'g', 15));
+    } else if (type == QMetaType::Bool) {
+        if (xfIndex >= 0)
+            writer->writeAttribute(QStringLiteral("s"), QString::number(xfIndex));
+        writer->writeAttribute(QStringLiteral("t"), QStringLiteral("b"));
+        writer->writeTextElement(QStringLiteral("v"), value.toBool() ? QStringLiteral("1") : QStringLiteral("0"));
+    } else if (type == QMetaType::QDateTime || type == QMetaType::QDate || type == QMetaType::QTime) {
+        double number;
+        QString numberFormat;
+        if (type == QMetaType::QTime) {
+            number = timeToNumber(value.toTime());
+            numberFormat = QStringLiteral("hh:mm:ss");
+        } else if (type == QMetaType::QDate) {
+            number = datetimeToNumber(QDateTime(value.toDate(), QTime(0, 0, 0)));
+            numberFormat = QStringLiteral("yyyy-mm-dd");
+        } else {
+            number = datetimeToNumber(value.toDateTime());
+            numberFormat = QStringLiteral("yyyy-mm-dd hh:mm:ss");
+        }
+        const int dateXfIndex = styleIndex(format, numberFormat);
+        if (dateXfIndex >= 0)
+            writer->writeAttribute(QStringLiteral("s"), QString::number(dateXfIndex));
+        writer->writeTextElement(QStringLiteral("v"), QString::number(number, 'g', 15));
+    } else {
+        QString text = value.toString();
+        if (text.size() > 32767) // XLSX_STRING_MAX
+            text.truncate(32767);
+        if (xfIndex >= 0)
+            writer->writeAttribute(QStringLiteral("s"), QString::number(xfIndex));
+        writer->writeAttribute(QStringLiteral("t"), QStringLiteral("inlineStr"));
+        writer->writeStartElement(QStringLiteral("is"));
+        writer->writeStartElement(QStringLiteral("t"));
+        if (isSpaceReserveNeeded(text))
+            writer->writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
+        writer->writeCharacters(text);
+        writer->writeEndElement(); // t
+        writer->writeEndElement(); // is
+    }
+
+    writer->writeEndElement(); // c
+}
+
+/*!
+  \class RowWriter
+  \inmodule QtXlsx
+  \brief Streams rows into a new xlsx package.
+
+  Each worksheet is serialized into a temporary file while rows are
+  appended; close() assembles the package.
+ */
+
+RowWriter::RowWriter(const QString &xlsxName) :
+    d_ptr(new RowWriterPrivate)
+{
+    Q_D(RowWriter);
+    d->fileName = xlsxName;
+}
+
+RowWriter::RowWriter(QIODevice *device) :
+    d_ptr(new RowWriterPrivate)
+{
+    Q_D(RowWriter);
+    d->device = device;
+}
+
+RowWriter::~RowWriter()
+{
+    if (!d_ptr->closed)
+        close();
+    delete d_ptr;
+}
+
+bool RowWriter::isValid() const
+{
+    Q_D(const RowWriter);
+    return d->errorString.isEmpty();
+}
+
+QString RowWriter::errorString() const
+{
+    Q_D(const RowWriter);
+    return d->errorString;
+}
+
+bool RowWriter::addSheet(const QString &name)
+{
+    Q_D(RowWriter);
+    if (d->closed) {
+        d->errorString = QStringLiteral("Writer is closed");
+        return false;
+    }
+
+    for (const RowWriterSheet &sheet : d->sheets) {
+        if (sheet.name.compare(name, Qt::CaseInsensitive) == 0)
+            return false;
+    }
+
+    d->finishSheet();
+
+    RowWriterSheet sheet;
+    sheet.name = name;
+    sheet.file.reset(new QTemporaryFile(QDir::tempPath() + QLatin1String("/qxlsx_sheet_XXXXXX.xml")));
+    if (!sheet.file->open()) {
+        d->errorString = QStringLiteral("Cannot create temporary file for %1").arg(name);
+        return false;
+    }
+    d->sheets.append(sheet);
+    d->writer.reset(new QXmlStreamWriter(sheet.file.data()));
+    return true;
+}
+
+bool RowWriter::setColumnWidth(int colFirst, int colLast, double width)
+{
+    Q_D(RowWriter);
+    if (colFirst < 1 || colLast < colFirst || colLast > 16384) // XLSX_COLUMN_MAX
+        return false;
+    if (!d->writer && !addSheet(QStringLiteral("Sheet%1").arg(d->sheets.size() + 1)))
+        return false;
+    if (d->sheetDataStarted)
+        return false;
+
+    d->sheets.last().columnWidths.append(qMakePair(qMakePair(colFirst, colLast), width));
+    return true;
+}
+
+bool RowWriter::appendRow(const QVector<QVariant> &values, const Format &format)
+{
+    Q_D(RowWriter);
+    if (!startRow())
+        return false;
+
+    const int xfIndex = d->cachedStyleIndex(format);
+    for (int i = 0; i < values.size() && i < 16384; ++i) {
+        if (!values.at(i).isNull())
+            d->writeCell(i + 1, values.at(i), format, xfIndex);
+    }
+    return d->finishRow();
+}
+
+bool RowWriter::appendRow(const QVector<QVariant> &values, const QVector<Format> &formats)
+{
+    Q_D(RowWriter);
+    if (!startRow())
+        return false;
+
+    for (int i = 0; i < values.size() && i < 16384; ++i) {
+        if (values.at(i).isNull())
+            continue;
+        const Format format = i < formats.size() ? formats.at(i) : Format();
+        d->writeCell(i + 1, values.at(i), format, d->cachedStyleIndex(format));
+    }
+    return d->finishRow();
+}
+
+bool RowWriter::startRow()
+{
+    Q_D(RowWriter);
+    if (d->closed) {
+        d->errorString = QStringLiteral("Writer is closed");
+        return false;
+    }
+    if (!d->writer && !addSheet(QStringLiteral("Sheet%1").arg(d->sheets.size() + 1)))
+        return false;
+    if (d->row > 1048576) // XLSX_ROW_MAX
+        return false;
+    if (!d->sheetDataStarted)
+        d->startSheetData();
+
+    d->writer->writeStartElement(QStringLiteral("row"));
+    d->writer->writeAttribute(QStringLiteral("r"), QString::number(d->row));
+    return true;
+}
+
+void RowWriter::skipRows(int count)
+{
+    Q_D(RowWriter);
+    if (count > 0)
+        d->row += count;
+}
+
+int RowWriter::nextRow() const
+{
+    Q_D(const RowWriter);
+    return d->row;
+}
+
+void RowWriter::setCompressionLevel(int level)
+{
+    Q_D(RowWriter);
+    d->compressionLevel = level;
+}
+
+void RowWriter::setCompressionThreads(int threads)
+{
+    Q_D(RowWriter);
+    d->compressionThreads = threads;
+}
+
+bool RowWriter::close()
+{
+    Q_D(RowWriter);
+    if (d->closed)
+        return d->errorString.isEmpty();
+
+    if (d->sheets.isEmpty())
+        addSheet(QStringLiteral("Sheet1"));
+    d->finishSheet();
+    d->closed = true;
+    if (!d->errorString.isEmpty())
+        return false;
+
+    QScopedPointer<ZipWriter> zipWriter;
+    if (d->device)
+        zipWriter.reset(new ZipWriter(d->device.data()));
+    else
+        zipWriter.reset(new ZipWriter(d->fileName));
+    if (zipWriter->error()) {
+        d->errorString = QStringLiteral("Cannot open %1 for writing").arg(d->fileName);
+        return false;
+    }
+    zipWriter->setCompressionLevel(d->compressionLevel);
+    zipWriter->setCompressionThreads(d->compressionThreads);
+
+    ContentTypes contentTypes(ContentTypes::F_NewFromScratch);
+    DocPropsApp docPropsApp(DocPropsApp::F_NewFromScratch);
+    DocPropsCore docPropsCore(DocPropsCore::F_NewFromScratch);
+    Relationships workbookRels;
+
+    docPropsApp.addHeadingPair(QStringLiteral("Worksheets"), d->sheets.size());
+
+    QByteArray workbookXml;
+    QXmlStreamWriter writer(&workbookXml);
+    writer.writeStartDocument(QStringLiteral("1.0"), true);
+    writer.writeStartElement(QStringLiteral("workbook"));
+    writer.writeAttribute(QStringLiteral("xmlns"), QStringLiteral("http://schemas.openxmlformats.org/spreadsheetml/2006/main"));
+    writer.writeAttribute(QStringLiteral("xmlns:r"), QStringLiteral("http://schemas.openxmlformats.org/officeDocument/2006/relationships"));
+    writer.writeStartElement(QStringLiteral("sheets"));
+
+    for (int i = 0; i < d->sheets.size(); ++i) {
+        const RowWriterSheet &sheet = d->sheets.at(i);
+        const QString sheetFile = QStringLiteral("sheet%1").arg(i + 1);
+
+        contentTypes.addWorksheetName(sheetFile);
+        docPropsApp.addPartTitle(sheet.name);
+        workbookRels.addDocumentRelationship(QStringLiteral("/worksheet"), QStringLiteral("worksheets/%1.xml").arg(sheetFile));
+
+        writer.writeEmptyElement(QStringLiteral("sheet"));
+        writer.writeAttribute(QStringLiteral("name"), sheet.name);
+        writer.writeAttribute(QStringLiteral("sheetId"), QString::number(i + 1));
+        writer.writeAttribute(QStringLiteral("r:id"), QStringLiteral("rId%1").arg(workbookRels.count()));
+
+        if (!sheet.file->open()) {
+            d->errorString = QStringLiteral("Cannot reopen temporary file of %1").arg(sheet.name);
+            return false;
+        }
+        zipWriter->addFile(QStringLiteral("xl/worksheets/%1.xml").arg(sheetFile), sheet.file.data());
+        sheet.file->close();
+    }
+
+    writer.writeEndElement(); // sheets
+    writer.writeEndElement(); // workbook
+    writer.writeEndDocument();
+
+    workbookRels.addDocumentRelationship(QStringLiteral("/theme"), QStringLiteral("theme/theme1.xml"));
+    workbookRels.addDocumentRelationship(QStringLiteral("/styles"), QStringLiteral("styles.xml"));
+
+    contentTypes.addWorkbook();
+    zipWriter->addFile(QStringLiteral("xl/workbook.xml"), workbookXml);
+    zipWriter->addFile(QStringLiteral("xl/_rels/workbook.xml.rels"), workbookRels.saveToXmlData());
+
+    contentTypes.addStyles();
+    zipWriter->addFile(QStringLiteral("xl/styles.xml"), d->styles.saveToXmlData());
+
+    Theme theme(Theme::F_NewFromScratch);
+    contentTypes.addTheme();
+    zipWriter->addFile(QStringLiteral("xl/theme/theme1.xml"), theme.saveToXmlData());
+
+    contentTypes.addDocPropApp();
+    contentTypes.addDocPropCore();
+    zipWriter->addFile(QStringLiteral("docProps/app.xml"), docPropsApp.saveToXmlData());
+    zipWriter->addFile(QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData());
+
+    Relationships rootrels;
+    rootrels.addDocumentRelationship(QStringLiteral("/officeDocument"), QStringLiteral("xl/workbook.xml"));
+    rootrels.addPackageRelationship(QStringLiteral("/metadata/core-properties"), QStringLiteral("docProps/core.xml"));
+    rootrels.addDocumentRelationship(QStringLiteral("/extended-properties"), QStringLiteral("docProps/app.xml"));
+    zipWriter->addFile(QStringLiteral("_rels/.rels"), rootrels.saveToXmlData());
+
+    zipWriter->addFile(QStringLiteral("[Content_Types].xml"), contentTypes.saveToXmlData());
+
+    zipWriter->close();
+    if (zipWriter->error()) {
+        d->errorString = QStringLiteral("Cannot write package");
+        return false;
+    }
+
+    d->sheets.clear();
+    return true;
+}
+
+QT_END_NAMESPACE_XLSX
@@ -20,14 +20,20 @@ QT_BEGIN_NAMESPACE_XLSX
  * Note that, when we open an existing .xlsx file (broken file?),
  * duplicated string items may exist in the shared string table.
  *
- * In such case, the size of stringList will larger than stringTable.
- * Duplicated items can be removed once we loaded all the worksheets.
+ * In such case, the size of stringList will larger than the lookup tables.
+ * Lookups find the first copy; saveIndex() merges the copies when saving.
+ *
+ * Strings are never moved, so the indices stored by worksheets stay valid
+ * whatever is added or removed. Plain strings, the common case, are looked
+ * up by their QString; only strings with several runs go through RichString.
  */
 
 SharedStrings::SharedStrings(CreateFlag flag)
     :AbstractOOXmlFile(flag)
 {
     m_stringCount = 0;
+    m_saving = false;
+    m_saveRefCount = 0;
 }
 
 int SharedStrings::count() const
@@ -37,81 +43,113 @@ int SharedStrings::count() const
 
 bool SharedStrings::isEmpty() const
 {
+    if (m_saving)
+        return m_saveOrder.isEmpty();
     return m_stringList.isEmpty();
 }
 
+int SharedStrings::appendString(const RichString &string, int refCount)
+{
+    const int index = m_stringList.size();
+    m_stringList.append(string);
+    m_refCounts.append(refCount);
+    if (m_saving)
+        m_saveIndices.append(-1);
+    return index;
+}
+
 int SharedStrings::addSharedString(const QString &string)
 {
-    return addSharedString(RichString(string));
+    m_stringCount += 1;
+
+    auto it = m_plainStringTable.constFind(string);
+    if (it != m_plainStringTable.constEnd()) {
+        m_refCounts[it.value()] += 1;
+        return it.value();
+    }
+
+    const int index = appendString(RichString(string), 1);
+    m_plainStringTable.insert(string, index);
+    return index;
 }
 
 int SharedStrings::addSharedString(const RichString &string)
 {
+    // Single runs are saved as plain text anyway
+    if (!string.isRichString())
+        return addSharedString(string.toPlainString());
+
     m_stringCount += 1;
 
-    auto it = m_stringTable.find(string);
-    if (it != m_stringTable.end()) {
-        it->count += 1;
-        return it->index;
+    auto it = m_richStringTable.constFind(string);
+    if (it != m_richStringTable.constEnd()) {
+        m_refCounts[it.value()] += 1;
+        return it.value();
     }
 
-    int index = m_stringList.size();
-    m_stringTable[string] = XlsxSharedStringInfo(index);
-    m_stringList.append(string);
+    const int index = appendString(string, 1);
+    m_richStringTable.insert(string, index);
     return index;
 }
 
 void SharedStrings::incRefByStringIndex(int idx)
+{
+    incRefByStringIndex(idx, 1);
+}
+
+/*
+ * Adds \a count references at once, used to merge the references counted
+ * by sheets that were loaded in parallel.
+ */
+void SharedStrings::incRefByStringIndex(int idx, int count)
 {
     if (idx <0 || idx >= m_stringList.size()) {
         qDebug("SharedStrings: invlid index");
         return;
     }
+    if (count <= 0)
+        return;
 
-    addSharedString(m_stringList[idx]);
+    m_refCounts[idx] += count;
+    m_stringCount += count;
 }
 
-/*
- * Broken, don't use.
- */
 void SharedStrings::removeSharedString(const QString &string)
 {
-    removeSharedString(RichString(string));
+    auto it = m_plainStringTable.constFind(string);
+    if (it != m_plainStringTable.constEnd())
+        removeSharedStringByIndex(it.value());
+}
+
+void SharedStrings::removeSharedString(const RichString &string)
+{
+    removeSharedStringByIndex(getSharedStringIndex(string));
 }
 
 /*
- * Broken, don't use.
+ * Drops one reference. The string keeps its index, so this is O(1) and
+ * other indices are not affected; if nothing refers to it any longer it is
+ * left out of the next save.
  */
-void SharedStrings::removeSharedString(const RichString &string)
+void SharedStrings::removeSharedStringByIndex(int idx)
 {
-    auto it = m_stringTable.find(string);
-    if (it == m_stringTable.end())
+    if (idx < 0 || idx >= m_stringList.size() || m_refCounts[idx] <= 0)
         return;
 
+    m_refCounts[idx] -= 1;
     m_stringCount -= 1;
-
-    it->count -= 1;
-
-    if (it->count <= 0) {
-        for (int i=it->index+1; i<m_stringList.size(); ++i)
-            m_stringTable[m_stringList[i]].index -= 1;
-
-        m_stringList.removeAt(it->index);
-        m_stringTable.remove(string);
-    }
 }
 
 int SharedStrings::getSharedStringIndex(const QString &string) const
 {
-    return getSharedStringIndex(RichString(string));
+    return m_plainStringTable.value(string, -1);
 }
 
 int SharedStrings::getSharedStringIndex(const RichString &string) const
 {
-    auto it = m_stringTable.constFind(string);
-    if (it != m_stringTable.constEnd())
-        return it->index;
-    return -1;
+    if (!string.isRichString())
+        return getSharedStringIndex(string.toPlainString());
+    return m_richStringTable.value(string, -1);
 }
 
 RichString SharedStrings::getSharedString(int index) const
@@ -126,6 +164,48 @@ QList<RichString> SharedStrings::getSharedStrings() const
     return m_stringList;
 }
 
+void SharedStrings::beginSave()
+{
+    m_saving = true;
+    m_saveIndices.fill(-1, m_stringList.size());
+    m_saveOrder.clear();
+    m_saveRefCount = 0;
+}
+
+/*
+ * Returns the index the string \a idx has in the saved table, giving it the
+ * next free one on first use. Copies of a string share one saved index.
+ * Outside beginSave()/endSave() the index is returned as is.
+ */
+int SharedStrings::saveIndex(int idx)
+{
+    if (!m_saving || idx < 0 || idx >= m_saveIndices.size())
+        return idx;
+
+    m_saveRefCount += 1;
+    if (m_saveIndices.at(idx) != -1)
+        return m_saveIndices.at(idx);
+
+    const int first = getSharedStringIndex(m_stringList.at(idx));
+    if (first >= 0 && first != idx && m_saveIndices.at(first) != -1) {
+        m_saveIndices[idx] = m_saveIndices.at(first);
+    } else {
+        m_saveIndices[idx] = m_saveOrder.size();
+        m_saveOrder.append(idx);
+        if (first >= 0)
+            m_saveIndices[first] = m_saveIndices.at(idx);
+    }
+    return m_saveIndices.at(idx);
+}
+
+void SharedStrings::endSave()
+{
+    m_saving = false;
+    m_saveIndices.clear();
+    m_saveOrder.clear();
+    m_saveRefCount = 0;
+}
+
 void SharedStrings::writeRichStringPart_rPr(QXmlStreamWriter &writer, const Format &format) const
 {
     if (!format.hasFontData())
@@ -193,19 +273,18 @@ void SharedStrings::saveToXmlFile(QIODevice *device) const
 {
     QXmlStreamWriter writer(device);
 
-    if (m_stringList.size() != m_stringTable.size()) {
-        //Duplicated string items exist in m_stringList
-        //Clean up can not be done here, as the indices
-        //have been used when we save the worksheets part.
-    }
+    //While saving, only the strings the worksheets refer to are written,
+    //in the order saveIndex() numbered them.
+    const int stringCount = m_saving ? m_saveOrder.size() : m_stringList.size();
 
     writer.writeStartDocument(QStringLiteral("1.0"), true);
     writer.writeStartElement(QStringLiteral("sst"));
     writer.writeAttribute(QStringLiteral("xmlns"), QStringLiteral("http://schemas.openxmlformats.org/spreadsheetml/2006/main"));
-    writer.writeAttribute(QStringLiteral("count"), QString::number(m_stringCount));
-    writer.writeAttribute(QStringLiteral("uniqueCount"), QString::number(m_stringList.size()));
+    writer.writeAttribute(QStringLiteral("count"), QString::number(m_saving ? m_saveRefCount : m_stringCount));
+    writer.writeAttribute(QStringLiteral("uniqueCount"), QString::number(stringCount));
 
-    for (const RichString &string : m_stringList) {
+    for (int i = 0; i < stringCount; ++i) {
+        const RichString &string = m_stringList.at(m_saving ? m_saveOrder.at(i) : i);
         writer.writeStartElement(QStringLiteral("si"));
         if (string.isRichString()) {
             //Rich text string
@@ -255,9 +334,17 @@ void SharedStrings::readString(QXmlStreamReader &reader)
         }
     }
 
-    int idx = m_stringList.size();
-    m_stringTable[richString] = XlsxSharedStringInfo(idx, 0);
-    m_stringList.append(richString);
+    //Duplicates get their own index, lookups find the first copy
+    if (richString.isRichString()) {
+        const int idx = appendString(richString, 0);
+        if (!m_richStringTable.contains(richString))
+            m_richStringTable.insert(richString, idx);
+    } else {
+        const QString text = richString.toPlainString();
+        const int idx = appendString(RichString(text), 0);
+        if (!m_plainStringTable.contains(text))
+            m_plainStringTable.insert(text, idx);
+    }
 }
 
 void SharedStrings::readRichStringPart(QXmlStreamReader &reader, RichString &richString)
@@ -371,11 +458,6 @@ bool SharedStrings::loadFromXmlFile(QIODevice *device)
         return false;
     }
 
-    if (m_stringList.size() != m_stringTable.size()) {
-        //qDebug("Warning: Duplicated items exist in shared string table.");
-        //Nothing we can do here, as indices of the strings will be used when loading sheets.
-    }
-
     return true;
 }
 
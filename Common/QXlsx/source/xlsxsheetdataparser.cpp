@@ -0,0 +1,459 @@
+// xlsxsheetdataparser.cpp
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QLocale>
+#include <QString>
+#include <QXmlStreamReader>
+
+#include <cstring>
+
+#if defined(__has_include)
+#  if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#    include <charconv>
+#  endif
+#endif
+
+#include "xlsxsheetdataparser_p.h"
+#include "xlsxworksheet_p.h"
+#include "xlsxworkbook.h"
+#include "xlsxstyles_p.h"
+#include "xlsxsharedstrings_p.h"
+#include "xlsxformat.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+// Raw attribute of a start tag, the value is not unescaped
+struct Attribute
+{
+    const char *name;
+    int nameSize;
+    const char *value;
+    int valueSize;
+};
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+template <int N>
+inline bool equals(const char *p, int size, const char (&str)[N])
+{
+    return size == N - 1 && memcmp(p, str, N - 1) == 0;
+}
+
+template <int N>
+inline bool startsWith(const char *p, const char *end, const char (&str)[N])
+{
+    return end - p >= N - 1 && memcmp(p, str, N - 1) == 0;
+}
+
+// True if \a p, just behind a '<', starts the element \a name
+template <int N>
+inline bool isElement(const char *p, const char *end, const char (&name)[N])
+{
+    return end - p >= N && memcmp(p, name, N - 1) == 0
+            && (isSpace(p[N - 1]) || p[N - 1] == '>' || p[N - 1] == '/');
+}
+
+// The '>' closing the tag that \a p is in; quoted attribute values may hold '>'
+const char *findTagEnd(const char *p, const char *end)
+{
+    char quote = 0;
+    for (; p < end; ++p) {
+        if (quote) {
+            if (*p == quote)
+                quote = 0;
+        } else if (*p == '"' || *p == '\'') {
+            quote = *p;
+        } else if (*p == '>') {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+// Just behind the end tag of \a name that follows \a p
+template <int N>
+const char *findEndTag(const char *p, const char *end, const char (&name)[N])
+{
+    while (p < end) {
+        p = static_cast<const char *>(memchr(p, '<', size_t(end - p)));
+        if (!p)
+            return nullptr;
+        if (end - p >= N + 2 && p[1] == '/' && memcmp(p + 2, name, N - 1) == 0
+                && (p[N + 1] == '>' || isSpace(p[N + 1]))) {
+            const char *tagEnd = static_cast<const char *>(memchr(p, '>', size_t(end - p)));
+            return tagEnd ? tagEnd + 1 : nullptr;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+// Reads the next attribute of the start tag ending at \a tagEnd; false at the
+// end of the tag and for malformed input, \a p then points at the stop.
+bool nextAttribute(const char *&p, const char *tagEnd, Attribute *attr)
+{
+    while (p < tagEnd && isSpace(*p))
+        ++p;
+    if (p >= tagEnd || *p == '/')
+        return false;
+
+    const char *name = p;
+    while (p < tagEnd && *p != '=' && !isSpace(*p))
+        ++p;
+    const int nameSize = int(p - name);
+    while (p < tagEnd && isSpace(*p))
+        ++p;
+    if (p >= tagEnd || *p != '=')
+        return false;
+    ++p;
+    while (p < tagEnd && isSpace(*p))
+        ++p;
+    if (p >= tagEnd || (*p != '"' && *p != '\''))
+        return false;
+
+    const char quote = *p++;
+    const char *value = p;
+    while (p < tagEnd && *p != quote)
+        ++p;
+    if (p >= tagEnd)
+        return false;
+
+    attr->name = name;
+    attr->nameSize = nameSize;
+    attr->value = value;
+    attr->valueSize = int(p - value);
+    ++p;
+    return true;
+}
+
+bool parseInt(const char *p, const char *end, int *value)
+{
+    if (p == end || end - p > 9)
+        return false;
+    int v = 0;
+    for (; p < end; ++p) {
+        if (!isDigit(*p))
+            return false;
+        v = v * 10 + (*p - '0');
+    }
+    *value = v;
+    return true;
+}
+
+bool parseDouble(const char *p, const char *end, double *value)
+{
+#if defined(__cpp_lib_to_chars)
+    const std::from_chars_result result = std::from_chars(p, end, *value);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    bool ok = false;
+    *value = QByteArray::fromRawData(p, int(end - p)).toDouble(&ok);
+    return ok;
+#endif
+}
+
+// "B12" -> row 12, column 2
+bool decodeReference(const char *p, const char *end, int *row, int *col)
+{
+    int c = 0;
+    for (; p < end && *p >= 'A' && *p <= 'Z'; ++p) {
+        c = c * 26 + (*p - 'A' + 1);
+        if (c > 16384) // XLSX_COLUMN_MAX
+            return false;
+    }
+
+    int r = 0;
+    const char *digits = p;
+    for (; p < end && isDigit(*p); ++p) {
+        r = r * 10 + (*p - '0');
+        if (r > 1048576) // XLSX_ROW_MAX
+            return false;
+    }
+
+    if (c == 0 || p == digits || p != end || r == 0)
+        return false;
+    *row = r;
+    *col = c;
+    return true;
+}
+
+/*
+  Whether the text of a cell without "t" survives the round trip through
+  double, as checked by WorksheetPrivate::loadXmlCell(). Plain decimals
+  with up to 15 significant digits, no redundant zeros and a magnitude
+  QString::number() writes without exponent are accepted directly.
+ */
+bool isShortestText(const char *p, const char *end, double value)
+{
+    const char *q = p;
+    if (q < end && *q == '-')
+        ++q;
+
+    const char *intBegin = q;
+    while (q < end && isDigit(*q))
+        ++q;
+    const int intDigits = int(q - intBegin);
+
+    int fracDigits = 0;
+    int fracZeros = 0;
+    if (q < end && *q == '.') {
+        const char *fracBegin = ++q;
+        while (q < end && isDigit(*q))
+            ++q;
+        fracDigits = int(q - fracBegin);
+        while (fracZeros < fracDigits && fracBegin[fracZeros] == '0')
+            ++fracZeros;
+        if (fracDigits == 0 || q[-1] == '0')
+            q = nullptr;
+    }
+
+    if (q == end && intDigits > 0 && !(intDigits > 1 && *intBegin == '0')) {
+        if (*intBegin == '0') {
+            if (fracDigits == 0 && p == intBegin) // "0", but not "-0"
+                return true;
+            if (fracDigits > 0 && fracZeros <= 2 && fracDigits - fracZeros <= 15)
+                return true;
+        } else {
+            int intZeros = 0;
+            while (intZeros < intDigits && intBegin[intDigits - 1 - intZeros] == '0')
+                ++intZeros;
+            if ((fracDigits > 0 || intZeros <= 2) && intDigits + fracDigits <= 15)
+                return true;
+        }
+    }
+
+    return QString::number(value, 'g', QLocale::FloatingPointShortest)
+            == QLatin1String(p, int(end - p));
+}
+
+} // namespace
+
+SheetDataParser::SheetDataParser(WorksheetPrivate *sheet)
+    : m_sheet(sheet), m_sharedStringCount(-1)
+{
+    if (sheet->sharedStringLoad != WorksheetPrivate::DeferSharedStrings)
+        m_sharedStringCount = sheet->sharedStrings()->getSharedStrings().size();
+}
+
+bool SheetDataParser::locate(const QByteArray &data, int *begin, int *end)
+{
+    const int first = data.indexOf("<sheetData");
+    if (first < 0)
+        return false;
+
+    const char *p = data.constData();
+    const char *tagEnd = findTagEnd(p + first, p + data.size());
+    if (!tagEnd || tagEnd[-1] == '/') // <sheetData/>
+        return false;
+
+    const int last = data.lastIndexOf("</sheetData>");
+    if (last < tagEnd - p)
+        return false;
+
+    *begin = first;
+    *end = last + 12;
+    return true;
+}
+
+void SheetDataParser::parse(const char *begin, const char *end)
+{
+    const char *p = findTagEnd(begin, end);
+    if (!p)
+        return;
+    ++p;
+
+    while (p < end) {
+        p = static_cast<const char *>(memchr(p, '<', size_t(end - p)));
+        if (!p)
+            break;
+
+        const char *name = p + 1;
+        if (isElement(name, end, "row")) {
+            const char *tagEnd = findTagEnd(name, end);
+            if (!tagEnd)
+                break;
+            loadRow(p, tagEnd);
+            p = tagEnd + 1;
+        } else if (isElement(name, end, "c")) {
+            const char *tagEnd = findTagEnd(name, end);
+            if (!tagEnd)
+                break;
+            const char *elementEnd = tagEnd[-1] == '/' ? tagEnd + 1 : findEndTag(tagEnd + 1, end, "c");
+            if (!elementEnd)
+                break;
+            if (!parseCell(p, tagEnd, elementEnd))
+                loadCell(p, elementEnd);
+            p = elementEnd;
+        } else {
+            p = name; // </row>, comments, ...
+        }
+    }
+}
+
+/*
+  The fast path: <c r=".." [s=".."] [t="n"|"s"]><v>..</v></c> holding a plain
+  number or a plain shared string. Returns false, without having changed
+  anything, for every other cell.
+ */
+bool SheetDataParser::parseCell(const char *tagBegin, const char *tagEnd, const char *elementEnd)
+{
+    if (tagEnd[-1] == '/') // no value
+        return false;
+
+    const char *ref = nullptr;
+    int refSize = 0;
+    int style = -1;
+    char type = 0;
+
+    const char *p = tagBegin + 2;
+    Attribute attr;
+    while (nextAttribute(p, tagEnd, &attr)) {
+        if (equals(attr.name, attr.nameSize, "r")) {
+            ref = attr.value;
+            refSize = attr.valueSize;
+        } else if (equals(attr.name, attr.nameSize, "s")) {
+            if (!parseInt(attr.value, attr.value + attr.valueSize, &style))
+                return false;
+        } else if (equals(attr.name, attr.nameSize, "t")) {
+            if (equals(attr.value, attr.valueSize, "n"))
+                type = 'n';
+            else if (equals(attr.value, attr.valueSize, "s"))
+                type = 's';
+            else
+                return false;
+        }
+    }
+    if (p != tagEnd || !ref)
+        return false;
+
+    int row = 0;
+    int col = 0;
+    if (!decodeReference(ref, ref + refSize, &row, &col))
+        return false;
+
+    // The only child has to be <v>, without entities
+    const char *contentEnd = elementEnd - 1;
+    while (contentEnd > tagEnd && *contentEnd != '<')
+        --contentEnd;
+    const char *v = tagEnd + 1;
+    while (v < contentEnd && isSpace(*v))
+        ++v;
+    if (!startsWith(v, contentEnd, "<v>"))
+        return false;
+    const char *text = v + 3;
+    const char *textEnd = static_cast<const char *>(memchr(text, '<', size_t(contentEnd - text)));
+    if (!textEnd || !startsWith(textEnd, contentEnd, "</v>")
+            || memchr(text, '&', size_t(textEnd - text)))
+        return false;
+    for (const char *rest = textEnd + 4; rest < contentEnd; ++rest) {
+        if (!isSpace(*rest))
+            return false;
+    }
+
+    qint32 xfIndex = -1;
+    bool date = false;
+    if (style >= 0) {
+        const StyleInfo *info = styleInfo(style);
+        if (!info)
+            return false;
+        xfIndex = info->xfIndex;
+        date = info->date;
+    }
+
+    if (type == 's') {
+        int idx = 0;
+        if (col > CellTable::DenseColumnLimit || !parseInt(text, textEnd, &idx))
+            return false;
+        // Rich strings need a Cell; unknown until the strings are loaded
+        if (m_sharedStringCount >= 0
+                && (idx >= m_sharedStringCount || m_sheet->sharedStrings()->getSharedString(idx).isRichString()))
+            return false;
+
+        if (m_sheet->sharedStringLoad == WorksheetPrivate::LoadSharedStrings) {
+            m_sheet->sharedStrings()->incRefByStringIndex(idx);
+        } else {
+            if (idx >= m_sheet->sharedStringRefs.size())
+                m_sheet->sharedStringRefs.resize(idx + 1);
+            ++m_sheet->sharedStringRefs[idx];
+        }
+        return m_sheet->cellTable.setSharedString(row, col, idx, xfIndex);
+    }
+
+    if (date)
+        return false;
+    double value = 0;
+    if (!parseDouble(text, textEnd, &value))
+        return false;
+    if (type == 'n')
+        return m_sheet->cellTable.setNumber(row, col, value, xfIndex);
+    if (!isShortestText(text, textEnd, value))
+        return false;
+    return m_sheet->cellTable.setNumber(row, col, value, xfIndex, true);
+}
+
+const SheetDataParser::StyleInfo *SheetDataParser::styleInfo(int idx)
+{
+    if (idx >= 0x10000)
+        return nullptr;
+    if (idx >= m_styles.size())
+        m_styles.resize(idx + 1);
+
+    StyleInfo &info = m_styles[idx];
+    if (!info.known) {
+        const Format format = m_sheet->workbook->styles()->xfFormat(idx);
+        info.known = true;
+        info.date = format.isValid() && format.isDateTimeFormat();
+        info.xfIndex = format.isEmpty() ? -1 : format.xfIndex();
+    }
+    return &info;
+}
+
+/*
+  Most rows only carry "r" and "spans", which loadXmlRow() ignores.
+ */
+void SheetDataParser::loadRow(const char *tagBegin, const char *tagEnd)
+{
+    bool needed = false;
+    const char *p = tagBegin + 4;
+    Attribute attr;
+    while (!needed && nextAttribute(p, tagEnd, &attr)) {
+        needed = equals(attr.name, attr.nameSize, "customFormat")
+                || equals(attr.name, attr.nameSize, "customHeight")
+                || equals(attr.name, attr.nameSize, "hidden")
+                || equals(attr.name, attr.nameSize, "outlineLevel")
+                || equals(attr.name, attr.nameSize, "collapsed");
+    }
+    if (!needed)
+        return;
+
+    QByteArray element(tagBegin, int(tagEnd - tagBegin));
+    if (!element.endsWith('/'))
+        element.append('/');
+    element.append('>');
+
+    QXmlStreamReader reader(element);
+    reader.setNamespaceProcessing(false);
+    if (reader.readNextStartElement())
+        m_sheet->loadXmlRow(reader);
+}
+
+void SheetDataParser::loadCell(const char *begin, const char *end)
+{
+    QXmlStreamReader reader(QByteArray::fromRawData(begin, int(end - begin)));
+    reader.setNamespaceProcessing(false);
+    if (reader.readNextStartElement())
+        m_sheet->loadXmlCell(reader);
+}
+
+QT_END_NAMESPACE_XLSX
@@ -14,6 +14,7 @@
 #include "xlsxformat_p.h"
 #include "xlsxutility_p.h"
 #include "xlsxcolor_p.h"
+#include "xlsxnumformatparser_p.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -63,7 +64,7 @@ Styles::Styles(CreateFlag flag)
         Format fillFmt;
         fillFmt.setFillPattern(Format::PatternGray125);
         m_fillsList.append(fillFmt);
-        m_fillsHash.insert(fillFmt.fillKey(), fillFmt);
+        m_fillsHash.insert(fillFmt.fillHash(), m_fillsList.size() - 1);
     }
 }
 
@@ -87,18 +88,8 @@ Format Styles::dxfFormat(int idx) const
     return m_dxf_formatsList[idx];
 }
 
-// dev74 issue#57
-void Styles::fixNumFmt(const Format &format)
+void Styles::initBuiltinNumFmts()
 {
-    if (!format.hasNumFmtData())
-        return;
-
-    if (format.hasProperty(FormatPrivate::P_NumFmt_Id)
-            && !format.stringProperty(FormatPrivate::P_NumFmt_FormatCode).isEmpty())
-    {
-        return;
-    }
-
     if ( m_builtinNumFmtsHash.isEmpty() )
     {
         m_builtinNumFmtsHash.insert(QStringLiteral("General"), 0);
@@ -143,6 +134,43 @@ void Styles::fixNumFmt(const Format &format)
         // m_builtinNumFmtsHash.insert(QStringLiteral("0.####"), 176);
 
     }
+}
+
+/*!
+    Returns the compiled program of the number format of \a format, compiling
+    each distinct format code once. A built-in id without a code uses the
+    built-in code; unknown ids render as General.
+ */
+QSharedPointer<const NumFormatProgram> Styles::numFormatProgram(const Format &format)
+{
+    QString code = format.numberFormat();
+    if (code.isEmpty() && format.hasProperty(FormatPrivate::P_NumFmt_Id)) {
+        initBuiltinNumFmts();
+        code = m_builtinNumFmtsHash.key(format.numberFormatIndex(), QStringLiteral("General"));
+    }
+
+    auto it = m_numFmtPrograms.constFind(code);
+    if (it != m_numFmtPrograms.constEnd())
+        return it.value();
+
+    QSharedPointer<const NumFormatProgram> program = NumFormatProgram::compile(code);
+    m_numFmtPrograms.insert(code, program);
+    return program;
+}
+
+// dev74 issue#57
+void Styles::fixNumFmt(const Format &format)
+{
+    if (!format.hasNumFmtData())
+        return;
+
+    if (format.hasProperty(FormatPrivate::P_NumFmt_Id)
+            && !format.stringProperty(FormatPrivate::P_NumFmt_FormatCode).isEmpty())
+    {
+        return;
+    }
+
+    initBuiltinNumFmts();
 
     const auto& str = format.numberFormat();
     if (!str.isEmpty())
@@ -203,6 +231,24 @@ void Styles::fixNumFmt(const Format &format)
     }
 }
 
+namespace {
+
+/*
+   Returns the position in \a list of the format that \a same() to \a format,
+   or -1. \a index maps the hashes of the listed formats to their positions.
+*/
+int findFormat(const QMultiHash<quint64, int> &index, const QList<Format> &list, quint64 hash,
+               const Format &format, bool (Format::*same)(const Format &) const)
+{
+    for (auto it = index.constFind(hash); it != index.constEnd() && it.key() == hash; ++it) {
+        if ((list.at(it.value()).*same)(format))
+            return it.value();
+    }
+    return -1;
+}
+
+} // namespace
+
 /*
    Assign index to Font/Fill/Border and Format
 
@@ -227,69 +273,67 @@ void Styles::addXfFormat(const Format &format, bool force)
     {
         fixNumFmt(format);
     }
-
-    //Font
-    const auto& fontIt = m_fontsHash.constFind(format.fontKey());
-    if (format.hasFontData() && !format.fontIndexValid())
+    if (format.hasNumFmtData() && !format.d->numFmtProgram)
     {
-        //Assign proper font index, if has font data.
-        if (fontIt == m_fontsHash.constEnd())
-            const_cast<Format *>(&format)->setFontIndex(m_fontsList.size());
-        else
-            const_cast<Format *>(&format)->setFontIndex(fontIt->fontIndex());
+        //Readers of the cell find the format code compiled
+        const_cast<Format *>(&format)->setNumberFormatProgram(numFormatProgram(format));
     }
-    if (fontIt == m_fontsHash.constEnd())
+
+    //Font
+    int fontIdx = findFormat(m_fontsHash, m_fontsList, format.fontHash(), format, &Format::hasSameFont);
+    if (fontIdx == -1)
     {
         //Still a valid font if the format has no fontData. (All font properties are default)
+        fontIdx = m_fontsList.size();
         m_fontsList.append(format);
-        m_fontsHash[format.fontKey()] = format;
+        m_fontsHash.insert(format.fontHash(), fontIdx);
+    }
+    if (format.hasFontData() && !format.fontIndexValid())
+    {
+        //Assign proper font index, if has font data.
+        const_cast<Format *>(&format)->setFontIndex(fontIdx);
     }
 
     //Fill
-    const auto& fillIt = m_fillsHash.constFind(format.fillKey());
-    if (format.hasFillData() && !format.fillIndexValid()) {
-        //Assign proper fill index, if has fill data.
-        if (fillIt == m_fillsHash.constEnd())
-            const_cast<Format *>(&format)->setFillIndex(m_fillsList.size());
-        else
-            const_cast<Format *>(&format)->setFillIndex(fillIt->fillIndex());
-    }
-    if (fillIt == m_fillsHash.constEnd()) {
+    int fillIdx = findFormat(m_fillsHash, m_fillsList, format.fillHash(), format, &Format::hasSameFill);
+    if (fillIdx == -1) {
         //Still a valid fill if the format has no fillData. (All fill properties are default)
+        fillIdx = m_fillsList.size();
         m_fillsList.append(format);
-        m_fillsHash[format.fillKey()] = format;
+        m_fillsHash.insert(format.fillHash(), fillIdx);
+    }
+    if (format.hasFillData() && !format.fillIndexValid()) {
+        //Assign proper fill index, if has fill data.
+        const_cast<Format *>(&format)->setFillIndex(fillIdx);
     }
 
     //Border
-    const auto& borderIt = m_bordersHash.constFind(format.borderKey());
-    if (format.hasBorderData() && !format.borderIndexValid()) {
-        //Assign proper border index, if has border data.
-        if (borderIt == m_bordersHash.constEnd())
-            const_cast<Format *>(&format)->setBorderIndex(m_bordersList.size());
-        else
-            const_cast<Format *>(&format)->setBorderIndex(borderIt->borderIndex());
-    }
-    if (borderIt == m_bordersHash.constEnd()) {
+    int borderIdx = findFormat(m_bordersHash, m_bordersList, format.borderHash(), format, &Format::hasSameBorder);
+    if (borderIdx == -1) {
         //Still a valid border if the format has no borderData. (All border properties are default)
+        borderIdx = m_bordersList.size();
         m_bordersList.append(format);
-        m_bordersHash[format.borderKey()] = format;
+        m_bordersHash.insert(format.borderHash(), borderIdx);
+    }
+    if (format.hasBorderData() && !format.borderIndexValid()) {
+        //Assign proper border index, if has border data.
+        const_cast<Format *>(&format)->setBorderIndex(borderIdx);
     }
 
     //Format
-    const auto& formatIt = m_xf_formatsHash.constFind(format.formatKey());
+    const int formatIdx = findFormat(m_xf_formatsHash, m_xf_formatsList, format.formatHash(), format, &Format::operator==);
     if (!format.isEmpty() && !format.xfIndexValid())
     {
-        if (formatIt == m_xf_formatsHash.constEnd())
-            const_cast<Format *>(&format)->setXfIndex(m_xf_formatsList.size());
-        else
-            const_cast<Format *>(&format)->setXfIndex(formatIt->xfIndex());
+        const_cast<Format *>(&format)->setXfIndex(formatIdx == -1 ? m_xf_formatsList.size() : formatIdx);
     }
 
-    if (formatIt == m_xf_formatsHash.constEnd() ||
+    if (formatIdx == -1 ||
             force)
     {
+        //A forced duplicate is only listed, lookups keep finding the first one
+        if (formatIdx == -1)
+            m_xf_formatsHash.insert(format.formatHash(), m_xf_formatsList.size());
         m_xf_formatsList.append(format);
-        m_xf_formatsHash[format.formatKey()] = format;
     }
 }
 
@@ -301,25 +345,19 @@ void Styles::addDxfFormat(const Format &format, bool force)
         fixNumFmt(format);
     }
 
-    const auto& formatIt = m_dxf_formatsHash.constFind(format.formatKey());
+    const int formatIdx = findFormat(m_dxf_formatsHash, m_dxf_formatsList, format.formatHash(), format, &Format::operator==);
     if ( !format.isEmpty() &&
             !format.dxfIndexValid() )
     {
-        if (formatIt ==  m_dxf_formatsHash.constEnd() ) // m_xf_formatsHash.constEnd()) // issue #108
-        {
-            const_cast<Format *>(&format)->setDxfIndex( m_dxf_formatsList.size() );
-        }
-        else
-        {
-            const_cast<Format *>(&format)->setDxfIndex( formatIt->dxfIndex() );
-        }
+        const_cast<Format *>(&format)->setDxfIndex( formatIdx == -1 ? m_dxf_formatsList.size() : formatIdx );
     }
 
-    if (formatIt == m_xf_formatsHash.constEnd() ||
+    if (formatIdx == -1 ||
          force )
     {
+        if (formatIdx == -1)
+            m_dxf_formatsHash.insert(format.formatHash(), m_dxf_formatsList.size());
         m_dxf_formatsList.append(format);
-        m_dxf_formatsHash[ format.formatKey() ] = format;
     }
 }
 
@@ -800,7 +838,7 @@ bool Styles::readFonts(QXmlStreamReader &reader)
                 Format format;
                 readFont(reader, format);
                 m_fontsList.append(format);
-                m_fontsHash.insert(format.fontKey(), format);
+                m_fontsHash.insert(format.fontHash(), m_fontsList.size()-1);
                 if (format.isValid())
                     format.setFontIndex(m_fontsList.size()-1);
             }
@@ -888,7 +926,7 @@ bool Styles::readFills(QXmlStreamReader &reader)
                 Format fill;
                 readFill(reader, fill);
                 m_fillsList.append(fill);
-                m_fillsHash.insert(fill.fillKey(), fill);
+                m_fillsHash.insert(fill.fillHash(), m_fillsList.size()-1);
                 if (fill.isValid())
                     fill.setFillIndex(m_fillsList.size()-1);
             }
@@ -985,7 +1023,7 @@ bool Styles::readBorders(QXmlStreamReader &reader)
                 Format border;
                 readBorder(reader, border);
                 m_bordersList.append(border);
-                m_bordersHash.insert(border.borderKey(), border);
+                m_bordersHash.insert(border.borderHash(), m_bordersList.size()-1);
                 if (border.isValid())
                     border.setBorderIndex(m_bordersList.size()-1);
             }
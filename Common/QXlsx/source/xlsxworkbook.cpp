@@ -20,6 +20,8 @@
 #include "xlsxmediafile_p.h"
 #include "xlsxutility_p.h"
 #include "xlsxchart.h"
+#include "xlsxdrawing_p.h"
+#include "xlsxabstractsheet_p.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -47,6 +49,8 @@ WorkbookPrivate::WorkbookPrivate(Workbook *q, Workbook::CreateFlag flag) :
     last_worksheet_index = 0;
     last_chartsheet_index = 0;
     last_sheet_id = 0;
+
+    skipDrawings = false;
 }
 
 Workbook::Workbook(CreateFlag flag)
@@ -276,7 +280,9 @@ AbstractSheet *Workbook::activeSheet() const
     Q_D(const Workbook);
     if (d->sheets.isEmpty())
         const_cast<Workbook*>(this)->addSheet();
-    return d->sheets[d->activesheetIndex].data();
+    AbstractSheet *sheet = d->sheets[d->activesheetIndex].data();
+    loadPendingSheet(sheet);
+    return sheet;
 }
 
 bool Workbook::setActiveSheet(int index)
@@ -321,6 +327,7 @@ bool Workbook::deleteSheet(int index)
         return false;
     if (index < 0 || index >= d->sheets.size())
         return false;
+    d->pendingSheets.remove(d->sheets[index].data());
     d->sheets.removeAt(index);
     d->sheetNames.removeAt(index);
     return true;
@@ -370,6 +377,7 @@ bool Workbook::copySheet(int index, const QString &newName)
     }
 
     ++d->last_sheet_id;
+    loadPendingSheet(d->sheets[index].data());
     AbstractSheet *sheet = d->sheets[index]->copy(worksheetName, d->last_sheet_id);
     d->sheets.append(QSharedPointer<AbstractSheet> (sheet));
     d->sheetNames.append(sheet->sheetName());
@@ -394,7 +402,80 @@ AbstractSheet *Workbook::sheet(int index) const
     Q_D(const Workbook);
     if (index < 0 || index >= d->sheets.size())
         return 0;
-    return d->sheets.at(index).data();
+    AbstractSheet *sheet = d->sheets.at(index).data();
+    loadPendingSheet(sheet);
+    return sheet;
+}
+
+/*!
+ * \internal
+ * With Document::LazySheets, reads the parts of \a sheet from the package
+ * the first time it is accessed: the sheet, its relationships and, unless
+ * Document::SkipDrawings is set, its drawing with the charts and pictures
+ * the drawing refers to.
+ */
+void Workbook::loadPendingSheet(AbstractSheet *sheet) const
+{
+    WorkbookPrivate *d = const_cast<WorkbookPrivate *>(d_func());
+    if (!d->pendingSheets.remove(sheet))
+        return;
+
+    const ZipReader &zipReader = *d->lazyPackage;
+    const QString rel_path = getRelFilePath(sheet->filePath());
+    //If the .rel file exists, load it.
+    if (zipReader.filePaths().contains(rel_path))
+        sheet->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
+    sheet->loadFromXmlData(zipReader.fileData(sheet->filePath()));
+
+    if (d->skipDrawings)
+        const_cast<Workbook *>(this)->dropDrawing(sheet);
+
+    Drawing *drawing = sheet->drawing();
+    if (drawing) {
+        // charts and pictures the drawing registers are appended to the workbook lists
+        const int firstChart = d->chartFiles.size();
+        const int firstMedia = d->mediaFiles.size();
+
+        const QString drawing_rel_path = getRelFilePath(drawing->filePath());
+        if (zipReader.filePaths().contains(drawing_rel_path))
+            drawing->relationships()->loadFromXmlData(zipReader.fileData(drawing_rel_path));
+        drawing->loadFromXmlData(zipReader.fileData(drawing->filePath()));
+
+        for (int i=firstChart; i<d->chartFiles.size(); ++i)
+            d->chartFiles[i]->loadFromXmlData(zipReader.fileData(d->chartFiles[i]->filePath()));
+        for (int i=firstMedia; i<d->mediaFiles.size(); ++i) {
+            const auto &mf = d->mediaFiles[i];
+            const QString path = mf->fileName();
+            const QString suffix = path.mid(path.lastIndexOf(QLatin1Char('.'))+1);
+            mf->set(zipReader.fileData(path), suffix);
+        }
+    }
+
+    if (d->pendingSheets.isEmpty())
+        d->lazyPackage.reset();
+}
+
+/*!
+ * \internal
+ * Reads all sheets that have not been accessed yet, e.g. before saving.
+ */
+void Workbook::loadPendingSheets() const
+{
+    Q_D(const Workbook);
+    while (!d->pendingSheets.isEmpty())
+        loadPendingSheet(*d->pendingSheets.constBegin());
+}
+
+/*!
+ * \internal
+ * Forgets the drawing of a worksheet loaded with Document::SkipDrawings, so
+ * neither the drawing nor its charts and pictures are read. The drawing of
+ * a chartsheet is the chart itself and is kept.
+ */
+void Workbook::dropDrawing(AbstractSheet *sheet)
+{
+    if (sheet->sheetType() == AbstractSheet::ST_WorkSheet)
+        sheet->d_func()->drawing.reset();
 }
 
 SharedStrings *Workbook::sharedStrings() const
@@ -423,6 +504,7 @@ Theme *Workbook::theme()
 QList<Drawing *> Workbook::drawings()
 {
     Q_D(Workbook);
+    loadPendingSheets();
     QList<Drawing *> ds;
     for (int i=0; i<d->sheets.size(); ++i) {
         QSharedPointer<AbstractSheet> sheet = d->sheets[i];
@@ -439,6 +521,7 @@ QList<Drawing *> Workbook::drawings()
 QList<QSharedPointer<AbstractSheet> > Workbook::getSheetsByTypes(AbstractSheet::SheetType type) const
 {
     Q_D(const Workbook);
+    loadPendingSheets();
     QList<QSharedPointer<AbstractSheet> > list;
     for (int i=0; i<d->sheets.size(); ++i) {
         if (d->sheets[i]->sheetType() == type)
@@ -9,6 +9,7 @@
 #include <QFile>
 #include <QUrl>
 #include <QDebug>
+#include <QLocale>
 #include <QBuffer>
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
@@ -39,11 +40,13 @@
 #include "xlsxcellformula.h"
 #include "xlsxcellformula_p.h"
 #include "xlsxcelllocation.h"
+#include "xlsxsheetdataparser_p.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
 WorksheetPrivate::WorksheetPrivate(Worksheet *p, Worksheet::CreateFlag flag)
 : AbstractSheetPrivate(p, flag),
+  sharedStringLoad(LoadSharedStrings),
   windowProtection(false),
   showFormulas(false),
   showGridLines(true),
@@ -82,20 +85,17 @@ void WorksheetPrivate::calculateSpans() const
 	int span_max = -1;
 
 	for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        auto it = cellTable.constFind(row_num);
-        if (it != cellTable.constEnd()) {
-			for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn(); col_num++) {
-                if (it->contains(col_num)) {
-					if (span_max == -1) {
-						span_min = col_num;
-						span_max = col_num;
-					} else {
-						if (col_num < span_min)
-							span_min = col_num;
-						else if (col_num > span_max)
-							span_max = col_num;
-					}
-				}
+        if (cellTable.hasRow(row_num)) {
+			const int firstCol = cellTable.firstColumn(row_num);
+			const int lastCol = cellTable.lastColumn(row_num);
+			if (span_max == -1) {
+				span_min = firstCol;
+				span_max = lastCol;
+			} else {
+				if (firstCol < span_min)
+					span_min = firstCol;
+				if (lastCol > span_max)
+					span_max = lastCol;
 			}
 		}
         auto cIt = comments.constFind(row_num);
@@ -191,26 +191,35 @@ Worksheet *Worksheet::copy(const QString &distName, int distId) const
 
 	sheet_d->dimension = d->dimension;
 
-    QMapIterator<int, QMap<int, std::shared_ptr<Cell> > > it(d->cellTable);
-    while (it.hasNext())
+    for (int row = d->cellTable.firstRow(); row != -1; row = d->cellTable.nextRow(row))
     {
-		it.next();
-		int row = it.key();
-        QMapIterator<int, std::shared_ptr<Cell> > it2(it.value());
-        while (it2.hasNext())
+        for (int col = d->cellTable.firstColumn(row); col != -1; col = d->cellTable.nextColumn(row, col))
         {
-			it2.next();
-			int col = it2.key();
-
-            auto cell = std::make_shared<Cell>(it2.value().get());
-			cell->d_ptr->parent = sheet;
+            switch (d->cellTable.slotType(row, col))
+            {
+            case CellTable::NumberSlot:
+            case CellTable::CustomNumberSlot:
+                sheet_d->cellTable.setNumber(row, col, d->cellTable.number(row, col), d->cellTable.styleIndex(row, col),
+                                             d->cellTable.slotType(row, col) == CellTable::CustomNumberSlot);
+                break;
+            case CellTable::SharedStringSlot:
+                d->workbook->sharedStrings()->incRefByStringIndex(d->cellTable.sharedStringIndex(row, col));
+                sheet_d->cellTable.setSharedString(row, col, d->cellTable.sharedStringIndex(row, col), d->cellTable.styleIndex(row, col));
+                break;
+            default:
+            {
+                auto cell = std::make_shared<Cell>(d->cellTable.cell(row, col).get());
+                cell->d_ptr->parent = sheet;
 
-			if (cell->cellType() == Cell::SharedStringType)
-				d->workbook->sharedStrings()->addSharedString(cell->d_ptr->richString);
+                if (cell->cellType() == Cell::SharedStringType)
+                    d->workbook->sharedStrings()->addSharedString(cell->d_ptr->richString);
 
-			sheet_d->cellTable[row][col] = cell;
-		}
-	}
+                sheet_d->cellTable.setCell(row, col, cell);
+                break;
+            }
+            }
+        }
+    }
 
 	sheet_d->merges = d->merges;
 //    sheet_d->rowsInfo = d->rowsInfo;
@@ -537,6 +546,20 @@ QVariant Worksheet::read(int row, int column) const
 {
 	Q_D(const Worksheet);
 
+	//Plain numbers and strings are answered from the dense storage
+	switch (d->cellTable.slotType(row, column)) {
+	case CellTable::EmptySlot:
+		return QVariant();
+	case CellTable::NumberSlot:
+		return d->cellTable.number(row, column);
+	case CellTable::CustomNumberSlot:
+		return QString::number(d->cellTable.number(row, column), 'g', QLocale::FloatingPointShortest);
+	case CellTable::SharedStringSlot:
+		return d->sharedStrings()->getSharedString(d->cellTable.sharedStringIndex(row, column)).toPlainString();
+	default:
+		break;
+	}
+
 	Cell *cell = cellAt(row, column);
 	if (!cell)
 		return QVariant();
@@ -574,6 +597,156 @@ QVariant Worksheet::read(int row, int column) const
 	return cell->value();
 }
 
+/*!
+	\overload
+	Return the contents of the cell \a row_column, with formulas calculated.
+ */
+QVariant Worksheet::readValue(const CellReference &row_column) const
+{
+	if (!row_column.isValid())
+		return QVariant();
+
+	return readValue(row_column.row(), row_column.column());
+}
+
+/*!
+	Return the contents of the cell (\a row, \a column) like read(), except
+	that a formula cell returns its result instead of the formula text.
+	Results are calculated when the cells the formula depends on changed
+	since the last calculation; otherwise the cached value is returned.
+ */
+QVariant Worksheet::readValue(int row, int column) const
+{
+	Q_D(const Worksheet);
+
+	if (d->cellTable.slotType(row, column) == CellTable::CellSlot) {
+		std::shared_ptr<Cell> cell = d->cellTable.cell(row, column);
+		if (cell->hasFormula()) {
+			d->formulaEngine()->evaluate(row, column);
+			if (cell->isDateTime())
+				return cell->dateTime();
+			return cell->value();
+		}
+	}
+	return read(row, column);
+}
+
+/*!
+	Returns the contents of the cells in \a range as one row-major buffer of
+	range.rowCount() * range.columnCount() values, with the same conversions
+	as read(). Empty cells are null QVariants. Only the rows and columns that
+	hold cells are visited, so pass usedRange() rather than a generous guess.
+ */
+QVector<QVariant> Worksheet::readRange(const CellRange &range) const
+{
+	Q_D(const Worksheet);
+
+	QVector<QVariant> values;
+	if (!range.isValid())
+		return values;
+
+	const int columnCount = range.columnCount();
+	values.resize(range.rowCount() * columnCount);
+
+	for (int row = d->cellTable.nextRow(range.firstRow() - 1);
+		 row != -1 && row <= range.lastRow();
+		 row = d->cellTable.nextRow(row)) {
+		QVariant *line = values.data() + (row - range.firstRow()) * columnCount;
+		for (int col = d->cellTable.nextColumn(row, range.firstColumn() - 1);
+			 col != -1 && col <= range.lastColumn();
+			 col = d->cellTable.nextColumn(row, col)) {
+			line[col - range.firstColumn()] = read(row, col);
+		}
+	}
+	return values;
+}
+
+/*!
+	Writes the row-major buffer \a values into \a range with the \a format,
+	converting each value as write() does. Null QVariants leave the cell
+	untouched. Returns false if the buffer size does not match the range or
+	any cell could not be written.
+ */
+bool Worksheet::writeRange(const CellRange &range, const QVector<QVariant> &values, const Format &format)
+{
+	if (!range.isValid() || range.firstRow() < 1 || range.firstColumn() < 1
+			|| range.lastRow() > XLSX_ROW_MAX || range.lastColumn() > XLSX_COLUMN_MAX)
+		return false;
+	if (values.size() != range.rowCount() * range.columnCount())
+		return false;
+
+	bool ret = true;
+	const QVariant *value = values.constData();
+	for (int row = range.firstRow(); row <= range.lastRow(); ++row) {
+		for (int col = range.firstColumn(); col <= range.lastColumn(); ++col, ++value) {
+			if (!value->isNull() && !write(row, col, *value, format))
+				ret = false;
+		}
+	}
+	return ret;
+}
+
+/*!
+	Returns the smallest range containing every stored cell, or an invalid
+	range for an empty sheet. Unlike dimension() it is computed from the
+	cells themselves and ignores a stale or missing <dimension> element.
+ */
+CellRange Worksheet::usedRange() const
+{
+	Q_D(const Worksheet);
+
+	const int firstRow = d->cellTable.firstRow();
+	if (firstRow == -1)
+		return CellRange();
+
+	int lastRow = firstRow;
+	int firstColumn = XLSX_COLUMN_MAX;
+	int lastColumn = 1;
+	for (int row = firstRow; row != -1; row = d->cellTable.nextRow(row)) {
+		firstColumn = qMin(firstColumn, d->cellTable.firstColumn(row));
+		lastColumn = qMax(lastColumn, d->cellTable.lastColumn(row));
+		lastRow = row;
+	}
+	return CellRange(firstRow, firstColumn, lastRow, lastColumn);
+}
+
+/*!
+	Calls \a func once for each row inside \a range that holds at least one
+	cell in the range, in ascending row order. The values passed have
+	range.columnCount() entries, empty cells are null QVariants. Returning
+	false from \a func stops the iteration.
+
+	\code
+	sheet->forEachRow(sheet->usedRange(), [&](int row, const QVector<QVariant> &values) {
+		...
+		return true;
+	});
+	\endcode
+ */
+void Worksheet::forEachRow(const CellRange &range, const std::function<bool (int, const QVector<QVariant> &)> &func) const
+{
+	Q_D(const Worksheet);
+
+	if (!range.isValid() || !func)
+		return;
+
+	QVector<QVariant> values(range.columnCount());
+	for (int row = d->cellTable.nextRow(range.firstRow() - 1);
+		 row != -1 && row <= range.lastRow();
+		 row = d->cellTable.nextRow(row)) {
+		bool empty = true;
+		values.fill(QVariant());
+		for (int col = d->cellTable.nextColumn(row, range.firstColumn() - 1);
+			 col != -1 && col <= range.lastColumn();
+			 col = d->cellTable.nextColumn(row, col)) {
+			values[col - range.firstColumn()] = read(row, col);
+			empty = false;
+		}
+		if (!empty && !func(row, values))
+			return;
+	}
+}
+
 /*!
  * Returns the cell at the given \a row_column. If there
  * is no cell at the specified position, the function returns 0.
@@ -593,23 +766,104 @@ Cell *Worksheet::cellAt(const CellReference &row_column) const
 Cell *Worksheet::cellAt(int row, int col) const
 {
 	Q_D(const Worksheet);
-    auto it = d->cellTable.constFind(row);
-    if (it == d->cellTable.constEnd())
-		return 0;
-    if (!it->contains(col))
-		return 0;
+	return d->cellAt(row, col).get();
+}
+
+/*
+  Returns the Cell stored at (row, col). A plain number or shared string
+  kept in the dense part of the table is turned into a Cell first, so the
+  returned object stays valid (and may be modified) like any other cell.
+ */
+std::shared_ptr<Cell> WorksheetPrivate::cellAt(int row, int col) const
+{
+	Q_Q(const Worksheet);
+
+	const CellTable::SlotType type = cellTable.slotType(row, col);
+	if (type == CellTable::EmptySlot)
+		return nullptr;
+	if (type == CellTable::CellSlot)
+		return cellTable.cell(row, col);
+
+	const int styleIndex = cellTable.styleIndex(row, col);
+	const Format format = styleIndex >= 0 ? workbook->styles()->xfFormat(styleIndex) : Format();
+	Worksheet *sheet = const_cast<Worksheet *>(q);
+
+	std::shared_ptr<Cell> cell;
+	if (type == CellTable::SharedStringSlot) {
+		const QString text = sharedStrings()->getSharedString(cellTable.sharedStringIndex(row, col)).toPlainString();
+		cell = std::make_shared<Cell>(text, Cell::SharedStringType, format, sheet, styleIndex);
+	} else if (type == CellTable::CustomNumberSlot) {
+		const QString text = QString::number(cellTable.number(row, col), 'g', QLocale::FloatingPointShortest);
+		cell = std::make_shared<Cell>(text, Cell::CustomType, format, sheet, styleIndex);
+	} else {
+		cell = std::make_shared<Cell>(cellTable.number(row, col), Cell::NumberType, format, sheet, styleIndex);
+	}
 
-    return (*it)[col].get();
+	cellTable.setCell(row, col, cell);
+	return cell;
 }
 
 Format WorksheetPrivate::cellFormat(int row, int col) const
 {
-    auto it = cellTable.constFind(row);
-    if (it == cellTable.constEnd())
+	switch (cellTable.slotType(row, col)) {
+	case CellTable::EmptySlot:
 		return Format();
-    if (!it->contains(col))
-		return Format();
-    return (*it)[col]->format();
+	case CellTable::CellSlot:
+		return cellTable.cell(row, col)->format();
+	default:
+	{
+		const int styleIndex = cellTable.styleIndex(row, col);
+		return styleIndex >= 0 ? workbook->styles()->xfFormat(styleIndex) : Format();
+	}
+	}
+}
+
+/*
+  Plain numbers and plain shared strings go to the dense part of cellTable;
+  dates keep a Cell because read() has to convert them.
+ */
+void WorksheetPrivate::storeNumber(int row, int col, double value, const Format &format)
+{
+	Q_Q(Worksheet);
+
+	const int styleIndex = format.isEmpty() ? -1 : format.xfIndex();
+	if (!(format.isValid() && format.isDateTimeFormat())
+			&& cellTable.setNumber(row, col, value, styleIndex)) {
+		cellChanged(row, col);
+		return;
+	}
+
+	cellTable.setCell(row, col, std::make_shared<Cell>(value, Cell::NumberType, format, q));
+	cellChanged(row, col);
+}
+
+void WorksheetPrivate::cellChanged(int row, int col)
+{
+	formulaEngine()->cellChanged(row, col);
+}
+
+FormulaEngine *WorksheetPrivate::formulaEngine() const
+{
+	if (!formulas)
+		formulas.reset(new FormulaEngine(const_cast<WorksheetPrivate *>(this)));
+	return formulas.data();
+}
+
+void WorksheetPrivate::storeSharedString(int row, int col, int sstIndex, const Format &format)
+{
+	Q_Q(Worksheet);
+
+	const int styleIndex = format.isEmpty() ? -1 : format.xfIndex();
+	if (cellTable.setSharedString(row, col, sstIndex, styleIndex)) {
+		cellChanged(row, col);
+		return;
+	}
+
+	const RichString rs = sharedStrings()->getSharedString(sstIndex);
+	auto cell = std::make_shared<Cell>(rs.toPlainString(), Cell::SharedStringType, format, q, styleIndex);
+	cell->d_ptr->richString = rs;
+	cellTable.setCell(row, col, cell);
+	cellChanged(row, col);
 }
 
 /*!
@@ -642,14 +896,19 @@ bool Worksheet::writeString(int row, int column, const RichString &value, const
 //        error = -2;
 //    }
 
-	d->sharedStrings()->addSharedString(value);
+	int sstIndex = d->sharedStrings()->addSharedString(value);
 	Format fmt = format.isValid() ? format : d->cellFormat(row, column);
 	if (value.fragmentCount() == 1 && value.fragmentFormat(0).isValid())
 		fmt.mergeFormat(value.fragmentFormat(0));
 	d->workbook->styles()->addXfFormat(fmt);
+	if (!value.isRichString()) {
+		d->storeSharedString(row, column, sstIndex, fmt);
+		return true;
+	}
     auto cell = std::make_shared<Cell>(value.toPlainString(), Cell::SharedStringType, fmt, this);
 	cell->d_ptr->richString = value;
-	d->cellTable[row][column] = cell;
+	d->cellTable.setCell(row, column, cell);
+	d->cellChanged(row, column);
 	return true;
 }
 
@@ -717,7 +976,8 @@ bool Worksheet::writeInlineString(int row, int column, const QString &value, con
 
 	Format fmt = format.isValid() ? format : d->cellFormat(row, column);
 	d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = std::make_shared<Cell>(value, Cell::InlineStringType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(value, Cell::InlineStringType, fmt, this));
+	d->cellChanged(row, column);
 	return true;
 }
 
@@ -746,7 +1006,7 @@ bool Worksheet::writeNumeric(int row, int column, double value, const Format &fo
 
 	Format fmt = format.isValid() ? format : d->cellFormat(row, column);
 	d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = std::make_shared<Cell>(value, Cell::NumberType, fmt, this);
+	d->storeNumber(row, column, value, fmt);
 	return true;
 }
 
@@ -794,7 +1054,8 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
 
     auto data = std::make_shared<Cell>(result, Cell::NumberType, fmt, this);
 	data->d_ptr->formula = formula;
-	d->cellTable[row][column] = data;
+	d->cellTable.setCell(row, column, data);
+	d->cellChanged(row, column);
 
 	CellRange range = formula.reference();
 	if (formula.formulaType() == CellFormula::SharedType) {
@@ -808,8 +1069,9 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
 					} else {
                         auto newCell = std::make_shared<Cell>(result, Cell::NumberType, fmt, this);
 						newCell->d_ptr->formula = sf;
-						d->cellTable[r][c] = newCell;
+						d->cellTable.setCell(r, c, newCell);
 					}
+					d->cellChanged(r, c);
 				}
 			}
 		}
@@ -845,7 +1107,8 @@ bool Worksheet::writeBlank(int row, int column, const Format &format)
 	d->workbook->styles()->addXfFormat(fmt);
 
 	//Note: NumberType with an invalid QVariant value means blank.
-    d->cellTable[row][column] = std::make_shared<Cell>(QVariant{}, Cell::NumberType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(QVariant{}, Cell::NumberType, fmt, this));
+	d->cellChanged(row, column);
 
 	return true;
 }
@@ -874,7 +1137,8 @@ bool Worksheet::writeBool(int row, int column, bool value, const Format &format)
 
 	Format fmt = format.isValid() ? format : d->cellFormat(row, column);
 	d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = std::make_shared<Cell>(value, Cell::BooleanType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(value, Cell::BooleanType, fmt, this));
+	d->cellChanged(row, column);
 
 	return true;
 }
@@ -908,7 +1172,8 @@ bool Worksheet::writeDateTime(int row, int column, const QDateTime &dt, const Fo
 
 	double value = datetimeToNumber(dt, d->workbook->isDate1904());
 
-    d->cellTable[row][column] = std::make_shared<Cell>(value, Cell::NumberType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(value, Cell::NumberType, fmt, this));
+	d->cellChanged(row, column);
 
 	return true;
 }
@@ -938,7 +1203,8 @@ bool Worksheet::writeDate(int row, int column, const QDate &dt, const Format &fo
 
     double value = datetimeToNumber(QDateTime(dt, QTime(0,0,0)), d->workbook->isDate1904());
 
-    d->cellTable[row][column] = std::make_shared<Cell>(value, Cell::NumberType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(value, Cell::NumberType, fmt, this));
+	d->cellChanged(row, column);
 
     return true;
 }
@@ -971,7 +1237,8 @@ bool Worksheet::writeTime(int row, int column, const QTime &t, const Format &for
 		fmt.setNumberFormat(QStringLiteral("hh:mm:ss"));
 	d->workbook->styles()->addXfFormat(fmt);
 
-    d->cellTable[row][column] = std::make_shared<Cell>(timeToNumber(t), Cell::NumberType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(timeToNumber(t), Cell::NumberType, fmt, this));
+	d->cellChanged(row, column);
 
 	return true;
 }
@@ -1037,7 +1304,8 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
 
 	//Write the hyperlink string as normal string.
 	d->sharedStrings()->addSharedString(displayString);
-    d->cellTable[row][column] = std::make_shared<Cell>(displayString, Cell::SharedStringType, fmt, this);
+    d->cellTable.setCell(row, column, std::make_shared<Cell>(displayString, Cell::SharedStringType, fmt, this));
+	d->cellChanged(row, column);
 
 	//Store the hyperlink data in a separate table
 	d->urlTable[row][column] = QSharedPointer<XlsxHyperlinkData>(new XlsxHyperlinkData(XlsxHyperlinkData::External, urlString, locationString, QString(), tip));
@@ -1527,12 +1795,14 @@ bool Worksheet::setStartPage(int spagen)
 
 void WorksheetPrivate::saveXmlSheetData(QXmlStreamWriter &writer) const
 {
+	// formula results are saved as the cached <v> of their cells
+	formulaEngine()->recalculate();
 	calculateSpans();
     for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++)
     {
-        auto ctIt = cellTable.constFind(row_num);
+        const bool hasCells = cellTable.hasRow(row_num);
         auto riIt = rowsInfo.constFind(row_num);
-        if (ctIt == cellTable.constEnd() && riIt == rowsInfo.constEnd() && !comments.contains(row_num))
+        if (!hasCells && riIt == rowsInfo.constEnd() && !comments.contains(row_num))
         {
 			//Only process rows with cell data / comments / formatting
 			continue;
@@ -1577,14 +1847,14 @@ void WorksheetPrivate::saveXmlSheetData(QXmlStreamWriter &writer) const
 		}
 
 		//Write cell data if row contains filled cells
-        if (ctIt != cellTable.constEnd())
+        if (hasCells)
         {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn(); col_num++)
+            for (int col_num = cellTable.firstColumn(row_num); col_num != -1; col_num = cellTable.nextColumn(row_num, col_num))
             {
-                if (ctIt->contains(col_num))
-                {
-                    saveXmlCellData(writer, row_num, col_num, (*ctIt)[col_num]);
-				}
+                if (cellTable.slotType(row_num, col_num) == CellTable::CellSlot)
+                    saveXmlCellData(writer, row_num, col_num, cellTable.cell(row_num, col_num));
+                else
+                    saveXmlDenseCellData(writer, row_num, col_num);
 			}
 		}
 		writer.writeEndElement(); //row
@@ -1601,16 +1871,8 @@ void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int co
 	writer.writeStartElement(QStringLiteral("c"));
 	writer.writeAttribute(QStringLiteral("r"), cell_pos);
 
-    QMap<int, QSharedPointer<XlsxRowInfo> >::ConstIterator rIt;
-    QMap<int, QSharedPointer<XlsxColumnInfo> >::ConstIterator cIt;
-
-	//Style used by the cell, row or col
-	if (!cell->format().isEmpty())
-		writer.writeAttribute(QStringLiteral("s"), QString::number(cell->format().xfIndex()));
-    else if ((rIt = rowsInfo.constFind(row)) != rowsInfo.constEnd() && !(*rIt)->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number((*rIt)->format.xfIndex()));
-    else if ((cIt = colsInfoHelper.constFind(col)) != colsInfoHelper.constEnd() && !(*cIt)->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number((*cIt)->format.xfIndex()));
+	const Format format = cell->format();
+	saveXmlCellStyle(writer, row, col, format.isEmpty() ? -1 : format.xfIndex());
 
     if (cell->cellType() == Cell::SharedStringType) // 's'
     {
@@ -1621,7 +1883,7 @@ void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int co
 			sst_idx = sharedStrings()->getSharedStringIndex(cell->value().toString());
 
 		writer.writeAttribute(QStringLiteral("t"), QStringLiteral("s"));
-		writer.writeTextElement(QStringLiteral("v"), QString::number(sst_idx));
+		writer.writeTextElement(QStringLiteral("v"), QString::number(sharedStrings()->saveIndex(sst_idx)));
     }
     else if (cell->cellType() == Cell::InlineStringType) // 'inlineStr'
     {
@@ -1718,6 +1980,8 @@ void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int co
     else if (cell->cellType() == Cell::ErrorType) // 'e'
     {
         writer.writeAttribute(QStringLiteral("t"), QStringLiteral("e"));
+        if (cell->hasFormula())
+            cell->formula().saveToXml(writer);
         writer.writeTextElement(QStringLiteral("v"), cell->value().toString() );
     }
     else // if (cell->cellType() == Cell::CustomType)
@@ -1741,6 +2005,53 @@ void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int co
     writer.writeEndElement(); // c
 }
 
+/*
+  Writes a number or shared string kept in the dense part of cellTable,
+  with the same output as saveXmlCellData() gives for the matching Cell.
+ */
+void WorksheetPrivate::saveXmlDenseCellData(QXmlStreamWriter &writer, int row, int col) const
+{
+	writer.writeStartElement(QStringLiteral("c"));
+	writer.writeAttribute(QStringLiteral("r"), CellReference(row, col).toString());
+	saveXmlCellStyle(writer, row, col, cellTable.styleIndex(row, col));
+
+	switch (cellTable.slotType(row, col)) {
+	case CellTable::SharedStringSlot:
+		writer.writeAttribute(QStringLiteral("t"), QStringLiteral("s"));
+		writer.writeTextElement(QStringLiteral("v"), QString::number(sharedStrings()->saveIndex(cellTable.sharedStringIndex(row, col))));
+		break;
+	case CellTable::NumberSlot:
+		writer.writeAttribute(QStringLiteral("t"), QStringLiteral("n"));
+		writer.writeTextElement(QStringLiteral("v"), QString::number(cellTable.number(row, col), 'g', 15));
+		break;
+	case CellTable::CustomNumberSlot:
+		writer.writeTextElement(QStringLiteral("v"), QString::number(cellTable.number(row, col), 'g', 15));
+		break;
+	default:
+		Q_ASSERT(false);
+		break;
+	}
+
+	writer.writeEndElement(); // c
+}
+
+/*
+  Style used by the cell, row or col; xfIndex is -1 when the cell itself
+  has no format.
+ */
+void WorksheetPrivate::saveXmlCellStyle(QXmlStreamWriter &writer, int row, int col, int xfIndex) const
+{
+    QMap<int, QSharedPointer<XlsxRowInfo> >::ConstIterator rIt;
+    QMap<int, QSharedPointer<XlsxColumnInfo> >::ConstIterator cIt;
+
+	if (xfIndex >= 0)
+		writer.writeAttribute(QStringLiteral("s"), QString::number(xfIndex));
+    else if ((rIt = rowsInfo.constFind(row)) != rowsInfo.constEnd() && !(*rIt)->format.isEmpty())
+        writer.writeAttribute(QStringLiteral("s"), QString::number((*rIt)->format.xfIndex()));
+    else if ((cIt = colsInfoHelper.constFind(col)) != colsInfoHelper.constEnd() && !(*cIt)->format.isEmpty())
+        writer.writeAttribute(QStringLiteral("s"), QString::number((*cIt)->format.xfIndex()));
+}
+
 void WorksheetPrivate::saveXmlMergeCells(QXmlStreamWriter &writer) const
 {
 	if (merges.isEmpty())
@@ -2333,8 +2644,6 @@ int WorksheetPrivate::colPixelsSize(int col) const
 
 void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
 {
-	Q_Q(Worksheet);
-
 	Q_ASSERT(reader.name() == QLatin1String("sheetData"));
 
 	while (!reader.atEnd() && !(reader.name() == QLatin1String("sheetData") && reader.tokenType() == QXmlStreamReader::EndElement))
@@ -2342,209 +2651,266 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
 		if (reader.readNextStartElement())
 		{
 			if (reader.name() == QLatin1String("row"))
-			{
-				QXmlStreamAttributes attributes = reader.attributes();
+				loadXmlRow(reader);
+			else if (reader.name() == QLatin1String("c")) // Cell
+				loadXmlCell(reader);
+		}
+	}
+}
 
-				if (attributes.hasAttribute(QLatin1String("customFormat"))
-						|| attributes.hasAttribute(QLatin1String("customHeight"))
-						|| attributes.hasAttribute(QLatin1String("hidden"))
-						|| attributes.hasAttribute(QLatin1String("outlineLevel"))
-						|| attributes.hasAttribute(QLatin1String("collapsed")))
-				{
+/*
+  Attributes of a <row>; its cells are read by the caller.
+ */
+void WorksheetPrivate::loadXmlRow(QXmlStreamReader &reader)
+{
+	Q_ASSERT(reader.name() == QLatin1String("row"));
 
-					QSharedPointer<XlsxRowInfo> info(new XlsxRowInfo);
-                    if (attributes.hasAttribute(QLatin1String("customFormat")) &&
-                            attributes.hasAttribute(QLatin1String("s")))
-                    {
-						int idx = attributes.value(QLatin1String("s")).toInt();
-						info->format = workbook->styles()->xfFormat(idx);
-					}
+	QXmlStreamAttributes attributes = reader.attributes();
 
-                    if (attributes.hasAttribute(QLatin1String("customHeight")))
-                    {
-						info->customHeight = attributes.value(QLatin1String("customHeight")) == QLatin1String("1");
-						//Row height is only specified when customHeight is set
-                        if(attributes.hasAttribute(QLatin1String("ht")))
-                        {
-							info->height = attributes.value(QLatin1String("ht")).toDouble();
-						}
-					}
+	if (attributes.hasAttribute(QLatin1String("customFormat"))
+			|| attributes.hasAttribute(QLatin1String("customHeight"))
+			|| attributes.hasAttribute(QLatin1String("hidden"))
+			|| attributes.hasAttribute(QLatin1String("outlineLevel"))
+			|| attributes.hasAttribute(QLatin1String("collapsed")))
+	{
 
-					//both "hidden" and "collapsed" default are false
-					info->hidden = attributes.value(QLatin1String("hidden")) == QLatin1String("1");
-					info->collapsed = attributes.value(QLatin1String("collapsed")) == QLatin1String("1");
+		QSharedPointer<XlsxRowInfo> info(new XlsxRowInfo);
+        if (attributes.hasAttribute(QLatin1String("customFormat")) &&
+                attributes.hasAttribute(QLatin1String("s")))
+        {
+			int idx = attributes.value(QLatin1String("s")).toInt();
+			info->format = workbook->styles()->xfFormat(idx);
+		}
 
-					if (attributes.hasAttribute(QLatin1String("outlineLevel")))
-						info->outlineLevel = attributes.value(QLatin1String("outlineLevel")).toInt();
+        if (attributes.hasAttribute(QLatin1String("customHeight")))
+        {
+			info->customHeight = attributes.value(QLatin1String("customHeight")) == QLatin1String("1");
+			//Row height is only specified when customHeight is set
+            if(attributes.hasAttribute(QLatin1String("ht")))
+            {
+				info->height = attributes.value(QLatin1String("ht")).toDouble();
+			}
+		}
 
-					//"r" is optional too.
-                    if (attributes.hasAttribute(QLatin1String("r")))
-                    {
-						int row = attributes.value(QLatin1String("r")).toInt();
-						rowsInfo[row] = info;
-					}
-				}
+		//both "hidden" and "collapsed" default are false
+		info->hidden = attributes.value(QLatin1String("hidden")) == QLatin1String("1");
+		info->collapsed = attributes.value(QLatin1String("collapsed")) == QLatin1String("1");
 
-			}
-			else if (reader.name() == QLatin1String("c")) // Cell
-			{
+		if (attributes.hasAttribute(QLatin1String("outlineLevel")))
+			info->outlineLevel = attributes.value(QLatin1String("outlineLevel")).toInt();
 
-				//Cell
-				QXmlStreamAttributes attributes = reader.attributes();
-				QString r = attributes.value(QLatin1String("r")).toString();
-				CellReference pos(r);
+		//"r" is optional too.
+        if (attributes.hasAttribute(QLatin1String("r")))
+        {
+			int row = attributes.value(QLatin1String("r")).toInt();
+			rowsInfo[row] = info;
+		}
+	}
+}
 
-				//get format
-				Format format;
-				qint32 styleIndex = -1;
-				if (attributes.hasAttribute(QLatin1String("s"))) // Style (defined in the styles.xml file)
-				{
-					//"s" == style index
-					int idx = attributes.value(QLatin1String("s")).toInt();
-					format = workbook->styles()->xfFormat(idx);
-					styleIndex = idx;
-				}
+void WorksheetPrivate::loadXmlCell(QXmlStreamReader &reader)
+{
+	Q_Q(Worksheet);
+	Q_ASSERT(reader.name() == QLatin1String("c"));
 
-                // Cell::CellType cellType = Cell::NumberType;
-                Cell::CellType cellType = Cell::CustomType;
+	//Cell
+	QXmlStreamAttributes attributes = reader.attributes();
+	QString r = attributes.value(QLatin1String("r")).toString();
+	CellReference pos(r);
 
-				if (attributes.hasAttribute(QLatin1String("t"))) // Type
+	//get format
+	Format format;
+	qint32 styleIndex = -1;
+	if (attributes.hasAttribute(QLatin1String("s"))) // Style (defined in the styles.xml file)
+	{
+		//"s" == style index
+		int idx = attributes.value(QLatin1String("s")).toInt();
+		format = workbook->styles()->xfFormat(idx);
+		styleIndex = idx;
+	}
+
+    // Cell::CellType cellType = Cell::NumberType;
+    Cell::CellType cellType = Cell::CustomType;
+
+	if (attributes.hasAttribute(QLatin1String("t"))) // Type
+	{
+		const auto typeString = attributes.value(QLatin1String("t"));
+        if (typeString == QLatin1String("s")) // Shared string
+		{
+			cellType = Cell::SharedStringType;
+		}
+        else if (typeString == QLatin1String("inlineStr")) //  Inline String
+		{
+			cellType = Cell::InlineStringType;
+		}
+        else if (typeString == QLatin1String("str")) // String
+		{
+			cellType = Cell::StringType;
+		}
+        else if (typeString == QLatin1String("b")) // Boolean
+		{
+			cellType = Cell::BooleanType;
+		}
+        else if (typeString == QLatin1String("e")) // Error
+		{
+			cellType = Cell::ErrorType;
+		}
+        else if (typeString == QLatin1String("d")) // Date
+        {
+            cellType = Cell::DateType;
+        }
+        else if (typeString == QLatin1String("n")) // Number
+        {
+            cellType = Cell::NumberType;
+        }
+		else
+		{
+            // custom type
+            cellType = Cell::CustomType;
+		}
+	}
+
+	if (Cell::isDateType(cellType, format))
+	{
+		cellType = Cell::DateType;
+	}
+
+	// The Cell object is only created when the value cannot be kept
+	// in the dense part of cellTable
+	CellFormula formula;
+	QVariant cellValue;
+	RichString richString;
+	int sstIndex = -1;
+
+    while (!reader.atEnd() &&
+           !(reader.name() == QLatin1String("c") &&
+             reader.tokenType() == QXmlStreamReader::EndElement))
+	{
+		if (reader.readNextStartElement())
+		{
+            if (reader.name() == QLatin1String("f")) // formula
+			{
+				formula.loadFromXml(reader);
+                if (formula.formulaType() == CellFormula::SharedType &&
+                        !formula.formulaText().isEmpty())
 				{
-					const auto typeString = attributes.value(QLatin1String("t"));
-                    if (typeString == QLatin1String("s")) // Shared string
-					{
-						cellType = Cell::SharedStringType;
-					}
-                    else if (typeString == QLatin1String("inlineStr")) //  Inline String
-					{
-						cellType = Cell::InlineStringType;
-					}
-                    else if (typeString == QLatin1String("str")) // String
-					{
-						cellType = Cell::StringType;
-					}
-                    else if (typeString == QLatin1String("b")) // Boolean
-					{
-						cellType = Cell::BooleanType;
-					}
-                    else if (typeString == QLatin1String("e")) // Error
-					{
-						cellType = Cell::ErrorType;
+                    int si = formula.sharedIndex();
+                    sharedFormulaMap[ si ] = formula;
+				}
+			}
+			else if (reader.name() == QLatin1String("v")) // Value
+			{
+				QString value = reader.readElementText();
+				if (cellType == Cell::SharedStringType)
+				{
+					int sst_idx = value.toInt();
+					sstIndex = sst_idx;
+					if (sharedStringLoad == LoadSharedStrings) {
+						sharedStrings()->incRefByStringIndex(sst_idx);
+					} else if (sst_idx >= 0) {
+						if (sst_idx >= sharedStringRefs.size())
+							sharedStringRefs.resize(sst_idx + 1);
+						++sharedStringRefs[sst_idx];
 					}
-                    else if (typeString == QLatin1String("d")) // Date
-                    {
-                        cellType = Cell::DateType;
-                    }
-                    else if (typeString == QLatin1String("n")) // Number
-                    {
-                        cellType = Cell::NumberType;
-                    }
-					else
-					{
-                        // custom type
-                        cellType = Cell::CustomType;
+
+					if (sharedStringLoad == DeferSharedStrings) {
+						// resolveSharedStrings() fills in the text
+						cellValue = sst_idx;
+					} else {
+						RichString rs = sharedStrings()->getSharedString(sst_idx);
+						QString strPlainString = rs.toPlainString();
+						cellValue = strPlainString;
+						if (rs.isRichString())
+							richString = rs;
 					}
 				}
-
-				if (Cell::isDateType(cellType, format))
+				else if (cellType == Cell::NumberType)
+				{
+					cellValue = value.toDouble();
+				}
+				else if (cellType == Cell::BooleanType)
 				{
-					cellType = Cell::DateType;
+					cellValue = value.toInt() ? true : false;
 				}
+                else  if (cellType == Cell::DateType)
+                {
+                    // [dev54] DateType
+
+                    double dValue = value.toDouble(); // days from 1900(or 1904)
+                    bool bIsDate1904 = q->workbook()->isDate1904();
 
-				// create a heap of new cell
-                auto cell = std::make_shared<Cell>(QVariant{}, cellType, format, q, styleIndex);
+                    QVariant vDatetimeValue = datetimeFromNumber( dValue, bIsDate1904 );
+                    Q_UNUSED(vDatetimeValue);
+                    // cellValue = vDatetimeValue;
+                    cellValue = dValue; // dev67
+                }
+				else
+                {
+                    // ELSE type
+					cellValue = value;
+				}
 
+            }
+            else if (reader.name() == QLatin1String("is"))
+            {
                 while (!reader.atEnd() &&
-                       !(reader.name() == QLatin1String("c") &&
-                         reader.tokenType() == QXmlStreamReader::EndElement))
-				{
-					if (reader.readNextStartElement())
-					{
-                        if (reader.name() == QLatin1String("f")) // formula
-						{
-							CellFormula &formula = cell->d_func()->formula;
-							formula.loadFromXml(reader);
-                            if (formula.formulaType() == CellFormula::SharedType &&
-                                    !formula.formulaText().isEmpty())
-							{
-                                int si = formula.sharedIndex();
-                                sharedFormulaMap[ si ] = formula;
-							}
-						}
-						else if (reader.name() == QLatin1String("v")) // Value
-						{
-							QString value = reader.readElementText();
-							if (cellType == Cell::SharedStringType)
-							{
-								int sst_idx = value.toInt();
-								sharedStrings()->incRefByStringIndex(sst_idx);
-								RichString rs = sharedStrings()->getSharedString(sst_idx);
-								QString strPlainString = rs.toPlainString();
-								cell->d_func()->value = strPlainString;
-								if (rs.isRichString())
-									cell->d_func()->richString = rs;
-							}
-							else if (cellType == Cell::NumberType)
-							{
-								cell->d_func()->value = value.toDouble();
-							}
-							else if (cellType == Cell::BooleanType)
-							{
-								cell->d_func()->value = value.toInt() ? true : false;
-							}
-                            else  if (cellType == Cell::DateType)
-                            {
-                                // [dev54] DateType
-
-                                double dValue = value.toDouble(); // days from 1900(or 1904)
-                                bool bIsDate1904 = q->workbook()->isDate1904();
-
-                                QVariant vDatetimeValue = datetimeFromNumber( dValue, bIsDate1904 );
-                                Q_UNUSED(vDatetimeValue);
-                                // cell->d_func()->value = vDatetimeValue;
-                                cell->d_func()->value = dValue; // dev67
-                            }
-							else
-                            {
-                                // ELSE type
-								cell->d_func()->value = value;
-							}
-
-                        }
-                        else if (reader.name() == QLatin1String("is"))
-                        {
-                            while (!reader.atEnd() &&
-                                   !(reader.name() == QLatin1String("is") &&
-                                   reader.tokenType() == QXmlStreamReader::EndElement))
-                            {
-                                if (reader.readNextStartElement())
-                                {
-									//:Todo, add rich text read support
-                                    if (reader.name() == QLatin1String("t"))
-                                    {
-										cell->d_func()->value = reader.readElementText();
-									}
-								}
-							}
-                        }
-                        else if (reader.name() == QLatin1String("extLst"))
+                       !(reader.name() == QLatin1String("is") &&
+                       reader.tokenType() == QXmlStreamReader::EndElement))
+                {
+                    if (reader.readNextStartElement())
+                    {
+						//:Todo, add rich text read support
+                        if (reader.name() == QLatin1String("t"))
                         {
-							//skip extLst element
-                            while ( !reader.atEnd() &&
-                                    !(reader.name() == QLatin1String("extLst") &&
-                                    reader.tokenType() == QXmlStreamReader::EndElement))
-                            {
-								reader.readNextStartElement();
-							}
+							cellValue = reader.readElementText();
 						}
 					}
 				}
-
-                cellTable[ pos.row() ][ pos.column() ] = cell;
-
+            }
+            else if (reader.name() == QLatin1String("extLst"))
+            {
+				//skip extLst element
+                while ( !reader.atEnd() &&
+                        !(reader.name() == QLatin1String("extLst") &&
+                        reader.tokenType() == QXmlStreamReader::EndElement))
+                {
+					reader.readNextStartElement();
+				}
 			}
 		}
 	}
+
+	const int xfIndex = format.isEmpty() ? -1 : format.xfIndex();
+	if (!formula.isValid() && cellValue.isValid())
+	{
+		bool stored = false;
+		if (cellType == Cell::SharedStringType && !richString.isRichString())
+		{
+			stored = cellTable.setSharedString(pos.row(), pos.column(), sstIndex, xfIndex);
+		}
+		else if (cellType == Cell::NumberType)
+		{
+			stored = cellTable.setNumber(pos.row(), pos.column(), cellValue.toDouble(), xfIndex);
+		}
+		else if (cellType == Cell::CustomType)
+		{
+			// only when the text survives the round trip through double
+			bool ok = false;
+			const QString text = cellValue.toString();
+			const double number = text.toDouble(&ok);
+			if (ok && QString::number(number, 'g', QLocale::FloatingPointShortest) == text)
+				stored = cellTable.setNumber(pos.row(), pos.column(), number, xfIndex, true);
+		}
+		if (stored)
+			return;
+	}
+
+	auto cell = std::make_shared<Cell>(cellValue, cellType, format, q, styleIndex);
+	cell->d_func()->formula = formula;
+	cell->d_func()->richString = richString;
+    cellTable.setCell(pos.row(), pos.column(), cell);
+	if (cellType == Cell::SharedStringType && sharedStringLoad == DeferSharedStrings)
+		pendingSharedStringCells.append(cell);
 }
 
 void WorksheetPrivate::loadXmlColumnsInfo(QXmlStreamReader &reader)
@@ -2969,40 +3335,93 @@ bool Worksheet::loadFromXmlFile(QIODevice *device)
 	return true;
 }
 
+/*!
+ * \internal
+ * <sheetData>, the bulk of the part, is read from the raw bytes by
+ * SheetDataParser; the rest of the part goes through loadFromXmlFile().
+ */
+bool Worksheet::loadFromXmlData(const QByteArray &data)
+{
+	Q_D(Worksheet);
+
+	int begin = 0;
+	int end = 0;
+	if (!SheetDataParser::locate(data, &begin, &end))
+		return AbstractSheet::loadFromXmlData(data);
+
+	SheetDataParser parser(d);
+	parser.parse(data.constData() + begin, data.constData() + end);
+
+	QByteArray rest = data.left(begin);
+	rest.append(data.constData() + end, data.size() - end);
+	return AbstractSheet::loadFromXmlData(rest);
+}
+
 /*
  *  Documents imported from Google Docs does not contain dimension data.
  */
 void WorksheetPrivate::validateDimension()
 {
+	Q_Q(const Worksheet);
+
 	if (dimension.isValid() || cellTable.isEmpty())
 		return;
 
-	const auto firstRow = cellTable.constBegin().key();
-
-    const auto lastRow = (--cellTable.constEnd()).key();
+	CellRange cr = q->usedRange();
 
-	int firstColumn = -1;
-	int lastColumn = -1;
+	if (cr.isValid())
+		dimension = cr;
+}
 
-    for ( auto&& it = cellTable.constBegin()
-            ; it != cellTable.constEnd()
-            ; ++it )
-    {
-        Q_ASSERT(!it.value().isEmpty());
+/*
+  Called by the parallel package loader on its own thread once sharedStrings.xml
+  is loaded: adds the references counted by loadXmlSheetData() and, after a
+  DeferSharedStrings load, fills in the text of the shared string cells.
+ */
+void WorksheetPrivate::resolveSharedStrings()
+{
+	SharedStrings *sst = sharedStrings();
+	for (int i = 0; i < sharedStringRefs.size(); ++i)
+		sst->incRefByStringIndex(i, sharedStringRefs.at(i));
 
-        if (firstColumn == -1 || it.value().constBegin().key() < firstColumn)
-            firstColumn = it.value().constBegin().key();
+	if (sharedStringLoad == DeferSharedStrings)
+	{
+		// Rich strings cannot stay in the dense part of cellTable
+		QVector<bool> rich(sharedStringRefs.size(), false);
+		bool hasRich = false;
+		for (int i = 0; i < sharedStringRefs.size(); ++i)
+		{
+			if (sharedStringRefs.at(i) && sst->getSharedString(i).isRichString())
+				rich[i] = hasRich = true;
+		}
 
-        if (lastColumn == -1 || (--it.value().constEnd()).key() > lastColumn)
-        {
-            lastColumn = (--it.value().constEnd()).key();
-        }
-    }
+		if (hasRich)
+		{
+			for (int row = cellTable.firstRow(); row != -1; row = cellTable.nextRow(row))
+			{
+				for (int col = cellTable.firstColumn(row); col != -1; col = cellTable.nextColumn(row, col))
+				{
+					if (cellTable.slotType(row, col) != CellTable::SharedStringSlot)
+						continue;
+					const int idx = cellTable.sharedStringIndex(row, col);
+					if (idx >= 0 && idx < rich.size() && rich.at(idx))
+						cellAt(row, col)->d_ptr->richString = sst->getSharedString(idx);
+				}
+			}
+		}
 
-	CellRange cr(firstRow, firstColumn, lastRow, lastColumn);
+		for (const auto &cell : pendingSharedStringCells)
+		{
+			const RichString rs = sst->getSharedString(cell->d_ptr->value.toInt());
+			cell->d_ptr->value = rs.toPlainString();
+			if (rs.isRichString())
+				cell->d_ptr->richString = rs;
+		}
+	}
 
-	if (cr.isValid())
-		dimension = cr;
+	sharedStringRefs.clear();
+	pendingSharedStringCells.clear();
+	sharedStringLoad = LoadSharedStrings;
 }
 
 /*!
@@ -3041,21 +3460,11 @@ QVector<CellLocation> Worksheet::getFullCells(int* maxRow, int* maxCol)
         return ret;
     }
 
-    QMapIterator< int, QMap< int, std::shared_ptr<Cell> > > _it( d->cellTable );
-
-    while ( _it.hasNext() )
+    for (int keyI = d->cellTable.firstRow(); keyI != -1; keyI = d->cellTable.nextRow(keyI)) // cell row
     {
-        _it.next();
-
-        int keyI = _it.key(); // key (cell row)
-        QMapIterator<int, std::shared_ptr<Cell> > _iit( _it.value() ); // value
-
-        while ( _iit.hasNext() )
+        for (int keyII = d->cellTable.firstColumn(keyI); keyII != -1; keyII = d->cellTable.nextColumn(keyI, keyII)) // cell column
         {
-            _iit.next();
-
-            int keyII = _iit.key(); // key (cell column)
-            std::shared_ptr<Cell> ptrCell = _iit.value(); // value
+            std::shared_ptr<Cell> ptrCell = d->cellAt(keyI, keyII); // value
 
             CellLocation cl;
 
@@ -2,19 +2,70 @@
 
 #include "xlsxzipreader_p.h"
 
-#include <private/qzipreader_p.h>
+#include <QtGlobal>
+#include <QtEndian>
+#include <QFile>
+#include <QBuffer>
+#include <QDebug>
+
+#include <cstring>
+
+#include "zlib.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
+namespace {
+
+const quint32 LocalHeaderSignature = 0x04034b50;
+const quint32 CentralHeaderSignature = 0x02014b50;
+const quint32 EndOfCentralDirSignature = 0x06054b50;
+const quint32 Zip64EndOfCentralDirSignature = 0x06064b50;
+const quint32 Zip64LocatorSignature = 0x07064b50;
+
+const int LocalHeaderSize = 30;
+const int CentralHeaderSize = 46;
+const int EndOfCentralDirSize = 22;
+const int InputChunkSize = 64 * 1024;
+
+inline quint16 readU16(const char *p)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(p));
+}
+
+inline quint32 readU32(const char *p)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(p));
+}
+
+inline quint64 readU64(const char *p)
+{
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(p));
+}
+
+} // namespace
+
 ZipReader::ZipReader(const QString &filePath) :
-    m_reader(new QZipReader(filePath))
+    m_ownedDevice(new QFile(filePath)), m_exists(false)
 {
+    m_device = m_ownedDevice.data();
+    m_device->open(QIODevice::ReadOnly);
     init();
 }
 
 ZipReader::ZipReader(QIODevice *device) :
-    m_reader(new QZipReader(device))
+    m_device(device), m_exists(false)
+{
+    init();
+}
+
+ZipReader::ZipReader(const QByteArray &data) :
+    m_exists(false)
 {
+    QBuffer *buffer = new QBuffer;
+    buffer->setData(data);
+    buffer->open(QIODevice::ReadOnly);
+    m_ownedDevice.reset(buffer);
+    m_device = buffer;
     init();
 }
 
@@ -25,16 +76,142 @@ ZipReader::~ZipReader()
 
 void ZipReader::init()
 {
-    const auto& allFiles = m_reader->fileInfoList();
-    for (const auto &fi : allFiles) {
-        if (fi.isFile || (!fi.isDir && !fi.isFile && !fi.isSymLink))
-            m_filePaths.append(fi.filePath);
+    if (!m_device || !m_device->isOpen() || !m_device->isReadable())
+        return;
+    m_exists = readCentralDirectory();
+    if (!m_exists) {
+        m_entries.clear();
+        m_entryIndex.clear();
+        return;
     }
+
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const ZipEntry &entry = m_entries.at(i);
+        if (entry.name.endsWith(QLatin1Char('/')))
+            continue; // directory
+        m_entryIndex.insert(entry.name, i);
+        m_filePaths.append(entry.name);
+    }
+}
+
+bool ZipReader::readAt(qint64 pos, char *data, qint64 size) const
+{
+    return m_device->seek(pos) && m_device->read(data, size) == size;
+}
+
+/*
+   Finds the end of central directory record in the last 64K of the
+   package and reads all entries of the central directory, with the zip64
+   extensions for sizes and offsets above 4 GB.
+ */
+bool ZipReader::readCentralDirectory()
+{
+    const qint64 deviceSize = m_device->size();
+    if (deviceSize < EndOfCentralDirSize)
+        return false;
+
+    const qint64 tailSize = qMin<qint64>(deviceSize, EndOfCentralDirSize + 0xffff);
+    QByteArray tail(int(tailSize), Qt::Uninitialized);
+    if (!readAt(deviceSize - tailSize, tail.data(), tailSize))
+        return false;
+
+    int eocd = -1;
+    for (int i = int(tailSize) - EndOfCentralDirSize; i >= 0; --i) {
+        if (readU32(tail.constData() + i) == EndOfCentralDirSignature) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd == -1)
+        return false;
+
+    const char *e = tail.constData() + eocd;
+    quint64 entryCount = readU16(e + 10);
+    quint64 directorySize = readU32(e + 12);
+    quint64 directoryOffset = readU32(e + 16);
+
+    if (entryCount == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff) {
+        const qint64 locatorPos = deviceSize - tailSize + eocd - 20;
+        char locator[20];
+        if (locatorPos < 0 || !readAt(locatorPos, locator, 20) || readU32(locator) != Zip64LocatorSignature)
+            return false;
+        char record[56];
+        if (!readAt(qint64(readU64(locator + 8)), record, 56) || readU32(record) != Zip64EndOfCentralDirSignature)
+            return false;
+        entryCount = readU64(record + 32);
+        directorySize = readU64(record + 40);
+        directoryOffset = readU64(record + 48);
+    }
+
+    if (directoryOffset + directorySize > quint64(deviceSize) || directorySize > 0x7fffffff)
+        return false;
+
+    QByteArray directory(int(directorySize), Qt::Uninitialized);
+    if (!readAt(qint64(directoryOffset), directory.data(), qint64(directorySize)))
+        return false;
+
+    m_entries.reserve(int(qMin<quint64>(entryCount, directorySize / CentralHeaderSize)));
+    const char *p = directory.constData();
+    const char *end = p + directory.size();
+    for (quint64 n = 0; n < entryCount; ++n) {
+        if (end - p < CentralHeaderSize || readU32(p) != CentralHeaderSignature)
+            return false;
+
+        const int nameLength = readU16(p + 28);
+        const int extraLength = readU16(p + 30);
+        const int commentLength = readU16(p + 32);
+        if (end - p < CentralHeaderSize + nameLength + extraLength + commentLength)
+            return false;
+
+        ZipEntry entry;
+        entry.flags = readU16(p + 8);
+        entry.method = readU16(p + 10);
+        entry.crc = readU32(p + 16);
+        entry.compressedSize = readU32(p + 20);
+        entry.uncompressedSize = readU32(p + 24);
+        entry.localHeaderOffset = readU32(p + 42);
+
+        const char *name = p + CentralHeaderSize;
+        if (entry.flags & 0x0800) // language encoding flag
+            entry.name = QString::fromUtf8(name, nameLength);
+        else
+            entry.name = QString::fromLocal8Bit(name, nameLength);
+
+        // zip64 extra field: the values that did not fit, in this order
+        const char *extra = name + nameLength;
+        const char *extraEnd = extra + extraLength;
+        while (extraEnd - extra >= 4) {
+            const quint16 id = readU16(extra);
+            const quint16 size = readU16(extra + 2);
+            const char *field = extra + 4;
+            if (extraEnd - field < size)
+                break;
+            if (id == 0x0001) {
+                const char *fieldEnd = field + size;
+                if (entry.uncompressedSize == 0xffffffff && fieldEnd - field >= 8) {
+                    entry.uncompressedSize = qint64(readU64(field));
+                    field += 8;
+                }
+                if (entry.compressedSize == 0xffffffff && fieldEnd - field >= 8) {
+                    entry.compressedSize = qint64(readU64(field));
+                    field += 8;
+                }
+                if (entry.localHeaderOffset == 0xffffffff && fieldEnd - field >= 8)
+                    entry.localHeaderOffset = qint64(readU64(field));
+                break;
+            }
+            extra = field + size;
+        }
+
+        m_entries.append(entry);
+        p += CentralHeaderSize + nameLength + extraLength + commentLength;
+    }
+    return true;
 }
 
 bool ZipReader::exists() const
 {
-    return m_reader->exists();
+    return m_exists;
 }
 
 QStringList ZipReader::filePaths() const
@@ -44,7 +221,199 @@ QStringList ZipReader::filePaths() const
 
 QByteArray ZipReader::fileData(const QString &fileName) const
 {
-    return m_reader->fileData(fileName);
+    QScopedPointer<QIODevice> file(openFile(fileName));
+    if (!file)
+        return QByteArray();
+
+    // The central directory gives the size, inflate straight into the result
+    const qint64 size = file->size();
+    if (size <= 0 || size > 0x7fffffff)
+        return file->readAll();
+
+    QByteArray data(int(size), Qt::Uninitialized);
+    qint64 done = 0;
+    while (done < size) {
+        const qint64 n = file->read(data.data() + done, size - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    if (done != size)
+        data.resize(int(done));
+    return data;
+}
+
+QIODevice *ZipReader::openFile(const QString &fileName) const
+{
+    auto it = m_entryIndex.constFind(fileName);
+    if (it == m_entryIndex.constEnd())
+        return nullptr;
+
+    const ZipEntry &entry = m_entries.at(it.value());
+    if (entry.method != 0 && entry.method != Z_DEFLATED) {
+        qWarning("QXlsx::ZipReader: unsupported compression method %d", entry.method);
+        return nullptr;
+    }
+    if (entry.flags & 0x0001) {
+        qWarning("QXlsx::ZipReader: encrypted entries are not supported");
+        return nullptr;
+    }
+
+    ZipEntryReader *reader = new ZipEntryReader(this, entry);
+    reader->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    return reader;
+}
+
+struct ZipInflateState
+{
+    ZipInflateState() : initialized(false)
+    {
+        memset(&stream, 0, sizeof(stream));
+    }
+    ~ZipInflateState()
+    {
+        if (initialized)
+            inflateEnd(&stream);
+    }
+
+    z_stream stream;
+    bool initialized;
+};
+
+ZipEntryReader::ZipEntryReader(const ZipReader *zip, const ZipEntry &entry) :
+    m_zip(zip), m_entry(entry), m_sourcePos(-1), m_compressedLeft(entry.compressedSize),
+    m_produced(0), m_crc(crc32(0L, Z_NULL, 0)), m_finished(false), m_state(new ZipInflateState)
+{
+}
+
+ZipEntryReader::~ZipEntryReader()
+{
+
+}
+
+bool ZipEntryReader::isSequential() const
+{
+    return true;
+}
+
+qint64 ZipEntryReader::size() const
+{
+    return m_entry.uncompressedSize;
+}
+
+qint64 ZipEntryReader::bytesAvailable() const
+{
+    return qMax<qint64>(0, m_entry.uncompressedSize - m_produced) + QIODevice::bytesAvailable();
+}
+
+bool ZipEntryReader::atEnd() const
+{
+    return m_finished && QIODevice::bytesAvailable() == 0;
+}
+
+/*
+   Finds the entry data behind the local header. The name and extra field
+   lengths of the local header may differ from the central directory.
+ */
+bool ZipEntryReader::locateData()
+{
+    if (m_sourcePos != -1)
+        return true;
+
+    char header[LocalHeaderSize];
+    if (!m_zip->readAt(m_entry.localHeaderOffset, header, LocalHeaderSize)
+            || readU32(header) != LocalHeaderSignature) {
+        setErrorString(QStringLiteral("Invalid local header of %1").arg(m_entry.name));
+        return false;
+    }
+    m_sourcePos = m_entry.localHeaderOffset + LocalHeaderSize + readU16(header + 26) + readU16(header + 28);
+    return true;
+}
+
+// Reads the next chunk of compressed data into m_input
+bool ZipEntryReader::fillInput()
+{
+    if (!locateData())
+        return false;
+
+    const qint64 chunk = qMin<qint64>(m_compressedLeft, InputChunkSize);
+    m_input.resize(int(chunk));
+    if (chunk > 0 && !m_zip->readAt(m_sourcePos, m_input.data(), chunk)) {
+        setErrorString(QStringLiteral("Cannot read %1").arg(m_entry.name));
+        return false;
+    }
+    m_sourcePos += chunk;
+    m_compressedLeft -= chunk;
+    return true;
+}
+
+qint64 ZipEntryReader::readData(char *data, qint64 maxSize)
+{
+    if (m_finished || maxSize <= 0)
+        return m_finished ? -1 : 0;
+
+    qint64 produced = 0;
+    if (m_entry.method == 0) {
+        // stored, read straight into the caller's buffer
+        if (!locateData())
+            return -1;
+        produced = qMin(maxSize, m_compressedLeft);
+        if (produced > 0 && !m_zip->readAt(m_sourcePos, data, produced)) {
+            setErrorString(QStringLiteral("Cannot read %1").arg(m_entry.name));
+            return -1;
+        }
+        m_sourcePos += produced;
+        m_compressedLeft -= produced;
+        if (m_compressedLeft == 0)
+            m_finished = true;
+    } else {
+        z_stream &stream = m_state->stream;
+        if (!m_state->initialized) {
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+                setErrorString(QStringLiteral("Cannot inflate %1").arg(m_entry.name));
+                return -1;
+            }
+            m_state->initialized = true;
+        }
+
+        while (produced < maxSize && !m_finished) {
+            if (stream.avail_in == 0) {
+                if (m_compressedLeft == 0) {
+                    setErrorString(QStringLiteral("Truncated entry %1").arg(m_entry.name));
+                    return produced > 0 ? produced : -1;
+                }
+                if (!fillInput())
+                    return -1;
+                stream.next_in = reinterpret_cast<Bytef *>(m_input.data());
+                stream.avail_in = uInt(m_input.size());
+            }
+
+            stream.next_out = reinterpret_cast<Bytef *>(data + produced);
+            stream.avail_out = uInt(qMin<qint64>(maxSize - produced, 0x40000000));
+            const uInt before = stream.avail_out;
+            const int ret = inflate(&stream, Z_NO_FLUSH);
+            produced += before - stream.avail_out;
+            if (ret == Z_STREAM_END) {
+                m_finished = true;
+            } else if (ret != Z_OK && !(ret == Z_BUF_ERROR && stream.avail_in == 0)) {
+                setErrorString(QStringLiteral("Corrupt data in %1").arg(m_entry.name));
+                return produced > 0 ? produced : -1;
+            }
+        }
+    }
+
+    m_crc = crc32(m_crc, reinterpret_cast<const Bytef *>(data), uInt(produced));
+    m_produced += produced;
+    if (m_finished && (m_crc != m_entry.crc || m_produced != m_entry.uncompressedSize))
+        qWarning() << "QXlsx::ZipReader: checksum mismatch in" << m_entry.name;
+    return produced;
+}
+
+qint64 ZipEntryReader::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
 }
 
 QT_END_NAMESPACE_XLSX
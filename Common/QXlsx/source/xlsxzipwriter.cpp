@@ -3,46 +3,512 @@
 #include "xlsxzipwriter_p.h"
 
 #include <QtGlobal>
+#include <QtEndian>
 #include <QDebug>
-#include <private/qzipwriter_p.h>
+#include <QFile>
+#include <QDateTime>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <cstring>
+
+#include "zlib.h"
 
 QT_BEGIN_NAMESPACE_XLSX
 
-ZipWriter::ZipWriter(const QString &filePath)
+namespace {
+
+const quint32 LocalHeaderSignature = 0x04034b50;
+const quint32 CentralHeaderSignature = 0x02014b50;
+const quint32 EndOfCentralDirSignature = 0x06054b50;
+const quint32 DataDescriptorSignature = 0x08074b50;
+
+const int ChunkSize = 64 * 1024;
+// Input of one parallel deflate block; smaller blocks lose ratio, as every
+// block only sees the last 32K of its predecessor
+const int BlockSize = 1024 * 1024;
+const int DictionarySize = 32 * 1024;
+
+inline void putU16(QByteArray &bytes, quint16 value)
 {
-    m_writer = new QZipWriter(filePath, QIODevice::WriteOnly);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    uchar buffer[2];
+    qToLittleEndian(value, buffer);
+    bytes.append(reinterpret_cast<const char *>(buffer), 2);
 }
 
-ZipWriter::ZipWriter(QIODevice *device)
+inline void putU32(QByteArray &bytes, quint32 value)
 {
-    m_writer = new QZipWriter(device);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    uchar buffer[4];
+    qToLittleEndian(value, buffer);
+    bytes.append(reinterpret_cast<const char *>(buffer), 4);
+}
+
+inline bool isAscii(const QByteArray &bytes)
+{
+    for (char c : bytes) {
+        if (uchar(c) > 0x7f)
+            return false;
+    }
+    return true;
+}
+
+/*
+   Deflates one block of a parallel entry into a raw deflate fragment.
+   Every block but the last ends with a sync flush, so the fragments can be
+   concatenated; the last one finishes the stream. Priming each block with
+   the tail of the previous one keeps the ratio close to a serial deflate.
+ */
+class DeflateBlockTask : public QRunnable
+{
+public:
+    DeflateBlockTask(int level, const char *input, int size, const char *dictionary, int dictionarySize, bool last) :
+        m_level(level), m_input(input), m_size(size),
+        m_dictionary(dictionary), m_dictionarySize(dictionarySize), m_last(last),
+        crc(0), ok(false)
+    {
+        setAutoDelete(false);
+    }
+
+    int inputSize() const
+    {
+        return m_size;
+    }
+
+    void run() override
+    {
+        crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(m_input), uInt(m_size));
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, m_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return;
+        if (m_dictionarySize > 0)
+            deflateSetDictionary(&stream, reinterpret_cast<const Bytef *>(m_dictionary), uInt(m_dictionarySize));
+
+        output.resize(int(deflateBound(&stream, uLong(m_size))) + 16);
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(m_input));
+        stream.avail_in = uInt(m_size);
+        int produced = 0;
+        int ret;
+        for (;;) {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data() + produced);
+            stream.avail_out = uInt(output.size() - produced);
+            ret = deflate(&stream, m_last ? Z_FINISH : Z_SYNC_FLUSH);
+            produced = output.size() - int(stream.avail_out);
+            if (stream.avail_out != 0 || ret == Z_STREAM_END || (ret != Z_OK && ret != Z_BUF_ERROR))
+                break;
+            output.resize(output.size() * 2);
+        }
+        output.resize(produced);
+        deflateEnd(&stream);
+
+        ok = m_last ? ret == Z_STREAM_END : (ret == Z_OK && stream.avail_in == 0);
+    }
+
+private:
+    int m_level;
+    const char *m_input;
+    int m_size;
+    const char *m_dictionary;
+    int m_dictionarySize;
+    bool m_last;
+
+public:
+    QByteArray output;
+    uLong crc;
+    bool ok;
+};
+
+// Modification time of all entries
+void currentDosTime(quint16 *time, quint16 *date)
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    *time = quint16((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+    *date = quint16(((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day());
+}
+
+} // namespace
+
+ZipWriter::ZipWriter(const QString &filePath) :
+    m_ownedDevice(new QFile(filePath)),
+    m_level(Z_DEFAULT_COMPRESSION), m_threads(1), m_startPos(0), m_offset(0), m_error(false), m_closed(false)
+{
+    m_device = m_ownedDevice.data();
+    if (!m_device->open(QIODevice::WriteOnly))
+        m_error = true;
+
+    currentDosTime(&m_dosTime, &m_dosDate);
+}
+
+ZipWriter::ZipWriter(QIODevice *device) :
+    m_device(device),
+    m_level(Z_DEFAULT_COMPRESSION), m_threads(1), m_startPos(0), m_offset(0), m_error(false), m_closed(false)
+{
+    if (!m_device || !m_device->isWritable())
+        m_error = true;
+    else if (!m_device->isSequential())
+        m_startPos = m_device->pos();
+
+    currentDosTime(&m_dosTime, &m_dosDate);
 }
 
 ZipWriter::~ZipWriter()
 {
-    delete m_writer;
+    close();
+}
+
+void ZipWriter::setCompressionLevel(int level)
+{
+    m_level = qBound(-1, level, 9);
+}
+
+int ZipWriter::compressionLevel() const
+{
+    return m_level;
+}
+
+void ZipWriter::setCompressionThreads(int threads)
+{
+    m_threads = qMax(1, threads);
+}
+
+int ZipWriter::compressionThreads() const
+{
+    return m_threads;
 }
 
 bool ZipWriter::error() const
 {
-    return m_writer->status() != QZipWriter::NoError;
+    return m_error;
 }
 
 void ZipWriter::addFile(const QString &filePath, QIODevice *device)
 {
-    m_writer->addFile(filePath, device);
+    if (!device->isOpen() && !device->open(QIODevice::ReadOnly)) {
+        qWarning() << "QXlsx::ZipWriter: cannot open" << filePath;
+        m_error = true;
+        return;
+    }
+    addEntry(filePath, device, nullptr);
 }
 
 void ZipWriter::addFile(const QString &filePath, const QByteArray &data)
 {
-    m_writer->addFile(filePath, data);
+    addEntry(filePath, nullptr, &data);
 }
 
+bool ZipWriter::write(const char *bytes, qint64 size)
+{
+    if (m_error)
+        return false;
+    if (m_device->write(bytes, size) != size) {
+        m_error = true;
+        return false;
+    }
+    m_offset += size;
+    return true;
+}
+
+bool ZipWriter::write(const QByteArray &bytes)
+{
+    return write(bytes.constData(), bytes.size());
+}
+
+// Reads \a size bytes, fewer only at the end of \a device
+qint64 ZipWriter::readInput(QIODevice *device, char *buffer, qint64 size)
+{
+    qint64 done = 0;
+    while (done < size) {
+        const qint64 n = device->read(buffer + done, size - done);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+/*
+   Writes one entry. Deflated entries are streamed: the local header goes
+   out first and gets the checksum and sizes patched in afterwards, or, on
+   sequential devices, a data descriptor behind the data.
+ */
+void ZipWriter::addEntry(const QString &filePath, QIODevice *device, const QByteArray *data)
+{
+    if (m_error || m_closed)
+        return;
+
+    QByteArray storedData;
+    if (m_level == 0 && device) {
+        // stored entries need their size up front
+        storedData = device->readAll();
+        data = &storedData;
+        device = nullptr;
+    }
+
+    Entry entry;
+    entry.name = filePath.toUtf8();
+    entry.flags = isAscii(entry.name) ? 0 : 0x0800; // language encoding flag
+    entry.method = m_level == 0 ? 0 : Z_DEFLATED;
+    entry.crc = 0;
+    entry.compressedSize = 0;
+    entry.uncompressedSize = 0;
+    entry.localHeaderOffset = quint32(m_offset);
+
+    const bool patchHeader = !m_device->isSequential();
+    if (entry.method == Z_DEFLATED && !patchHeader)
+        entry.flags |= 0x0008; // data descriptor
+    if (entry.method == 0) {
+        entry.crc = quint32(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(data->constData()), uInt(data->size())));
+        entry.compressedSize = entry.uncompressedSize = quint32(data->size());
+    }
+
+    if (m_offset > 0xffffffffLL || (data && data->size() > 0x7fffffff)) {
+        qWarning("QXlsx::ZipWriter: packages above 4 GB are not supported");
+        m_error = true;
+        return;
+    }
+
+    QByteArray header;
+    header.reserve(30 + entry.name.size());
+    putU32(header, LocalHeaderSignature);
+    putU16(header, 20); // version needed to extract
+    putU16(header, entry.flags);
+    putU16(header, entry.method);
+    putU16(header, m_dosTime);
+    putU16(header, m_dosDate);
+    putU32(header, entry.crc);
+    putU32(header, entry.compressedSize);
+    putU32(header, entry.uncompressedSize);
+    putU16(header, quint16(entry.name.size()));
+    putU16(header, 0); // extra field length
+    header.append(entry.name);
+    if (!write(header))
+        return;
+
+    if (entry.method == 0) {
+        write(*data);
+    } else {
+        qint64 inputSize = -1;
+        if (data)
+            inputSize = data->size();
+        else if (!device->isSequential())
+            inputSize = device->size() - device->pos();
+
+        bool ok;
+        if (m_threads > 1 && (inputSize == -1 || inputSize > BlockSize))
+            ok = deflateParallel(entry, device, data);
+        else
+            ok = deflateSerial(entry, device, data);
+        if (!ok) {
+            m_error = true;
+            return;
+        }
+
+        QByteArray trailer;
+        putU32(trailer, entry.crc);
+        putU32(trailer, entry.compressedSize);
+        putU32(trailer, entry.uncompressedSize);
+        if (patchHeader) {
+            if (!m_device->seek(m_startPos + entry.localHeaderOffset + 14) || m_device->write(trailer) != trailer.size()
+                    || !m_device->seek(m_startPos + m_offset)) {
+                m_error = true;
+                return;
+            }
+        } else {
+            trailer.prepend(QByteArray(4, '\0'));
+            qToLittleEndian(DataDescriptorSignature, reinterpret_cast<uchar *>(trailer.data()));
+            write(trailer);
+        }
+    }
+
+    if (!m_error)
+        m_entries.append(entry);
+}
+
+bool ZipWriter::deflateSerial(Entry &entry, QIODevice *device, const QByteArray *data)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, m_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    QByteArray input(data ? 0 : ChunkSize, Qt::Uninitialized);
+    QByteArray output(ChunkSize, Qt::Uninitialized);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    qint64 consumed = 0;
+    qint64 compressed = 0;
+    bool ok = true;
+    bool last = false;
+
+    while (ok && !last) {
+        const char *in;
+        qint64 n;
+        if (data) {
+            // feed the array directly, chunk by chunk
+            in = data->constData() + consumed;
+            n = qMin<qint64>(ChunkSize, data->size() - consumed);
+            last = consumed + n == data->size();
+        } else {
+            in = input.constData();
+            n = readInput(device, input.data(), ChunkSize);
+            if (n < 0) {
+                ok = false;
+                break;
+            }
+            last = n < ChunkSize;
+        }
+        consumed += n;
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(in), uInt(n));
+
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+        stream.avail_in = uInt(n);
+        int ret;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = uInt(output.size());
+            ret = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) {
+                ok = false;
+                break;
+            }
+            const qint64 produced = output.size() - stream.avail_out;
+            compressed += produced;
+            if (!write(output.constData(), produced)) {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0 || (last && ret != Z_STREAM_END));
+    }
+    deflateEnd(&stream);
+
+    if (!ok || consumed > 0xffffffffLL || compressed > 0xffffffffLL)
+        return false;
+    entry.crc = quint32(crc);
+    entry.compressedSize = quint32(compressed);
+    entry.uncompressedSize = quint32(consumed);
+    return true;
+}
+
+/*
+   Deflates the entry in batches of BlockSize blocks, one block per thread
+   task, and writes the fragments in order. Memory stays at a few blocks per
+   thread whatever the entry size.
+ */
+bool ZipWriter::deflateParallel(Entry &entry, QIODevice *device, const QByteArray *data)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threads);
+
+    const int batchBlocks = m_threads * 2;
+    QByteArray input(data ? 0 : batchBlocks * BlockSize, Qt::Uninitialized);
+    QByteArray dictionary; // tail of the last block of the previous batch
+    uLong crc = crc32(0L, Z_NULL, 0);
+    qint64 consumed = 0;
+    qint64 compressed = 0;
+    bool last = false;
+    bool readError = false;
+
+    while (!last && !readError) {
+        QVector<DeflateBlockTask *> tasks;
+        const char *previous = dictionary.constData();
+        int previousSize = dictionary.size();
+
+        for (int i = 0; i < batchBlocks && !last; ++i) {
+            const char *in;
+            qint64 n;
+            if (data) {
+                in = data->constData() + consumed;
+                n = qMin<qint64>(BlockSize, data->size() - consumed);
+                last = consumed + n == data->size();
+            } else {
+                char *buffer = input.data() + qint64(i) * BlockSize;
+                n = readInput(device, buffer, BlockSize);
+                if (n < 0) {
+                    readError = true;
+                    break;
+                }
+                in = buffer;
+                last = n < BlockSize;
+            }
+            consumed += n;
+
+            const int dictionarySize = qMin(previousSize, DictionarySize);
+            DeflateBlockTask *task = new DeflateBlockTask(m_level, in, int(n),
+                    previous + previousSize - dictionarySize, dictionarySize, last);
+            tasks.append(task);
+            pool.start(task);
+            previous = in;
+            previousSize = int(n);
+        }
+        pool.waitForDone();
+
+        bool ok = !readError && !tasks.isEmpty();
+        for (DeflateBlockTask *task : qAsConst(tasks)) {
+            ok = ok && task->ok && write(task->output);
+            compressed += task->output.size();
+            crc = crc32_combine(crc, task->crc, z_off_t(task->inputSize()));
+        }
+        qDeleteAll(tasks);
+        if (!ok)
+            return false;
+
+        dictionary = QByteArray(previous + previousSize - qMin(previousSize, DictionarySize), qMin(previousSize, DictionarySize));
+    }
+
+    if (consumed > 0xffffffffLL || compressed > 0xffffffffLL)
+        return false;
+    entry.crc = quint32(crc);
+    entry.compressedSize = quint32(compressed);
+    entry.uncompressedSize = quint32(consumed);
+    return true;
+}
+
+// Writes the central directory and closes the device
 void ZipWriter::close()
 {
-    m_writer->close();
+    if (m_closed || !m_device)
+        return;
+    m_closed = true;
+
+    if (!m_error) {
+        const qint64 directoryOffset = m_offset;
+        QByteArray directory;
+        for (const Entry &entry : qAsConst(m_entries)) {
+            putU32(directory, CentralHeaderSignature);
+            putU16(directory, 20); // version made by: MS-DOS, 2.0
+            putU16(directory, 20); // version needed to extract
+            putU16(directory, entry.flags);
+            putU16(directory, entry.method);
+            putU16(directory, m_dosTime);
+            putU16(directory, m_dosDate);
+            putU32(directory, entry.crc);
+            putU32(directory, entry.compressedSize);
+            putU32(directory, entry.uncompressedSize);
+            putU16(directory, quint16(entry.name.size()));
+            putU16(directory, 0); // extra field length
+            putU16(directory, 0); // comment length
+            putU16(directory, 0); // disk number start
+            putU16(directory, 0); // internal attributes
+            putU32(directory, 0); // external attributes
+            putU32(directory, entry.localHeaderOffset);
+            directory.append(entry.name);
+        }
+
+        const int directorySize = directory.size();
+        putU32(directory, EndOfCentralDirSignature);
+        putU16(directory, 0); // number of this disk
+        putU16(directory, 0); // disk with the central directory
+        putU16(directory, quint16(m_entries.size()));
+        putU16(directory, quint16(m_entries.size()));
+        putU32(directory, quint32(directorySize));
+        putU32(directory, quint32(directoryOffset));
+        putU16(directory, 0); // comment length
+        write(directory);
+    }
+
+    m_device->close();
 }
 
 QT_END_NAMESPACE_XLSX
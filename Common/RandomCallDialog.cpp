@@ -247,8 +247,16 @@ RandomCallDialog::RandomCallDialog(QWidget* parent)
 }
 
 void RandomCallDialog::setStudentData(const QList<struct StudentInfo>& students)
+{
+    TaScoreStats stats;
+    stats.setStudents(students);
+    setStudentData(students, stats);
+}
+
+void RandomCallDialog::setStudentData(const QList<struct StudentInfo>& students, const TaScoreStats& stats)
 {
     m_students = students;
+    m_stats = stats;
     updateParticipants();
 }
 
@@ -402,9 +410,11 @@ void RandomCallDialog::onSeatClicked()
             for (auto& s : m_students) {
                 if (s.id == id) {
                     s.attributes[attrName] = newValue;
+                    m_stats.setValue(id, attrName, newValue);
                     // 如果是当前选择的属性，也更新score
                     if (attrName == currentAttribute || attrName == "总分") {
                         s.score = newValue;
+                        m_stats.setValue(id, QString(), newValue);
                     }
                     break;
                 }
@@ -448,29 +458,23 @@ void RandomCallDialog::updateParticipants()
         return;
     }
     
-    // 根据当前选择的属性筛选参与者
+    // 根据当前选择的属性筛选参与者：有该属性的学生按属性值，没有的按score，都在有序统计上按区间查找
     QString selectedAttr = currentAttribute;
-    for (const auto& student : m_students) {
-        double value = student.score; // 默认使用score
-        
-        // 如果学生有该属性的值，使用属性值
-        if (student.attributes.contains(selectedAttr)) {
-            value = student.attributes[selectedAttr];
-        } else if (selectedAttr == "总分" && student.attributes.contains("总分")) {
-            value = student.attributes["总分"];
-        } else if (selectedAttr == "数学" && student.attributes.contains("数学")) {
-            value = student.attributes["数学"];
-        } else if (selectedAttr == "语文" && student.attributes.contains("语文")) {
-            value = student.attributes["语文"];
-        } else if (selectedAttr == "英语" && student.attributes.contains("英语")) {
-            value = student.attributes["英语"];
-        }
-        
-        if (value >= minValue && value <= maxValue) {
-            m_participants.append(student);
+    QVector<int> matched = m_stats.studentsInRange(selectedAttr, minValue, maxValue);
+    if (m_stats.count(selectedAttr) < m_stats.studentCount()) {
+        for (int student : m_stats.studentsInRange(QString(), minValue, maxValue)) {
+            if (!m_stats.value(student, selectedAttr, nullptr)) {
+                matched.append(student);
+            }
         }
     }
     
+    // 保持学生原来的顺序
+    std::sort(matched.begin(), matched.end());
+    for (int student : matched) {
+        m_participants.append(m_students[student]);
+    }
+    
     lblInfo->setText(QString("参与者: %1 人").arg(m_participants.size()));
 }
 
@@ -560,6 +564,7 @@ void RandomCallDialog::updateStudentScore(const QString& studentId, double newSc
             break;
         }
     }
+    m_stats.setValue(studentId, QString(), newScore);
     
     // 更新参与者列表中的成绩
     for (auto& participant : m_participants) {
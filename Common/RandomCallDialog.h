@@ -16,6 +16,7 @@
 #include <QDebug>
 #include <QList>
 #include "ScheduleDialog.h" // 包含 StudentInfo 定义
+#include "TaScoreStats.h"
 
 class RandomCallDialog : public QDialog
 {
@@ -30,6 +31,8 @@ public:
     
     // 设置学生数据
     void setStudentData(const QList<struct StudentInfo>& students);
+    // stats 须由同一份 students 建立（与 ScheduleDialog 共享，不再重排）
+    void setStudentData(const QList<struct StudentInfo>& students, const TaScoreStats& stats);
     
     // 设置座位表格（用于高亮显示）
     void setSeatTable(QTableWidget* seatTable);
@@ -64,6 +67,7 @@ private:
     
     QList<struct StudentInfo> m_students;
     QList<struct StudentInfo> m_participants;
+    TaScoreStats m_stats; // m_students 各项成绩的有序统计，学生编号即 m_students 下标
     QTableWidget* m_seatTable;
     
     QTimer* animationTimer;
@@ -3,6 +3,7 @@
 #include <qpainterpath>
 #include <QRegExp>
 #include <QMessageBox>
+#include "TaEndpoints.h"
 
 RegisterDialog::RegisterDialog(QWidget* parent)
     : QDialog(parent), m_dragging(false),
@@ -419,7 +420,7 @@ void RegisterDialog::onGetCodeClicked()
     {
         QMap<QString, QString> params;
         params["phone"] = phoneEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/send_verification_code"), params);
+        m_httpHandler->post(TaEndpoints::url("/send_verification_code"), params);
     }
 }
 
@@ -462,6 +463,6 @@ void RegisterDialog::onLoginClicked()
         params["phone"] = phoneEdit->text();
         params["password"] = secPwdEdit->text();
         params["verification_code"] = codeEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/register"), params);
+        m_httpHandler->post(TaEndpoints::url("/register"), params);
     }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <qpainterpath>
 #include <QRegExp>
 #include <QMessageBox>
+#include "TaEndpoints.h"
 
 ResetPwdDialog::ResetPwdDialog(QWidget* parent)
     : QDialog(parent), m_dragging(false),
@@ -410,7 +411,7 @@ void ResetPwdDialog::onGetCodeClicked()
     {
         QMap<QString, QString> params;
         params["phone"] = phoneEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/send_verification_code"), params);
+        m_httpHandler->post(TaEndpoints::url("/send_verification_code"), params);
     }
 }
 
@@ -447,7 +448,7 @@ void ResetPwdDialog::onLoginClicked()
         params["phone"] = phoneEdit->text();
         params["new_password"] = secPwdEdit->text();
         params["verification_code"] = codeEdit->text();
-        m_httpHandler->post(QString("http://47.100.126.194:5000/verify_and_set_password"), params);
+        m_httpHandler->post(TaEndpoints::url("/verify_and_set_password"), params);
     }
     //accept(); // 验证通过，关闭对话框并返回 Accepted
 }
\ No newline at end of file
@@ -31,9 +31,12 @@
 #include "TAHttpHandler.h"
 #include "ChatDialog.h"
 #include "CommonInfo.h"
+#include "TaMessageBus.h"
+#include "TaEndpoints.h"
 #include "QGroupInfo.h"
 #include "TAHttpHandler.h"
 #include "ArrangeSeatDialog.h"
+#include "TaScoreStats.h"
 // 前向声明，避免循环依赖
 class HeatmapSegmentDialog;
 class HeatmapViewDialog;
@@ -339,7 +342,7 @@ public:
 					
 					// 可选：重新从服务器获取成员列表以确保数据同步
 					if (m_httpHandler && !m_unique_group_id.isEmpty()) {
-						QUrl url("http://47.100.126.194:5000/groups/members");
+						QUrl url(TaEndpoints::url("/groups/members"));
 						QUrlQuery query;
 						query.addQueryItem("group_id", m_unique_group_id);
 						url.setQuery(query);
@@ -580,11 +583,14 @@ public:
 		
 		// 连接热力图按钮点击事件
 		connect(btnHeatmap, &QPushButton::clicked, this, [=]() {
-			// 检查是否有学生数据（必须上传期中成绩）
-			if (m_students.isEmpty()) {
-				QMessageBox::information(this, "提示", "请先上传期中成绩表！");
-				return;
-			}
+			// 检查是否有学生数据（分段图、热力图必须上传期中成绩；多班成绩趋势在窗口内自行导入，不需要）
+			auto hasStudents = [=]() {
+				if (m_students.isEmpty()) {
+					QMessageBox::information(this, "提示", "请先上传期中成绩表！");
+					return false;
+				}
+				return true;
+			};
 			
 			// 显示热力图选择对话框
 			QDialog* typeDialog = new QDialog(this);
@@ -598,22 +604,31 @@ public:
 			
 			QPushButton* btnSegment = new QPushButton("分段图1（每一段一种颜色）");
 			QPushButton* btnGradient = new QPushButton("热力图2（颜色渐变）");
+			QPushButton* btnTrend = new QPushButton("多班成绩趋势（历次考试）");
 			QPushButton* btnCancel = new QPushButton("取消");
 			
 			typeLayout->addWidget(btnSegment);
 			typeLayout->addWidget(btnGradient);
+			typeLayout->addWidget(btnTrend);
 			typeLayout->addWidget(btnCancel);
 			
 			connect(btnSegment, &QPushButton::clicked, typeDialog, [=]() {
+				if (!hasStudents()) return;
 				typeDialog->accept();
 				this->showSegmentDialog();
 			});
 			
 			connect(btnGradient, &QPushButton::clicked, typeDialog, [=]() {
+				if (!hasStudents()) return;
 				typeDialog->accept();
 				this->showGradientHeatmap();
 			});
 			
+			connect(btnTrend, &QPushButton::clicked, typeDialog, [=]() {
+				typeDialog->accept();
+				this->showExamTrend();
+			});
+			
 			connect(btnCancel, &QPushButton::clicked, typeDialog, &QDialog::reject);
 			
 			typeDialog->exec();
@@ -911,7 +926,7 @@ public:
 		params["unique_group_id"] = m_unique_group_id;
 		if (m_taHttpHandler)
 		{
-			m_taHttpHandler->post(QString("http://47.100.126.194:5000/updateGroupInfo"), params);
+			m_taHttpHandler->post(TaEndpoints::url("/updateGroupInfo"), params);
 		}
 	}
 
@@ -921,16 +936,60 @@ public:
 		{
 			m_chatDlg->InitWebSocket();
 		}
+
+		// 订阅通知推送，只转交本群新到的和状态变了的通知；窗口销毁时消息总线自动退订
+		if (0 == m_noticeSubId)
+		{
+			m_noticeSubId = TaMessageBus::subscribe(this, TaMessageBus::kTypeNotification,
+				[this](const QJsonObject&, const QString&) {
+					onNotificationPushed();
+				});
+		}
 	}
 
 	void setNoticeMsg(QList<Notification> listNoticeMsg)
 	{
+		for (const Notification& n : listNoticeMsg)
+		{
+			m_notices.insert(n.id, n);
+		}
 		if (m_chatDlg)
 		{
 			m_chatDlg->setNoticeMsg(listNoticeMsg);
 		}
 	}
 
+	// 消息总线分发前已把这次推送解析并按 id 合并进通知表，这里直接读本群的通知，
+	// 与已显示的按 id 比对：新 id 和已读、撤回等状态更新都转交，不再重新解析推送
+	void onNotificationPushed()
+	{
+		if (m_unique_group_id.isEmpty())
+		{
+			return;
+		}
+
+		QList<Notification> changed;
+		for (const Notification& n : TaMessageBus::notificationsOfGroup(m_unique_group_id))
+		{
+			auto shown = m_notices.constFind(n.id);
+			if (shown == m_notices.constEnd() || !sameNotice(*shown, n))
+			{
+				changed.append(n);
+			}
+		}
+
+		if (!changed.isEmpty())
+		{
+			setNoticeMsg(changed);
+		}
+	}
+
+	static bool sameNotice(const Notification& a, const Notification& b)
+	{
+		return a.content == b.content && a.is_read == b.is_read && a.is_agreed == b.is_agreed
+			&& a.remark == b.remark && a.updated_at == b.updated_at;
+	}
+
 signals:
 	void groupLeft(const QString& groupId); // 群聊退出信号，通知父窗口刷新群列表
 
@@ -942,6 +1001,7 @@ public:
 	// 热力图相关方法
 	void showSegmentDialog(); // 显示分段区间设置对话框
 	void showGradientHeatmap(); // 显示渐变热力图
+	void showExamTrend(); // 显示多班成绩趋势
 	void setSegments(const QList<struct SegmentRange>& segments); // 设置分段区间
 	
 	void InitData(QString groupName, QString unique_group_id, QString classid, bool iGroupOwner)
@@ -968,7 +1028,7 @@ public:
 		if (m_httpHandler && !unique_group_id.isEmpty())
 		{
 			// 使用QUrl和QUrlQuery来正确编码URL参数（特别是#等特殊字符）
-			QUrl url("http://47.100.126.194:5000/groups/members");
+			QUrl url(TaEndpoints::url("/groups/members"));
 			QUrlQuery query;
 			query.addQueryItem("group_id", unique_group_id);
 			url.setQuery(query);
@@ -983,7 +1043,7 @@ public:
 		if (m_httpHandler && !m_unique_group_id.isEmpty())
 		{
 			// 使用QUrl和QUrlQuery来正确编码URL参数（特别是#等特殊字符）
-			QUrl url("http://47.100.126.194:5000/groups/members");
+			QUrl url(TaEndpoints::url("/groups/members"));
 			QUrlQuery query;
 			query.addQueryItem("group_id", m_unique_group_id);
 			url.setQuery(query);
@@ -1305,6 +1365,8 @@ private:
 	TAHttpHandler* m_taHttpHandler = NULL;
 	ChatDialog* m_chatDlg = NULL;
 	TaQTWebSocket* m_pWs = NULL;
+	int m_noticeSubId = 0;
+	QMap<int, Notification> m_notices; // 已显示的本群通知，按 id
 	bool m_iGroupOwner = false;
 	QString m_classid;
 	QAudioInput* audioInput = nullptr;
@@ -1329,10 +1391,12 @@ private:
 	QTableWidget* seatTable = nullptr; // 座位表格
 	ArrangeSeatDialog* arrangeSeatDlg = nullptr; // 排座对话框
 	QList<StudentInfo> m_students; // 学生数据
+	TaScoreStats m_scoreStats; // m_students 各项成绩的有序统计，热力图、分段、随机点名共用
 	
 	// 热力图相关
 	class HeatmapSegmentDialog* heatmapSegmentDlg = nullptr; // 分段区间对话框
 	class HeatmapViewDialog* heatmapViewDlg = nullptr; // 热力图显示窗口
+	class ExamTrendDialog* examTrendDlg = nullptr; // 多班成绩趋势窗口
 	QList<struct SegmentRange> m_segments; // 分段区间列表
 	int m_heatmapType = 1; // 1=分段，2=渐变
 	
@@ -1363,6 +1427,7 @@ inline void ScheduleDialog::arrangeSeats(const QList<StudentInfo>& students, con
 	qDebug() << "seatTable 存在，开始排座...";
 	
 	m_students = students;
+	m_scoreStats.setStudents(m_students);
 	
 	// 获取所有座位按钮（标记为 isSeat 的按钮），按行列顺序排列
 	QList<QPushButton*> seatButtons;
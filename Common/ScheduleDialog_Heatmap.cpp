@@ -1,6 +1,7 @@
 #include "ScheduleDialog.h"
 #include "HeatmapSegmentDialog.h"
 #include "HeatmapViewDialog.h"
+#include "ExamTrendDialog.h"
 #include "HeatmapTypes.h"
 #include <QMessageBox>
 
@@ -9,7 +10,7 @@ void ScheduleDialog::showSegmentDialog()
 {
 	if (!heatmapSegmentDlg) {
 		heatmapSegmentDlg = new HeatmapSegmentDialog(this);
-		heatmapSegmentDlg->setStudentData(m_students);
+		heatmapSegmentDlg->setStudentData(m_scoreStats);
 		connect(heatmapSegmentDlg, &QDialog::accepted, this, [this]() {
 			if (heatmapSegmentDlg) {
 				m_segments = heatmapSegmentDlg->getSegments();
@@ -27,7 +28,7 @@ void ScheduleDialog::showGradientHeatmap()
 {
 	if (!heatmapViewDlg) {
 		heatmapViewDlg = new HeatmapViewDialog(this);
-		heatmapViewDlg->setStudentData(m_students);
+		heatmapViewDlg->setStudentData(m_scoreStats);
 		heatmapViewDlg->setHeatmapType(2); // 渐变热力图
 	}
 	heatmapViewDlg->show();
@@ -35,6 +36,17 @@ void ScheduleDialog::showGradientHeatmap()
 	heatmapViewDlg->activateWindow();
 }
 
+void ScheduleDialog::showExamTrend()
+{
+	// 多班历次成绩由窗口内自行导入，不依赖本班的 m_students
+	if (!examTrendDlg) {
+		examTrendDlg = new ExamTrendDialog(this);
+	}
+	examTrendDlg->show();
+	examTrendDlg->raise();
+	examTrendDlg->activateWindow();
+}
+
 void ScheduleDialog::setSegments(const QList<struct SegmentRange>& segments)
 {
 	m_segments = segments;
@@ -100,13 +112,9 @@ void ScheduleDialog::updateSeatColors()
 		}
 	} else if (m_heatmapType == 2) {
 		// 渐变图：根据成绩计算渐变颜色
-		// 找到最小和最大成绩
-		double minScore = m_students[0].score;
-		double maxScore = m_students[0].score;
-		for (const auto& student : m_students) {
-			if (student.score < minScore) minScore = student.score;
-			if (student.score > maxScore) maxScore = student.score;
-		}
+		// 最小和最大成绩取自有序统计
+		double minScore = m_scoreStats.minimum(QString());
+		double maxScore = m_scoreStats.maximum(QString());
 		
 		double range = maxScore - minScore;
 		if (range == 0) range = 1; // 避免除零
@@ -16,7 +16,7 @@ void ScheduleDialog::connectRandomCallButton(QPushButton* btnRandom, QTableWidge
         
         if (!randomCallDlg) {
             randomCallDlg = new RandomCallDialog(this);
-            randomCallDlg->setStudentData(m_students);
+            randomCallDlg->setStudentData(m_students, m_scoreStats);
             randomCallDlg->setSeatTable(seatTable);
             // 连接学生成绩更新信号
             connect(randomCallDlg, &RandomCallDialog::studentScoreUpdated, this, [this](const QString& studentId, double newScore) {
@@ -27,13 +27,14 @@ void ScheduleDialog::connectRandomCallButton(QPushButton* btnRandom, QTableWidge
                         break;
                     }
                 }
+                m_scoreStats.setValue(studentId, QString(), newScore);
                 // 如果热力图已设置，需要更新座位颜色
                 if (m_heatmapType == 1 || m_heatmapType == 2) {
                     updateSeatColors();
                 }
             });
         } else {
-            randomCallDlg->setStudentData(m_students);
+            randomCallDlg->setStudentData(m_students, m_scoreStats);
             randomCallDlg->setSeatTable(seatTable);
         }
         randomCallDlg->show();
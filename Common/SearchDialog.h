@@ -24,6 +24,7 @@
 #include "CommonInfo.h"
 #include "ImSDK/includes/TIMCloud.h"
 #include "ImSDK/includes/TIMCloudDef.h"
+#include "TaEndpoints.h"
 
 class SearchDialog : public QDialog
 {
@@ -140,7 +141,7 @@ private slots:
         }
 
         // 构建URL
-        QUrl url("http://47.100.126.194:5000/groups/search");
+        QUrl url(TaEndpoints::url("/groups/search"));
         QUrlQuery query;
         query.addQueryItem("schoolid", userInfo.schoolId);
         if (searchType == "group_id") {
@@ -221,7 +222,7 @@ private slots:
         UserInfo userInfo = CommonInfo::GetData();
         if (m_httpHandler && !userInfo.teacher_unique_id.isEmpty())
         {
-            QUrl url("http://47.100.126.194:5000/groups/by-teacher");
+            QUrl url(TaEndpoints::url("/groups/by-teacher"));
             QUrlQuery query;
             query.addQueryItem("teacher_unique_id", userInfo.teacher_unique_id);
             url.setQuery(query);
@@ -385,7 +386,7 @@ private slots:
         QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
         
         // 发送POST请求到服务器
-        QString url = "http://47.100.126.194:5000/groups/join";
+        QString url = TaEndpoints::url("/groups/join");
         
         // 使用QNetworkAccessManager发送POST请求
         QNetworkAccessManager* manager = new QNetworkAccessManager(this);
@@ -37,6 +37,9 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <algorithm>
+#include "TaEndpoints.h"
+#include "TaTableExport.h"
+#include "TaScoreTotals.h"
 
 // 单元格注释窗口
 class CellCommentWidget : public QWidget
@@ -233,7 +236,6 @@ public:
 
         // 单元格点击和悬浮事件
         connect(table, &QTableWidget::cellClicked, this, &StudentPhysiqueDialog::onCellClicked);
-        connect(table, &QTableWidget::cellChanged, this, &StudentPhysiqueDialog::onCellChanged);
         
         // 创建注释窗口
         commentWidget = new CellCommentWidget(this);
@@ -245,13 +247,27 @@ public:
         table->setContextMenuPolicy(Qt::CustomContextMenu);
         connect(table, &QTableWidget::customContextMenuRequested, this, &StudentPhysiqueDialog::onTableContextMenu);
         
-        // 监听单元格内容变化，自动更新总分和小组总分
+        // 监听单元格内容变化，增量更新总分和小组总分
         connect(table, &QTableWidget::itemChanged, this, &StudentPhysiqueDialog::onItemChanged);
     }
 
     // 导入Excel数据
     void importData(const QStringList& headers, const QList<QStringList>& dataRows)
     {
+        beginImport(headers);
+        appendImportRows(dataRows);
+        finishImport();
+    }
+
+    // 分批导入：beginImport 清空表格并按表头建立列映射，之后每批数据行调用 appendImportRows，
+    // 最后 finishImport 合并小组单元格并计算总分
+    void beginImport(const QStringList& headers)
+    {
+        m_importColumns.clear();
+        m_importColumnCount = headers.size();
+        m_importGroupColumn = -1;
+        m_importGroupTarget = -1;
+        m_importCurrentGroup.clear();
         if (!table) return;
 
         // 清空现有数据
@@ -263,39 +279,34 @@ public:
             headerMap[headers[i]] = i;
         }
 
-        // 获取固定列的索引
-        int colGroup = -1, colId = -1, colName = -1;
-        QMap<QString, int> scoreColumnMap; // 存储其他评分列的映射
-        int colTotal = -1, colGroupTotal = -1;
-        
-        // 在表格中找到对应的列
+        // 在表格中找到对应的列；总分和小组总分由表格自己计算，不导入
         for (int col = 0; col < table->columnCount(); ++col) {
             QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
             if (!headerItem) continue;
             QString headerText = headerItem->text();
-            
-            if (headerText == "小组") colGroup = col;
-            else if (headerText == "学号") colId = col;
-            else if (headerText == "姓名") colName = col;
-            else if (headerText == "总分") colTotal = col;
-            else if (headerText == "小组总分") colGroupTotal = col;
-            else {
-                // 其他列可能是评分列
-                if (headerMap.contains(headerText)) {
-                    scoreColumnMap[headerText] = col;
-                }
+            if (!headerMap.contains(headerText)) continue;
+
+            if (headerText == "小组") {
+                m_importGroupColumn = headerMap[headerText];
+                m_importGroupTarget = col;
+            } else if (headerText != "总分" && headerText != "小组总分") {
+                // 学号、姓名和其他评分列
+                m_importColumns.append(qMakePair(headerMap[headerText], col));
             }
         }
+    }
 
-        // 导入数据
-        QString currentGroup = "";
-        int groupStartRow = -1;
-        
-        for (const QStringList& rowData : dataRows) {
-            if (rowData.size() != headers.size()) continue; // 跳过列数不匹配的行
+    void appendImportRows(const QList<QStringList>& dataRows)
+    {
+        if (!table || dataRows.isEmpty()) return;
 
-            int row = table->rowCount();
-            table->insertRow(row);
+        // 整批一次性加行，期间不刷新界面；填数据不触发 onItemChanged，总分在 finishImport 里统一计算
+        QSignalBlocker blocker(table);
+        table->setUpdatesEnabled(false);
+        int row = table->rowCount();
+        table->setRowCount(row + dataRows.size());
+        for (const QStringList& rowData : dataRows) {
+            if (rowData.size() != m_importColumnCount) continue; // 跳过列数不匹配的行
 
             // 初始化所有单元格
             for (int col = 0; col < table->columnCount(); ++col) {
@@ -304,45 +315,31 @@ public:
                 table->setItem(row, col, item);
             }
 
-            // 填充数据
-            if (colGroup >= 0 && headerMap.contains("小组")) {
-                int srcCol = headerMap["小组"];
-                if (srcCol < rowData.size() && !rowData[srcCol].isEmpty()) {
-                    QString group = rowData[srcCol];
-                    table->item(row, colGroup)->setText(group);
-                    currentGroup = group;
-                    if (groupStartRow < 0) {
-                        groupStartRow = row;
-                    }
-                } else if (!currentGroup.isEmpty()) {
-                    table->item(row, colGroup)->setText(currentGroup);
-                }
-            }
-            if (colId >= 0 && headerMap.contains("学号")) {
-                int srcCol = headerMap["学号"];
-                if (srcCol < rowData.size()) {
-                    table->item(row, colId)->setText(rowData[srcCol]);
-                }
-            }
-            if (colName >= 0 && headerMap.contains("姓名")) {
-                int srcCol = headerMap["姓名"];
-                if (srcCol < rowData.size()) {
-                    table->item(row, colName)->setText(rowData[srcCol]);
+            // 小组列为空时沿用上一行的小组（合并单元格导出的表格只有每组第一行有小组名）
+            if (m_importGroupTarget >= 0) {
+                if (m_importGroupColumn < rowData.size() && !rowData[m_importGroupColumn].isEmpty()) {
+                    m_importCurrentGroup = rowData[m_importGroupColumn];
                 }
+                table->item(row, m_importGroupTarget)->setText(m_importCurrentGroup);
             }
 
-            // 填充评分列
-            for (auto it = scoreColumnMap.begin(); it != scoreColumnMap.end(); ++it) {
-                QString headerName = it.key();
-                int targetCol = it.value();
-                if (headerMap.contains(headerName)) {
-                    int srcCol = headerMap[headerName];
-                    if (srcCol < rowData.size()) {
-                        table->item(row, targetCol)->setText(rowData[srcCol]);
-                    }
+            // 填充学号、姓名和评分列
+            for (const QPair<int, int>& column : m_importColumns) {
+                if (column.first < rowData.size()) {
+                    table->item(row, column.second)->setText(rowData[column.first]);
                 }
             }
+            ++row;
         }
+        table->setRowCount(row);
+        table->setUpdatesEnabled(true);
+    }
+
+    void finishImport()
+    {
+        m_importColumns.clear();
+        m_importColumnCount = 0;
+        m_importCurrentGroup.clear();
 
         // 重新合并小组单元格并更新总分
         mergeGroupCells();
@@ -382,10 +379,9 @@ private slots:
             }
         }
         
-        // 重新合并小组单元格
+        // 重新合并小组单元格并更新总分
         mergeGroupCells();
-        // 更新小组总分
-        updateGroupTotals();
+        updateAllTotals();
     }
 
     void onDeleteColumn()
@@ -475,8 +471,9 @@ private slots:
         }
         fixedColumns = newFixedColumns;
         
-        // 重新合并小组单元格（因为列索引变化了）
+        // 重新合并小组单元格（因为列索引变化了）并重建汇总
         mergeGroupCells();
+        updateAllTotals();
     }
 
     void onFontColor()
@@ -509,11 +506,31 @@ private slots:
 
     void onExport()
     {
-        QString fileName = QFileDialog::getSaveFileName(this, "导出统计表", "", "CSV文件 (*.csv);;所有文件 (*.*)");
+        QString fileName = QFileDialog::getSaveFileName(this, "导出统计表", "", "Excel文件 (*.xlsx);;CSV文件 (*.csv);;所有文件 (*.*)");
         if (fileName.isEmpty()) {
             return;
         }
 
+        // xlsx 逐行流式写出，大表导出内存占用恒定
+        if (fileName.endsWith(".xlsx", Qt::CaseInsensitive)) {
+            // 小组、学号、姓名按文本写出，其余各项分数和总分按数值写出
+            QSet<int> scoreColumns;
+            for (int col = 0; col < table->columnCount(); ++col) {
+                QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
+                QString headerText = headerItem ? headerItem->text() : QString();
+                if (headerText != "小组" && headerText != "学号" && headerText != "姓名") {
+                    scoreColumns.insert(col);
+                }
+            }
+            QString error;
+            if (!TaTableExport::writeXlsx(fileName, "统计表", table, scoreColumns, textDescription->toPlainText(), &error)) {
+                QMessageBox::critical(this, "错误", "导出失败：" + error);
+                return;
+            }
+            QMessageBox::information(this, "成功", "导出完成！");
+            return;
+        }
+
         QFile file(fileName);
         if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QMessageBox::critical(this, "错误", "无法创建文件");
@@ -742,7 +759,7 @@ private slots:
         QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
 
         // 发送 POST 请求
-        QString url = "http://47.100.126.194:5000/group-scores/save";
+        QString url = TaEndpoints::url("/group-scores/save");
         QNetworkRequest request;
         request.setUrl(QUrl(url));
         request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
@@ -806,24 +823,43 @@ private slots:
         showCellComment(row, column);
     }
 
-    void onCellChanged(int row, int column)
-    {
-        // 单元格内容改变时，更新总分和小组总分
-        updateAllTotals();
-        mergeGroupCells();
-    }
-
     void onItemChanged(QTableWidgetItem* item)
     {
-        if (!item) return;
-        
-        // 如果修改的是小组列，需要重新合并单元格
-        if (item->column() == groupColumnIndex) {
+        if (!item || m_writingTotals) return;
+
+        // 行列结构变过（插入行、添加列）还没同步到汇总时，整体重建一次
+        int firstScoreCol = nameColumnIndex + 1;
+        int totalScoreCol = table->columnCount() - 2;
+        if (m_totals.rowCount() != table->rowCount() ||
+            m_totals.columnCount() != qMax(0, totalScoreCol - firstScoreCol)) {
             mergeGroupCells();
-            updateGroupTotals();
-        } else {
-            // 其他列改变时，更新总分
             updateAllTotals();
+            return;
+        }
+
+        int row = item->row();
+        int col = item->column();
+        if (col == groupColumnIndex) {
+            // 小组变了：重新合并单元格，小组总分整体重写
+            if (m_totals.setGroup(row, item->text())) {
+                mergeGroupCells();
+                updateGroupTotals();
+            }
+        } else if (col >= firstScoreCol && col < totalScoreCol) {
+            // 分值或跨列注释变了：只改这一行的总分和所在小组的小组总分
+            bool ok;
+            double value = item->text().toDouble(&ok);
+            bool changed = m_totals.setValue(row, col - firstScoreCol, value, ok);
+            changed = m_totals.setSpan(row, col - firstScoreCol, item->data(Qt::UserRole + 1).toInt()) || changed;
+            if (changed) {
+                writeRowTotal(row);
+                writeGroupTotal(m_totals.group(row));
+            }
+        } else if (col == totalScoreCol) {
+            // 总分由表格计算，手工改动还原
+            writeRowTotal(row);
+        } else if (col == totalScoreCol + 1) {
+            updateGroupTotals();
         }
     }
 
@@ -848,7 +884,7 @@ private slots:
             if (ret == QMessageBox::Yes) {
                 table->removeRow(row);
                 mergeGroupCells();
-                updateGroupTotals();
+                updateAllTotals();
             }
         }
     }
@@ -1065,136 +1101,116 @@ private:
             int endRow = table->rowCount();
             table->setSpan(startRow, groupCol, endRow - startRow, 1);
         }
+
+        // clearSpans 把小组总分列的合并也清掉了，按汇总结果补回
+        if (m_totals.rowCount() == table->rowCount()) {
+            mergeGroupTotalCells();
+        }
     }
 
+    // 从表格重建汇总并写出全部总分；用于初始化、导入和增删行列之后，单元格编辑走 onItemChanged 的增量更新
     void updateAllTotals()
     {
-        // 更新所有行的个人总分
         int totalColumns = table->columnCount();
         int totalScoreCol = totalColumns - 2; // 总分列
-        
-        for (int row = 0; row < table->rowCount(); ++row) {
-            double total = 0.0;
-            
-            // 从姓名列之后到总分列之前的所有列都是计分列
-            for (int col = nameColumnIndex + 1; col < totalScoreCol; ++col) {
-                // 检查该单元格是否被合并（可能是注释单元格）
+        int firstScoreCol = nameColumnIndex + 1; // 从姓名列之后到总分列之前的所有列都是计分列
+        int rowCount = table->rowCount();
+
+        QStringList groups;
+        for (int row = 0; row < rowCount; ++row) {
+            QTableWidgetItem* groupItem = table->item(row, groupColumnIndex);
+            groups.append(groupItem ? groupItem->text() : QString());
+        }
+        m_totals.reset(rowCount, totalScoreCol - firstScoreCol, groups);
+
+        for (int row = 0; row < rowCount; ++row) {
+            for (int col = firstScoreCol; col < totalScoreCol; ++col) {
                 QTableWidgetItem* item = table->item(row, col);
                 if (!item) continue;
-                
-                // 检查该单元格是否是跨列注释的起始单元格
-                int spanCols = item->data(Qt::UserRole + 1).toInt();
-                if (spanCols > 1) {
-                    // 这是跨列注释的起始单元格，跳过（不计算注释单元格）
-                    // 同时跳过该注释跨过的所有列
-                    col += (spanCols - 1);
-                    continue;
-                }
-                
-                // 检查该单元格是否在某个跨列注释的范围内
-                bool isInCommentSpan = false;
-                for (int c = col - 1; c >= nameColumnIndex + 1 && c >= 0; --c) {
-                    QTableWidgetItem* checkItem = table->item(row, c);
-                    if (checkItem) {
-                        int sc = checkItem->data(Qt::UserRole + 1).toInt();
-                        if (sc > 1 && c + sc > col) {
-                            // 当前单元格在跨列注释范围内
-                            isInCommentSpan = true;
-                            break;
-                        }
-                    }
-                }
-                if (isInCommentSpan) continue;
-                
-                QString text = item->text();
                 bool ok;
-                double value = text.toDouble(&ok);
-                if (ok) {
-                    total += value;
-                }
-            }
-            
-            // 设置总分
-            QTableWidgetItem* totalItem = table->item(row, totalScoreCol);
-            if (!totalItem) {
-                totalItem = new QTableWidgetItem("");
-                totalItem->setTextAlignment(Qt::AlignCenter);
-                table->setItem(row, totalScoreCol, totalItem);
+                double value = item->text().toDouble(&ok);
+                m_totals.setValue(row, col - firstScoreCol, value, ok);
+                // 跨列注释覆盖的格子不计分
+                m_totals.setSpan(row, col - firstScoreCol, item->data(Qt::UserRole + 1).toInt());
             }
-            totalItem->setText(QString::number(total));
         }
-        
+
+        // 设置总分
+        for (int row = 0; row < rowCount; ++row) {
+            writeRowTotal(row);
+        }
+
         // 更新小组总分
         updateGroupTotals();
     }
 
+    // 按汇总结果重写小组总分列：每个小组只在第一行显示，并合并该小组的行
     void updateGroupTotals()
     {
-        int totalColumns = table->columnCount();
-        int totalScoreCol = totalColumns - 2; // 总分列
-        int groupTotalScoreCol = totalColumns - 1; // 小组总分列
-        int groupCol = groupColumnIndex;
-        
-        // 按小组汇总总分
-        QMap<QString, double> groupTotals;
-        QMap<QString, QVector<int>> groupRows;
-        
-        // 收集每个小组的行号和总分
+        int groupTotalScoreCol = table->columnCount() - 1; // 小组总分列
+        const QHash<QString, TaScoreTotals::Group>& groups = m_totals.groups();
+
+        m_writingTotals = true;
+        for (int row = 0; row < m_totals.rowCount(); ++row) {
+            QString groupName = m_totals.group(row);
+            if (groupName.isEmpty()) continue;
+            const TaScoreTotals::Group& group = groups[groupName];
+            if (row == group.firstRow) {
+                setCellText(row, groupTotalScoreCol, TaScoreTotals::format(group.total));
+            } else if (QTableWidgetItem* item = table->item(row, groupTotalScoreCol)) {
+                // 清除其他行的小组总分显示
+                item->setText("");
+            }
+        }
+        m_writingTotals = false;
+
+        mergeGroupTotalCells();
+    }
+
+    void mergeGroupTotalCells()
+    {
+        int groupTotalScoreCol = table->columnCount() - 1; // 小组总分列
         for (int row = 0; row < table->rowCount(); ++row) {
-            QTableWidgetItem* groupItem = table->item(row, groupCol);
-            QTableWidgetItem* totalItem = table->item(row, totalScoreCol);
-            
-            if (groupItem && totalItem) {
-                QString groupName = groupItem->text();
-                if (!groupName.isEmpty()) {
-                    QString totalText = totalItem->text();
-                    bool ok;
-                    double total = totalText.toDouble(&ok);
-                    if (ok) {
-                        groupTotals[groupName] += total;
-                        if (!groupRows.contains(groupName)) {
-                            groupRows[groupName] = QVector<int>();
-                        }
-                        groupRows[groupName].append(row);
-                    }
-                }
+            if (table->rowSpan(row, groupTotalScoreCol) > 1) {
+                table->setSpan(row, groupTotalScoreCol, 1, 1);
             }
         }
-        
-        // 设置每个小组的小组总分（只在每个小组的第一行显示）
-        for (auto it = groupRows.begin(); it != groupRows.end(); ++it) {
-            QString groupName = it.key();
-            QVector<int> rows = it.value();
-            
-            if (!rows.isEmpty()) {
-                double groupTotal = groupTotals[groupName];
-                
-                // 只在该小组的第一行显示小组总分
-                int firstRow = rows[0];
-                QTableWidgetItem* groupTotalItem = table->item(firstRow, groupTotalScoreCol);
-                if (!groupTotalItem) {
-                    groupTotalItem = new QTableWidgetItem("");
-                    groupTotalItem->setTextAlignment(Qt::AlignCenter);
-                    table->setItem(firstRow, groupTotalScoreCol, groupTotalItem);
-                }
-                groupTotalItem->setText(QString::number(groupTotal));
-                
-                // 合并小组总分列
-                if (rows.size() > 1) {
-                    table->setSpan(firstRow, groupTotalScoreCol, rows.size(), 1);
-                }
-                
-                // 清除其他行的小组总分显示
-                for (int i = 1; i < rows.size(); ++i) {
-                    QTableWidgetItem* item = table->item(rows[i], groupTotalScoreCol);
-                    if (item) {
-                        item->setText("");
-                    }
-                }
+        const QHash<QString, TaScoreTotals::Group>& groups = m_totals.groups();
+        for (auto it = groups.begin(); it != groups.end(); ++it) {
+            if (it->rowCount > 1) {
+                table->setSpan(it->firstRow, groupTotalScoreCol, it->rowCount, 1);
             }
         }
     }
 
+    void writeRowTotal(int row)
+    {
+        m_writingTotals = true;
+        setCellText(row, table->columnCount() - 2, TaScoreTotals::format(m_totals.rowTotal(row)));
+        m_writingTotals = false;
+    }
+
+    void writeGroupTotal(const QString& groupName)
+    {
+        if (groupName.isEmpty()) return;
+        TaScoreTotals::Group group = m_totals.groupOf(groupName);
+        if (group.firstRow < 0) return;
+        m_writingTotals = true;
+        setCellText(group.firstRow, table->columnCount() - 1, TaScoreTotals::format(group.total));
+        m_writingTotals = false;
+    }
+
+    void setCellText(int row, int col, const QString& text)
+    {
+        QTableWidgetItem* item = table->item(row, col);
+        if (!item) {
+            item = new QTableWidgetItem("");
+            item->setTextAlignment(Qt::AlignCenter);
+            table->setItem(row, col, item);
+        }
+        item->setText(text);
+    }
+
     void showCellComment(int row, int column)
     {
         QTableWidgetItem* item = table->item(row, column);
@@ -1304,4 +1320,11 @@ private:
     int nameColumnIndex; // 姓名列索引
     int groupColumnIndex; // 小组列索引
     CellCommentWidget* commentWidget = nullptr; // 注释窗口
+    TaScoreTotals m_totals;                 // 个人总分、小组总分的增量汇总
+    bool m_writingTotals = false;           // 正在写总分单元格，onItemChanged 忽略
+    QList<QPair<int, int>> m_importColumns; // 导入中：源数据列 -> 表格列（小组列除外）
+    int m_importColumnCount = 0;            // 导入中：源数据的列数
+    int m_importGroupColumn = -1;           // 导入中：源数据的小组列
+    int m_importGroupTarget = -1;           // 导入中：表格的小组列
+    QString m_importCurrentGroup;           // 导入中：上一行的小组名
 };
\ No newline at end of file
@@ -0,0 +1,136 @@
+﻿#include "TaControlFrame.h"
+#include "./zlib/zlib.h"
+#include <QDataStream>
+#include <QJsonDocument>
+#include <QCborValue>
+#include <QCborMap>
+#include <QDebug>
+
+QByteArray TaControlFrame::encode(const QString& target, const QJsonObject& obj, bool useCbor, int compressLevel)
+{
+    quint8 flags = 0;
+    QByteArray payload;
+    if (useCbor)
+    {
+        payload = QCborValue::fromJsonValue(obj).toCbor();
+        flags |= Cbor;
+    }
+    else
+    {
+        payload = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    }
+
+    quint32 rawLen = payload.size();
+    if (compressLevel != Z_NO_COMPRESSION && payload.size() >= kCompressThreshold)
+    {
+        QByteArray deflated = deflate(payload, compressLevel);
+        if (!deflated.isEmpty() && deflated.size() < payload.size())
+        {
+            payload = deflated;
+            flags |= Deflated;
+        }
+    }
+
+    QByteArray packet;
+    packet.reserve(payload.size() + target.size() * 3 + 14);
+    QDataStream ds(&packet, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+
+    ds << kFrameType;
+    ds << flags;
+
+    QByteArray targetBytes = target.toUtf8();
+    quint32 targetLen = targetBytes.size();
+    ds << targetLen;
+    ds.writeRawData(targetBytes.constData(), targetLen);
+
+    quint32 payloadLen = payload.size();
+    ds << rawLen;
+    ds << payloadLen;
+    ds.writeRawData(payload.constData(), payloadLen);
+    return packet;
+}
+
+bool TaControlFrame::isControlFrame(const QByteArray& packet)
+{
+    return !packet.isEmpty() && (quint8)packet.at(0) == kFrameType;
+}
+
+bool TaControlFrame::decode(const QByteArray& packet, QString* target, QJsonObject* obj)
+{
+    QDataStream ds(packet);
+    ds.setByteOrder(QDataStream::LittleEndian);
+
+    quint8 frameType = 0;
+    quint8 flags = 0;
+    ds >> frameType >> flags;
+    if (frameType != kFrameType) return false;
+
+    quint32 targetLen = 0;
+    ds >> targetLen;
+    if (targetLen > (quint32)packet.size()) return false;
+    QByteArray targetBytes(targetLen, 0);
+    ds.readRawData(targetBytes.data(), targetLen);
+
+    quint32 rawLen = 0;
+    quint32 payloadLen = 0;
+    ds >> rawLen >> payloadLen;
+    if (ds.status() != QDataStream::Ok || payloadLen > (quint32)packet.size()) return false;
+    QByteArray payload(payloadLen, 0);
+    if (ds.readRawData(payload.data(), payloadLen) != (int)payloadLen) return false;
+
+    if (flags & Deflated)
+    {
+        if (rawLen > (quint32)kMaxRawLen) return false;
+        payload = inflate(payload, rawLen);
+        if (payload.size() != (int)rawLen) return false;
+    }
+
+    if (flags & Cbor)
+    {
+        QCborValue value = QCborValue::fromCbor(payload);
+        if (!value.isMap()) return false;
+        *obj = value.toMap().toJsonObject();
+    }
+    else
+    {
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(payload, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) return false;
+        *obj = doc.object();
+    }
+
+    if (target)
+    {
+        *target = QString::fromUtf8(targetBytes);
+    }
+    return true;
+}
+
+QByteArray TaControlFrame::deflate(const QByteArray& data, int level)
+{
+    uLong destLen = compressBound(data.size());
+    QByteArray out(destLen, 0);
+    int ret = compress2((Bytef*)out.data(), &destLen, (const Bytef*)data.constData(), data.size(), level);
+    if (ret != Z_OK)
+    {
+        qWarning() << "TaControlFrame compress2 failed:" << ret;
+        return QByteArray();
+    }
+    out.resize(destLen);
+    return out;
+}
+
+QByteArray TaControlFrame::inflate(const QByteArray& data, int rawLen)
+{
+    uLongf destLen = rawLen;
+    QByteArray out(rawLen, 0);
+    int ret = uncompress((Bytef*)out.data(), &destLen, (const Bytef*)data.constData(), data.size());
+    if (ret != Z_OK)
+    {
+        qWarning() << "TaControlFrame uncompress failed:" << ret;
+        return QByteArray();
+    }
+    out.resize(destLen);
+    return out;
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QJsonObject>
+
+// WebSocket 控制消息的二进制封包（帧类型 7，与音频帧 6 共用二进制通道）
+//
+// | u8 frameType=7 | u8 flags | u32 targetLen | target | u32 rawLen | u32 payloadLen | payload |
+//
+// 整数均为小端；target 为空表示发给服务端，否则等价于文本协议的 "to:<target>:"。
+// flags bit0：payload 经 zlib 压缩，rawLen 为压缩前长度；
+// flags bit1：payload 为 CBOR，否则为紧凑 JSON。
+class TaControlFrame
+{
+public:
+	enum Flag
+	{
+		Deflated = 0x01,
+		Cbor = 0x02,
+	};
+
+	static const quint8 kFrameType = 7;
+	// 小于该长度的 payload 压缩收益抵不过 zlib 头尾，直接明文发送
+	static const int kCompressThreshold = 256;
+	// 解压后长度上限，防止异常帧申请过大内存
+	static const int kMaxRawLen = 16 * 1024 * 1024;
+
+	static QByteArray encode(const QString& target, const QJsonObject& obj, bool useCbor, int compressLevel);
+	static bool isControlFrame(const QByteArray& packet);
+	static bool decode(const QByteArray& packet, QString* target, QJsonObject* obj);
+
+	static QByteArray deflate(const QByteArray& data, int level);
+	static QByteArray inflate(const QByteArray& data, int rawLen);
+};
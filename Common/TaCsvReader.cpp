@@ -0,0 +1,197 @@
+﻿#include "TaCsvReader.h"
+#include <QTextCodec>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TA_CSV_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef TA_CSV_SSE2
+static inline int lowestBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return int(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+static inline bool isSpecial(char c)
+{
+	return c == ',' || c == '"' || c == '\r' || c == '\n';
+}
+
+TaCsvReader::TaCsvReader(const QString& fileName)
+	: m_file(fileName)
+	, m_data(NULL)
+	, m_size(0)
+	, m_pos(0)
+	, m_encoding(Utf8)
+	, m_codec(NULL)
+{
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		m_errorString = m_file.errorString();
+		return;
+	}
+
+	m_size = m_file.size();
+	uchar* mapped = m_size > 0 ? m_file.map(0, m_size) : NULL;
+	if (mapped) {
+		m_data = reinterpret_cast<const char*>(mapped);
+	} else {
+		m_buffer = m_file.readAll();
+		m_size = m_buffer.size();
+		m_data = m_buffer.constData();
+	}
+
+	if (m_size >= 3 && memcmp(m_data, "\xEF\xBB\xBF", 3) == 0) {
+		m_pos = 3;
+	} else if (!isUtf8(m_data, m_size)) {
+		// 学校信息系统导出的 CSV 多为 GBK；GB18030 兼容 GBK
+		m_encoding = Gbk;
+		m_codec = QTextCodec::codecForName("GB18030");
+		if (!m_codec)
+			m_codec = QTextCodec::codecForName("GBK");
+	}
+}
+
+TaCsvReader::~TaCsvReader()
+{
+	m_file.close(); // 映射随文件关闭解除
+}
+
+bool TaCsvReader::isUtf8(const char* data, qint64 size)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+	qint64 i = 0;
+	while (i < size) {
+		// ASCII 一次跳过 8 字节
+		if (i + 8 <= size) {
+			quint64 word;
+			memcpy(&word, p + i, 8);
+			if ((word & Q_UINT64_C(0x8080808080808080)) == 0) {
+				i += 8;
+				continue;
+			}
+		}
+
+		const unsigned char lead = p[i];
+		int extra;
+		if (lead < 0x80)
+			extra = 0;
+		else if (lead >= 0xC2 && lead <= 0xDF)
+			extra = 1;
+		else if (lead >= 0xE0 && lead <= 0xEF)
+			extra = 2;
+		else if (lead >= 0xF0 && lead <= 0xF4)
+			extra = 3;
+		else
+			return false;
+
+		if (i + extra >= size && extra > 0)
+			return false;
+		for (int k = 1; k <= extra; ++k) {
+			if ((p[i + k] & 0xC0) != 0x80)
+				return false;
+		}
+		i += extra + 1;
+	}
+	return true;
+}
+
+qint64 TaCsvReader::findSpecial(qint64 from) const
+{
+#ifdef TA_CSV_SSE2
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	while (from + 16 <= m_size) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_data + from));
+		const __m128i hit = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, quote)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf)));
+		const int mask = _mm_movemask_epi8(hit);
+		if (mask)
+			return from + lowestBit(unsigned(mask));
+		from += 16;
+	}
+#endif
+	while (from < m_size && !isSpecial(m_data[from]))
+		++from;
+	return from;
+}
+
+qint64 TaCsvReader::findQuote(qint64 from) const
+{
+	if (from >= m_size)
+		return m_size;
+	const void* hit = memchr(m_data + from, '"', size_t(m_size - from));
+	return hit ? static_cast<const char*>(hit) - m_data : m_size;
+}
+
+QString TaCsvReader::decode(const char* data, qint64 size) const
+{
+	if (m_encoding == Gbk && m_codec)
+		return m_codec->toUnicode(data, int(size));
+	return QString::fromUtf8(data, int(size));
+}
+
+bool TaCsvReader::readRecord(QStringList& fields)
+{
+	fields.clear();
+	if (!m_data || m_pos >= m_size)
+		return false;
+
+	for (;;) {
+		if (m_pos < m_size && m_data[m_pos] == '"') {
+			// 引号字段："" 是一个引号，结束引号之后到分隔符之间的内容也并入字段
+			QByteArray value;
+			qint64 pos = m_pos + 1;
+			for (;;) {
+				const qint64 quote = findQuote(pos);
+				value.append(m_data + pos, int(quote - pos));
+				if (quote >= m_size) {
+					pos = m_size; // 引号未闭合，取到文件末尾
+					break;
+				}
+				if (quote + 1 < m_size && m_data[quote + 1] == '"') {
+					value.append('"');
+					pos = quote + 2;
+					continue;
+				}
+				pos = quote + 1;
+				break;
+			}
+			qint64 end = pos;
+			while (end < m_size && m_data[end] != ',' && m_data[end] != '\r' && m_data[end] != '\n')
+				++end;
+			value.append(m_data + pos, int(end - pos));
+			fields.append(decode(value.constData(), value.size()));
+			m_pos = end;
+		} else {
+			// 非引号字段中的引号按普通字符处理
+			qint64 end = findSpecial(m_pos);
+			while (end < m_size && m_data[end] == '"')
+				end = findSpecial(end + 1);
+			fields.append(decode(m_data + m_pos, end - m_pos));
+			m_pos = end;
+		}
+
+		if (m_pos >= m_size)
+			return true;
+		const char c = m_data[m_pos++];
+		if (c == ',')
+			continue;
+		if (c == '\r' && m_pos < m_size && m_data[m_pos] == '\n')
+			++m_pos;
+		return true;
+	}
+}
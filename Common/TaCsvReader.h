@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QFile>
+
+class QTextCodec;
+
+// CSV 流式读取（RFC 4180）：文件整体内存映射，按字节扫描分隔符和引号，逐条记录解码返回，
+// 不把整个文件转成 QString。
+// 引号字段内可以有逗号、换行和 "" 转义；行尾 \n、\r\n、\r 均可。
+// 编码：有 UTF-8 BOM 或整体是合法 UTF-8 时按 UTF-8，否则按 GBK（GB18030）；
+// 两种编码下 , " \r \n 都只会以单字节出现，所以可以先按字节切分再逐字段解码。
+//
+//     TaCsvReader reader(fileName);
+//     QStringList fields;
+//     while (reader.readRecord(fields))
+//         use(fields);
+class TaCsvReader
+{
+public:
+	enum Encoding
+	{
+		Utf8,
+		Gbk
+	};
+
+	explicit TaCsvReader(const QString& fileName);
+	~TaCsvReader();
+
+	bool isOpen() const { return m_data != NULL; }
+	QString errorString() const { return m_errorString; }
+	Encoding encoding() const { return m_encoding; }
+
+	// 读取下一条记录，字段原样返回（不 trim）；空行返回一个空字段；文件结束返回 false
+	bool readRecord(QStringList& fields);
+
+	// 已读字节数 / 文件字节数，用于显示进度
+	qint64 position() const { return m_pos; }
+	qint64 size() const { return m_size; }
+
+private:
+	Q_DISABLE_COPY(TaCsvReader)
+
+	qint64 findSpecial(qint64 from) const; // 下一个 , " \r \n
+	qint64 findQuote(qint64 from) const;   // 下一个 "
+	QString decode(const char* data, qint64 size) const;
+	static bool isUtf8(const char* data, qint64 size);
+
+	QFile m_file;
+	QByteArray m_buffer;   // 不能映射时（如管道、资源文件）读入的内容
+	const char* m_data;
+	qint64 m_size;
+	qint64 m_pos;
+	Encoding m_encoding;
+	QTextCodec* m_codec;
+	QString m_errorString;
+};
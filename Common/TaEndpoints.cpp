@@ -0,0 +1,70 @@
+﻿#include "TaEndpoints.h"
+#include <QtGlobal>
+#include <QDebug>
+
+QString TaEndpoints::m_baseUrl = QStringLiteral("http://47.100.126.194:5000");
+QString TaEndpoints::m_wsBaseUrl = QStringLiteral("ws://47.100.126.194:5000");
+
+void TaEndpoints::initFromEnvironment()
+{
+    QString baseUrl = QString::fromLocal8Bit(qgetenv("TA_SERVER_URL"));
+    if (!baseUrl.isEmpty())
+    {
+        setBaseUrl(baseUrl);
+    }
+
+    QString wsBaseUrl = QString::fromLocal8Bit(qgetenv("TA_WS_URL"));
+    if (!wsBaseUrl.isEmpty())
+    {
+        setWsBaseUrl(wsBaseUrl);
+    }
+    qInfo() << "server:" << m_baseUrl << "websocket:" << m_wsBaseUrl;
+}
+
+void TaEndpoints::setBaseUrl(const QString& baseUrl)
+{
+    m_baseUrl = baseUrl;
+    while (m_baseUrl.endsWith('/'))
+    {
+        m_baseUrl.chop(1);
+    }
+
+    m_wsBaseUrl = m_baseUrl;
+    if (m_wsBaseUrl.startsWith("https://"))
+    {
+        m_wsBaseUrl.replace(0, 5, "wss");
+    }
+    else if (m_wsBaseUrl.startsWith("http://"))
+    {
+        m_wsBaseUrl.replace(0, 4, "ws");
+    }
+}
+
+void TaEndpoints::setWsBaseUrl(const QString& wsBaseUrl)
+{
+    m_wsBaseUrl = wsBaseUrl;
+    while (m_wsBaseUrl.endsWith('/'))
+    {
+        m_wsBaseUrl.chop(1);
+    }
+}
+
+QString TaEndpoints::baseUrl()
+{
+    return m_baseUrl;
+}
+
+QString TaEndpoints::wsBaseUrl()
+{
+    return m_wsBaseUrl;
+}
+
+QString TaEndpoints::url(const QString& path)
+{
+    return m_baseUrl + path;
+}
+
+QString TaEndpoints::wsUrl(const QString& teacherUniqueId)
+{
+    return m_wsBaseUrl + "/ws/" + teacherUniqueId;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <QString>
+
+// 服务端地址注册表：所有 HTTP 接口和 WebSocket 地址都从这里拼出来，
+// 默认指向线上服务器，可通过环境变量或 setBaseUrl 切到本地替身服务（TaFakeServer）。
+// 传输层不另设接口：地址注册表就是切换点，各处仍用自己的 QNetworkAccessManager / TAHttpHandler 和 QWebSocket，
+// 指向替身服务后真实的网络栈仍在被测路径上。
+class TaEndpoints
+{
+public:
+	// TA_SERVER_URL=http://127.0.0.1:5000  TA_WS_URL=ws://127.0.0.1:5001
+	static void initFromEnvironment();
+
+	// 同时更新 WebSocket 地址（http -> ws，端口不变）
+	static void setBaseUrl(const QString& baseUrl);
+	static void setWsBaseUrl(const QString& wsBaseUrl);
+
+	static QString baseUrl();
+	static QString wsBaseUrl();
+
+	// path 以 "/" 开头，可带查询串，例如 url("/friends?id_card=")
+	static QString url(const QString& path);
+	static QString wsUrl(const QString& teacherUniqueId);
+
+private:
+	static QString m_baseUrl;
+	static QString m_wsBaseUrl;
+};
@@ -0,0 +1,161 @@
+﻿#include "TaExamAnalysis.h"
+#include "TaScoreStats.h"
+
+#include <QMap>
+#include <QtConcurrent>
+#include <QtNumeric>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	const int kTrendChunk = 512; // 每个趋势任务处理的学生数
+
+	// TaScoreStats::setStudents 需要的最小学生结构
+	struct ScoreEntry
+	{
+		QString id;
+		double score;
+		QMap<QString, double> attributes;
+	};
+}
+
+TaExamAnalysis::TaExamAnalysis()
+	: m_subject(-1)
+	, m_examCount(0)
+	, m_minimum(0)
+	, m_maximum(0)
+{
+}
+
+TaExamAnalysis TaExamAnalysis::compute(const TaExamStore& store, int subject)
+{
+	TaExamAnalysis result;
+	if (subject < 0 || subject >= store.subjectCount())
+		return result;
+
+	const int students = store.studentCount();
+	const int exams = store.examCount();
+	const int classes = store.classCount();
+	result.m_subject = subject;
+	result.m_examCount = exams;
+	result.m_trends.resize(students);
+	result.m_distributions.resize(classes * exams);
+	result.m_classSummaries.resize(classes);
+
+	// 各次考试这一科的成绩列，只读，各线程共享
+	QVector<QVector<float>> columns;
+	columns.reserve(exams);
+	for (int exam = 0; exam < exams; ++exam)
+		columns.append(store.scores(exam, subject));
+	auto scoreOf = [&columns](int student, int exam) {
+		const QVector<float>& values = columns[exam];
+		return student < values.size() ? values[student] : float(qQNaN());
+	};
+
+	// 学生趋势：按学生分块
+	QVector<int> chunks;
+	for (int first = 0; first < students; first += kTrendChunk)
+		chunks.append(first);
+	QtConcurrent::blockingMap(chunks, [&](int& first) {
+		int end = qMin(first + kTrendChunk, students);
+		for (int student = first; student < end; ++student)
+		{
+			Trend& trend = result.m_trends[student];
+			double sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+			for (int exam = 0; exam < exams; ++exam)
+			{
+				float value = scoreOf(student, exam);
+				if (qIsNaN(value))
+					continue;
+				if (trend.examCount == 0)
+					trend.first = value;
+				trend.last = value;
+				++trend.examCount;
+				sumX += exam;
+				sumY += value;
+				sumXY += exam * double(value);
+				sumXX += double(exam) * exam;
+			}
+			double n = trend.examCount;
+			double denominator = n * sumXX - sumX * sumX;
+			if (trend.examCount >= 2 && denominator != 0)
+				trend.slope = float((n * sumXY - sumX * sumY) / denominator);
+		}
+	});
+
+	// 班级分布和班内排序：按班级
+	QVector<QVector<int>> members(classes);
+	for (int student = 0; student < students; ++student)
+		members[store.studentClass(student)].append(student);
+
+	QVector<float> classMinimum(classes, std::numeric_limits<float>::max());
+	QVector<float> classMaximum(classes, std::numeric_limits<float>::lowest());
+	QVector<int> classIndexes(classes);
+	for (int c = 0; c < classes; ++c)
+		classIndexes[c] = c;
+	QtConcurrent::blockingMap(classIndexes, [&](int& classIndex) {
+		QVector<int>& rows = members[classIndex];
+		ClassSummary& summary = result.m_classSummaries[classIndex];
+		summary.students = rows.size();
+
+		for (int exam = 0; exam < exams; ++exam)
+		{
+			QVector<ScoreEntry> entries;
+			entries.reserve(rows.size());
+			for (int student : rows)
+			{
+				float value = scoreOf(student, exam);
+				if (qIsNaN(value))
+					continue;
+				entries.append(ScoreEntry{ QString::number(student), value, QMap<QString, double>() });
+				classMinimum[classIndex] = qMin(classMinimum[classIndex], value);
+				classMaximum[classIndex] = qMax(classMaximum[classIndex], value);
+			}
+
+			TaScoreStats stats;
+			stats.setStudents(entries);
+			Distribution& distribution = result.m_distributions[classIndex * exams + exam];
+			distribution.count = stats.count(QString());
+			distribution.mean = stats.mean(QString());
+			distribution.stddev = stats.stddev(QString());
+			distribution.p25 = stats.percentile(QString(), 25);
+			distribution.median = stats.percentile(QString(), 50);
+			distribution.p75 = stats.percentile(QString(), 75);
+		}
+
+		for (int student : rows)
+		{
+			const Trend& trend = result.m_trends[student];
+			if (trend.examCount < 2)
+				continue;
+			if (trend.slope > 0)
+				++summary.rising;
+			else if (trend.slope < 0)
+				++summary.falling;
+		}
+
+		std::stable_sort(rows.begin(), rows.end(), [&result](int a, int b) {
+			const Trend& ta = result.m_trends[a];
+			const Trend& tb = result.m_trends[b];
+			if ((ta.examCount > 0) != (tb.examCount > 0))
+				return ta.examCount > 0;
+			return ta.last > tb.last;
+		});
+	});
+
+	bool hasScore = false;
+	for (int c = 0; c < classes; ++c)
+	{
+		result.m_classStarts.append(result.m_rowOrder.size());
+		result.m_rowOrder += members[c];
+		if (classMinimum[c] <= classMaximum[c])
+		{
+			result.m_minimum = hasScore ? qMin(result.m_minimum, classMinimum[c]) : classMinimum[c];
+			result.m_maximum = hasScore ? qMax(result.m_maximum, classMaximum[c]) : classMaximum[c];
+			hasScore = true;
+		}
+	}
+	result.m_classStarts.append(result.m_rowOrder.size());
+	return result;
+}
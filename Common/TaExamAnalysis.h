@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include "TaExamStore.h"
+
+#include <QVector>
+
+// TaExamStore 中某一科目的分析结果：每个学生历次考试的趋势、每个班级每次考试的分布，以及热力图的行顺序。
+// compute 在 QThreadPool 上并行：学生趋势按学生分块计算，班级分布和班内排序按班级计算，
+// 各任务只写自己的那一段结果，不加锁。考试的先后按导入成绩库的顺序。
+class TaExamAnalysis
+{
+public:
+	struct Trend
+	{
+		float slope = 0;    // 最小二乘斜率，每次考试平均涨跌的分数
+		float first = 0;    // 第一次有成绩的考试
+		float last = 0;     // 最近一次有成绩的考试
+		int examCount = 0;  // 有成绩的考试次数，少于 2 次时 slope 为 0
+	};
+
+	struct Distribution
+	{
+		int count = 0;
+		double mean = 0;
+		double stddev = 0;
+		double p25 = 0;
+		double median = 0;
+		double p75 = 0;
+	};
+
+	struct ClassSummary
+	{
+		int students = 0;
+		int rising = 0;  // 趋势向上的人数
+		int falling = 0; // 趋势向下的人数
+	};
+
+	TaExamAnalysis();
+
+	// 阻塞到计算完成；在界面线程外调用
+	static TaExamAnalysis compute(const TaExamStore& store, int subject);
+
+	int subject() const { return m_subject; }
+	int examCount() const { return m_examCount; }
+	int classCount() const { return m_classSummaries.size(); }
+	// 该科目全部成绩的范围，没有成绩时都为 0
+	float minimum() const { return m_minimum; }
+	float maximum() const { return m_maximum; }
+
+	const Trend& trend(int student) const { return m_trends[student]; }
+	const Distribution& distribution(int classIndex, int exam) const { return m_distributions[classIndex * m_examCount + exam]; }
+	const ClassSummary& classSummary(int classIndex) const { return m_classSummaries[classIndex]; }
+
+	// 热力图的行：按班级排列，班内按最近一次成绩从高到低，没有成绩的排在最后
+	const QVector<int>& rowOrder() const { return m_rowOrder; }
+	// 每个班级在 rowOrder 中的起始行，末尾多一项为总行数
+	const QVector<int>& classStarts() const { return m_classStarts; }
+
+private:
+	int m_subject;
+	int m_examCount;
+	float m_minimum;
+	float m_maximum;
+	QVector<Trend> m_trends;
+	QVector<Distribution> m_distributions; // [班级 * 考试数 + 考试]
+	QVector<ClassSummary> m_classSummaries;
+	QVector<int> m_rowOrder;
+	QVector<int> m_classStarts;
+};
@@ -0,0 +1,134 @@
+﻿#include "TaExamStore.h"
+
+#include <QtNumeric>
+
+TaExamStore::TaExamStore()
+{
+}
+
+void TaExamStore::clear()
+{
+	m_studentIds.clear();
+	m_studentNames.clear();
+	m_studentClasses.clear();
+	m_studentIndex.clear();
+	m_classes.clear();
+	m_exams.clear();
+	m_subjects.clear();
+	m_scores.clear();
+}
+
+int TaExamStore::addClass(const QString& name)
+{
+	int index = m_classes.indexOf(name);
+	if (index >= 0)
+		return index;
+	m_classes.append(name);
+	return m_classes.size() - 1;
+}
+
+int TaExamStore::addExam(const QString& name)
+{
+	int index = m_exams.indexOf(name);
+	if (index >= 0)
+		return index;
+	m_exams.append(name);
+	m_scores.append(QVector<QVector<float>>(m_subjects.size()));
+	return m_exams.size() - 1;
+}
+
+int TaExamStore::addSubject(const QString& name)
+{
+	int index = m_subjects.indexOf(name);
+	if (index >= 0)
+		return index;
+	m_subjects.append(name);
+	for (auto& exam : m_scores)
+		exam.append(QVector<float>());
+	return m_subjects.size() - 1;
+}
+
+int TaExamStore::addStudent(int classIndex, const QString& id, const QString& name)
+{
+	QString key = QString::number(classIndex) + QLatin1Char('/') + id;
+	auto it = m_studentIndex.constFind(key);
+	if (it != m_studentIndex.constEnd())
+	{
+		// 后导入的表里姓名不为空时以它为准
+		if (!name.isEmpty())
+			m_studentNames[it.value()] = name;
+		return it.value();
+	}
+
+	m_studentIds.append(id);
+	m_studentNames.append(name);
+	m_studentClasses.append(classIndex);
+	m_studentIndex.insert(key, m_studentIds.size() - 1);
+	return m_studentIds.size() - 1;
+}
+
+float TaExamStore::score(int student, int exam, int subject) const
+{
+	const QVector<float>& values = m_scores[exam][subject];
+	return student < values.size() ? values[student] : float(qQNaN());
+}
+
+void TaExamStore::setScore(int student, int exam, int subject, float value)
+{
+	QVector<float>& values = m_scores[exam][subject];
+	// 只在写入时补齐到该学生，没成绩的列不占空间
+	if (values.size() <= student)
+	{
+		int from = values.size();
+		values.resize(student + 1);
+		for (int i = from; i < student; ++i)
+			values[i] = float(qQNaN());
+	}
+	values[student] = value;
+}
+
+QVector<float> TaExamStore::scores(int exam, int subject) const
+{
+	return m_scores[exam][subject];
+}
+
+int TaExamStore::addTable(const QString& className, const QString& examName,
+	const QStringList& headers, const QList<QStringList>& rows)
+{
+	int idColumn = headers.indexOf(QStringLiteral("学号"));
+	int nameColumn = headers.indexOf(QStringLiteral("姓名"));
+	if (idColumn < 0)
+		return -1;
+
+	int classIndex = addClass(className);
+	int exam = addExam(examName);
+
+	// 表头列 -> 科目编号，学号、姓名、空表头不是科目
+	QVector<int> subjects(headers.size(), -1);
+	for (int col = 0; col < headers.size(); ++col)
+	{
+		if (col == idColumn || col == nameColumn || headers[col].trimmed().isEmpty())
+			continue;
+		subjects[col] = addSubject(headers[col].trimmed());
+	}
+
+	int imported = 0;
+	for (const QStringList& row : rows)
+	{
+		QString id = row.value(idColumn).trimmed();
+		if (id.isEmpty())
+			continue;
+
+		int student = addStudent(classIndex, id, nameColumn >= 0 ? row.value(nameColumn).trimmed() : QString());
+		for (int col = 0; col < subjects.size(); ++col)
+		{
+			if (subjects[col] < 0)
+				continue;
+			bool ok = false;
+			double value = row.value(col).trimmed().toDouble(&ok);
+			setScore(student, exam, subjects[col], ok ? float(value) : float(qQNaN()));
+		}
+		++imported;
+	}
+	return imported;
+}
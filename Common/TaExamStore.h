@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+// 多班级、多次考试的成绩库：学生 × 考试 × 科目，按列存储。
+// 每个（考试，科目）一列 float，按学生编号下标，缺考或未录入为 NaN；学号、姓名、班级只存一份。
+// 同一班级内学号相同的视为同一个学生，不同考试的成绩表按学号对齐到同一行。
+// 内部数组都是隐式共享的，复制一份交给后台线程计算不复制数据。
+class TaExamStore
+{
+public:
+	TaExamStore();
+
+	void clear();
+
+	int studentCount() const { return m_studentIds.size(); }
+	int examCount() const { return m_exams.size(); }
+	int subjectCount() const { return m_subjects.size(); }
+	int classCount() const { return m_classes.size(); }
+
+	QString studentId(int student) const { return m_studentIds[student]; }
+	QString studentName(int student) const { return m_studentNames[student]; }
+	int studentClass(int student) const { return m_studentClasses[student]; }
+	QString className(int classIndex) const { return m_classes[classIndex]; }
+	QString examName(int exam) const { return m_exams[exam]; }
+	QString subjectName(int subject) const { return m_subjects[subject]; }
+	// 找不到返回 -1
+	int findSubject(const QString& name) const { return m_subjects.indexOf(name); }
+
+	// 已有同名的返回原来的编号
+	int addClass(const QString& name);
+	int addExam(const QString& name);
+	int addSubject(const QString& name);
+	int addStudent(int classIndex, const QString& id, const QString& name);
+
+	float score(int student, int exam, int subject) const;
+	void setScore(int student, int exam, int subject, float value);
+	// 一列成绩，可能比学生数短，超出部分视为 NaN
+	QVector<float> scores(int exam, int subject) const;
+
+	// 导入一张成绩表：学号、姓名列按表头找，其余列都作为科目，不能解析为数字的格子记为缺考。
+	// 没有学号列时返回 -1，否则返回导入的行数
+	int addTable(const QString& className, const QString& examName,
+		const QStringList& headers, const QList<QStringList>& rows);
+
+private:
+	QStringList m_studentIds;
+	QStringList m_studentNames;
+	QVector<int> m_studentClasses;
+	QHash<QString, int> m_studentIndex; // 班级编号 + 学号 -> 学生编号
+	QStringList m_classes;
+	QStringList m_exams;
+	QStringList m_subjects;
+	QVector<QVector<QVector<float>>> m_scores; // [考试][科目][学生]
+};
@@ -0,0 +1,483 @@
+﻿#include "TaFakeServer.h"
+#include "TaEndpoints.h"
+#include "TaControlFrame.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QPointer>
+#include <QDateTime>
+#include <QUrl>
+#include <QDebug>
+
+TaFakeServer::TaFakeServer(const TaFakeServerConfig& config, QObject* parent)
+    : QObject(parent)
+    , m_config(config)
+{
+    if (m_config.avatarBytes > 0)
+    {
+        m_avatarBase64 = QString::fromLatin1(QByteArray(m_config.avatarBytes, '\x5a').toBase64());
+    }
+}
+
+TaFakeServer::~TaFakeServer()
+{
+    stop();
+}
+
+bool TaFakeServer::start(quint16 httpPort, quint16 wsPort)
+{
+    m_httpServer = new QTcpServer(this);
+    connect(m_httpServer, &QTcpServer::newConnection, this, &TaFakeServer::onNewHttpConnection);
+    if (!m_httpServer->listen(QHostAddress::LocalHost, httpPort))
+    {
+        qWarning() << "TaFakeServer http listen failed:" << m_httpServer->errorString();
+        return false;
+    }
+
+    m_wsServer = new QWebSocketServer(QStringLiteral("TaFakeServer"), QWebSocketServer::NonSecureMode, this);
+    connect(m_wsServer, &QWebSocketServer::newConnection, this, &TaFakeServer::onNewWsConnection);
+    if (!m_wsServer->listen(QHostAddress::LocalHost, wsPort))
+    {
+        qWarning() << "TaFakeServer websocket listen failed:" << m_wsServer->errorString();
+        return false;
+    }
+
+    if (m_config.notifyIntervalMs > 0)
+    {
+        m_notifyTimer = new QTimer(this);
+        connect(m_notifyTimer, &QTimer::timeout, this, &TaFakeServer::pushNotifications);
+        m_notifyTimer->start(m_config.notifyIntervalMs);
+    }
+
+    TaEndpoints::setBaseUrl(QString("http://127.0.0.1:%1").arg(this->httpPort()));
+    TaEndpoints::setWsBaseUrl(QString("ws://127.0.0.1:%1").arg(this->wsPort()));
+    qInfo() << "TaFakeServer started, http:" << this->httpPort() << "ws:" << this->wsPort();
+    return true;
+}
+
+void TaFakeServer::stop()
+{
+    if (m_notifyTimer)
+    {
+        m_notifyTimer->stop();
+    }
+    // close() 会同步触发 disconnected，先取出再关闭
+    QList<QWebSocket*> clients = m_clients.values();
+    m_clients.clear();
+    for (QWebSocket* client : clients)
+    {
+        client->close();
+    }
+    if (m_wsServer)
+    {
+        m_wsServer->close();
+    }
+    if (m_httpServer)
+    {
+        m_httpServer->close();
+    }
+}
+
+quint16 TaFakeServer::httpPort() const
+{
+    return m_httpServer ? m_httpServer->serverPort() : 0;
+}
+
+quint16 TaFakeServer::wsPort() const
+{
+    return m_wsServer ? m_wsServer->serverPort() : 0;
+}
+
+QMap<QString, qint64> TaFakeServer::receivedBytes() const
+{
+    return m_receivedBytes;
+}
+
+TaFakeServer* TaFakeServer::installFromEnvironment(QObject* parent)
+{
+    if (qEnvironmentVariableIntValue("TA_FAKE_SERVER") == 0)
+    {
+        return nullptr;
+    }
+
+    auto envInt = [](const char* name, int def) {
+        bool ok = false;
+        int value = qEnvironmentVariableIntValue(name, &ok);
+        return ok ? value : def;
+    };
+
+    TaFakeServerConfig config;
+    config.latencyMs = envInt("TA_FAKE_LATENCY_MS", config.latencyMs);
+    config.jitterMs = envInt("TA_FAKE_JITTER_MS", config.jitterMs);
+    config.groupCount = envInt("TA_FAKE_GROUPS", config.groupCount);
+    config.membersPerGroup = envInt("TA_FAKE_MEMBERS", config.membersPerGroup);
+    config.friendCount = envInt("TA_FAKE_FRIENDS", config.friendCount);
+    config.avatarBytes = envInt("TA_FAKE_AVATAR_BYTES", config.avatarBytes);
+    config.notifyIntervalMs = envInt("TA_FAKE_NOTIFY_MS", config.notifyIntervalMs);
+    config.notifyBatch = envInt("TA_FAKE_NOTIFY_BATCH", config.notifyBatch);
+
+    TaFakeServer* server = new TaFakeServer(config, parent);
+    if (!server->start())
+    {
+        delete server;
+        return nullptr;
+    }
+    return server;
+}
+
+void TaFakeServer::onNewHttpConnection()
+{
+    while (QTcpSocket* socket = m_httpServer->nextPendingConnection())
+    {
+        connect(socket, &QTcpSocket::readyRead, this, &TaFakeServer::onHttpReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_pending.remove(socket);
+            socket->deleteLater();
+            });
+    }
+}
+
+void TaFakeServer::onHttpReadyRead()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) return;
+
+    QByteArray& buffer = m_pending[socket];
+    buffer += socket->readAll();
+
+    // 同一连接上可能连续到达多个请求（keep-alive）
+    while (true)
+    {
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) return;
+
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+        if (requestLine.size() < 2)
+        {
+            socket->disconnectFromHost();
+            return;
+        }
+
+        int contentLength = 0;
+        bool keepAlive = true;
+        for (int i = 1; i < lines.size(); ++i)
+        {
+            QByteArray line = lines[i].trimmed();
+            int colon = line.indexOf(':');
+            if (colon <= 0) continue;
+            QByteArray name = line.left(colon).trimmed().toLower();
+            QByteArray value = line.mid(colon + 1).trimmed();
+            if (name == "content-length")
+            {
+                contentLength = value.toInt();
+            }
+            else if (name == "connection" && value.toLower() == "close")
+            {
+                keepAlive = false;
+            }
+        }
+
+        int total = headerEnd + 4 + contentLength;
+        if (buffer.size() < total) return;
+
+        QByteArray method = requestLine[0];
+        QUrl url(QString::fromUtf8(requestLine[1]));
+        QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, total);
+
+        m_receivedBytes[url.path()] += body.size();
+        QByteArray response = QJsonDocument(handle(method, url.path(), QUrlQuery(url), body)).toJson(QJsonDocument::Compact);
+
+        int delay = responseDelay();
+        if (delay <= 0)
+        {
+            reply(socket, response, keepAlive);
+        }
+        else
+        {
+            QPointer<QTcpSocket> guard(socket);
+            QTimer::singleShot(delay, this, [this, guard, response, keepAlive]() {
+                if (guard)
+                {
+                    reply(guard, response, keepAlive);
+                }
+                });
+        }
+
+        if (!keepAlive) return;
+    }
+}
+
+void TaFakeServer::reply(QTcpSocket* socket, const QByteArray& body, bool keepAlive)
+{
+    QByteArray header = "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json; charset=utf-8\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    header += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    socket->write(header);
+    socket->write(body);
+    if (!keepAlive)
+    {
+        socket->disconnectFromHost();
+    }
+}
+
+int TaFakeServer::responseDelay() const
+{
+    int delay = m_config.latencyMs;
+    if (m_config.jitterMs > 0)
+    {
+        delay += QRandomGenerator::global()->bounded(m_config.jitterMs + 1);
+    }
+    return delay;
+}
+
+QJsonObject TaFakeServer::handle(const QByteArray& method, const QString& path, const QUrlQuery& query, const QByteArray& body)
+{
+    Q_UNUSED(body);
+
+    QJsonObject status;
+    status["code"] = 200;
+    status["message"] = "ok";
+
+    QJsonObject result;
+    result["code"] = 200;
+    result["message"] = "ok";
+
+    if (method == "GET" && path == "/friends")
+    {
+        result["friends"] = makeFriends();
+        result["data"] = status;
+    }
+    else if (method == "GET" && path == "/groups/by-teacher")
+    {
+        // 与 FriendGroupDialog / SearchDialog 解析的结构一致：偶数号群由本人创建，奇数号为加入的群
+        QJsonArray ownerGroups;
+        QJsonArray memberGroups;
+        const QJsonArray groups = makeGroups();
+        for (int i = 0; i < groups.size(); ++i)
+        {
+            (i % 2 == 0 ? ownerGroups : memberGroups).append(groups[i]);
+        }
+        QJsonObject data = status;
+        data["owner_groups"] = ownerGroups;
+        data["member_groups"] = memberGroups;
+        result["data"] = data;
+    }
+    else if (method == "GET" && path == "/groups/search")
+    {
+        QJsonObject data = status;
+        data["groups"] = makeGroups();
+        data["count"] = m_config.groupCount;
+        result["data"] = data;
+    }
+    else if (method == "GET" && path == "/groups/members")
+    {
+        QJsonObject data = status;
+        data["members"] = makeMembers(query.queryItemValue("group_id"));
+        result["data"] = data;
+    }
+    else
+    {
+        // /groups/sync、/groups/join、/student-scores/save 等写接口只回执
+        result["data"] = status;
+    }
+    return result;
+}
+
+QJsonObject TaFakeServer::makeGroup(int index) const
+{
+    QJsonObject group;
+    group["group_id"] = QString("fake_group_%1").arg(index);
+    group["group_name"] = QString("测试班级群%1").arg(index);
+    group["classid"] = QString("fake_class_%1").arg(index);
+    group["schoolid"] = "fake_school";
+    group["member_num"] = m_config.membersPerGroup;
+    group["face_url"] = QString("/images/fake_group_%1.png").arg(index);
+    group["avatar_base64"] = m_avatarBase64;
+    return group;
+}
+
+QJsonArray TaFakeServer::makeGroups() const
+{
+    QJsonArray groups;
+    for (int i = 0; i < m_config.groupCount; ++i)
+    {
+        groups.append(makeGroup(i));
+    }
+    return groups;
+}
+
+QJsonArray TaFakeServer::makeFriends() const
+{
+    QJsonArray friends;
+    for (int i = 0; i < m_config.friendCount; ++i)
+    {
+        QString idNumber = QString("fake_id_%1").arg(i, 6, 10, QChar('0'));
+
+        QJsonObject teacherInfo;
+        teacherInfo["id"] = i + 1;
+        teacherInfo["name"] = QString("教师%1").arg(i);
+        teacherInfo["subject"] = "语文";
+        teacherInfo["id_card"] = idNumber;
+
+        QJsonObject userDetails;
+        userDetails["phone"] = QString("1380000%1").arg(i, 4, 10, QChar('0'));
+        userDetails["name"] = teacherInfo["name"];
+        userDetails["sex"] = (i % 2) ? "男" : "女";
+        userDetails["avatar"] = QString("/avatars/%1.png").arg(idNumber);
+        userDetails["id_number"] = idNumber;
+        userDetails["avatar_base64"] = m_avatarBase64;
+
+        QJsonObject friendObj;
+        friendObj["teacher_info"] = teacherInfo;
+        friendObj["user_details"] = userDetails;
+        friends.append(friendObj);
+    }
+    return friends;
+}
+
+QJsonArray TaFakeServer::makeMembers(const QString& groupId) const
+{
+    QJsonArray members;
+    for (int i = 0; i < m_config.membersPerGroup; ++i)
+    {
+        QJsonObject member;
+        member["user_id"] = QString("%1_m%2").arg(groupId).arg(i);
+        member["user_name"] = QString("成员%1").arg(i);
+        member["self_role"] = (i == 0) ? 400 : 200;
+        member["role"] = (i == 0) ? "owner" : "member";
+        members.append(member);
+    }
+    return members;
+}
+
+void TaFakeServer::onNewWsConnection()
+{
+    while (QWebSocket* client = m_wsServer->nextPendingConnection())
+    {
+        // 路径形如 /ws/<teacher_unique_id>
+        QString id = client->requestUrl().path().section('/', -1);
+        if (m_clients.contains(id))
+        {
+            m_clients[id]->close();
+        }
+        m_clients[id] = client;
+        client->setProperty("clientId", id);
+
+        connect(client, &QWebSocket::textMessageReceived, this, &TaFakeServer::onWsTextMessage);
+        connect(client, &QWebSocket::binaryMessageReceived, this, &TaFakeServer::onWsBinaryMessage);
+        connect(client, &QWebSocket::disconnected, this, &TaFakeServer::onWsDisconnected);
+    }
+}
+
+void TaFakeServer::onWsTextMessage(const QString& msg)
+{
+    QWebSocket* client = qobject_cast<QWebSocket*>(sender());
+    if (!client) return;
+
+    if (msg == "ping")
+    {
+        client->sendTextMessage("pong");
+        return;
+    }
+
+    // 私聊协议 to:<id>:<json>，目标不在线时与线上一样回"不在线"
+    if (msg.startsWith("to:"))
+    {
+        QString target = msg.section(':', 1, 1);
+        QString payload = msg.section(':', 2);
+        QWebSocket* peer = m_clients.value(target);
+        if (peer)
+        {
+            peer->sendTextMessage(payload);
+        }
+        else
+        {
+            client->sendTextMessage(QString("%1 不在线").arg(target));
+        }
+        return;
+    }
+
+    client->sendTextMessage(msg);
+}
+
+void TaFakeServer::onWsBinaryMessage(const QByteArray& msg)
+{
+    QWebSocket* client = qobject_cast<QWebSocket*>(sender());
+    if (!client) return;
+
+    // 控制帧转发给目标，没有目标或目标不在线时回显给发送方，便于测量往返字节数
+    if (TaControlFrame::isControlFrame(msg))
+    {
+        QString target;
+        QJsonObject obj;
+        QWebSocket* peer = nullptr;
+        if (TaControlFrame::decode(msg, &target, &obj) && !target.isEmpty())
+        {
+            peer = m_clients.value(target);
+        }
+        (peer ? peer : client)->sendBinaryMessage(msg);
+        return;
+    }
+
+    // 音频等其他帧广播给其他在线客户端
+    for (QWebSocket* peer : m_clients)
+    {
+        if (peer != client)
+        {
+            peer->sendBinaryMessage(msg);
+        }
+    }
+}
+
+void TaFakeServer::onWsDisconnected()
+{
+    QWebSocket* client = qobject_cast<QWebSocket*>(sender());
+    if (!client) return;
+
+    QString id = client->property("clientId").toString();
+    if (m_clients.value(id) == client)
+    {
+        m_clients.remove(id);
+    }
+    client->deleteLater();
+}
+
+void TaFakeServer::pushNotifications()
+{
+    if (m_clients.isEmpty()) return;
+
+    QString now = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+    QJsonArray data;
+    for (int i = 0; i < m_config.notifyBatch; ++i)
+    {
+        int id = m_nextNotifyId++;
+        int groupIndex = m_config.groupCount > 0 ? id % m_config.groupCount : 0;
+
+        QJsonObject n;
+        n["id"] = id;
+        n["sender_id"] = 100000 + id % 97;
+        n["sender_name"] = QString("教师%1").arg(id % 97);
+        n["receiver_id"] = 0;
+        n["unique_group_id"] = QString("fake_group_%1").arg(groupIndex);
+        n["group_name"] = QString("测试班级群%1").arg(groupIndex);
+        n["content"] = QString("通知内容 %1").arg(id);
+        n["content_text"] = 3;
+        n["is_read"] = 0;
+        n["is_agreed"] = 0;
+        n["remark"] = QJsonValue::Null;
+        n["created_at"] = now;
+        n["updated_at"] = now;
+        data.append(n);
+    }
+
+    QJsonObject root;
+    root["data"] = data;
+    QString text = QString::fromUtf8(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    for (QWebSocket* client : m_clients)
+    {
+        client->sendTextMessage(text);
+    }
+}
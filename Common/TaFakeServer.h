@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QTimer>
+#include <QHash>
+#include <QMap>
+#include <QUrlQuery>
+#include <QJsonObject>
+#include <QJsonArray>
+
+// 本地替身服务的规模和网络条件，环境变量见 TaFakeServer::installFromEnvironment
+struct TaFakeServerConfig
+{
+	int latencyMs = 0;          // 每个 HTTP 响应的固定延迟
+	int jitterMs = 0;           // 在固定延迟上叠加的随机抖动
+	int groupCount = 20;        // /groups/by-teacher、/groups/search 返回的群数量
+	int membersPerGroup = 60;   // /groups/members 返回的成员数量（大班级场景）
+	int friendCount = 30;       // /friends 返回的好友数量
+	int avatarBytes = 0;        // 每个头像的原始字节数，用来放大响应体
+	int notifyIntervalMs = 0;   // >0 时定时向已连接的 WebSocket 推送通知
+	int notifyBatch = 10;       // 每次推送的通知条数
+};
+
+// 进程内的服务端替身：在回环地址上实现 /groups/*、/friends、/student-scores/save
+// 等接口和 WebSocket /ws/<id>，启动后把 TaEndpoints 指向自己，
+// 客户端走的仍是真实的 QNetworkAccessManager / QWebSocket 链路，便于端到端压测。
+class TaFakeServer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit TaFakeServer(const TaFakeServerConfig& config, QObject* parent = nullptr);
+	~TaFakeServer();
+
+	// 端口为 0 时由系统分配
+	bool start(quint16 httpPort = 0, quint16 wsPort = 0);
+	void stop();
+
+	quint16 httpPort() const;
+	quint16 wsPort() const;
+
+	// 各接口累计收到的请求体字节数，用于对比上传量
+	QMap<QString, qint64> receivedBytes() const;
+
+	// TA_FAKE_SERVER=1 时创建并启动；可选 TA_FAKE_LATENCY_MS、TA_FAKE_JITTER_MS、
+	// TA_FAKE_GROUPS、TA_FAKE_MEMBERS、TA_FAKE_FRIENDS、TA_FAKE_AVATAR_BYTES、
+	// TA_FAKE_NOTIFY_MS、TA_FAKE_NOTIFY_BATCH
+	static TaFakeServer* installFromEnvironment(QObject* parent);
+
+private slots:
+	void onNewHttpConnection();
+	void onHttpReadyRead();
+	void onNewWsConnection();
+	void onWsTextMessage(const QString& msg);
+	void onWsBinaryMessage(const QByteArray& msg);
+	void onWsDisconnected();
+	void pushNotifications();
+
+private:
+	QJsonObject handle(const QByteArray& method, const QString& path, const QUrlQuery& query, const QByteArray& body);
+	void reply(QTcpSocket* socket, const QByteArray& body, bool keepAlive);
+	QJsonObject makeGroup(int index) const;
+	QJsonArray makeGroups() const;
+	QJsonArray makeFriends() const;
+	QJsonArray makeMembers(const QString& groupId) const;
+	int responseDelay() const;
+
+private:
+	TaFakeServerConfig m_config;
+	QTcpServer* m_httpServer = nullptr;
+	QWebSocketServer* m_wsServer = nullptr;
+	QTimer* m_notifyTimer = nullptr;
+	QHash<QTcpSocket*, QByteArray> m_pending;
+	QHash<QString, QWebSocket*> m_clients;
+	QMap<QString, qint64> m_receivedBytes;
+	QString m_avatarBase64;
+	int m_nextNotifyId = 1;
+};
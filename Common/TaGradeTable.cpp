@@ -0,0 +1,429 @@
+﻿#include "TaGradeTable.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const double kNoNumber = std::numeric_limits<double>::quiet_NaN();
+
+TaGradeTable::TaGradeTable()
+	: m_nextRowKey(0)
+	, m_nextColumnKey(0)
+{
+}
+
+int TaGradeTable::findColumn(const QString& name) const
+{
+	for (int col = 0; col < m_columns.size(); ++col)
+	{
+		if (m_columns[col]->name == name)
+			return col;
+	}
+	return -1;
+}
+
+void TaGradeTable::insertColumn(int col, const QString& name, ColumnKind kind)
+{
+	QSharedPointer<Column> column(new Column);
+	column->name = name;
+	column->kind = kind;
+	column->key = m_nextColumnKey++;
+	int rows = rowCount();
+	if (kind == IdColumn)
+	{
+		column->ids.fill(-1, rows);
+	}
+	else
+	{
+		column->texts.resize(rows);
+		if (kind == ScoreColumn)
+			column->numbers.fill(kNoNumber, rows);
+	}
+	m_columns.insert(col, column);
+}
+
+void TaGradeTable::removeColumn(int col)
+{
+	quint32 key = m_columns[col]->key;
+	for (auto it = m_decorations.begin(); it != m_decorations.end();)
+	{
+		if (quint32(it.key()) == key)
+			it = m_decorations.erase(it);
+		else
+			++it;
+	}
+	m_columns.remove(col);
+}
+
+void TaGradeTable::insertRows(int row, int count)
+{
+	if (count <= 0)
+		return;
+
+	for (const QSharedPointer<Column>& column : m_columns)
+	{
+		if (column->kind == IdColumn)
+		{
+			column->ids.insert(row, count, -1);
+		}
+		else
+		{
+			column->texts.insert(row, count, QString());
+			if (column->kind == ScoreColumn)
+				column->numbers.insert(row, count, kNoNumber);
+		}
+	}
+	m_rowKeys.insert(row, count, 0);
+	for (int i = 0; i < count; ++i)
+		m_rowKeys[row + i] = m_nextRowKey++;
+}
+
+void TaGradeTable::removeRows(int row, int count)
+{
+	if (count <= 0)
+		return;
+
+	if (!m_decorations.isEmpty())
+	{
+		for (int i = row; i < row + count; ++i)
+		{
+			for (const QSharedPointer<Column>& column : m_columns)
+				m_decorations.remove(decorationKey(m_rowKeys[i], column->key));
+		}
+	}
+	for (const QSharedPointer<Column>& column : m_columns)
+	{
+		if (column->kind == IdColumn)
+		{
+			column->ids.remove(row, count);
+		}
+		else
+		{
+			column->texts.remove(row, count);
+			if (column->kind == ScoreColumn)
+				column->numbers.remove(row, count);
+		}
+	}
+	m_rowKeys.remove(row, count);
+}
+
+void TaGradeTable::clearRows()
+{
+	for (const QSharedPointer<Column>& column : m_columns)
+	{
+		column->ids.clear();
+		column->texts.clear();
+		column->numbers.clear();
+	}
+	m_rowKeys.clear();
+	m_decorations.clear();
+}
+
+QString TaGradeTable::text(int row, int col) const
+{
+	const Column& column = *m_columns[col];
+	switch (column.kind)
+	{
+	case IdColumn:
+		return column.ids[row] < 0 ? QString() : m_idPool[column.ids[row]];
+	case ScoreColumn:
+		if (!std::isnan(column.numbers[row]))
+			return QString::number(column.numbers[row], 'g', 15);
+		return column.texts[row];
+	default:
+		return column.texts[row];
+	}
+}
+
+void TaGradeTable::setText(int row, int col, const QString& text)
+{
+	Column& column = *m_columns[col];
+	switch (column.kind)
+	{
+	case IdColumn:
+		column.ids[row] = text.isEmpty() ? -1 : intern(text);
+		break;
+	case ScoreColumn:
+	{
+		bool ok = false;
+		double value = text.toDouble(&ok);
+		if (ok && std::isfinite(value))
+		{
+			column.numbers[row] = value;
+			column.texts[row] = QString();
+		}
+		else
+		{
+			column.numbers[row] = kNoNumber;
+			column.texts[row] = text;
+		}
+		break;
+	}
+	default:
+		column.texts[row] = text;
+		break;
+	}
+}
+
+bool TaGradeTable::number(int row, int col, double* value) const
+{
+	const Column& column = *m_columns[col];
+	if (column.kind != ScoreColumn || std::isnan(column.numbers[row]))
+		return false;
+	*value = column.numbers[row];
+	return true;
+}
+
+QVariant TaGradeTable::decoration(int row, int col, int role) const
+{
+	auto it = m_decorations.constFind(decorationKey(m_rowKeys[row], m_columns[col]->key));
+	if (it == m_decorations.constEnd())
+		return QVariant();
+
+	switch (role)
+	{
+	case Qt::ForegroundRole:
+		return it->foreground;
+	case Qt::BackgroundRole:
+		return it->background;
+	case Qt::UserRole:
+		return it->comment;
+	default:
+		return QVariant();
+	}
+}
+
+void TaGradeTable::setDecoration(int row, int col, int role, const QVariant& value)
+{
+	quint64 key = decorationKey(m_rowKeys[row], m_columns[col]->key);
+	Decoration& decoration = m_decorations[key];
+	switch (role)
+	{
+	case Qt::ForegroundRole:
+		decoration.foreground = value;
+		break;
+	case Qt::BackgroundRole:
+		decoration.background = value;
+		break;
+	case Qt::UserRole:
+		decoration.comment = value;
+		break;
+	default:
+		break;
+	}
+	if (!decoration.foreground.isValid() && !decoration.background.isValid() && !decoration.comment.isValid())
+		m_decorations.remove(key);
+}
+
+int TaGradeTable::intern(const QString& id)
+{
+	auto it = m_idIndex.constFind(id);
+	if (it != m_idIndex.constEnd())
+		return it.value();
+
+	int index = m_idPool.size();
+	m_idPool.append(id);
+	m_idIndex.insert(id, index);
+	return index;
+}
+
+double TaGradeTable::sortKey(int row, int col, bool* ok) const
+{
+	const Column& column = *m_columns[col];
+	if (column.kind == ScoreColumn && !std::isnan(column.numbers[row]))
+	{
+		*ok = true;
+		return column.numbers[row];
+	}
+	return text(row, col).toDouble(ok);
+}
+
+void TaGradeTable::sortRows(int col, bool ascending)
+{
+	const int rows = rowCount();
+	if (rows < 2)
+		return;
+
+	// 每行只解析一次，比较时只读数组
+	QVector<double> keys(rows);
+	QVector<char> numeric(rows);
+	bool allNumeric = true;
+	for (int row = 0; row < rows; ++row)
+	{
+		bool ok = false;
+		keys[row] = sortKey(row, col, &ok);
+		numeric[row] = ok;
+		allNumeric = allNumeric && ok;
+	}
+	QVector<QString> texts;
+	if (!allNumeric)
+	{
+		texts.resize(rows);
+		for (int row = 0; row < rows; ++row)
+			texts[row] = text(row, col);
+	}
+
+	QVector<int> order(rows);
+	for (int row = 0; row < rows; ++row)
+		order[row] = row;
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		if (numeric[a] && numeric[b])
+			return ascending ? keys[a] < keys[b] : keys[a] > keys[b];
+		return ascending ? texts[a] < texts[b] : texts[a] > texts[b];
+	});
+
+	auto permute = [&order](auto& values) {
+		if (values.isEmpty())
+			return;
+		auto sorted = values;
+		for (int i = 0; i < order.size(); ++i)
+			sorted[i] = values[order[i]];
+		values.swap(sorted);
+	};
+	for (const QSharedPointer<Column>& column : m_columns)
+	{
+		permute(column->ids);
+		permute(column->texts);
+		permute(column->numbers);
+	}
+	permute(m_rowKeys);
+}
+
+TaGradeTableModel::TaGradeTableModel(TaGradeTable* grades, QObject* parent)
+	: QAbstractTableModel(parent)
+	, m_grades(grades)
+{
+}
+
+int TaGradeTableModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : m_grades->rowCount();
+}
+
+int TaGradeTableModel::columnCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : m_grades->columnCount();
+}
+
+QVariant TaGradeTableModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid())
+		return QVariant();
+
+	switch (role)
+	{
+	case Qt::DisplayRole:
+	case Qt::EditRole:
+		return m_grades->text(index.row(), index.column());
+	case Qt::TextAlignmentRole:
+		return int(Qt::AlignCenter);
+	case Qt::ForegroundRole:
+	case Qt::BackgroundRole:
+	case Qt::UserRole:
+		return m_grades->decoration(index.row(), index.column(), role);
+	case Qt::ToolTipRole:
+	{
+		// 悬浮时显示注释
+		QString comment = m_grades->decoration(index.row(), index.column(), Qt::UserRole).toString();
+		return comment.isEmpty() ? QVariant() : QVariant(comment);
+	}
+	default:
+		return QVariant();
+	}
+}
+
+bool TaGradeTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+	if (!index.isValid())
+		return false;
+
+	switch (role)
+	{
+	case Qt::EditRole:
+		m_grades->setText(index.row(), index.column(), value.toString());
+		break;
+	case Qt::ForegroundRole:
+	case Qt::BackgroundRole:
+	case Qt::UserRole:
+		m_grades->setDecoration(index.row(), index.column(), role, value);
+		break;
+	default:
+		return false;
+	}
+	emit dataChanged(index, index);
+	return true;
+}
+
+QVariant TaGradeTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section < m_grades->columnCount())
+		return m_grades->columnName(section);
+	return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags TaGradeTableModel::flags(const QModelIndex& index) const
+{
+	return QAbstractTableModel::flags(index) | Qt::ItemIsEditable;
+}
+
+bool TaGradeTableModel::insertRows(int row, int count, const QModelIndex& parent)
+{
+	if (parent.isValid() || count <= 0 || row < 0 || row > m_grades->rowCount())
+		return false;
+
+	beginInsertRows(QModelIndex(), row, row + count - 1);
+	m_grades->insertRows(row, count);
+	endInsertRows();
+	return true;
+}
+
+bool TaGradeTableModel::removeRows(int row, int count, const QModelIndex& parent)
+{
+	if (parent.isValid() || count <= 0 || row < 0 || row + count > m_grades->rowCount())
+		return false;
+
+	beginRemoveRows(QModelIndex(), row, row + count - 1);
+	m_grades->removeRows(row, count);
+	endRemoveRows();
+	return true;
+}
+
+bool TaGradeTableModel::removeColumns(int column, int count, const QModelIndex& parent)
+{
+	if (parent.isValid() || count <= 0 || column < 0 || column + count > m_grades->columnCount())
+		return false;
+
+	beginRemoveColumns(QModelIndex(), column, column + count - 1);
+	for (int i = 0; i < count; ++i)
+		m_grades->removeColumn(column);
+	endRemoveColumns();
+	return true;
+}
+
+void TaGradeTableModel::sort(int column, Qt::SortOrder order)
+{
+	// 选中的单元格停在原来的位置，与原来 QTableWidget 逐格重设的效果一致
+	emit layoutAboutToBeChanged();
+	m_grades->sortRows(column, order == Qt::AscendingOrder);
+	emit layoutChanged();
+}
+
+void TaGradeTableModel::insertGradeColumn(int col, const QString& name, TaGradeTable::ColumnKind kind)
+{
+	beginInsertColumns(QModelIndex(), col, col);
+	m_grades->insertColumn(col, name, kind);
+	endInsertColumns();
+}
+
+void TaGradeTableModel::clearRows()
+{
+	beginResetModel();
+	m_grades->clearRows();
+	endResetModel();
+}
+
+void TaGradeTableModel::rowsUpdated(int first, int last)
+{
+	if (first > last || m_grades->columnCount() == 0)
+		return;
+	emit dataChanged(index(first, 0), index(last, m_grades->columnCount() - 1));
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QVariant>
+#include <QSharedPointer>
+#include <QAbstractTableModel>
+
+// 成绩表数据模型：按列存储，分数列直接存 double，学号列存入驻池下标，
+// 排序、统计、导出、上传都直接读原生数组，不再逐格解析文本。
+// 列之间互不相干：增删一列只创建或释放这一列自己的数组，不触碰其他列的数据。
+// 单元格的字体色、背景色和注释稀疏存放，按行、列的稳定编号索引，排序和删行后仍跟着原单元格。
+class TaGradeTable
+{
+public:
+	enum ColumnKind
+	{
+		IdColumn,    // 学号：入驻为下标，重复的学号只存一份
+		TextColumn,  // 姓名等文本
+		ScoreColumn  // 分数：能解析为数字的存 double，其余（如“缺考”）存原文
+	};
+
+	TaGradeTable();
+
+	int rowCount() const { return m_rowKeys.size(); }
+	int columnCount() const { return m_columns.size(); }
+
+	QString columnName(int col) const { return m_columns[col]->name; }
+	void setColumnName(int col, const QString& name) { m_columns[col]->name = name; }
+	ColumnKind columnKind(int col) const { return m_columns[col]->kind; }
+	// 按列名查找，找不到返回 -1
+	int findColumn(const QString& name) const;
+
+	void insertColumn(int col, const QString& name, ColumnKind kind);
+	void removeColumn(int col);
+
+	void insertRows(int row, int count);
+	void removeRows(int row, int count);
+	void clearRows();
+
+	QString text(int row, int col) const;
+	// 分数列能完整解析为数字时存为数值（首尾空白忽略），否则保留原文
+	void setText(int row, int col, const QString& text);
+	// 分数列的数值；空白、非数字或非分数列返回 false
+	bool number(int row, int col, double* value) const;
+	// 分数列的原生数组，非数字的单元格为 NaN
+	const QVector<double>& scores(int col) const { return m_columns[col]->numbers; }
+
+	// Qt::ForegroundRole、Qt::BackgroundRole、Qt::UserRole（注释），未设置时返回无效值
+	QVariant decoration(int row, int col, int role) const;
+	void setDecoration(int row, int col, int role, const QVariant& value);
+
+	// 数字与数字按数值比较，其余按文本比较（规则同原来的 QTableWidget 排序）；稳定排序
+	void sortRows(int col, bool ascending);
+
+private:
+	struct Column
+	{
+		QString name;
+		ColumnKind kind;
+		quint32 key;             // 稳定编号，用于单元格装饰
+		QVector<double> numbers; // ScoreColumn
+		QVector<QString> texts;  // TextColumn；ScoreColumn 中不是数字的原文
+		QVector<int> ids;        // IdColumn，m_idPool 下标，-1 为空
+	};
+
+	struct Decoration
+	{
+		QVariant foreground;
+		QVariant background;
+		QVariant comment;
+	};
+
+	static quint64 decorationKey(quint32 rowKey, quint32 columnKey) { return (quint64(rowKey) << 32) | columnKey; }
+	int intern(const QString& id);
+	double sortKey(int row, int col, bool* ok) const;
+
+	QVector<QSharedPointer<Column>> m_columns;
+	QVector<quint32> m_rowKeys; // 行的稳定编号
+	quint32 m_nextRowKey;
+	quint32 m_nextColumnKey;
+	QHash<quint64, Decoration> m_decorations;
+	QStringList m_idPool;
+	QHash<QString, int> m_idIndex;
+};
+
+// TaGradeTable 的 QAbstractTableModel 适配，供 QTableView 显示和编辑；
+// 增删行列、排序都应经过这里，以便通知视图
+class TaGradeTableModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	explicit TaGradeTableModel(TaGradeTable* grades, QObject* parent = nullptr);
+
+	TaGradeTable* grades() const { return m_grades; }
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+	bool insertRows(int row, int count, const QModelIndex& parent = QModelIndex()) override;
+	bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex()) override;
+	bool removeColumns(int column, int count, const QModelIndex& parent = QModelIndex()) override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+	void insertGradeColumn(int col, const QString& name, TaGradeTable::ColumnKind kind);
+	void clearRows();
+	// 直接改写了 grades() 中 first~last 行之后调用，刷新视图
+	void rowsUpdated(int first, int last);
+
+private:
+	TaGradeTable* m_grades;
+};
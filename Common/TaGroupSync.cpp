@@ -0,0 +1,331 @@
+﻿#include "TaGroupSync.h"
+#include "TaEndpoints.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QDebug>
+
+TaGroupSync* TaGroupSync::instance()
+{
+    static TaGroupSync* s_instance = []() {
+        TaGroupSync* sync = new TaGroupSync;
+        // 首次调用可能发生在 IM SDK 回调线程里
+        if (QCoreApplication::instance() && sync->thread() != QCoreApplication::instance()->thread())
+        {
+            sync->moveToThread(QCoreApplication::instance()->thread());
+        }
+        return sync;
+    }();
+    return s_instance;
+}
+
+TaGroupSync::TaGroupSync(QObject* parent)
+    : QObject(parent)
+{
+    m_manager = new QNetworkAccessManager(this);
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(kCoalesceMs);
+    connect(m_timer, &QTimer::timeout, this, &TaGroupSync::flush);
+}
+
+void TaGroupSync::syncJoinedGroups(const QString& userId, const QJsonArray& groups)
+{
+    enqueue(userId, groups, true, Callback());
+}
+
+void TaGroupSync::syncGroup(const QString& userId, const QJsonObject& group, Callback callback)
+{
+    QJsonArray groups;
+    groups.append(group);
+    enqueue(userId, groups, false, callback);
+}
+
+void TaGroupSync::resetSnapshot(const QString& userId)
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, [=]() { resetSnapshot(userId); }, Qt::QueuedConnection);
+        return;
+    }
+
+    m_snapshots.remove(userId);
+    QFile::remove(snapshotPath(userId));
+}
+
+QByteArray TaGroupSync::fingerprint(const QJsonObject& group)
+{
+    QJsonObject stable = group;
+    stable.remove("latest_seq");
+    stable.remove("last_msg_time");
+    stable.remove("next_msg_seq");
+    stable.remove("online_member_num");
+
+    QJsonObject memberInfo = stable["member_info"].toObject();
+    memberInfo.remove("readed_seq");
+    memberInfo.remove("unread_num");
+    stable["member_info"] = memberInfo;
+
+    // QJsonObject 的键有序，紧凑序列化结果稳定
+    return QCryptographicHash::hash(QJsonDocument(stable).toJson(QJsonDocument::Compact), QCryptographicHash::Md5).toHex();
+}
+
+void TaGroupSync::enqueue(const QString& userId, const QJsonArray& groups, bool fullList, Callback callback)
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, [=]() { enqueue(userId, groups, fullList, callback); }, Qt::QueuedConnection);
+        return;
+    }
+
+    if (userId.isEmpty())
+    {
+        qWarning() << "TaGroupSync: user_id 为空，忽略同步";
+        if (callback) callback(false);
+        return;
+    }
+
+    Pending& pending = m_pending[userId];
+    if (fullList)
+    {
+        // 新列表取代上一份列表：只来自上一份列表的群丢掉，期间已退出的群才能进 removed_groups
+        for (const QString& groupId : qAsConst(pending.listed))
+        {
+            if (!pending.added.contains(groupId))
+            {
+                pending.groups.remove(groupId);
+            }
+        }
+        pending.fullList = true;
+        pending.listed.clear();
+    }
+    for (int i = 0; i < groups.size(); i++)
+    {
+        QJsonObject group = groups[i].toObject();
+        QString groupId = group["group_id"].toString();
+        if (groupId.isEmpty()) continue;
+
+        pending.groups.insert(groupId, group);
+        if (fullList)
+        {
+            pending.listed.insert(groupId);
+            pending.added.remove(groupId);
+        }
+        else
+        {
+            pending.added.insert(groupId);
+        }
+    }
+    if (callback)
+    {
+        pending.callbacks.append(callback);
+    }
+
+    if (!m_timer->isActive())
+    {
+        m_timer->start();
+    }
+}
+
+void TaGroupSync::flush()
+{
+    const QStringList userIds = m_pending.keys();
+    for (const QString& userId : userIds)
+    {
+        // 同一用户的请求串行发送，避免旧请求重试时覆盖新数据
+        if (m_inFlight.contains(userId)) continue;
+
+        Pending pending = m_pending.take(userId);
+        Snapshot& snap = snapshot(userId);
+
+        Request* request = new Request;
+        request->userId = userId;
+        request->syncId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        request->fullList = pending.fullList;
+        request->callbacks = pending.callbacks;
+
+        QJsonArray changed;
+        for (auto it = pending.groups.constBegin(); it != pending.groups.constEnd(); ++it)
+        {
+            QByteArray fp = fingerprint(it.value());
+            if (snap.fingerprints.value(it.key()) == fp) continue;
+
+            changed.append(it.value());
+            request->fingerprints.insert(it.key(), fp);
+        }
+
+        if (pending.fullList)
+        {
+            for (auto it = snap.fingerprints.constBegin(); it != snap.fingerprints.constEnd(); ++it)
+            {
+                if (!pending.listed.contains(it.key()) && !pending.groups.contains(it.key()))
+                {
+                    request->removed.append(it.key());
+                }
+            }
+        }
+
+        if (changed.isEmpty() && request->removed.isEmpty())
+        {
+            qDebug() << "群组信息无变化，跳过上传，共" << pending.groups.size() << "个群组";
+            finish(request, true, QString());
+            continue;
+        }
+
+        QJsonObject uploadData;
+        uploadData["user_id"] = userId;
+        uploadData["groups"] = changed;
+        if (!request->removed.isEmpty())
+        {
+            uploadData["removed_groups"] = QJsonArray::fromStringList(request->removed);
+        }
+        uploadData["sync_id"] = request->syncId;
+        request->body = QJsonDocument(uploadData).toJson(QJsonDocument::Compact);
+
+        qDebug() << "上传群组信息到服务器，变化" << changed.size() << "个，退出" << request->removed.size()
+                 << "个，共" << pending.groups.size() << "个群组";
+        m_inFlight.insert(userId);
+        post(request);
+    }
+}
+
+void TaGroupSync::post(Request* request)
+{
+    QNetworkRequest networkRequest(QUrl(TaEndpoints::url("/groups/sync")));
+    networkRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    networkRequest.setRawHeader("Idempotency-Key", request->syncId.toUtf8());
+
+    QNetworkReply* reply = m_manager->post(networkRequest, request->body);
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        reply->deleteLater();
+        if (reply->error() == QNetworkReply::NoError)
+        {
+            finish(request, true, QString());
+            return;
+        }
+
+        // 网络错误、5xx 和 429 可以重试；其它 4xx 说明请求本身有问题，重试无意义
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        bool retryable = status == 0 || status == 429 || status >= 500;
+        if (retryable && request->attempt < kMaxRetries)
+        {
+            int delay = kRetryBaseMs << request->attempt;
+            request->attempt++;
+            qWarning() << "上传群组信息失败，" << delay << "ms 后重试，sync_id:" << request->syncId << "错误:" << reply->errorString();
+            QTimer::singleShot(delay, this, [=]() { post(request); });
+            return;
+        }
+        finish(request, false, reply->errorString());
+    });
+}
+
+void TaGroupSync::finish(Request* request, bool ok, const QString& error)
+{
+    const QString userId = request->userId;
+    m_inFlight.remove(userId);
+
+    if (ok)
+    {
+        if (!request->fingerprints.isEmpty() || !request->removed.isEmpty())
+        {
+            Snapshot& snap = snapshot(userId);
+            for (auto it = request->fingerprints.constBegin(); it != request->fingerprints.constEnd(); ++it)
+            {
+                snap.fingerprints.insert(it.key(), it.value());
+            }
+            for (const QString& groupId : request->removed)
+            {
+                snap.fingerprints.remove(groupId);
+            }
+            if (snap.savedAt == 0)
+            {
+                snap.savedAt = QDateTime::currentSecsSinceEpoch();
+            }
+            saveSnapshot(userId);
+        }
+        emit synced(userId, request->fingerprints.size(), request->removed.size());
+    }
+    else
+    {
+        // 快照保持不变，下次同步时这些群仍会被当作变化重新上传
+        qWarning() << "上传群组信息失败，sync_id:" << request->syncId << "错误:" << error;
+        emit syncFailed(userId, error);
+    }
+
+    for (const Callback& callback : request->callbacks)
+    {
+        callback(ok);
+    }
+    delete request;
+
+    if (m_pending.contains(userId) && !m_timer->isActive())
+    {
+        m_timer->start();
+    }
+}
+
+TaGroupSync::Snapshot& TaGroupSync::snapshot(const QString& userId)
+{
+    auto it = m_snapshots.find(userId);
+    if (it == m_snapshots.end())
+    {
+        Snapshot snap;
+        QFile file(snapshotPath(userId));
+        if (file.open(QIODevice::ReadOnly))
+        {
+            QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+            snap.savedAt = (qint64)root["saved_at"].toDouble();
+            QJsonObject groups = root["groups"].toObject();
+            for (auto g = groups.constBegin(); g != groups.constEnd(); ++g)
+            {
+                snap.fingerprints.insert(g.key(), g.value().toString().toLatin1());
+            }
+        }
+        it = m_snapshots.insert(userId, snap);
+    }
+
+    if (it->savedAt != 0 && QDateTime::currentSecsSinceEpoch() - it->savedAt > kSnapshotMaxAgeSecs)
+    {
+        qDebug() << "群组同步快照已过期，整体重新上传，user_id:" << userId;
+        it->fingerprints.clear();
+        it->savedAt = 0;
+    }
+    return *it;
+}
+
+void TaGroupSync::saveSnapshot(const QString& userId)
+{
+    const Snapshot& snap = m_snapshots[userId];
+
+    QJsonObject groups;
+    for (auto it = snap.fingerprints.constBegin(); it != snap.fingerprints.constEnd(); ++it)
+    {
+        groups[it.key()] = QString::fromLatin1(it.value());
+    }
+    QJsonObject root;
+    root["saved_at"] = (double)snap.savedAt;
+    root["groups"] = groups;
+
+    QString path = snapshotPath(userId);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "保存群组同步快照失败:" << path;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
+
+QString TaGroupSync::snapshotPath(const QString& userId)
+{
+    return QCoreApplication::applicationDirPath() + "/group_sync/" + userId + ".json";
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QList>
+#include <QTimer>
+#include <QNetworkAccessManager>
+#include <functional>
+
+// /groups/sync 上传引擎
+// 每个用户保留一份服务端已确认的群快照（群 id -> 内容指纹，持久化到 group_sync/<user_id>.json），
+// 只上传新增或变化的群（含 member_info），退出的群放进 removed_groups；
+// kCoalesceMs 内对同一用户的多次同步合并成一个请求，同一用户同时只有一个请求在途，
+// 失败时带同一个 sync_id 按退避重试，服务端可据此去重。
+class TaGroupSync : public QObject
+{
+	Q_OBJECT
+
+public:
+	typedef std::function<void(bool ok)> Callback;
+
+	static const int kCoalesceMs = 300;
+	static const int kMaxRetries = 3;
+	static const int kRetryBaseMs = 1000;
+	static const int kSnapshotMaxAgeSecs = 24 * 3600; // 快照过期后整体重传一次，防止服务端数据丢失后无法自愈
+
+	// 单例，始终运行在主线程；以下接口可以在 IM SDK 回调线程里直接调用
+	static TaGroupSync* instance();
+
+	// 完整的已加入群列表（TIMGroupGetJoinedGroupList 的结果）：快照中有而列表中没有的群记为退出
+	void syncJoinedGroups(const QString& userId, const QJsonArray& groups);
+	// 单个群的增量（建群、邀请成员后），callback 在包含它的请求被确认或最终失败后调用
+	void syncGroup(const QString& userId, const QJsonObject& group, Callback callback = Callback());
+	// 丢弃快照，下次同步全量上传
+	void resetSnapshot(const QString& userId);
+
+	// 变化判断时忽略的字段：消息序号、未读数等每次登录都会变的计数
+	static QByteArray fingerprint(const QJsonObject& group);
+
+signals:
+	void synced(const QString& userId, int changedCount, int removedCount);
+	void syncFailed(const QString& userId, const QString& error);
+
+private slots:
+	void flush();
+
+private:
+	explicit TaGroupSync(QObject* parent = nullptr);
+
+	struct Pending
+	{
+		QMap<QString, QJsonObject> groups;
+		bool fullList = false;
+		QSet<QString> listed;       // fullList 时最近一次列表中的全部群 id
+		QSet<QString> added;        // 最近一次列表之后经 syncGroup 加入的群 id
+		QList<Callback> callbacks;
+	};
+
+	struct Snapshot
+	{
+		QHash<QString, QByteArray> fingerprints;
+		qint64 savedAt = 0;
+	};
+
+	struct Request
+	{
+		QString userId;
+		QString syncId;
+		QByteArray body;
+		QHash<QString, QByteArray> fingerprints; // 确认后写入快照
+		QStringList removed;
+		bool fullList = false;
+		QList<Callback> callbacks;
+		int attempt = 0;
+	};
+
+	void enqueue(const QString& userId, const QJsonArray& groups, bool fullList, Callback callback);
+	void post(Request* request);
+	void finish(Request* request, bool ok, const QString& error);
+	Snapshot& snapshot(const QString& userId);
+	void saveSnapshot(const QString& userId);
+	static QString snapshotPath(const QString& userId);
+
+private:
+	QNetworkAccessManager* m_manager = nullptr;
+	QTimer* m_timer = nullptr;
+	QHash<QString, Pending> m_pending;
+	QHash<QString, Snapshot> m_snapshots;
+	QSet<QString> m_inFlight;
+};
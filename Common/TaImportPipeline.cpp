@@ -0,0 +1,401 @@
+﻿#include "TaImportPipeline.h"
+#include "TaCsvReader.h"
+#include "xlsxrowreader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaType>
+#include <QDebug>
+
+TaImportPipeline::TaImportPipeline(QObject* parent)
+	: QObject(parent)
+	, m_running(false)
+	, m_delivered(0)
+{
+	qRegisterMetaType<QList<QStringList> >("QList<QStringList>");
+
+	m_worker = new TaImportWorker(&m_generation);
+	m_worker->moveToThread(&m_thread);
+	connect(m_worker, &TaImportWorker::stageChanged, this, &TaImportPipeline::onStageChanged);
+	connect(m_worker, &TaImportWorker::progress, this, &TaImportPipeline::onProgress);
+	connect(m_worker, &TaImportWorker::tableDetected, this, &TaImportPipeline::onTableDetected);
+	connect(m_worker, &TaImportWorker::rowsReady, this, &TaImportPipeline::onRowsReady);
+	connect(m_worker, &TaImportWorker::finished, this, &TaImportPipeline::onFinished);
+	m_thread.start();
+}
+
+TaImportPipeline::~TaImportPipeline()
+{
+	// 让正在进行的读取尽快退出，再等线程结束
+	m_generation.fetchAndAddOrdered(1);
+	m_thread.quit();
+	m_thread.wait();
+	delete m_worker;
+}
+
+void TaImportPipeline::start(const QString& fileName)
+{
+	if (m_running)
+	{
+		cancel();
+	}
+
+	int generation = m_generation.fetchAndAddOrdered(1) + 1;
+	m_running = true;
+	m_delivered = 0;
+	QMetaObject::invokeMethod(m_worker, "run", Qt::QueuedConnection,
+		Q_ARG(int, generation), Q_ARG(QString, fileName));
+}
+
+void TaImportPipeline::cancel()
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	m_generation.fetchAndAddOrdered(1);
+	m_running = false;
+	emit finished(Canceled, m_delivered);
+}
+
+TaImportPipeline::TableKind TaImportPipeline::detect(const QStringList& headers)
+{
+	if (headers.contains("学号") && headers.contains("姓名") &&
+		headers.contains("语文") && headers.contains("数学") &&
+		headers.contains("英语") && headers.contains("总分") &&
+		!headers.contains("小组"))
+	{
+		return MidtermGradeTable;
+	}
+	if (headers.contains("小组") && headers.contains("学号") &&
+		headers.contains("姓名") && headers.contains("小组总分"))
+	{
+		return StudentPhysiqueTable;
+	}
+	return UnknownTable;
+}
+
+// 以下槽在主线程执行；取消或重新开始后，旧一轮排队中的信号在这里丢弃
+
+void TaImportPipeline::onStageChanged(int generation, int stage)
+{
+	if (generation == m_generation.loadAcquire())
+	{
+		emit stageChanged(stage);
+	}
+}
+
+void TaImportPipeline::onProgress(int generation, int percent)
+{
+	if (generation == m_generation.loadAcquire())
+	{
+		emit progress(percent);
+	}
+}
+
+void TaImportPipeline::onTableDetected(int generation, int kind, const QStringList& headers)
+{
+	if (generation == m_generation.loadAcquire())
+	{
+		emit tableDetected(kind, headers);
+	}
+}
+
+void TaImportPipeline::onRowsReady(int generation, const QList<QStringList>& rows)
+{
+	if (generation == m_generation.loadAcquire())
+	{
+		m_delivered += rows.size();
+		emit rowsReady(rows);
+	}
+}
+
+void TaImportPipeline::onFinished(int generation, int error, int rowCount)
+{
+	if (generation != m_generation.loadAcquire())
+	{
+		return;
+	}
+
+	m_running = false;
+	emit finished(error, rowCount);
+}
+
+void TaImportWorker::run(int generation, const QString& fileName)
+{
+	m_current = generation;
+	m_columns = 0;
+	m_rowCount = 0;
+	m_batch.clear();
+	if (isCanceled())
+	{
+		return;
+	}
+
+	emit stageChanged(m_current, TaImportPipeline::ReadStage);
+
+	int error = TaImportPipeline::UnsupportedFormat;
+	QString suffix = QFileInfo(fileName).suffix().toLower();
+	if (suffix == "xlsx" || suffix == "xls")
+	{
+		error = readExcel(fileName);
+	}
+	else if (suffix == "csv")
+	{
+		error = readCsv(fileName);
+	}
+
+	if (error == TaImportPipeline::NoError)
+	{
+		flush();
+		emit progress(m_current, 100);
+	}
+	m_batch.clear();
+	emit finished(m_current, error, m_rowCount);
+}
+
+// 当前行从第一列起到第一个空单元格为止的各列，第一列为空时返回空
+static QStringList readHeaderRow(QXlsx::RowReader& reader)
+{
+	QStringList headers;
+	for (int col = 1; col <= 1000; ++col) // 限制最大列数
+	{
+		QVariant cellValue = reader.read(col);
+		QString cellText = cellValue.isNull() ? QString() : cellValue.toString().trimmed();
+		if (cellText.isEmpty())
+		{
+			break; // 遇到空列，停止读取表头
+		}
+		headers.append(cellText);
+	}
+	return headers;
+}
+
+// 只需顺序扫描一遍，用 RowReader 流式读取第一个工作表，不加载整个文档
+int TaImportWorker::readExcel(const QString& fileName)
+{
+	using namespace QXlsx;
+
+	if (!QFile::exists(fileName))
+	{
+		return TaImportPipeline::ReadFailed;
+	}
+
+	RowReader reader(fileName);
+	if (!reader.isValid())
+	{
+		qWarning() << "读取Excel失败:" << reader.errorString();
+		return TaImportPipeline::ReadFailed;
+	}
+
+	// 解压后的工作表大小拿不到，进度只能显示忙碌
+	emit stageChanged(m_current, TaImportPipeline::ParseStage);
+	emit progress(m_current, -1);
+
+	// 表头取前几行里第一个能识别的行：带说明导出的表格第 1 行是说明、第 2 行空，表头在第 3 行
+	QStringList headers;
+	QStringList firstRow;
+	int headerRow = 0;
+	while (reader.readNextRow() && reader.row() <= TaImportPipeline::kHeaderScanRows)
+	{
+		QStringList candidate = readHeaderRow(reader);
+		if (candidate.isEmpty())
+		{
+			continue;
+		}
+		if (firstRow.isEmpty())
+		{
+			firstRow = candidate;
+		}
+		if (TaImportPipeline::detect(candidate) != TaImportPipeline::UnknownTable)
+		{
+			headers = candidate;
+			headerRow = reader.row();
+			break;
+		}
+	}
+	if (headers.isEmpty())
+	{
+		// 第一列为空的行不算表头，一行都没有说明文件格式有问题
+		return firstRow.isEmpty() ? int(TaImportPipeline::ReadFailed) : acceptHeaders(firstRow);
+	}
+
+	int error = acceptHeaders(headers);
+	if (error != TaImportPipeline::NoError)
+	{
+		return error;
+	}
+
+	// 数据行从表头的下一行开始；中间的空行保留，连续3个及以上空行（或文件结束）视为数据结束
+	QStringList emptyRow;
+	for (int c = 0; c < headers.size(); ++c)
+	{
+		emptyRow.append("");
+	}
+	int nextRow = headerRow + 1; // 下一个应输出的行号
+	while (reader.readNextRow())
+	{
+		if (isCanceled())
+		{
+			return TaImportPipeline::Canceled;
+		}
+
+		int row = reader.row();
+		if (row < nextRow)
+		{
+			continue;
+		}
+		if (row > TaImportPipeline::kMaxExcelRows)
+		{
+			break;
+		}
+
+		QStringList rowData;
+		bool hasData = false;
+		for (int c = 1; c <= headers.size(); ++c)
+		{
+			QVariant cellValue = reader.read(c);
+			QString cellText = cellValue.isNull() ? "" : cellValue.toString().trimmed();
+			rowData.append(cellText);
+			if (!cellText.isEmpty())
+			{
+				hasData = true;
+			}
+		}
+		if (!hasData)
+		{
+			continue;
+		}
+
+		int emptyRows = row - nextRow;
+		if (emptyRows >= 3)
+		{
+			break; // 确实都是空行，停止读取
+		}
+		for (int i = 0; i < emptyRows; ++i)
+		{
+			addRow(emptyRow);
+		}
+		addRow(rowData);
+		nextRow = row + 1;
+	}
+
+	return TaImportPipeline::NoError;
+}
+
+// TaCsvReader 按字节流式解析（RFC 4180，自动识别 UTF-8/GBK），进度按已读字节计算
+int TaImportWorker::readCsv(const QString& fileName)
+{
+	TaCsvReader reader(fileName);
+	if (!reader.isOpen())
+	{
+		qWarning() << "读取CSV失败:" << reader.errorString();
+		return TaImportPipeline::ReadFailed;
+	}
+
+	emit stageChanged(m_current, TaImportPipeline::ParseStage);
+	emit progress(m_current, 0);
+
+	bool hasHeaders = false;
+	int headerCandidates = 0;
+	QStringList firstRecord;
+	int percent = 0;
+	QStringList fields;
+	while (reader.readRecord(fields))
+	{
+		if (isCanceled())
+		{
+			return TaImportPipeline::Canceled;
+		}
+		if (fields.size() == 1 && fields[0].isEmpty())
+		{
+			continue; // 空行
+		}
+
+		for (QString& field : fields)
+		{
+			field = field.trimmed();
+		}
+		if (!hasHeaders)
+		{
+			// 同 xlsx：前几条记录里找能识别的表头，跳过导出时写在前面的说明
+			if (firstRecord.isEmpty())
+			{
+				firstRecord = fields;
+			}
+			bool known = TaImportPipeline::detect(fields) != TaImportPipeline::UnknownTable;
+			if (!known && ++headerCandidates < TaImportPipeline::kHeaderScanRows)
+			{
+				continue;
+			}
+			hasHeaders = true;
+			int error = acceptHeaders(known ? fields : firstRecord);
+			if (error != TaImportPipeline::NoError)
+			{
+				return error;
+			}
+			continue;
+		}
+		if (!fields[0].isEmpty())
+		{
+			addRow(fields);
+		}
+
+		int current = reader.size() > 0 ? int(reader.position() * 100 / reader.size()) : 100;
+		if (current != percent)
+		{
+			percent = current;
+			emit progress(m_current, percent);
+		}
+	}
+
+	if (!hasHeaders)
+	{
+		return firstRecord.isEmpty() ? int(TaImportPipeline::ReadFailed) : acceptHeaders(firstRecord);
+	}
+	return TaImportPipeline::NoError;
+}
+
+int TaImportWorker::acceptHeaders(const QStringList& headers)
+{
+	if (headers.isEmpty())
+	{
+		return TaImportPipeline::EmptyTable;
+	}
+
+	emit stageChanged(m_current, TaImportPipeline::DetectStage);
+	TaImportPipeline::TableKind kind = TaImportPipeline::detect(headers);
+	if (kind == TaImportPipeline::UnknownTable)
+	{
+		return TaImportPipeline::UnknownTableKind;
+	}
+
+	m_columns = headers.size();
+	emit tableDetected(m_current, kind, headers);
+	emit stageChanged(m_current, TaImportPipeline::ConvertStage);
+	return TaImportPipeline::NoError;
+}
+
+void TaImportWorker::addRow(const QStringList& row)
+{
+	if (row.size() != m_columns)
+	{
+		return; // 跳过列数不匹配的行
+	}
+
+	m_batch.append(row);
+	++m_rowCount;
+	if (m_batch.size() >= TaImportPipeline::kBatchRows)
+	{
+		flush();
+	}
+}
+
+void TaImportWorker::flush()
+{
+	if (!m_batch.isEmpty())
+	{
+		emit rowsReady(m_current, m_batch);
+		m_batch.clear();
+	}
+}
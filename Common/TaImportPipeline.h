@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QThread>
+#include <QAtomicInt>
+
+class TaImportWorker;
+
+// 表格导入流水线：读文件 → 解析（xlsx 用 RowReader，csv 用 TaCsvReader）→ 按表头识别表格类型 → 数据行整理，
+// 全部在后台线程里完成；整理好的数据行每 kBatchRows 行一批送回主线程，界面边收边填表，随时可以取消。
+// 数据行的整理规则和原来 CustomListDialog 同步读取时一致：
+//   表头取前 kHeaderScanRows 行（csv 为非空记录）里第一个能识别出表格类型的行，
+//   导出时带了说明的表格（说明、空行、表头）也能直接导入；都识别不出时按第一行报告表格类型未知；
+//   xlsx：表头之后中间的空行保留，连续 3 个及以上空行视为数据结束，最多读到第 kMaxExcelRows 行；
+//   csv：跳过空行，第一列为空的数据行跳过；
+// 字段都去掉首尾空白，列数和表头不一致的行丢弃，送出的每一行都与表头一一对应。
+//
+//     TaImportPipeline* pipeline = new TaImportPipeline(this);
+//     connect(pipeline, &TaImportPipeline::tableDetected, ...);  // 开始填表
+//     connect(pipeline, &TaImportPipeline::rowsReady, ...);      // 追加一批
+//     connect(pipeline, &TaImportPipeline::finished, ...);       // 结束或出错
+//     pipeline->start(fileName);
+class TaImportPipeline : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum TableKind
+	{
+		UnknownTable,
+		MidtermGradeTable,    // 期中成绩单
+		StudentPhysiqueTable  // 学生体质统计表
+	};
+
+	enum Stage
+	{
+		ReadStage,
+		ParseStage,
+		DetectStage,
+		ConvertStage
+	};
+
+	enum Error
+	{
+		NoError,
+		UnsupportedFormat, // 不是 xlsx/xls/csv
+		ReadFailed,        // 打不开或读不出表头
+		EmptyTable,        // 表头为空
+		UnknownTableKind,  // 表头对不上任何一种表格
+		Canceled
+	};
+
+	static const int kBatchRows = 200;
+	static const int kMaxExcelRows = 10000;
+	static const int kHeaderScanRows = 10;
+
+	explicit TaImportPipeline(QObject* parent = nullptr);
+	~TaImportPipeline();
+
+	// 开始导入；上一次导入未结束时先取消它
+	void start(const QString& fileName);
+	// 取消后不再送出数据行，并立即发出 finished(Canceled)
+	void cancel();
+	bool isRunning() const { return m_running; }
+
+	// 期中成绩单包含：学号、姓名、语文、数学、英语、总分，且没有小组列；
+	// 学生体质统计表包含：小组、学号、姓名、小组总分
+	static TableKind detect(const QStringList& headers);
+
+signals:
+	void stageChanged(int stage);
+	// 0~100；无法估计进度时（xlsx）为 -1
+	void progress(int percent);
+	void tableDetected(int kind, const QStringList& headers);
+	void rowsReady(const QList<QStringList>& rows);
+	// rowCount 为已送出的数据行数
+	void finished(int error, int rowCount);
+
+private slots:
+	void onStageChanged(int generation, int stage);
+	void onProgress(int generation, int percent);
+	void onTableDetected(int generation, int kind, const QStringList& headers);
+	void onRowsReady(int generation, const QList<QStringList>& rows);
+	void onFinished(int generation, int error, int rowCount);
+
+private:
+	QThread m_thread;
+	TaImportWorker* m_worker;
+	QAtomicInt m_generation; // 每次 start/cancel 加一，旧一轮的信号和工作都据此作废
+	bool m_running;
+	int m_delivered; // 本轮已送出的数据行数
+};
+
+// 运行在 TaImportPipeline 的后台线程里，只由 TaImportPipeline 使用
+class TaImportWorker : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit TaImportWorker(QAtomicInt* generation) : m_generation(generation) {}
+
+public slots:
+	void run(int generation, const QString& fileName);
+
+signals:
+	void stageChanged(int generation, int stage);
+	void progress(int generation, int percent);
+	void tableDetected(int generation, int kind, const QStringList& headers);
+	void rowsReady(int generation, const QList<QStringList>& rows);
+	void finished(int generation, int error, int rowCount);
+
+private:
+	int readExcel(const QString& fileName);
+	int readCsv(const QString& fileName);
+	int acceptHeaders(const QStringList& headers);
+	void addRow(const QStringList& row);
+	void flush();
+	bool isCanceled() const { return m_generation->loadAcquire() != m_current; }
+
+	QAtomicInt* m_generation;
+	int m_current = 0;
+	int m_columns = 0;
+	int m_rowCount = 0;
+	QList<QStringList> m_batch;
+};
@@ -0,0 +1,237 @@
+﻿#include "TaMessageBus.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
+
+const QString TaMessageBus::kTypeAny = QStringLiteral("*");
+const QString TaMessageBus::kTypeNotification = QStringLiteral("notification");
+
+int TaMessageBus::m_nextId = 1;
+QHash<QString, QList<TaMessageBus::Subscriber>> TaMessageBus::m_subscribers;
+QHash<QObject*, QMetaObject::Connection> TaMessageBus::m_watched;
+QList<QString> TaMessageBus::m_noticeMsg;
+QMap<int, Notification> TaMessageBus::m_notifications;
+QMultiHash<QString, int> TaMessageBus::m_groupIndex;
+
+int TaMessageBus::subscribe(QObject* receiver, const QString& type, Handler handler)
+{
+    if (!receiver || !handler)
+    {
+        return 0;
+    }
+
+    Subscriber sub;
+    sub.id = m_nextId++;
+    sub.receiver = receiver;
+    sub.handler = handler;
+    m_subscribers[type].append(sub);
+
+    // 对话框关闭销毁时自动退订
+    if (!m_watched.contains(receiver))
+    {
+        m_watched.insert(receiver, QObject::connect(receiver, &QObject::destroyed, [](QObject* obj) {
+            TaMessageBus::unsubscribe(obj);
+            }));
+    }
+    return sub.id;
+}
+
+void TaMessageBus::unsubscribe(int subscriptionId)
+{
+    for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it)
+    {
+        QList<Subscriber>& subs = it.value();
+        for (int i = 0; i < subs.size(); ++i)
+        {
+            if (subs[i].id == subscriptionId)
+            {
+                subs.removeAt(i);
+                return;
+            }
+        }
+    }
+}
+
+void TaMessageBus::unsubscribe(QObject* receiver)
+{
+    for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it)
+    {
+        QList<Subscriber>& subs = it.value();
+        for (int i = subs.size() - 1; i >= 0; --i)
+        {
+            // receiver 正在析构时 QPointer 已置空，一并清掉
+            if (subs[i].receiver.isNull() || subs[i].receiver.data() == receiver)
+            {
+                subs.removeAt(i);
+            }
+        }
+    }
+
+    auto watched = m_watched.find(receiver);
+    if (watched != m_watched.end())
+    {
+        QObject::disconnect(watched.value());
+        m_watched.erase(watched);
+    }
+}
+
+void TaMessageBus::publish(const QString& msg)
+{
+    QJsonObject obj;
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(msg.toUtf8(), &parseError);
+    if (parseError.error == QJsonParseError::NoError && doc.isObject())
+    {
+        obj = doc.object();
+    }
+    else
+    {
+        qDebug() << "TaMessageBus 非 JSON 消息:" << msg.left(64);
+    }
+
+    QString type = messageType(obj);
+    bool stored = obj.value("data").isArray();
+    if (stored)
+    {
+        storeNotifications(obj, msg);
+    }
+
+    dispatch(type, obj, msg, stored);
+}
+
+void TaMessageBus::publish(const QJsonObject& obj)
+{
+    // 通知列表对外仍按原始文本提供，只有通知才需要回写一份紧凑 JSON
+    QString raw;
+    bool stored = obj.value("data").isArray();
+    if (stored)
+    {
+        raw = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        storeNotifications(obj, raw);
+    }
+
+    dispatch(messageType(obj), obj, raw, stored);
+}
+
+void TaMessageBus::dispatch(const QString& type, const QJsonObject& obj, const QString& raw, bool stored)
+{
+    // 拷贝一份再回调：处理函数里可能订阅/退订
+    QList<Subscriber> targets = m_subscribers.value(type);
+    if (stored && type != kTypeNotification)
+    {
+        // 通知表已更新，按通知表刷新的订阅者不关心消息本身的 type
+        targets += m_subscribers.value(kTypeNotification);
+    }
+    if (type != kTypeAny)
+    {
+        targets += m_subscribers.value(kTypeAny);
+    }
+
+    for (const Subscriber& sub : targets)
+    {
+        if (!sub.receiver.isNull())
+        {
+            sub.handler(obj, raw);
+        }
+    }
+}
+
+void TaMessageBus::storeNotifications(const QJsonObject& obj, const QString& raw)
+{
+    m_noticeMsg.append(raw);
+    while (m_noticeMsg.size() > kMaxNoticeMsg)
+    {
+        m_noticeMsg.removeFirst();
+    }
+
+    QJsonArray dataArray = obj["data"].toArray();
+    for (const QJsonValue& item : dataArray)
+    {
+        if (!item.isObject()) continue;
+
+        Notification n = parseNotification(item.toObject());
+        auto existing = m_notifications.find(n.id);
+        if (existing != m_notifications.end())
+        {
+            // 服务端会重复推送未读通知，只更新状态
+            m_groupIndex.remove(existing.value().unique_group_id, n.id);
+            existing.value() = n;
+        }
+        else
+        {
+            m_notifications.insert(n.id, n);
+        }
+        m_groupIndex.insert(n.unique_group_id, n.id);
+    }
+
+    // 超出上限时淘汰最早（id 最小）的通知
+    while (m_notifications.size() > kMaxNotifications)
+    {
+        auto oldest = m_notifications.begin();
+        m_groupIndex.remove(oldest.value().unique_group_id, oldest.key());
+        m_notifications.erase(oldest);
+    }
+}
+
+QVector<QString> TaMessageBus::noticeMsg()
+{
+    return m_noticeMsg.toVector();
+}
+
+QList<Notification> TaMessageBus::notifications()
+{
+    return m_notifications.values();
+}
+
+QList<Notification> TaMessageBus::notificationsOfGroup(const QString& unique_group_id)
+{
+    QList<int> ids = m_groupIndex.values(unique_group_id);
+    std::sort(ids.begin(), ids.end());
+
+    QList<Notification> result;
+    result.reserve(ids.size());
+    for (int id : ids)
+    {
+        result.append(m_notifications.value(id));
+    }
+    return result;
+}
+
+QString TaMessageBus::messageType(const QJsonObject& obj)
+{
+    // type 字段服务端有时发字符串 "3"，有时发数字 3
+    QJsonValue type = obj.value("type");
+    if (type.isString())
+    {
+        return type.toString();
+    }
+    if (type.isDouble())
+    {
+        return QString::number(type.toInt());
+    }
+    if (obj.value("data").isArray())
+    {
+        return kTypeNotification;
+    }
+    return QString();
+}
+
+Notification TaMessageBus::parseNotification(const QJsonObject& obj)
+{
+    Notification n;
+    n.id = obj["id"].toInt();
+    n.sender_id = obj["sender_id"].toInt();
+    n.sender_name = obj["sender_name"].isNull() ? "" : obj["sender_name"].toString();
+    n.receiver_id = obj["receiver_id"].toInt();
+    n.unique_group_id = obj["unique_group_id"].isNull() ? "" : obj["unique_group_id"].toString();
+    n.group_name = obj["group_name"].isNull() ? "" : obj["group_name"].toString();
+    n.content = obj["content"].toString();
+    n.content_text = obj["content_text"].toInt();
+    n.is_read = obj["is_read"].toInt();
+    n.is_agreed = obj["is_agreed"].toInt();
+    n.remark = obj["remark"].isNull() ? "" : obj["remark"].toString();
+    n.created_at = obj["created_at"].toString();
+    n.updated_at = obj["updated_at"].toString();
+    return n;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QJsonObject>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <functional>
+#include "CommonInfo.h"
+
+// WebSocket 文本消息总线
+// TaQTWebSocket 收到的每一帧只在这里解析一次，再按消息类型分发给订阅者；
+// 通知类消息（带 data 数组）按通知 id 去重后存入有上限的通知表，供各对话框查询。
+class TaMessageBus
+{
+public:
+	typedef std::function<void(const QJsonObject& obj, const QString& raw)> Handler;
+
+	static const QString kTypeAny;          // 订阅全部消息
+	static const QString kTypeNotification; // 带 data 数组的通知推送：存入通知表后总会分发到这里，带 type 的也一样
+
+	// 订阅某类消息，receiver 销毁后自动退订；返回订阅 id
+	static int subscribe(QObject* receiver, const QString& type, Handler handler);
+	static void unsubscribe(int subscriptionId);
+	static void unsubscribe(QObject* receiver);
+
+	// 由 TaQTWebSocket 调用：文本帧解析一次并分发；二进制控制帧已解码为对象
+	static void publish(const QString& msg);
+	static void publish(const QJsonObject& obj);
+
+	// 最近收到的原始通知消息（最多 kMaxNoticeMsg 条，按到达顺序）
+	static QVector<QString> noticeMsg();
+	// 按 id 去重后的通知（最多 kMaxNotifications 条，按 id 升序）
+	static QList<Notification> notifications();
+	static QList<Notification> notificationsOfGroup(const QString& unique_group_id);
+
+	static QString messageType(const QJsonObject& obj);
+	static Notification parseNotification(const QJsonObject& obj);
+
+	static const int kMaxNoticeMsg = 64;
+	static const int kMaxNotifications = 512;
+
+private:
+	struct Subscriber
+	{
+		int id;
+		QPointer<QObject> receiver;
+		Handler handler;
+	};
+
+	static void storeNotifications(const QJsonObject& obj, const QString& raw);
+	static void dispatch(const QString& type, const QJsonObject& obj, const QString& raw, bool stored);
+
+	static int m_nextId;
+	static QHash<QString, QList<Subscriber>> m_subscribers;
+	static QHash<QObject*, QMetaObject::Connection> m_watched;
+	static QList<QString> m_noticeMsg;
+	static QMap<int, Notification> m_notifications;
+	static QMultiHash<QString, int> m_groupIndex;
+};
@@ -1,10 +1,18 @@
 ﻿#include "TaQTWebSocket.h"
 #include "CommonInfo.h"
+#include "TaMessageBus.h"
+#include "TaControlFrame.h"
+#include "TaEndpoints.h"
+#include <QJsonDocument>
 
 QTimer* TaQTWebSocket::heartbeatTimer = NULL;
 QWebSocket* TaQTWebSocket::socket = NULL;
-QVector<QString> TaQTWebSocket::m_NoticeMsg;
 QVector<QDialog*> TaQTWebSocket::m_vecRecvDlg;
+bool TaQTWebSocket::m_binaryControl = false;
+bool TaQTWebSocket::m_controlCbor = true;
+int TaQTWebSocket::m_compressLevel = 1;
+qint64 TaQTWebSocket::m_controlRawBytes = 0;
+qint64 TaQTWebSocket::m_controlWireBytes = 0;
 
 TaQTWebSocket::TaQTWebSocket(QObject *parent)
 	: QObject(parent)
@@ -29,7 +37,7 @@ void TaQTWebSocket::InitWebSocket(TaQTWebSocket* wsInstance)
 
     UserInfo userinfo = CommonInfo::GetData();
     // 建立连接
-    socket->open(QUrl(QString("ws://47.100.126.194:5000/ws/%1").arg(userinfo.teacher_unique_id)));
+    socket->open(QUrl(TaEndpoints::wsUrl(userinfo.teacher_unique_id)));
 
     // 发送心跳
     heartbeatTimer = new QTimer(wsInstance);
@@ -44,13 +52,28 @@ void TaQTWebSocket::onConnected() {
 void TaQTWebSocket::onMessageReceived(const QString& msg) {
     if (0 != msg.compare("pong") && 0 == msg.contains("不在线"))
     {
-        m_NoticeMsg.push_back(msg);
+        // 解析一次后按类型分发，通知由消息总线按 id 去重保存
+        TaMessageBus::publish(msg);
         emit newMessage(msg); // 发信号
     }
 }
 
 void TaQTWebSocket::onBinaryMessageReceived(const QByteArray& message)
 {
+    if (TaControlFrame::isControlFrame(message))
+    {
+        QJsonObject obj;
+        if (TaControlFrame::decode(message, NULL, &obj))
+        {
+            TaMessageBus::publish(obj);
+        }
+        else
+        {
+            qWarning() << "控制帧解析失败，长度:" << message.size();
+        }
+        return;
+    }
+
     emit newBinaryMessage(message);
 }
 
@@ -142,6 +165,43 @@ void TaQTWebSocket::sendBinaryMessage(QByteArray packet)
     }
 }
 
+void TaQTWebSocket::sendControlMessage(const QString& target, const QJsonObject& obj)
+{
+    if (!socket)
+    {
+        return;
+    }
+
+    QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    m_controlRawBytes += json.size();
+    if (m_binaryControl)
+    {
+        QByteArray packet = TaControlFrame::encode(target, obj, m_controlCbor, m_compressLevel);
+        m_controlWireBytes += packet.size();
+        socket->sendBinaryMessage(packet);
+    }
+    else
+    {
+        QString text = target.isEmpty() ? QString::fromUtf8(json)
+            : QString("to:%1:%2").arg(target, QString::fromUtf8(json));
+        m_controlWireBytes += json.size() + (target.isEmpty() ? 0 : target.toUtf8().size() + 4);
+        socket->sendTextMessage(text);
+    }
+}
+
+void TaQTWebSocket::setControlFraming(bool binary, bool useCbor, int compressLevel)
+{
+    m_binaryControl = binary;
+    m_controlCbor = useCbor;
+    m_compressLevel = compressLevel;
+}
+
+void TaQTWebSocket::controlTrafficStats(qint64* rawBytes, qint64* wireBytes)
+{
+    if (rawBytes) *rawBytes = m_controlRawBytes;
+    if (wireBytes) *wireBytes = m_controlWireBytes;
+}
+
 void TaQTWebSocket::sendHeartbeat() {
     if (socket->state() == QAbstractSocket::ConnectedState) {
         socket->sendTextMessage("ping");
@@ -5,6 +5,7 @@
 #include <QTimer>
 #include <qvector.h>
 #include <qdialog.h>
+#include <QJsonObject>
 
 class TaQTWebSocket  : public QObject
 {
@@ -17,6 +18,10 @@ public:
 	static void regRecvDlg(QDialog* dlg);
 	static void sendPrivateMessage(QString msg);
 	static void sendBinaryMessage(QByteArray packet);
+	// 控制消息：默认按旧协议发紧凑 JSON 文本，服务端支持后可切到二进制封包（TaControlFrame）
+	static void sendControlMessage(const QString& target, const QJsonObject& obj);
+	static void setControlFraming(bool binary, bool useCbor = true, int compressLevel = 1);
+	static void controlTrafficStats(qint64* rawBytes, qint64* wireBytes);
 signals:
 	void newMessage(QString msg);
 	void newBinaryMessage(const QByteArray& msg);
@@ -30,7 +35,11 @@ private slots:
 private:
 	static QTimer* heartbeatTimer;
 	static QWebSocket* socket;
-	static QVector<QString> m_NoticeMsg;
 	static QVector<QDialog*> m_vecRecvDlg;
+	static bool m_binaryControl;
+	static bool m_controlCbor;
+	static int m_compressLevel;
+	static qint64 m_controlRawBytes;
+	static qint64 m_controlWireBytes;
 };
 
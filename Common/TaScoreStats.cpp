@@ -0,0 +1,273 @@
+﻿#include "TaScoreStats.h"
+
+#include <QtNumeric>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	bool isNumber(double value)
+	{
+		return !qIsNaN(value);
+	}
+}
+
+TaScoreStats::TaScoreStats()
+{
+}
+
+void TaScoreStats::clear()
+{
+	m_ids.clear();
+	m_index.clear();
+	m_columns.clear();
+}
+
+int TaScoreStats::addStudent(const QString& id)
+{
+	int index = m_ids.size();
+	m_ids.append(id);
+	if (!m_index.contains(id))
+		m_index.insert(id, index);
+	return index;
+}
+
+void TaScoreStats::load(int student, const QString& attribute, double value)
+{
+	if (!isNumber(value))
+		return;
+
+	// 载入时先追加，finishLoad 里每列只排一次序
+	Column& c = m_columns[attribute];
+	while (c.values.size() <= student)
+		c.values.append(qQNaN());
+	c.values[student] = value;
+	c.sorted.append(Entry{ value, student });
+}
+
+void TaScoreStats::finishLoad()
+{
+	for (auto it = m_columns.begin(); it != m_columns.end(); ++it)
+	{
+		Column& c = it.value();
+		std::sort(c.sorted.begin(), c.sorted.end(), [](const Entry& a, const Entry& b) {
+			return a.value < b.value || (a.value == b.value && a.student < b.student);
+		});
+		updateMoments(c);
+	}
+}
+
+void TaScoreStats::updateMoments(Column& column)
+{
+	column.mean = 0;
+	column.variance = 0;
+	if (column.sorted.isEmpty())
+		return;
+
+	// 两遍：先求均值，再求离差平方和，结果不会小于 0
+	double n = column.sorted.size();
+	double sum = 0;
+	for (const Entry& entry : column.sorted)
+		sum += entry.value;
+	column.mean = sum / n;
+
+	double squares = 0;
+	for (const Entry& entry : column.sorted)
+	{
+		double d = entry.value - column.mean;
+		squares += d * d;
+	}
+	column.variance = squares / n;
+}
+
+const TaScoreStats::Column* TaScoreStats::column(const QString& attribute) const
+{
+	auto it = m_columns.constFind(attribute);
+	return it == m_columns.constEnd() ? nullptr : &it.value();
+}
+
+int TaScoreStats::lowerBound(const Column& column, double value)
+{
+	auto it = std::lower_bound(column.sorted.constBegin(), column.sorted.constEnd(), value,
+		[](const Entry& entry, double v) { return entry.value < v; });
+	return int(it - column.sorted.constBegin());
+}
+
+int TaScoreStats::upperBound(const Column& column, double value)
+{
+	auto it = std::upper_bound(column.sorted.constBegin(), column.sorted.constEnd(), value,
+		[](double v, const Entry& entry) { return v < entry.value; });
+	return int(it - column.sorted.constBegin());
+}
+
+bool TaScoreStats::setValue(const QString& id, const QString& attribute, double value)
+{
+	if (!isNumber(value))
+		return removeValue(id, attribute);
+
+	int student = indexOf(id);
+	if (student < 0)
+		return false;
+
+	Column& c = m_columns[attribute];
+	while (c.values.size() <= student)
+		c.values.append(qQNaN());
+	double old = c.values[student];
+	if (old == value)
+		return false;
+
+	auto less = [](const Entry& a, const Entry& b) {
+		return a.value < b.value || (a.value == b.value && a.student < b.student);
+	};
+	if (isNumber(old))
+	{
+		auto it = std::lower_bound(c.sorted.begin(), c.sorted.end(), Entry{ old, student }, less);
+		c.sorted.erase(it);
+	}
+	Entry entry{ value, student };
+	c.sorted.insert(std::lower_bound(c.sorted.begin(), c.sorted.end(), entry, less), entry);
+	c.values[student] = value;
+	updateMoments(c);
+	return true;
+}
+
+bool TaScoreStats::removeValue(const QString& id, const QString& attribute)
+{
+	int student = indexOf(id);
+	auto columnIt = m_columns.find(attribute);
+	if (student < 0 || columnIt == m_columns.end())
+		return false;
+
+	Column& c = columnIt.value();
+	if (student >= c.values.size() || !isNumber(c.values[student]))
+		return false;
+
+	double old = c.values[student];
+	auto it = std::lower_bound(c.sorted.begin(), c.sorted.end(), Entry{ old, student },
+		[](const Entry& a, const Entry& b) {
+			return a.value < b.value || (a.value == b.value && a.student < b.student);
+		});
+	c.sorted.erase(it);
+	c.values[student] = qQNaN();
+	updateMoments(c);
+	return true;
+}
+
+bool TaScoreStats::value(int student, const QString& attribute, double* value) const
+{
+	const Column* c = column(attribute);
+	if (!c || student < 0 || student >= c->values.size() || !isNumber(c->values[student]))
+		return false;
+	if (value)
+		*value = c->values[student];
+	return true;
+}
+
+int TaScoreStats::count(const QString& attribute) const
+{
+	const Column* c = column(attribute);
+	return c ? c->sorted.size() : 0;
+}
+
+int TaScoreStats::countInRange(const QString& attribute, double minValue, double maxValue) const
+{
+	const Column* c = column(attribute);
+	if (!c || minValue > maxValue)
+		return 0;
+	return upperBound(*c, maxValue) - lowerBound(*c, minValue);
+}
+
+QVector<int> TaScoreStats::studentsInRange(const QString& attribute, double minValue, double maxValue) const
+{
+	QVector<int> students;
+	const Column* c = column(attribute);
+	if (!c || minValue > maxValue)
+		return students;
+
+	int first = lowerBound(*c, minValue);
+	int last = upperBound(*c, maxValue);
+	students.reserve(last - first);
+	for (int i = first; i < last; ++i)
+		students.append(c->sorted[i].student);
+	return students;
+}
+
+QVector<int> TaScoreStats::order(const QString& attribute) const
+{
+	QVector<int> students;
+	const Column* c = column(attribute);
+	if (!c)
+		return students;
+
+	students.reserve(c->sorted.size());
+	for (const Entry& entry : c->sorted)
+		students.append(entry.student);
+	return students;
+}
+
+double TaScoreStats::minimum(const QString& attribute) const
+{
+	const Column* c = column(attribute);
+	return c && !c->sorted.isEmpty() ? c->sorted.first().value : 0;
+}
+
+double TaScoreStats::maximum(const QString& attribute) const
+{
+	const Column* c = column(attribute);
+	return c && !c->sorted.isEmpty() ? c->sorted.last().value : 0;
+}
+
+double TaScoreStats::mean(const QString& attribute) const
+{
+	const Column* c = column(attribute);
+	return c ? c->mean : 0;
+}
+
+double TaScoreStats::stddev(const QString& attribute) const
+{
+	const Column* c = column(attribute);
+	return c ? std::sqrt(c->variance) : 0;
+}
+
+double TaScoreStats::percentile(const QString& attribute, double percent) const
+{
+	const Column* c = column(attribute);
+	if (!c || c->sorted.isEmpty())
+		return 0;
+
+	double position = qBound(0.0, percent, 100.0) / 100.0 * (c->sorted.size() - 1);
+	int below = int(std::floor(position));
+	int above = qMin(below + 1, c->sorted.size() - 1);
+	double t = position - below;
+	return c->sorted[below].value + (c->sorted[above].value - c->sorted[below].value) * t;
+}
+
+int TaScoreStats::rank(const QString& attribute, double value) const
+{
+	const Column* c = column(attribute);
+	if (!c)
+		return 1;
+	return c->sorted.size() - upperBound(*c, value) + 1;
+}
+
+QVector<int> TaScoreStats::histogram(const QString& attribute, const QVector<double>& boundaries) const
+{
+	QVector<int> counts;
+	if (boundaries.size() < 2)
+		return counts;
+
+	counts.fill(0, boundaries.size() - 1);
+	const Column* c = column(attribute);
+	if (!c)
+		return counts;
+
+	int start = lowerBound(*c, boundaries.first());
+	for (int i = 0; i + 1 < boundaries.size(); ++i)
+	{
+		bool last = i + 2 == boundaries.size();
+		int end = last ? upperBound(*c, boundaries[i + 1]) : lowerBound(*c, boundaries[i + 1]);
+		counts[i] = qMax(0, end - start);
+		start = qMax(start, end);
+	}
+	return counts;
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+// 成绩统计：每项成绩（StudentInfo::score 和 attributes 中的各项）各保存一份排好序的数组，
+// 只在载入时排序一次；区间人数、百分位、名次、直方图都在有序数组上二分查找，均值和方差在载入和每次修改后按有序数组两遍重算，不用增减累计和，避免反复修改后的舍入漂移。
+// 改一个学生的一项成绩只在有序数组里删一个、插一个，不再整列重排。
+// 属性名为空串表示 StudentInfo::score。学生按载入顺序编号，编号即原列表中的下标。
+// 内部数组都是隐式共享的，复制一份 TaScoreStats 不复制数据，可以直接传给各个分析对话框。
+class TaScoreStats
+{
+public:
+	TaScoreStats();
+
+	// StudentList 为 QList<StudentInfo> 等，元素需有 id、score、attributes
+	template <typename StudentList>
+	void setStudents(const StudentList& students);
+	void clear();
+
+	int studentCount() const { return m_ids.size(); }
+	QString studentId(int student) const { return m_ids[student]; }
+	// 学号重复时返回第一个，找不到返回 -1
+	int indexOf(const QString& id) const { return m_index.value(id, -1); }
+	QStringList attributes() const { return m_columns.keys(); }
+
+	// 修改学号为 id 的学生的一项成绩，返回 false 表示学号不存在或成绩没变
+	bool setValue(const QString& id, const QString& attribute, double value);
+	bool removeValue(const QString& id, const QString& attribute);
+	// 该学生没有这项成绩时返回 false；value 可以为空
+	bool value(int student, const QString& attribute, double* value) const;
+
+	// 有这项成绩的人数
+	int count(const QString& attribute) const;
+	// 成绩在 [minValue, maxValue] 内的人数
+	int countInRange(const QString& attribute, double minValue, double maxValue) const;
+	// 成绩在 [minValue, maxValue] 内的学生编号，按成绩从低到高
+	QVector<int> studentsInRange(const QString& attribute, double minValue, double maxValue) const;
+	// 有这项成绩的学生编号，按成绩从低到高（同分按编号）
+	QVector<int> order(const QString& attribute) const;
+
+	// 以下在没有人有这项成绩时返回 0
+	double minimum(const QString& attribute) const;
+	double maximum(const QString& attribute) const;
+	double mean(const QString& attribute) const;
+	// 总体标准差
+	double stddev(const QString& attribute) const;
+	// percent 为 0~100，相邻两名之间线性插值
+	double percentile(const QString& attribute, double percent) const;
+	// 从高分往低分排的名次，同分同名次：比 value 高的人数加一
+	int rank(const QString& attribute, double value) const;
+	// boundaries 为升序的 b0 < b1 < ... < bk，返回 k 个桶的人数：
+	// 第 i 个桶为 [b(i), b(i+1))，最后一个桶包含 bk
+	QVector<int> histogram(const QString& attribute, const QVector<double>& boundaries) const;
+
+private:
+	struct Entry
+	{
+		double value;
+		int student;
+	};
+
+	struct Column
+	{
+		QVector<Entry> sorted;
+		QVector<double> values; // 按学生编号，没有这项成绩为 NaN；可能比学生数短
+		double mean = 0;
+		double variance = 0;    // 总体方差
+	};
+
+	int addStudent(const QString& id);
+	void load(int student, const QString& attribute, double value);
+	void finishLoad();
+	static void updateMoments(Column& column);
+	const Column* column(const QString& attribute) const;
+	// 第一个不小于 / 大于 value 的位置
+	static int lowerBound(const Column& column, double value);
+	static int upperBound(const Column& column, double value);
+
+	QStringList m_ids;
+	QHash<QString, int> m_index;
+	QHash<QString, Column> m_columns;
+};
+
+template <typename StudentList>
+void TaScoreStats::setStudents(const StudentList& students)
+{
+	clear();
+	for (const auto& student : students)
+	{
+		int index = addStudent(student.id);
+		load(index, QString(), student.score);
+		for (auto it = student.attributes.constBegin(); it != student.attributes.constEnd(); ++it)
+			load(index, it.key(), it.value());
+	}
+	finishLoad();
+}
@@ -0,0 +1,149 @@
+﻿#include "TaScoreTotals.h"
+
+TaScoreTotals::TaScoreTotals()
+	: m_columnCount(0)
+{
+}
+
+void TaScoreTotals::reset(int rowCount, int columnCount, const QStringList& groups)
+{
+	m_columnCount = qMax(0, columnCount);
+	m_rows.clear();
+	m_rows.resize(qMax(0, rowCount));
+	for (int i = 0; i < m_rows.size(); ++i)
+	{
+		Row& row = m_rows[i];
+		row.values.fill(0, m_columnCount);
+		row.valid.fill(0, m_columnCount);
+		row.covered.fill(0, m_columnCount);
+		row.group = groups.value(i);
+	}
+	rebuildGroups();
+}
+
+bool TaScoreTotals::setValue(int row, int col, double value, bool valid)
+{
+	Row& r = m_rows[row];
+	if (r.valid[col] == char(valid) && (!valid || r.values[col] == value))
+		return false;
+
+	double before = counts(r, col) ? r.values[col] : 0;
+	r.values[col] = valid ? value : 0;
+	r.valid[col] = valid;
+	double after = counts(r, col) ? r.values[col] : 0;
+	if (before == after)
+		return false;
+
+	double total = r.total;
+	sumRow(r);
+	sumGroup(r.group);
+	return r.total != total;
+}
+
+bool TaScoreTotals::setSpan(int row, int col, int span)
+{
+	Row& r = m_rows[row];
+	span = span > 1 ? span : 0;
+	if (r.spans.value(col, 0) == span)
+		return false;
+
+	double before = r.total;
+	auto it = r.spans.find(col);
+	if (it != r.spans.end())
+	{
+		cover(r, col, it.value(), -1);
+		r.spans.erase(it);
+	}
+	if (span > 1)
+	{
+		r.spans.insert(col, span);
+		cover(r, col, span, 1);
+	}
+	sumRow(r);
+	sumGroup(r.group);
+	return r.total != before;
+}
+
+void TaScoreTotals::cover(Row& row, int col, int span, int delta)
+{
+	// 覆盖计数从 0 变为非 0 的格子退出总分，反之重新计入
+	int end = qMin(col + span, m_columnCount);
+	for (int c = col; c < end; ++c)
+		row.covered[c] = quint8(row.covered[c] + delta);
+}
+
+void TaScoreTotals::sumRow(Row& row)
+{
+	double total = 0;
+	for (int c = 0; c < m_columnCount; ++c)
+	{
+		if (counts(row, c))
+			total += row.values[c];
+	}
+	row.total = total;
+}
+
+bool TaScoreTotals::setGroup(int row, const QString& group)
+{
+	if (m_rows[row].group == group)
+		return false;
+
+	m_rows[row].group = group;
+	// 小组第一行和人数都可能变，按行重排一遍，只扫行不扫格
+	rebuildGroups();
+	return true;
+}
+
+int TaScoreTotals::spanStart(int row, int col) const
+{
+	const Row& r = m_rows[row];
+	if (col < 0 || col >= m_columnCount || r.covered[col] == 0)
+		return -1;
+
+	// 起始列不大于 col 的注释里，找最后一个覆盖到 col 的
+	auto it = r.spans.upperBound(col);
+	while (it != r.spans.constBegin())
+	{
+		--it;
+		if (it.key() + it.value() > col)
+			return it.key();
+	}
+	return -1;
+}
+
+void TaScoreTotals::sumGroup(const QString& group)
+{
+	if (group.isEmpty())
+		return;
+	auto it = m_groups.find(group);
+	if (it == m_groups.end())
+		return;
+	double total = 0;
+	for (int row : qAsConst(it->rows))
+		total += m_rows[row].total;
+	it->total = total;
+}
+
+QString TaScoreTotals::format(double total)
+{
+	if (qAbs(total) < 1e-9)
+		return QStringLiteral("0");
+	return QString::number(total, 'g', 10);
+}
+
+void TaScoreTotals::rebuildGroups()
+{
+	m_groups.clear();
+	for (int row = 0; row < m_rows.size(); ++row)
+	{
+		const Row& r = m_rows[row];
+		if (r.group.isEmpty())
+			continue;
+		Group& group = m_groups[r.group];
+		if (group.firstRow < 0)
+			group.firstRow = row;
+		++group.rowCount;
+		group.rows.append(row);
+		group.total += r.total;
+	}
+}
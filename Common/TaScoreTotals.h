@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+
+// 积分表的增量汇总：每行的个人总分、每个小组的小组总分。
+// 计分区域是 rows × columns 的分值格（StudentPhysiqueDialog 中姓名列之后、总分列之前的列）；
+// 跨列注释覆盖到的格子不计分，每行用一个区间索引（起始列 -> 跨列数）加每格的覆盖计数表示。
+// 改一个分值、改一个跨列注释或改一行的小组都只重算受影响的那一行和那个小组，
+// 不再每次编辑都把整张表重算一遍；增删行列等结构变化时调用 reset 重建。
+// 行总分按列顺序从存储的分值重新求和、小组总分按行顺序从行总分重新求和，
+// 而不是在累计值上加减差值，这样反复编辑不会积累浮点残差（如 2.77556e-17），结果与整表重算一致。
+class TaScoreTotals
+{
+public:
+	TaScoreTotals();
+
+	// 清空并设定尺寸和每行的小组，之后用 setValue/setSpan 填入分值和注释
+	void reset(int rowCount, int columnCount, const QStringList& groups = QStringList());
+	int rowCount() const { return m_rows.size(); }
+	int columnCount() const { return m_columnCount; }
+
+	// 以下修改返回 true 表示该行的个人总分变了
+	// valid 为 false 表示格子为空或不是数字
+	bool setValue(int row, int col, double value, bool valid);
+	// span > 1 为从 col 起跨 span 列的注释，这些格子不计分；span <= 1 取消
+	bool setSpan(int row, int col, int span);
+	// 返回 true 表示小组划分变了
+	bool setGroup(int row, const QString& group);
+
+	double rowTotal(int row) const { return m_rows[row].total; }
+	QString group(int row) const { return m_rows[row].group; }
+	// 覆盖该格的跨列注释的起始列，没有返回 -1
+	int spanStart(int row, int col) const;
+
+	// 总分的显示文本：0.1 + 0.2 这类小数和保留 10 位有效数字，接近 0 的残差显示为 0
+	static QString format(double total);
+
+	struct Group
+	{
+		double total = 0;
+		int firstRow = -1; // 小组总分显示在小组第一行
+		int rowCount = 0;
+		QVector<int> rows;
+	};
+	// 按小组名汇总，小组为空的行不计入
+	Group groupOf(const QString& group) const { return m_groups.value(group); }
+	const QHash<QString, Group>& groups() const { return m_groups; }
+
+private:
+	struct Row
+	{
+		QVector<double> values;
+		QVector<char> valid;
+		QVector<quint8> covered; // 覆盖该格的跨列注释数
+		QMap<int, int> spans;    // 起始列 -> 跨列数（> 1）
+		double total = 0;
+		QString group;
+	};
+
+	bool counts(const Row& row, int col) const { return row.valid[col] && row.covered[col] == 0; }
+	void cover(Row& row, int col, int span, int delta);
+	void sumRow(Row& row);
+	void sumGroup(const QString& group);
+	void rebuildGroups();
+
+	QVector<Row> m_rows;
+	int m_columnCount;
+	QHash<QString, Group> m_groups;
+};
@@ -0,0 +1,145 @@
+﻿#include "TaTableExport.h"
+#include "TaGradeTable.h"
+#include <QTableWidget>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QBrush>
+#include "xlsxrowwriter.h"
+#include "xlsxformat.h"
+
+static QXlsx::Format cellFormat(const QVariant& foreground, const QVariant& background, QHash<QPair<QRgb, QRgb>, QXlsx::Format>& cache)
+{
+    // 只导出用户设置过的颜色（onFontColor/onBgColor），0表示未设置
+    QRgb fg = foreground.isValid() ? foreground.value<QBrush>().color().rgba() : 0;
+    QRgb bg = background.isValid() ? background.value<QBrush>().color().rgba() : 0;
+    if (fg == 0 && bg == 0)
+        return QXlsx::Format();
+
+    QPair<QRgb, QRgb> key(fg, bg);
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd())
+        return it.value();
+
+    QXlsx::Format format;
+    if (fg != 0)
+        format.setFontColor(QColor::fromRgba(fg));
+    if (bg != 0)
+        format.setPatternBackgroundColor(QColor::fromRgba(bg));
+    cache.insert(key, format);
+    return format;
+}
+
+// 分数列中能完整解析为数字的文本按数值写出，其余按原文
+static QVariant cellValue(const QString& text, bool scoreColumn)
+{
+    if (text.isEmpty())
+        return QVariant();
+    if (!scoreColumn)
+        return QVariant(text);
+    bool ok = false;
+    double number = text.toDouble(&ok);
+    return ok ? QVariant(number) : QVariant(text);
+}
+
+// 两种表格共用的写出流程，fillRow 填好一行的值和格式
+template <typename FillRow>
+static bool writeTable(const QString& fileName, const QString& sheetName, const QTableView* view,
+    const QStringList& headers, int rowCount, const QString& description, QString* errorString, FillRow fillRow)
+{
+    QXlsx::RowWriter writer(fileName);
+    // 导出由用户点击触发，用最快的压缩级别，文件略大但保存不卡界面
+    writer.setCompressionLevel(1);
+    if (!writer.addSheet(sheetName)) {
+        if (errorString)
+            *errorString = writer.errorString().isEmpty() ? QString("无法创建工作表 %1").arg(sheetName) : writer.errorString();
+        return false;
+    }
+
+    const int columnCount = headers.size();
+    for (int col = 0; view && col < columnCount; ++col) {
+        if (!view->isColumnHidden(col))
+            writer.setColumnWidth(col + 1, col + 1, qMax(8.0, view->columnWidth(col) / 7.0));
+    }
+
+    if (!description.isEmpty()) {
+        writer.appendRow(QVector<QVariant>() << description);
+        writer.skipRows(1);
+    }
+
+    QXlsx::Format headerFormat;
+    headerFormat.setFontBold(true);
+
+    QVector<QVariant> values(columnCount);
+    for (int col = 0; col < columnCount; ++col)
+        values[col] = headers[col];
+    writer.appendRow(values, headerFormat);
+
+    // 字体色/背景色相同的单元格共用一个Format，样式表按Format去重时只需比较指针
+    QHash<QPair<QRgb, QRgb>, QXlsx::Format> colorFormats;
+    QVector<QXlsx::Format> formats(columnCount);
+
+    bool ok = true;
+    for (int row = 0; row < rowCount; ++row) {
+        fillRow(row, values, formats, colorFormats);
+        if (!writer.appendRow(values, formats)) {
+            ok = false;
+            break;
+        }
+    }
+
+    // 写行失败时保留那时的错误信息，不被 close 覆盖
+    QString error = writer.errorString();
+    ok = writer.close() && ok;
+    if (!ok && errorString)
+        *errorString = error.isEmpty() ? writer.errorString() : error;
+    return ok;
+}
+
+bool TaTableExport::writeXlsx(const QString& fileName, const QString& sheetName, const QTableWidget* table,
+    const QSet<int>& scoreColumns, const QString& description, QString* errorString)
+{
+    QStringList headers;
+    for (int col = 0; col < table->columnCount(); ++col) {
+        QTableWidgetItem* headerItem = table->horizontalHeaderItem(col);
+        headers.append(headerItem ? headerItem->text() : QString());
+    }
+
+    return writeTable(fileName, sheetName, table, headers, table->rowCount(), description, errorString,
+        [table, &scoreColumns](int row, QVector<QVariant>& values, QVector<QXlsx::Format>& formats, QHash<QPair<QRgb, QRgb>, QXlsx::Format>& colorFormats) {
+            for (int col = 0; col < values.size(); ++col) {
+                QTableWidgetItem* item = table->item(row, col);
+                if (item) {
+                    formats[col] = cellFormat(item->data(Qt::ForegroundRole), item->data(Qt::BackgroundRole), colorFormats);
+                    values[col] = cellValue(item->text(), scoreColumns.contains(col));
+                } else {
+                    formats[col] = QXlsx::Format();
+                    values[col] = QVariant();
+                }
+            }
+        });
+}
+
+bool TaTableExport::writeXlsx(const QString& fileName, const QString& sheetName, const TaGradeTable& grades,
+    const QTableView* view, const QString& description, QString* errorString)
+{
+    QStringList headers;
+    for (int col = 0; col < grades.columnCount(); ++col)
+        headers.append(grades.columnName(col));
+
+    return writeTable(fileName, sheetName, view, headers, grades.rowCount(), description, errorString,
+        [&grades](int row, QVector<QVariant>& values, QVector<QXlsx::Format>& formats, QHash<QPair<QRgb, QRgb>, QXlsx::Format>& colorFormats) {
+            for (int col = 0; col < values.size(); ++col) {
+                formats[col] = cellFormat(grades.decoration(row, col, Qt::ForegroundRole),
+                    grades.decoration(row, col, Qt::BackgroundRole), colorFormats);
+                // 只有分数列按数值写出；学号列、文本列即使内容像数字也保持文本
+                double number = 0;
+                if (grades.columnKind(col) == TaGradeTable::ScoreColumn && grades.number(row, col, &number))
+                    values[col] = number;
+                else
+                    values[col] = cellValue(grades.text(row, col), false);
+            }
+        });
+}
@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <QString>
+#include <QSet>
+
+class QTableWidget;
+class QTableView;
+class TaGradeTable;
+
+// 表格导出：逐行流式写出 xlsx（QXlsx::RowWriter），不在内存中构建 Document，
+// 行数再多内存也不随之增长，可用于整校成绩导出
+class TaTableExport
+{
+public:
+	// 依次写入：说明（非空时，占一行并空一行）、加粗表头、全部数据行；
+	// scoreColumns 中能完整解析为数字的单元格按数值写出，便于在 Excel 中直接求和、排序；
+	// 其余列（学号、姓名等）一律按文本写出，保留前导零和长学号的全部位数；
+	// 单元格设置过的字体色、背景色一并写出
+	static bool writeXlsx(const QString& fileName, const QString& sheetName, const QTableWidget* table,
+		const QSet<int>& scoreColumns, const QString& description, QString* errorString = NULL);
+	// 成绩表数据模型：分数列（ScoreColumn）按数值写出，不经过文本，其余列按文本写出；列宽取自显示它的 view
+	static bool writeXlsx(const QString& fileName, const QString& sheetName, const TaGradeTable& grades,
+		const QTableView* view, const QString& description, QString* errorString = NULL);
+};
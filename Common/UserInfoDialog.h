@@ -18,6 +18,7 @@
 #include "AvatarLabel.h"
 #include "NameLabel.h"
 #include "TAHttpHandler.h"
+#include "TaEndpoints.h"
 
 class UserInfoDialog : public QDialog
 {
@@ -69,7 +70,7 @@ public:
         params["id_number"] = m_userInfo.strIdNumber;
         if (m_httpHandler)
         {
-            m_httpHandler->post(QString("http://47.100.126.194:5000/updateUserInfo"), params);
+            m_httpHandler->post(TaEndpoints::url("/updateUserInfo"), params);
         }
 	}
 
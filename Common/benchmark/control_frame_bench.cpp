@@ -0,0 +1,316 @@
+// control_frame_bench.cpp
+//
+// Compares the two framings of WebSocket control messages
+// (TaQTWebSocket::sendControlMessage):
+//
+//   json         compact JSON text, "to:<id>:<json>" for a target
+//   binary_json  TaControlFrame with a compact JSON payload
+//   binary_cbor  TaControlFrame with a CBOR payload
+//
+// The binary framings deflate payloads of kCompressThreshold bytes or more at
+// level 1, the default of setControlFraming.
+//
+// Each framing is measured on a small status message and on a create-group
+// message with --members members, like the one ClassTeacherDelDialog sends:
+// bytes per message on the wire, encode and decode time per message, and the
+// time to pass --messages messages from one client to another through
+// TaFakeServer, which routes control frames to their target like the server
+// does. The receiver checks every message against the one sent. Results are
+// written as JSON.
+//
+//     control_frame_bench --messages 2000 --members 60 --output bench.json
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QUrl>
+#include <QVector>
+#include <QWebSocket>
+
+#include <functional>
+
+#include "TaControlFrame.h"
+#include "TaEndpoints.h"
+#include "TaFakeServer.h"
+
+namespace {
+
+const int CompressLevel = 1;
+const int TimeoutMs = 30000;
+
+enum Framing { Json, BinaryJson, BinaryCbor };
+
+const char *framingName(Framing framing)
+{
+    switch (framing) {
+    case Json: return "json";
+    case BinaryJson: return "binary_json";
+    default: return "binary_cbor";
+    }
+}
+
+// Deterministic content, the same for every run
+quint32 hash(quint32 a, quint32 b)
+{
+    return a * 2654435761u ^ b * 40503u;
+}
+
+// Two CJK characters, the size of a typical name in UTF-8
+QString memberName(int index)
+{
+    return QString(QChar(0x5f20 + hash(index, 1) % 64)) + QChar(0x4e00 + hash(index, 2) % 2000);
+}
+
+QJsonObject makeStatusMessage(int index)
+{
+    QJsonObject message;
+    message["type"] = "5";
+    message["id"] = index;
+    message["is_read"] = 1;
+    message["unique_group_id"] = QString("group_%1").arg(hash(index, 3) % 100);
+    return message;
+}
+
+QJsonObject makeGroupMessage(int index, int memberCount)
+{
+    QJsonObject message;
+    message["type"] = "3";
+    message["permission_level"] = 1;
+    message["headImage_path"] = "/images/group.png";
+    message["group_type"] = 1;
+    message["nickname"] = QString("%1").arg(index % 9 + 1) + QChar(0x5e74) + QChar(0x7ea7);
+    message["owner_id"] = QString("T%1").arg(100000 + index % 97);
+    message["owner_name"] = memberName(index);
+
+    QJsonArray members;
+    for (int i = 0; i < memberCount; ++i) {
+        QJsonObject member;
+        member["unique_member_id"] = QString("S%1").arg(200000 + int(hash(index, i) % 800000));
+        member["member_name"] = memberName(index * memberCount + i);
+        member["group_role"] = i == 0 ? 0 : 2;
+        members.append(member);
+    }
+    message["members"] = members;
+    return message;
+}
+
+// What sendControlMessage puts on the wire for \a target
+QByteArray encode(Framing framing, const QString &target, const QJsonObject &message)
+{
+    if (framing == Json) {
+        const QByteArray json = QJsonDocument(message).toJson(QJsonDocument::Compact);
+        return "to:" + target.toUtf8() + ':' + json;
+    }
+    return TaControlFrame::encode(target, message, framing == BinaryCbor, CompressLevel);
+}
+
+// What the receiver does with a delivered message; the server strips the
+// "to:<id>:" prefix of text messages
+bool decode(Framing framing, const QByteArray &delivered, QJsonObject *message)
+{
+    if (framing == Json) {
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(delivered, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject())
+            return false;
+        *message = doc.object();
+        return true;
+    }
+    return TaControlFrame::decode(delivered, nullptr, message);
+}
+
+QByteArray delivered(Framing framing, const QByteArray &sent)
+{
+    return framing == Json ? sent.mid(sent.indexOf(':', 3) + 1) : sent;
+}
+
+bool spin(const std::function<bool()> &done)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done() && timer.elapsed() < TimeoutMs)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    return done();
+}
+
+struct Result
+{
+    double rawBytes = 0;  // compact JSON per message
+    double wireBytes = 0; // as sent per message
+    double encodeUs = 0;
+    double decodeUs = 0;
+    double transferMs = 0;
+    int received = 0;
+    bool match = true;
+};
+
+Result measure(Framing framing, const QVector<QJsonObject> &messages, QWebSocket &sender, QWebSocket &receiver,
+               const QString &receiverId)
+{
+    Result result;
+    const int count = messages.size();
+
+    QVector<QByteArray> packets;
+    packets.reserve(count);
+    QElapsedTimer timer;
+    timer.start();
+    for (const QJsonObject &message : messages)
+        packets.append(encode(framing, receiverId, message));
+    result.encodeUs = timer.nsecsElapsed() / 1e3 / count;
+
+    timer.restart();
+    for (const QByteArray &packet : qAsConst(packets)) {
+        QJsonObject message;
+        result.match = decode(framing, delivered(framing, packet), &message) && result.match;
+    }
+    result.decodeUs = timer.nsecsElapsed() / 1e3 / count;
+
+    qint64 rawBytes = 0;
+    qint64 wireBytes = 0;
+    for (int i = 0; i < count; ++i) {
+        rawBytes += QJsonDocument(messages[i]).toJson(QJsonDocument::Compact).size();
+        wireBytes += packets[i].size();
+    }
+    result.rawBytes = double(rawBytes) / count;
+    result.wireBytes = double(wireBytes) / count;
+
+    // sender -> TaFakeServer -> receiver, checked in order
+    auto onMessage = [&](const QByteArray &data) {
+        QJsonObject message;
+        const bool ok = result.received < count && decode(framing, data, &message)
+            && message == messages[result.received];
+        result.match = ok && result.match;
+        ++result.received;
+    };
+    QMetaObject::Connection textConnection = QObject::connect(&receiver, &QWebSocket::textMessageReceived,
+        [&](const QString &text) { onMessage(text.toUtf8()); });
+    QMetaObject::Connection binaryConnection = QObject::connect(&receiver, &QWebSocket::binaryMessageReceived, onMessage);
+
+    timer.restart();
+    for (const QByteArray &packet : qAsConst(packets)) {
+        if (framing == Json)
+            sender.sendTextMessage(QString::fromUtf8(packet));
+        else
+            sender.sendBinaryMessage(packet);
+    }
+    result.match = spin([&]() { return result.received >= count; }) && result.match;
+    result.transferMs = timer.nsecsElapsed() / 1e6;
+
+    QObject::disconnect(textConnection);
+    QObject::disconnect(binaryConnection);
+    return result;
+}
+
+QJsonObject record(Framing framing, const QString &payload, int messages, const Result &result)
+{
+    QJsonObject json;
+    json.insert(QStringLiteral("framing"), QLatin1String(framingName(framing)));
+    json.insert(QStringLiteral("payload"), payload);
+    json.insert(QStringLiteral("messages"), messages);
+    json.insert(QStringLiteral("json_bytes_per_message"), result.rawBytes);
+    json.insert(QStringLiteral("wire_bytes_per_message"), result.wireBytes);
+    json.insert(QStringLiteral("encode_us_per_message"), result.encodeUs);
+    json.insert(QStringLiteral("decode_us_per_message"), result.decodeUs);
+    json.insert(QStringLiteral("transfer_ms"), result.transferMs);
+    json.insert(QStringLiteral("received"), result.received);
+    json.insert(QStringLiteral("match"), result.match);
+    QTextStream(stderr) << framingName(framing) << ' ' << payload << ": " << result.wireBytes << " B/msg (json "
+                        << result.rawBytes << "), encode " << result.encodeUs << " us, decode " << result.decodeUs
+                        << " us, transfer " << result.transferMs << " ms\n";
+    return json;
+}
+
+bool connectClient(QWebSocket &socket, const QString &id)
+{
+    bool connected = false;
+    QMetaObject::Connection connection = QObject::connect(&socket, &QWebSocket::connected,
+                                                          [&connected]() { connected = true; });
+    socket.open(QUrl(TaEndpoints::wsUrl(id)));
+    const bool ok = spin([&connected]() { return connected; });
+    QObject::disconnect(connection);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Compares the JSON and binary framings of control messages."));
+    parser.addHelpOption();
+    QCommandLineOption messagesOption(QStringLiteral("messages"), QStringLiteral("Messages per framing and payload."),
+                                      QStringLiteral("count"), QStringLiteral("2000"));
+    QCommandLineOption membersOption(QStringLiteral("members"), QStringLiteral("Members of the create-group message."),
+                                     QStringLiteral("count"), QStringLiteral("60"));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("JSON file, stdout when omitted."),
+                                    QStringLiteral("file"));
+    parser.addOptions({ messagesOption, membersOption, outputOption });
+    parser.process(app);
+
+    const int messageCount = qMax(1, parser.value(messagesOption).toInt());
+    const int memberCount = qMax(1, parser.value(membersOption).toInt());
+
+    TaFakeServer server(TaFakeServerConfig{});
+    if (!server.start()) {
+        QTextStream(stderr) << "cannot start TaFakeServer\n";
+        return 1;
+    }
+    const QString receiverId = QStringLiteral("bench_receiver");
+    QWebSocket sender;
+    QWebSocket receiver;
+    if (!connectClient(sender, QStringLiteral("bench_sender")) || !connectClient(receiver, receiverId)) {
+        QTextStream(stderr) << "cannot connect to TaFakeServer\n";
+        return 1;
+    }
+
+    QVector<QJsonObject> statusMessages;
+    QVector<QJsonObject> groupMessages;
+    for (int i = 0; i < messageCount; ++i) {
+        statusMessages.append(makeStatusMessage(i));
+        groupMessages.append(makeGroupMessage(i, memberCount));
+    }
+
+    QJsonArray results;
+    bool match = true;
+    for (Framing framing : { Json, BinaryJson, BinaryCbor }) {
+        const Result status = measure(framing, statusMessages, sender, receiver, receiverId);
+        results.append(record(framing, QStringLiteral("status"), messageCount, status));
+        const Result group = measure(framing, groupMessages, sender, receiver, receiverId);
+        results.append(record(framing, QStringLiteral("group_%1").arg(memberCount), messageCount, group));
+        match = match && status.match && group.match;
+    }
+    if (!match)
+        QTextStream(stderr) << "messages were lost or changed in transit\n";
+
+    QJsonObject report;
+    report.insert(QStringLiteral("benchmark"), QStringLiteral("control_frame_bench"));
+    report.insert(QStringLiteral("qt"), QLatin1String(qVersion()));
+    report.insert(QStringLiteral("os"), QSysInfo::prettyProductName());
+    report.insert(QStringLiteral("cpu"), QSysInfo::currentCpuArchitecture());
+    report.insert(QStringLiteral("date"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    report.insert(QStringLiteral("compress_level"), CompressLevel);
+    report.insert(QStringLiteral("messages_match"), match);
+    report.insert(QStringLiteral("results"), results);
+
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            QTextStream(stderr) << "cannot write " << file.fileName() << '\n';
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return match ? 0 : 1;
+}
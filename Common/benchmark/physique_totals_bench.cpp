@@ -0,0 +1,249 @@
+// physique_totals_bench.cpp
+//
+// Replays rapid score edits on a synthetic group score sheet and times how
+// the row and group totals are kept up to date:
+//
+//   full         what StudentPhysiqueDialog did on every edit before
+//                TaScoreTotals: parse every scoring cell of every row, scan
+//                back over the row for comment spans covering the cell, then
+//                regroup all rows for the group totals
+//   incremental  TaScoreTotals: resum only the edited row and its group
+//
+// Only the totals are timed, not the QTableWidget updates around them. The
+// two methods are checked against each other after the replay. Results are
+// written as JSON.
+//
+// Both sum the same values in the same order, so the totals have to be
+// equal exactly, not just within a tolerance: any drift would show up in the
+// sheet as residue like 2.77556e-17.
+//
+//     physique_totals_bench --rows 60 --columns 40 --edits 20000 --output bench.json
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+
+#include "TaScoreTotals.h"
+
+namespace {
+
+const int StudentsPerGroup = 6;
+
+struct Sheet
+{
+    QVector<QStringList> cells;   // scoring cells as the table holds them
+    QVector<QVector<int>> spans;  // comment span starting at the cell, 0 if none
+    QStringList groups;
+};
+
+struct Edit
+{
+    int row;
+    int col;
+    QString text;
+};
+
+// Deterministic content, the same for every run
+quint32 hash(quint32 a, quint32 b)
+{
+    return a * 2654435761u ^ b * 40503u;
+}
+
+Sheet makeSheet(int rows, int columns)
+{
+    Sheet sheet;
+    for (int row = 0; row < rows; ++row) {
+        QStringList cells;
+        QVector<int> spans(columns, 0);
+        for (int col = 0; col < columns; ++col) {
+            const quint32 seed = hash(row, col);
+            cells.append(seed % 7 == 0 ? QString() : QString::number(seed % 4));
+        }
+        // one two-column comment in every third row, like the sample sheet
+        if (row % 3 == 0 && columns > 2)
+            spans[hash(row, 99) % (columns - 1)] = 2;
+        sheet.cells.append(cells);
+        sheet.spans.append(spans);
+        sheet.groups.append(QString::number(row / StudentsPerGroup + 1));
+    }
+    return sheet;
+}
+
+QVector<Edit> makeEdits(int rows, int columns, int count)
+{
+    QVector<Edit> edits;
+    edits.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const quint32 seed = hash(i, 7);
+        // tenths, which leave residue in running sums
+        edits.append({ int(seed % rows), int((seed >> 8) % columns), QString::number(((seed >> 16) % 40) / 10.0) });
+    }
+    return edits;
+}
+
+// The pre-TaScoreTotals recomputation: updateAllTotals + updateGroupTotals
+void fullTotals(const Sheet &sheet, QVector<double> &rowTotals, QMap<QString, double> &groupTotals)
+{
+    const int columns = sheet.cells.isEmpty() ? 0 : sheet.cells.first().size();
+    for (int row = 0; row < sheet.cells.size(); ++row) {
+        double total = 0.0;
+        for (int col = 0; col < columns; ++col) {
+            const int spanCols = sheet.spans[row][col];
+            if (spanCols > 1) {
+                col += spanCols - 1;
+                continue;
+            }
+            bool isInCommentSpan = false;
+            for (int c = col - 1; c >= 0; --c) {
+                const int sc = sheet.spans[row][c];
+                if (sc > 1 && c + sc > col) {
+                    isInCommentSpan = true;
+                    break;
+                }
+            }
+            if (isInCommentSpan)
+                continue;
+            bool ok;
+            const double value = sheet.cells[row][col].toDouble(&ok);
+            if (ok)
+                total += value;
+        }
+        rowTotals[row] = total;
+    }
+
+    groupTotals.clear();
+    QMap<QString, QVector<int>> groupRows;
+    for (int row = 0; row < sheet.cells.size(); ++row) {
+        const QString &group = sheet.groups[row];
+        if (group.isEmpty())
+            continue;
+        groupTotals[group] += rowTotals[row];
+        groupRows[group].append(row);
+    }
+}
+
+void loadTotals(const Sheet &sheet, TaScoreTotals &totals)
+{
+    const int columns = sheet.cells.isEmpty() ? 0 : sheet.cells.first().size();
+    totals.reset(sheet.cells.size(), columns, sheet.groups);
+    for (int row = 0; row < sheet.cells.size(); ++row) {
+        for (int col = 0; col < columns; ++col) {
+            bool ok;
+            const double value = sheet.cells[row][col].toDouble(&ok);
+            totals.setValue(row, col, value, ok);
+            totals.setSpan(row, col, sheet.spans[row][col]);
+        }
+    }
+}
+
+QJsonObject record(const QString &method, int rows, int columns, int edits, double ms)
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("method"), method);
+    result.insert(QStringLiteral("rows"), rows);
+    result.insert(QStringLiteral("columns"), columns);
+    result.insert(QStringLiteral("edits"), edits);
+    result.insert(QStringLiteral("ms"), ms);
+    result.insert(QStringLiteral("us_per_edit"), edits > 0 ? ms * 1000.0 / edits : 0.0);
+    QTextStream(stderr) << method << ' ' << rows << 'x' << columns << ": " << ms << " ms, "
+                        << (edits > 0 ? ms * 1000.0 / edits : 0.0) << " us/edit\n";
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Times row and group total updates of the group score sheet."));
+    parser.addHelpOption();
+    QCommandLineOption rowsOption(QStringLiteral("rows"), QStringLiteral("Students."),
+                                  QStringLiteral("count"), QStringLiteral("60"));
+    QCommandLineOption columnsOption(QStringLiteral("columns"), QStringLiteral("Scoring columns."),
+                                     QStringLiteral("count"), QStringLiteral("40"));
+    QCommandLineOption editsOption(QStringLiteral("edits"), QStringLiteral("Edits to replay."),
+                                   QStringLiteral("count"), QStringLiteral("20000"));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("JSON file, stdout when omitted."),
+                                    QStringLiteral("file"));
+    parser.addOptions({ rowsOption, columnsOption, editsOption, outputOption });
+    parser.process(app);
+
+    const int rows = qMax(1, parser.value(rowsOption).toInt());
+    const int columns = qMax(1, parser.value(columnsOption).toInt());
+    const int editCount = qMax(0, parser.value(editsOption).toInt());
+    const QVector<Edit> edits = makeEdits(rows, columns, editCount);
+    QJsonArray results;
+
+    // full: every edit recomputes the whole sheet
+    Sheet fullSheet = makeSheet(rows, columns);
+    QVector<double> rowTotals(rows);
+    QMap<QString, double> groupTotals;
+    QElapsedTimer timer;
+    timer.start();
+    for (const Edit &edit : edits) {
+        fullSheet.cells[edit.row][edit.col] = edit.text;
+        fullTotals(fullSheet, rowTotals, groupTotals);
+    }
+    results.append(record(QStringLiteral("full"), rows, columns, editCount, timer.nsecsElapsed() / 1e6));
+
+    // incremental: every edit updates one row and one group
+    Sheet sheet = makeSheet(rows, columns);
+    TaScoreTotals totals;
+    timer.restart();
+    loadTotals(sheet, totals);
+    results.append(record(QStringLiteral("incremental_load"), rows, columns, 0, timer.nsecsElapsed() / 1e6));
+    timer.restart();
+    for (const Edit &edit : edits) {
+        bool ok;
+        const double value = edit.text.toDouble(&ok);
+        totals.setValue(edit.row, edit.col, value, ok);
+    }
+    results.append(record(QStringLiteral("incremental"), rows, columns, editCount, timer.nsecsElapsed() / 1e6));
+
+    // Both methods have to agree
+    if (editCount == 0)
+        fullTotals(fullSheet, rowTotals, groupTotals);
+    bool match = true;
+    for (int row = 0; row < rows; ++row)
+        match = match && rowTotals[row] == totals.rowTotal(row);
+    for (auto it = groupTotals.constBegin(); it != groupTotals.constEnd(); ++it)
+        match = match && it.value() == totals.groupOf(it.key()).total;
+    if (!match)
+        QTextStream(stderr) << "totals differ between full and incremental\n";
+
+    QJsonObject report;
+    report.insert(QStringLiteral("benchmark"), QStringLiteral("physique_totals_bench"));
+    report.insert(QStringLiteral("qt"), QLatin1String(qVersion()));
+    report.insert(QStringLiteral("os"), QSysInfo::prettyProductName());
+    report.insert(QStringLiteral("cpu"), QSysInfo::currentCpuArchitecture());
+    report.insert(QStringLiteral("date"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    report.insert(QStringLiteral("totals_match"), match);
+    report.insert(QStringLiteral("results"), results);
+
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            QTextStream(stderr) << "cannot write " << file.fileName() << '\n';
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return match ? 0 : 1;
+}
@@ -1,57 +1,36 @@
-#ifndef UNICODE
-#define UNICODE
-#endif
-
-#ifndef _WIN32_WINNT
-#define _WIN32_WINNT 0x0600
-#endif
-
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-
-#include <Windows.h>
-#include <http.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <atomic>
+
+#include <QThread>
+#include <QThreadPool>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QUrl>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
 
 #include "HttpServer.h"
 
 /**************************************************************************/
 
-//
-// Macros.
-//
-#define INITIALIZE_HTTP_RESPONSE( resp, status, reason )    \
-    do                                                      \
-    {                                                       \
-        RtlZeroMemory( (resp), sizeof(*(resp)) );           \
-        (resp)->StatusCode = (status);                      \
-        (resp)->pReason = (reason);                         \
-        (resp)->ReasonLength = (USHORT) strlen(reason);     \
-    } while (FALSE)
-
-#define ADD_KNOWN_HEADER(Response, HeaderId, RawValue)               \
-    do                                                               \
-    {                                                                \
-        (Response).Headers.KnownHeaders[(HeaderId)].pRawValue =      \
-                                                          (RawValue);\
-        (Response).Headers.KnownHeaders[(HeaderId)].RawValueLength = \
-            (USHORT) strlen(RawValue);                               \
-    } while(FALSE)
-
-#define ALLOC_MEM(cb) HeapAlloc(GetProcessHeap(), 0, (cb))
-
-#define FREE_MEM(ptr) HeapFree(GetProcessHeap(), 0, (ptr))
-
+static const int kMaxHeaderBytes = 16 * 1024;        // 请求行 + 头部上限
+static const qint64 kMaxBodyBytes = 1024 * 1024;     // 只处理 GET/HEAD，请求体读完即丢弃
+static const qint64 kFileSliceBytes = 256 * 1024;    // 每次从文件映射区交给 socket 的字节数
+static const qint64 kWriteHighWater = 1024 * 1024;   // socket 待发数据超过此值时暂停续写文件
 
 static std::string logFormat(const char* pszFormat, ...)
 {
-    char buffer[MAX_PATH * 4] = { 0 };  // 注意缓冲区溢出
+    char buffer[1024] = { 0 };  // 注意缓冲区溢出
 
     va_list ap;
     va_start(ap, pszFormat);
-    int nCount = ::vsprintf_s(buffer, _countof(buffer), pszFormat, ap);
+    int nCount = ::vsnprintf(buffer, sizeof(buffer), pszFormat, ap);
     va_end(ap);
 
     if (nCount < 0)
@@ -63,291 +42,660 @@ static std::string logFormat(const char* pszFormat, ...)
     return buffer;
 }
 
-HttpServer::HttpServer(IHttpServerCallback* callback)
-    : m_callback(callback)
-    , m_reqQueue(NULL)
-    , m_thread()
-    , m_urls()
+static const char* reasonPhrase(int statusCode)
 {
-    assert(m_callback);
+    switch (statusCode)
+    {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
 }
 
-HttpServer::~HttpServer()
+static QByteArray contentTypeOf(const QString& filePath)
 {
-    close();
-
-    if (m_thread && m_thread->joinable())
-    {
-        m_thread->join();
-    }
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix == "html" || suffix == "htm") return "text/html";
+    if (suffix == "json") return "application/json";
+    if (suffix == "js") return "application/javascript";
+    if (suffix == "css") return "text/css";
+    if (suffix == "txt" || suffix == "log") return "text/plain";
+    if (suffix == "png") return "image/png";
+    if (suffix == "jpg" || suffix == "jpeg") return "image/jpeg";
+    if (suffix == "wav") return "audio/wav";
+    return "application/octet-stream";
 }
 
-DWORD HttpServer::listen(const std::vector<std::wstring>& urls)
+/**************************************************************************/
+
+struct HttpConnection
 {
-    m_callback->onLog(HSLOG_INFO_LEVEL, "Http server listen");
+    ULONGLONG id = 0;
+    QTcpSocket* socket = NULL;
+    QTcpServer* server = NULL;
+    QByteArray buffer;
+    bool busy = false;          // 有请求正在处理，后续流水线请求排队
+    bool keepAlive = true;
+    bool http10 = false;
+    bool headOnly = false;
+    std::shared_ptr<std::atomic<bool>> alive = std::make_shared<std::atomic<bool>>(true);
+
+    // 正在发送的文件
+    QFile* file = NULL;
+    uchar* map = NULL;
+    qint64 fileOffset = 0;
+    qint64 fileSize = 0;
+};
+
+struct HttpServerImpl
+{
+    explicit HttpServerImpl(IHttpServerCallback* cb) : callback(cb) {}
+
+    DWORD open(const std::vector<std::wstring>& urls);
+    void shutdown();
+
+    void onNewConnection(QTcpServer* server);
+    void processNext(HttpConnection* conn);
+    void dispatch(HttpConnection* conn, const QByteArray& target);
+    void sendHeader(HttpConnection* conn, int statusCode, const QByteArray& contentType, qint64 contentLength);
+    void sendResponse(HttpConnection* conn, int statusCode, const QByteArray& body);
+    void sendError(HttpConnection* conn, int statusCode);
+    void startFile(HttpConnection* conn, const QString& filePath);
+    void pumpFile(HttpConnection* conn);
+    void closeFile(HttpConnection* conn);
+    void finishResponse(HttpConnection* conn);
+    void closeConnection(HttpConnection* conn);
+
+    IHttpServerCallback* callback;
+    QThread thread;                 // I/O 线程：accept、解析、收发都在这里
+    QObject* context = NULL;        // 归属 I/O 线程，用来把工作线程的结果投递回来
+    QThreadPool pool;               // 执行回调的工作线程
+    QList<QTcpServer*> servers;
+    QHash<QTcpServer*, QList<QByteArray>> prefixes;
+    QHash<QTcpSocket*, HttpConnection*> connections;
+    ULONGLONG nextId = 1;
+};
+
+// onChunkedRequest 的写入端：在工作线程里调用，数据按顺序投递回 I/O 线程发送
+class HttpChunkWriter : public IHttpChunkWriter
+{
+public:
+    // 连接参数在 I/O 线程里取好传进来，工作线程不直接读 HttpConnection
+    HttpChunkWriter(HttpServerImpl* impl, HttpConnection* conn, const std::shared_ptr<std::atomic<bool>>& alive,
+        const DWORD* statusCode, bool headOnly, bool chunked, bool keepAlive)
+        : m_impl(impl), m_conn(conn), m_alive(alive), m_statusCode(statusCode)
+        , m_headerSent(false), m_headOnly(headOnly), m_chunked(chunked), m_keepAlive(keepAlive)
+    {
+    }
 
-    if (m_thread)
+    bool write(const std::string& chunk) override
     {
-        assert(false == m_thread);  // 不支持重入
-        m_callback->onLog(HSLOG_ERROR_LEVEL, "Do not support reentry");
-        return ERROR_INVALID_ACCESS;
+        if (!*m_alive) return false;
+        if (chunk.empty()) return true;     // 空块会被当作结束标记
+
+        QByteArray data;
+        if (!m_headerSent)
+        {
+            data = header();
+            m_headerSent = true;
+        }
+        if (!m_headOnly)
+        {
+            if (m_chunked)
+            {
+                data += QByteArray::number((qulonglong)chunk.size(), 16) + "\r\n";
+                data.append(chunk.data(), (int)chunk.size());
+                data += "\r\n";
+            }
+            else
+            {
+                data.append(chunk.data(), (int)chunk.size());
+            }
+        }
+        post(data, false);
+        return *m_alive;
     }
 
-    if (0 == urls.size())
+    void finish()
     {
-        m_callback->onLog(HSLOG_ERROR_LEVEL, "Do not support reentry");
-        return ERROR_INVALID_PARAMETER;
+        QByteArray data;
+        if (!m_headerSent)
+        {
+            data = header();
+            m_headerSent = true;
+        }
+        if (m_chunked && !m_headOnly)
+        {
+            data += "0\r\n\r\n";
+        }
+        post(data, true);
     }
 
-    ULONG ret = ::HttpInitialize(HTTPAPI_VERSION_1, HTTP_INITIALIZE_SERVER, NULL);
-    if (NO_ERROR != ret)
+private:
+    QByteArray header() const
     {
-        m_callback->onLog(HSLOG_ERROR_LEVEL, logFormat("HttpInitialize failed: %lu", ret));
-        return ret;
+        int statusCode = (int)*m_statusCode;
+        QByteArray data = "HTTP/1.1 " + QByteArray::number(statusCode) + " " + reasonPhrase(statusCode) + "\r\n";
+        data += "Content-Type: text/html\r\n";
+        if (m_chunked)
+        {
+            data += "Transfer-Encoding: chunked\r\n";
+        }
+        data += (m_chunked && m_keepAlive) ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        data += "\r\n";
+        return data;
     }
 
-    ret = ::HttpCreateHttpHandle(&m_reqQueue, 0);
-    if (NO_ERROR != ret)
+    void post(const QByteArray& data, bool last)
     {
-        m_callback->onLog(HSLOG_ERROR_LEVEL, logFormat("HttpCreateHttpHandle failed: %lu", ret));
-        return ret;
+        HttpServerImpl* impl = m_impl;
+        HttpConnection* conn = m_conn;
+        std::shared_ptr<std::atomic<bool>> alive = m_alive;
+        bool chunked = m_chunked;
+        QMetaObject::invokeMethod(impl->context, [=]() {
+            if (!*alive) return;
+            conn->socket->write(data);
+            if (last)
+            {
+                // HTTP/1.0 没有分块编码，靠关闭连接表示结束
+                if (!chunked) conn->keepAlive = false;
+                impl->finishResponse(conn);
+            }
+        }, Qt::QueuedConnection);
     }
 
-    //
-    // The command line arguments represent URIs that to 
-    // listen on. Call HttpAddUrl for each URI.
-    //
-    // The URI is a fully qualified URI and must include the
-    // terminating (/) character.
-    //
+    HttpServerImpl* m_impl;
+    HttpConnection* m_conn;
+    std::shared_ptr<std::atomic<bool>> m_alive;
+    const DWORD* m_statusCode;
+    bool m_headerSent;
+    bool m_headOnly;
+    bool m_chunked;
+    bool m_keepAlive;
+};
+
+/**************************************************************************/
+
+DWORD HttpServerImpl::open(const std::vector<std::wstring>& urls)
+{
+    QHash<QString, QTcpServer*> byHostPort;
+    DWORD ret = ERROR_INVALID_PARAMETER;
+
     for (std::vector<std::wstring>::const_iterator it = urls.begin(); urls.end() != it; ++it)
     {
-        ret = ::HttpAddUrl(m_reqQueue, it->c_str(), NULL);
-        if (NO_ERROR != ret)
+        // 前缀格式同 HTTP.sys：http://host:port/path/，host 可以是 + 或 *
+        QString url = QString::fromStdWString(*it);
+        if (!url.startsWith("http://", Qt::CaseInsensitive))
         {
-            m_callback->onLog(HSLOG_ERROR_LEVEL, logFormat("HttpAddUrl failed: %lu", ret));
+            callback->onLog(HSLOG_ERROR_LEVEL, logFormat("Unsupported url: %s", url.toUtf8().constData()));
+            continue;
         }
+
+        QString rest = url.mid(7);
+        int slash = rest.indexOf('/');
+        QString hostPort = slash < 0 ? rest : rest.left(slash);
+        QString path = slash < 0 ? QString("/") : rest.mid(slash);
+
+        QString host = hostPort;
+        quint16 port = 80;
+        int colon = hostPort.lastIndexOf(':');
+        if (colon > hostPort.lastIndexOf(']'))
+        {
+            host = hostPort.left(colon);
+            port = hostPort.mid(colon + 1).toUShort();
+        }
+        if (host.startsWith('[') && host.endsWith(']'))
+        {
+            host = host.mid(1, host.size() - 2);
+        }
+
+        QString key = host + ":" + QString::number(port);
+        QTcpServer* server = byHostPort.value(key);
+        if (NULL == server)
+        {
+            QHostAddress address;
+            if (host == "+" || host == "*")
+            {
+                address = QHostAddress::Any;
+            }
+            else if (host.compare("localhost", Qt::CaseInsensitive) == 0)
+            {
+                address = QHostAddress::LocalHost;
+            }
+            else if (!address.setAddress(host))
+            {
+                callback->onLog(HSLOG_WARNING_LEVEL, logFormat("Unknown host %s, listen on any address", host.toUtf8().constData()));
+                address = QHostAddress::Any;
+            }
+
+            server = new QTcpServer(context);
+            if (!server->listen(address, port))
+            {
+                callback->onLog(HSLOG_ERROR_LEVEL, logFormat("Listen %s failed: %s",
+                    url.toUtf8().constData(), server->errorString().toUtf8().constData()));
+                delete server;
+                ret = ERROR_ACCESS_DENIED;
+                continue;
+            }
+
+            QObject::connect(server, &QTcpServer::newConnection, context, [this, server]() { onNewConnection(server); });
+            byHostPort.insert(key, server);
+            servers.append(server);
+        }
+        prefixes[server].append(path.toUtf8());
     }
 
-    m_thread.reset(new std::thread(&HttpServer::handle, this));
-    if (false == m_thread)
+    return servers.isEmpty() ? ret : ERROR_SUCCESS;
+}
+
+void HttpServerImpl::shutdown()
+{
+    for (QTcpServer* server : servers)
     {
-        m_callback->onLog(HSLOG_ERROR_LEVEL, "Create thread failed");
-        return ERROR_OUTOFMEMORY;
+        server->close();
+        delete server;
     }
+    servers.clear();
+    prefixes.clear();
 
-    return ERROR_SUCCESS;
+    QList<HttpConnection*> conns = connections.values();
+    connections.clear();
+    for (HttpConnection* conn : conns)
+    {
+        *conn->alive = false;
+        closeFile(conn);
+        conn->socket->disconnect(context);
+        conn->socket->abort();
+        delete conn->socket;
+        delete conn;
+    }
 }
 
-void HttpServer::close()
+void HttpServerImpl::onNewConnection(QTcpServer* server)
 {
-    m_callback->onLog(HSLOG_INFO_LEVEL, "Http server close");
+    while (server->hasPendingConnections())
+    {
+        QTcpSocket* socket = server->nextPendingConnection();
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+        HttpConnection* conn = new HttpConnection;
+        conn->id = nextId++;
+        conn->socket = socket;
+        conn->server = server;
+        connections.insert(socket, conn);
+
+        QObject::connect(socket, &QTcpSocket::readyRead, context, [this, conn]() {
+            conn->buffer += conn->socket->readAll();
+            processNext(conn);
+        });
+        QObject::connect(socket, &QTcpSocket::bytesWritten, context, [this, conn]() {
+            if (conn->file) pumpFile(conn);
+        });
+        QObject::connect(socket, &QTcpSocket::disconnected, context, [this, conn]() {
+            closeConnection(conn);
+        });
+    }
+}
+
+void HttpServerImpl::processNext(HttpConnection* conn)
+{
+    if (conn->busy) return;
 
-    if (NULL != m_reqQueue)
+    int headerEnd = conn->buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
     {
-        for (std::vector<std::wstring>::iterator it = m_urls.begin(); m_urls.end() != it; ++it)
+        if (conn->buffer.size() > kMaxHeaderBytes)
         {
-            ::HttpRemoveUrl(m_reqQueue, it->c_str());
+            conn->keepAlive = false;
+            conn->busy = true;
+            sendError(conn, 431);
         }
+        return;
+    }
 
-        ::CloseHandle(m_reqQueue);
-        m_reqQueue = NULL;
+    QList<QByteArray> lines = conn->buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.isEmpty() ? QList<QByteArray>() : lines[0].trimmed().split(' ');
 
-        HttpTerminate(HTTP_INITIALIZE_SERVER, NULL);
+    qint64 contentLength = 0;
+    QByteArray connectionHeader;
+    bool chunkedBody = false;
+    for (int i = 1; i < lines.size(); i++)
+    {
+        int colon = lines[i].indexOf(':');
+        if (colon <= 0) continue;
+        QByteArray name = lines[i].left(colon).trimmed().toLower();
+        QByteArray value = lines[i].mid(colon + 1).trimmed();
+        if (name == "content-length") contentLength = value.toLongLong();
+        else if (name == "connection") connectionHeader = value.toLower();
+        else if (name == "transfer-encoding") chunkedBody = value.toLower().contains("chunked");
     }
-}
 
-void HttpServer::handle()
-{
-    DWORD bytesRead = 0;
-    PHTTP_REQUEST pRequest = NULL;
-    PCHAR pRequestBuffer = NULL;
-    ULONG RequestBufferLength = 0;
-
-    //
-    // Allocate a 2 KB buffer. This size should work for most 
-    // requests. The buffer size can be increased if required. Space
-    // is also required for an HTTP_REQUEST structure.
-    //
-    RequestBufferLength = sizeof(HTTP_REQUEST) + 2048;
-    pRequestBuffer = (PCHAR)ALLOC_MEM(RequestBufferLength);
-
-    if (pRequestBuffer == NULL)
-    {
-        m_callback->onLog(HSLOG_ERROR_LEVEL, "Out of memory");
+    conn->busy = true;
+    if (requestLine.size() != 3 || !requestLine[2].startsWith("HTTP/1."))
+    {
+        conn->keepAlive = false;
+        sendError(conn, 400);
         return;
     }
+    if (chunkedBody || contentLength < 0 || contentLength > kMaxBodyBytes)
+    {
+        conn->keepAlive = false;
+        sendError(conn, 413);
+        return;
+    }
+    if (conn->buffer.size() < headerEnd + 4 + contentLength)
+    {
+        conn->busy = false;     // 等请求体收齐
+        return;
+    }
+    conn->buffer.remove(0, headerEnd + 4 + (int)contentLength);
 
-    pRequest = (PHTTP_REQUEST)pRequestBuffer;
+    const QByteArray& method = requestLine[0];
+    conn->http10 = requestLine[2] == "HTTP/1.0";
+    conn->keepAlive = conn->http10 ? connectionHeader == "keep-alive" : connectionHeader != "close";
+    conn->headOnly = method == "HEAD";
 
-    //
-    // Wait for a new request. This is indicated by a NULL 
-    // request ID.
-    //
-    HTTP_REQUEST_ID requestId = 0;
-    HTTP_SET_NULL_ID(&requestId);
+    if (method == "GET" || method == "HEAD")
+    {
+        dispatch(conn, requestLine[1]);
+    }
+    else
+    {
+        callback->onLog(HSLOG_INFO_LEVEL, logFormat("Got a %s request for %s, not implemented",
+            method.constData(), requestLine[1].constData()));
+        sendError(conn, 501);
+    }
+}
 
-    while (true)
+void HttpServerImpl::dispatch(HttpConnection* conn, const QByteArray& target)
+{
+    // 只受理 listen 时登记过的路径前缀
+    QByteArray path = target.left(target.indexOf('?'));
+    bool matched = false;
+    for (const QByteArray& prefix : prefixes.value(conn->server))
     {
-        RtlZeroMemory(pRequest, RequestBufferLength);
+        if (path.startsWith(prefix) || path + "/" == prefix)
+        {
+            matched = true;
+            break;
+        }
+    }
+    if (!matched)
+    {
+        sendError(conn, 404);
+        return;
+    }
+
+    // 与 HTTP.sys 的 CookedUrl.pAbsPath 一致：已解码的路径，带查询串
+    std::wstring absPath = QUrl::fromPercentEncoding(target).toStdWString();
+    std::shared_ptr<std::atomic<bool>> alive = conn->alive;
+    bool headOnly = conn->headOnly;
+    bool chunked = !conn->http10;
+    bool keepAlive = conn->keepAlive;
+    HttpServerImpl* impl = this;
 
-        DWORD ret = ::HttpReceiveHttpRequest(
-            m_reqQueue,         // Req Queue
-            requestId,          // Req ID
-            0,                  // Flags
-            pRequest,           // HTTP request buffer
-            RequestBufferLength,// req buffer length
-            &bytesRead,         // bytes received
-            NULL                // LPOVERLAPPED
-        );
+    pool.start([=]() {
+        if (!*alive) return;
 
-        if (NO_ERROR == ret)
+        std::wstring filePath;
+        if (impl->callback->onFileRequest(absPath, filePath))
         {
-            switch (pRequest->Verb)
-            {
-            case HttpVerbGET:
-            {
-                //m_callback->onLog(HSLOG_INFO_LEVEL, logFormat("Got a GET request for %ws",
-                //    pRequest->CookedUrl.pFullUrl));
+            QString file = QString::fromStdWString(filePath);
+            QMetaObject::invokeMethod(impl->context, [=]() {
+                if (*alive) impl->startFile(conn, file);
+            }, Qt::QueuedConnection);
+            return;
+        }
 
-                DWORD statusCode = 200;
-                std::string respDataUTF8("");
-                m_callback->onGetRequest(pRequest->CookedUrl.pAbsPath, statusCode, respDataUTF8);
-                ret = response(m_reqQueue, pRequest, statusCode, "OK", respDataUTF8.c_str());
-            }
-                break;
-            case HttpVerbPOST:
-            {
-                m_callback->onLog(HSLOG_INFO_LEVEL, logFormat("Got a POST request for %ws",
-                    pRequest->CookedUrl.pFullUrl));
+        DWORD statusCode = 200;
+        HttpChunkWriter writer(impl, conn, alive, &statusCode, headOnly, chunked, keepAlive);
+        if (impl->callback->onChunkedRequest(absPath, statusCode, &writer))
+        {
+            writer.finish();
+            return;
+        }
 
-                // todo
+        statusCode = 200;
+        std::string respDataUTF8("");
+        impl->callback->onGetRequest(absPath, statusCode, respDataUTF8);
+        QByteArray body(respDataUTF8.data(), (int)respDataUTF8.size());
+        QMetaObject::invokeMethod(impl->context, [=]() {
+            if (*alive) impl->sendResponse(conn, (int)statusCode, body);
+        }, Qt::QueuedConnection);
+    });
+}
 
-                assert(false);
-            }
-                break;
-            default:
-            {
-                m_callback->onLog(HSLOG_INFO_LEVEL, logFormat("Got a POST request for %ws, verb: %d",
-                    pRequest->CookedUrl.pFullUrl, pRequest->Verb));
+void HttpServerImpl::sendHeader(HttpConnection* conn, int statusCode, const QByteArray& contentType, qint64 contentLength)
+{
+    QByteArray header = "HTTP/1.1 " + QByteArray::number(statusCode) + " " + reasonPhrase(statusCode) + "\r\n";
+    header += "Content-Type: " + contentType + "\r\n";
+    header += "Content-Length: " + QByteArray::number(contentLength) + "\r\n";
+    header += conn->keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    header += "\r\n";
+    conn->socket->write(header);
+}
 
-                ret = response(m_reqQueue, pRequest, 503, "Not Implemented", NULL);
-            }
-                break;
-            }
+void HttpServerImpl::sendResponse(HttpConnection* conn, int statusCode, const QByteArray& body)
+{
+    sendHeader(conn, statusCode, "text/html", body.size());
+    if (!conn->headOnly)
+    {
+        conn->socket->write(body);
+    }
+    finishResponse(conn);
+}
 
-            if (NO_ERROR != ret)
-            {
-                break;
-            }
+void HttpServerImpl::sendError(HttpConnection* conn, int statusCode)
+{
+    sendResponse(conn, statusCode, QByteArray(reasonPhrase(statusCode)));
+}
+
+void HttpServerImpl::startFile(HttpConnection* conn, const QString& filePath)
+{
+    QFile* file = new QFile(filePath);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        callback->onLog(HSLOG_WARNING_LEVEL, logFormat("Open file failed: %s", filePath.toUtf8().constData()));
+        delete file;
+        sendError(conn, 404);
+        return;
+    }
+
+    qint64 size = file->size();
+    sendHeader(conn, 200, contentTypeOf(filePath), size);
+    if (conn->headOnly || 0 == size)
+    {
+        delete file;
+        finishResponse(conn);
+        return;
+    }
+
+    // 映射后直接把映射区交给 socket，省去先读进堆缓冲的一次拷贝；映射失败时退回分段 read
+    conn->file = file;
+    conn->map = file->map(0, size);
+    conn->fileOffset = 0;
+    conn->fileSize = size;
+    pumpFile(conn);
+}
 
-            //
-            // Reset the Request ID to handle the next request.
-            //
-            HTTP_SET_NULL_ID(&requestId);
+void HttpServerImpl::pumpFile(HttpConnection* conn)
+{
+    while (conn->fileOffset < conn->fileSize && conn->socket->bytesToWrite() < kWriteHighWater)
+    {
+        qint64 len = qMin(kFileSliceBytes, conn->fileSize - conn->fileOffset);
+        if (conn->map)
+        {
+            conn->socket->write((const char*)conn->map + conn->fileOffset, len);
         }
-        else if (ERROR_MORE_DATA == ret)
+        else
         {
-            //
-            // The input buffer was too small to hold the request
-            // headers. Increase the buffer size and call the 
-            // API again. 
-            //
-            // When calling the API again, handle the request
-            // that failed by passing a RequestID.
-            //
-            // This RequestID is read from the old buffer.
-            //
-            requestId = pRequest->RequestId;
-
-            //
-            // Free the old buffer and allocate a new buffer.
-            //
-            RequestBufferLength = bytesRead;
-            FREE_MEM(pRequestBuffer);
-            pRequestBuffer = (PCHAR)ALLOC_MEM(RequestBufferLength);
-
-            if (pRequestBuffer == NULL)
+            QByteArray slice = conn->file->read(len);
+            if (slice.isEmpty())
             {
-                m_callback->onLog(HSLOG_ERROR_LEVEL, "Out of memory");
-                break;
+                // 文件被截断，已声明的长度无法满足，只能断开
+                closeFile(conn);
+                conn->socket->abort();
+                return;
             }
+            conn->socket->write(slice);
+            len = slice.size();
+        }
+        conn->fileOffset += len;
+    }
 
-            pRequest = (PHTTP_REQUEST)pRequestBuffer;
+    if (conn->fileOffset >= conn->fileSize)
+    {
+        closeFile(conn);
+        finishResponse(conn);
+    }
+}
 
-        }
-        else if (ERROR_CONNECTION_INVALID == ret && !HTTP_IS_NULL_ID(&requestId))
-        {
-            // The TCP connection was corrupted by the peer when
-            // attempting to handle a request with more buffer. 
-            // Continue to the next request.
-            HTTP_SET_NULL_ID(&requestId);
-        }
-        else
+void HttpServerImpl::closeFile(HttpConnection* conn)
+{
+    if (conn->file)
+    {
+        if (conn->map)
         {
-            break;
+            conn->file->unmap(conn->map);
         }
+        delete conn->file;
     }
+    conn->file = NULL;
+    conn->map = NULL;
+    conn->fileOffset = 0;
+    conn->fileSize = 0;
+}
 
-    if (pRequestBuffer)
+void HttpServerImpl::finishResponse(HttpConnection* conn)
+{
+    conn->busy = false;
+    if (!conn->keepAlive)
     {
-        FREE_MEM(pRequestBuffer);
-        pRequestBuffer = NULL;
+        // 待发数据写完后才真正断开
+        conn->socket->disconnectFromHost();
+        return;
     }
+
+    // 同一连接上流水线发来的下一个请求
+    processNext(conn);
 }
 
-DWORD HttpServer::response(HANDLE hReqQueue, void* request, USHORT statusCode, const char* pReason, const char* pEntityString)
+void HttpServerImpl::closeConnection(HttpConnection* conn)
 {
-    PHTTP_REQUEST pRequest = reinterpret_cast<PHTTP_REQUEST>(request);
-
-    //
-    // Initialize the HTTP response structure.
-    //
-    HTTP_RESPONSE resp;
-    INITIALIZE_HTTP_RESPONSE(&resp, statusCode, pReason);
-
-    //
-    // Add a known header.
-    //
-    ADD_KNOWN_HEADER(resp, HttpHeaderContentType, "text/html");
-
-    HTTP_DATA_CHUNK dataChunk;
-    if (pEntityString)
-    {
-        // 
-        // Add an entity chunk.
-        //
-        dataChunk.DataChunkType = HttpDataChunkFromMemory;
-        dataChunk.FromMemory.pBuffer = const_cast<char*>(pEntityString);
-        dataChunk.FromMemory.BufferLength =
-            (ULONG)strlen(pEntityString);
-
-        resp.EntityChunkCount = 1;
-        resp.pEntityChunks = &dataChunk;
-    }
-
-    // 
-    // Because the entity body is sent in one call, it is not
-    // required to specify the Content-Length.
-    //
-    DWORD bytesSent = 0;
-    DWORD ret = HttpSendHttpResponse(
-        hReqQueue,           // ReqQueueHandle
-        pRequest->RequestId, // Request ID
-        0,                   // Flags
-        &resp,               // HTTP response
-        NULL,                // pReserved1
-        &bytesSent,          // bytes sent  (OPTIONAL)
-        NULL,                // pReserved2  (must be NULL)
-        0,                   // Reserved3   (must be 0)
-        NULL,                // LPOVERLAPPED(OPTIONAL)
-        NULL                 // pReserved4  (must be NULL)
-    );
-    if (NO_ERROR != ret)
-    {
-        m_callback->onLog(HSLOG_ERROR_LEVEL, logFormat("HttpSendHttpResponse failed: %lu", ret));
+    if (!connections.contains(conn->socket)) return;
+    connections.remove(conn->socket);
+
+    *conn->alive = false;
+    closeFile(conn);
+    callback->onClose(conn->id);
+    conn->socket->deleteLater();
+    delete conn;
+}
+
+/**************************************************************************/
+
+HttpServer::HttpServer(IHttpServerCallback* callback)
+    : m_callback(callback)
+    , m_impl()
+    , m_urls()
+    , m_workerCount(QThread::idealThreadCount())
+{
+    assert(m_callback);
+}
+
+HttpServer::~HttpServer()
+{
+    close();
+}
+
+void HttpServer::setWorkerCount(int count)
+{
+    m_workerCount = count > 0 ? count : 1;
+}
+
+DWORD HttpServer::listen(const std::vector<std::wstring>& urls)
+{
+    m_callback->onLog(HSLOG_INFO_LEVEL, "Http server listen");
+
+    if (m_impl)
+    {
+        assert(false);  // 不支持重入
+        m_callback->onLog(HSLOG_ERROR_LEVEL, "Do not support reentry");
+        return ERROR_INVALID_ACCESS;
+    }
+
+    if (0 == urls.size())
+    {
+        m_callback->onLog(HSLOG_ERROR_LEVEL, "No url to listen");
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    m_impl.reset(new HttpServerImpl(m_callback));
+    m_impl->pool.setMaxThreadCount(m_workerCount);
+    m_impl->thread.setObjectName("HttpServerIO");
+    m_impl->thread.start();
+    m_impl->context = new QObject;
+    m_impl->context->moveToThread(&m_impl->thread);
+
+    DWORD ret = ERROR_SUCCESS;
+    HttpServerImpl* impl = m_impl.get();
+    QMetaObject::invokeMethod(impl->context, [impl, &urls, &ret]() {
+        ret = impl->open(urls);
+    }, Qt::BlockingQueuedConnection);
+
+    if (ERROR_SUCCESS != ret)
+    {
+        close();
         return ret;
     }
 
-    return ret;
+    m_urls = urls;
+    return ERROR_SUCCESS;
+}
+
+void HttpServer::close()
+{
+    if (!m_impl)
+    {
+        return;
+    }
+
+    // 不能在 I/O 线程（例如 onClose 回调）里调用
+    m_callback->onLog(HSLOG_INFO_LEVEL, "Http server close");
+
+    HttpServerImpl* impl = m_impl.get();
+    QMetaObject::invokeMethod(impl->context, [impl]() {
+        impl->shutdown();
+    }, Qt::BlockingQueuedConnection);
+
+    // 连接都已失效，工作线程里剩余的回调执行完后投递的结果会被丢弃
+    impl->pool.waitForDone();
+    impl->thread.quit();
+    impl->thread.wait();
+    delete impl->context;
+    impl->context = NULL;
+
+    m_impl.reset();
+    m_urls.clear();
+}
+
+std::vector<unsigned short> HttpServer::ports() const
+{
+    std::vector<unsigned short> result;
+    if (m_impl)
+    {
+        for (QTcpServer* server : m_impl->servers)
+        {
+            result.push_back(server->serverPort());
+        }
+    }
+    return result;
 }
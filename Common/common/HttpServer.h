@@ -3,8 +3,19 @@
 
 #include <vector>
 #include <memory>
-#include <thread>
 #include <string>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+typedef uint32_t DWORD;
+typedef uint64_t ULONGLONG;
+#define ERROR_SUCCESS           0L
+#define ERROR_ACCESS_DENIED     5L
+#define ERROR_INVALID_ACCESS    12L
+#define ERROR_INVALID_PARAMETER 87L
+#endif
 
 /**************************************************************************/
 
@@ -16,6 +27,15 @@ enum HSLogLevel
     HSLOG_ERROR_LEVEL = 3,
 };
 
+// 分块响应的写入端，write 返回 false 表示连接已断开，应停止生成
+class IHttpChunkWriter
+{
+public:
+    virtual ~IHttpChunkWriter() {}
+    virtual bool write(const std::string& chunk) = 0;
+};
+
+// 回调在工作线程池中执行，worker 数大于 1 时可能并发调用
 class IHttpServerCallback
 {
 public:
@@ -23,25 +43,39 @@ public:
     virtual void onGetRequest(const std::wstring& absPath, DWORD& statusCode, std::string& respDataUTF8) = 0;
     virtual void onLog(HSLogLevel level, const std::string& content) = 0;
     virtual void onClose(ULONGLONG requestId) = 0;
+
+    // 可选：返回 true 时以本地文件 filePath 作为响应体（内存映射后分段发送）
+    virtual bool onFileRequest(const std::wstring& absPath, std::wstring& filePath) { return false; }
+    // 可选：返回 true 时表示已通过 writer 以 chunked 编码输出了响应体，
+    // 状态码在第一次 write 时发出
+    virtual bool onChunkedRequest(const std::wstring& absPath, DWORD& statusCode, IHttpChunkWriter* writer) { return false; }
 };
 
+struct HttpServerImpl;
+
+// 基于 QTcpServer 的嵌入式 HTTP/1.1 服务：一个 I/O 线程负责收发（keep-alive、按连接顺序应答），
+// 回调放到工作线程池执行，不再依赖 HTTP.sys，Linux 下同样可用
+
 class HttpServer
 {
 public:
     explicit HttpServer(IHttpServerCallback* callback);
     ~HttpServer();
 
+    // urls 沿用 HTTP.sys 的前缀写法，例如 http://127.0.0.1:8080/ 、http://+:8080/api/
     DWORD listen(const std::vector<std::wstring>& urls);
     void close();
-private:
-    void handle();
 
-    DWORD response(HANDLE hReqQueue, void* request, USHORT StatusCode, const char* pReason, const char* pEntityString);
+    // 须在 listen 之前设置，默认 CPU 核数；设为 1 即与旧实现一样串行回调
+    void setWorkerCount(int count);
+    // listen 成功后实际监听的端口（url 中端口为 0 时由系统分配）
+    std::vector<unsigned short> ports() const;
+
 private:
     IHttpServerCallback* m_callback;
-    HANDLE m_reqQueue;
-    std::unique_ptr<std::thread> m_thread;
+    std::unique_ptr<HttpServerImpl> m_impl;
     std::vector<std::wstring> m_urls;
+    int m_workerCount;
 };
 
 #endif /* __HTTPSERVER_H__ */
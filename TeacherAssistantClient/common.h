@@ -1,4 +1,6 @@
 #pragma once
+#include "TaEndpoints.h"
+
 #define TAC_VERSION 1.0
 
 #define TAC_ICON_TEXT "TeacherAssistantClient"
@@ -7,7 +9,8 @@
 #define TAC_CONFIG_FILE "tac-config.json"
 #define TAC_APP_ICON QIcon(":/res/img/logo.ico")
 
-#define TAC_SERVER_URL "http://47.100.126.194"
+// server base URL, from the endpoint registry (TA_SERVER_URL / TaFakeServer)
+#define TAC_SERVER_URL TaEndpoints::baseUrl()
 #define HJ_URL_UPDATE HJ_SERVER_URL"/service/v10/updater"
 #define TAC_AES_KEY "evGel4wHMqzOVxJj6k8gKwODBrzSAvKo"
 
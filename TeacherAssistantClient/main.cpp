@@ -11,6 +11,8 @@
 #include <QSslConfiguration>
 #include "common.h"
 #include "TACApp.h"
+#include "TaEndpoints.h"
+#include "TaFakeServer.h"
 #ifdef _WIN32
 #include <windows.h>
 #include <filesystem>
@@ -166,6 +168,9 @@ int main(int argc, char* argv[])
 	qInstallMessageHandler(customLogHandler);
 	qInfo() << "teacher assistant start ,current version is  " << TAC_VERSION;
 	TACApp program(argc, argv);
+	// TA_SERVER_URL 指定服务端；TA_FAKE_SERVER=1 时改用进程内替身服务（压测/离线调试）
+	TaEndpoints::initFromEnvironment();
+	TaFakeServer::installFromEnvironment(&program);
 	QFile qssFile(":/res/css/main.css");
 	if (qssFile.open(QFile::ReadOnly))
 	{